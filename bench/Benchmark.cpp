@@ -0,0 +1,547 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "DataGenerator.h"
+#include "database/ChangeStream.h"
+#include "database/Database.h"
+#include "database/Table.h"
+#include "database/ValidationPlan.h"
+
+// Synthetic benchmark suite for the engine. Every benchmark runs at each
+// requested scale (number of Orders rows, or operations for micro benchmarks)
+// and reports one JSON object per (benchmark, scale) on stdout or a file.
+//
+// Usage: RelationalDatabaseBench [--scales 1e3,1e4,1e5] [--repetitions N]
+//                                [--filter SUBSTRING] [--output FILE]
+
+// Timings of one benchmark at one scale
+struct BenchmarkResult {
+    std::string name;
+    size_t scale = 0;
+    size_t operations = 0;        // work items per repetition (rows, lookups, statements)
+    std::vector<double> samplesMs;
+};
+
+// Times repetitions of a benchmark body; setup outside measure() is not timed
+class Sampler {
+public:
+    Sampler(BenchmarkResult& result, size_t repetitions) : result(result), repetitions(repetitions) {}
+
+    size_t getRepetitions() const { return repetitions; }
+
+    // Run 'body' once and record its duration; body returns the operations it performed
+    void measure(const std::function<size_t()>& body) {
+        auto start = std::chrono::steady_clock::now();
+        size_t operations = body();
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        result.samplesMs.push_back(elapsed.count());
+        result.operations = operations;
+    }
+
+private:
+    BenchmarkResult& result;
+    size_t repetitions;
+};
+
+// Generated rows for one scale, kept across benchmarks so generation is paid once
+struct Dataset {
+    size_t scale;
+    std::vector<DataGenerator::Record> customers;
+    std::vector<DataGenerator::Record> products;
+    std::vector<DataGenerator::Record> orders;
+
+    explicit Dataset(size_t scale) : scale(scale) {
+        DataGenerator generator;
+        size_t dimensionRows = std::max<size_t>(scale / 10, 1);
+        customers = generator.customers(dimensionRows);
+        products = generator.products(dimensionRows);
+        orders = generator.orders(scale, dimensionRows);
+    }
+};
+
+static const size_t insertBatchSize = 1000;
+
+// Results are written here so the compiler cannot discard the measured work
+static volatile size_t sink;
+
+// Stream buffer that drops everything written to it
+class NullBuffer : public std::streambuf {
+protected:
+    int overflow(int c) override { return c; }
+};
+
+static void insertRows(Database& db, const std::string& table, const std::vector<DataGenerator::Record>& rows,
+                       size_t batchSize = insertBatchSize) {
+    for (size_t begin = 0; begin < rows.size(); begin += batchSize) {
+        size_t end = std::min(begin + batchSize, rows.size());
+        db.executeQuery(DataGenerator::insertQuery(table, rows, begin, end));
+    }
+}
+
+// Create the schemas and load the dimension tables; Orders is loaded only if asked
+static void loadDatabase(Database& db, const Dataset& data, bool withOrders) {
+    db.executeStatement(DataGenerator::customersSchema());
+    db.executeStatement(DataGenerator::productsSchema());
+    db.executeStatement(DataGenerator::ordersSchema());
+    insertRows(db, "CUSTOMERS", data.customers);
+    insertRows(db, "PRODUCTS", data.products);
+    if (withOrders) {
+        insertRows(db, "ORDERS", data.orders);
+    }
+}
+
+static size_t runSelect(Database& db, const std::string& sql) {
+    SQLParser::Query query = SQLParser::parse(sql);
+    SelectPlan plan = db.planSelectQuery(query);
+    return db.executeSelectPlan(plan).size();
+}
+
+// Micro: type and constraint validation of one column's values
+static void benchValidation(const Dataset& data, const std::string& table, const std::string& column, Sampler& sampler) {
+    Database db;
+    loadDatabase(db, data, false);
+    const ValidationPlan::ColumnRule* rule = db.getTable(table)->getValidationPlan().findColumn(column);
+
+    const auto& rows = table == "ORDERS" ? data.orders : table == "CUSTOMERS" ? data.customers : data.products;
+    std::vector<std::string> values;
+    for (size_t i = 0; i < data.scale; ++i) {
+        values.push_back(rows[i % rows.size()].at(column));
+    }
+
+    for (size_t r = 0; r < sampler.getRepetitions(); ++r) {
+        sampler.measure([&] {
+            size_t failures = 0;
+            for (const auto& value : values) {
+                failures += ValidationPlan::check(*rule, value) != nullptr;
+            }
+            if (failures != 0) {
+                throw std::runtime_error("Generated value failed validation: " + column);
+            }
+            return values.size();
+        });
+    }
+}
+
+// Micro: statements parsed per second
+static void benchParser(const Dataset& data, bool insert, Sampler& sampler) {
+    std::vector<std::string> statements;
+    for (size_t i = 0; i < data.scale; ++i) {
+        const auto& order = data.orders[i];
+        if (insert) {
+            statements.push_back("INSERT INTO Orders ( OrderID , CustomerID , OrderDate , TotalAmount ) VALUES ( " +
+                                 order.at("ORDERID") + " , " + order.at("CUSTOMERID") + " , '" + order.at("ORDERDATE") +
+                                 "' , " + order.at("TOTALAMOUNT") + " );");
+        } else {
+            statements.push_back("SELECT OrderID , TotalAmount FROM Orders WHERE CustomerID = " + order.at("CUSTOMERID") +
+                                 " AND TotalAmount > " + order.at("TOTALAMOUNT") + " ;");
+        }
+    }
+
+    for (size_t r = 0; r < sampler.getRepetitions(); ++r) {
+        sampler.measure([&] {
+            size_t fields = 0;
+            for (const auto& sql : statements) {
+                fields += SQLParser::parse(sql).fields.size();
+            }
+            sink = fields;
+            return statements.size();
+        });
+    }
+}
+
+// Micro: WHERE evaluation per row; the predicates match nothing so no rows are materialized
+static void benchPredicate(const Dataset& data, const std::string& where, Sampler& sampler) {
+    Database db;
+    loadDatabase(db, data, true);
+    Table* orders = db.getTable("ORDERS");
+    SQLParser::Query query = SQLParser::parse("SELECT OrderID FROM Orders WHERE " + where + " ;");
+
+    for (size_t r = 0; r < sampler.getRepetitions(); ++r) {
+        sampler.measure([&] {
+            sink = orders->scanRowIds(Predicate::compile(query.conditions), {}).size();
+            return orders->getRecords().size();
+        });
+    }
+}
+
+// Micro: primary key probes, hits and misses interleaved
+static void benchPrimaryKeyLookup(const Dataset& data, Sampler& sampler) {
+    Database db;
+    loadDatabase(db, data, true);
+    Table* orders = db.getTable("ORDERS");
+
+    std::mt19937_64 random(7);
+    std::uniform_int_distribution<size_t> id(1, data.scale * 2);
+    std::vector<std::string> keys;
+    for (size_t i = 0; i < data.scale; ++i) {
+        keys.push_back(std::to_string(id(random)));
+    }
+
+    for (size_t r = 0; r < sampler.getRepetitions(); ++r) {
+        sampler.measure([&] {
+            size_t hits = 0;
+            for (const auto& key : keys) {
+                hits += orders->containsKey("ORDERID", key);
+            }
+            sink = hits;
+            return keys.size();
+        });
+    }
+}
+
+// Macro: load Orders in INSERT batches through the executor, constraints included
+static void benchBulkInsert(const Dataset& data, Sampler& sampler) {
+    for (size_t r = 0; r < sampler.getRepetitions(); ++r) {
+        Database db;
+        loadDatabase(db, data, false);
+        sampler.measure([&] {
+            insertRows(db, "ORDERS", data.orders);
+            return data.orders.size();
+        });
+    }
+}
+
+// Macro: load Orders one row per INSERT, as an application inserting rows
+// as they arrive does
+static void benchSingleRowInsert(const Dataset& data, Sampler& sampler) {
+    for (size_t r = 0; r < sampler.getRepetitions(); ++r) {
+        Database db;
+        loadDatabase(db, data, false);
+        sampler.measure([&] {
+            insertRows(db, "ORDERS", data.orders, 1);
+            return data.orders.size();
+        });
+    }
+}
+
+// Macro: bulk_insert with every row change appended to a change stream file
+static void benchBulkInsertCaptured(const Dataset& data, Sampler& sampler) {
+    std::string path = (std::filesystem::temp_directory_path() / "reldb_bench_changes.jsonl").string();
+    for (size_t r = 0; r < sampler.getRepetitions(); ++r) {
+        std::remove(path.c_str());
+        ChangeStream stream;
+        stream.openFile(path);
+            Database db;
+        loadDatabase(db, data, false);
+        db.setChangeStream(&stream);
+        sampler.measure([&] {
+            insertRows(db, "ORDERS", data.orders);
+            return data.orders.size();
+        });
+        db.setChangeStream(nullptr);
+    }
+    std::remove(path.c_str());
+}
+
+// Macro: SELECT through the planner and executor; reports rows scanned
+static void benchSelect(const Dataset& data, const std::string& sql, Sampler& sampler) {
+    Database db;
+    loadDatabase(db, data, true);
+    for (size_t r = 0; r < sampler.getRepetitions(); ++r) {
+        sampler.measure([&] {
+            sink = runSelect(db, sql);
+            return data.orders.size();
+        });
+    }
+}
+
+// Macro: substring search over product descriptions, optionally through a
+// trigram index. The term is the longest word of one description, so it is rare.
+static void benchLikeSearch(const Dataset& data, bool indexed, Sampler& sampler) {
+    Database db;
+    loadDatabase(db, data, false);
+    if (indexed) {
+        db.executeStatement("CREATE INDEX ProductDescription ON Products ( Description ) USING TRIGRAM ;");
+    }
+    const std::string& description = data.products[data.products.size() / 2].at("DESCRIPTION");
+    std::string term;
+    std::istringstream words(description);
+    for (std::string word; words >> word;) {
+        term = word.size() > term.size() ? word : term;
+    }
+    std::string sql = "SELECT ProductID FROM Products WHERE Description LIKE '%" + term + "%' ;";
+    for (size_t r = 0; r < sampler.getRepetitions(); ++r) {
+        sampler.measure([&] {
+            sink = runSelect(db, sql);
+            return data.products.size();
+        });
+    }
+}
+
+// Macro: a dashboard query re-run against unchanged tables, answered from
+// the result cache after the first run
+static void benchCachedSelect(const Dataset& data, const std::string& sql, Sampler& sampler) {
+    Database db;
+    loadDatabase(db, data, true);
+    db.setOutput(nullptr);
+    db.setResultCacheLimit(size_t(64) << 20);
+    SQLParser::Query query = SQLParser::parse(sql);
+    db.executeQuery(query);
+    for (size_t r = 0; r < sampler.getRepetitions(); ++r) {
+        sampler.measure([&] {
+            db.executeQuery(query);
+            sink = db.getLastRowsAffected();
+            return data.orders.size();
+        });
+    }
+}
+
+static const char* customerTotalsView =
+    "CREATE MATERIALIZED VIEW CustomerTotals AS SELECT CustomerID , COUNT(*) , SUM(TotalAmount) FROM Orders "
+    "GROUP BY CustomerID ;";
+
+// Macro: the group_by report read from a materialized view of the aggregate
+static void benchViewSelect(const Dataset& data, Sampler& sampler) {
+    Database db;
+    loadDatabase(db, data, true);
+    db.setOutput(nullptr);
+    db.executeStatement(customerTotalsView);
+    for (size_t r = 0; r < sampler.getRepetitions(); ++r) {
+        sampler.measure([&] {
+            sink = runSelect(db, "SELECT CustomerID , COUNT , SUM_TOTALAMOUNT FROM CustomerTotals "
+                                 "ORDER BY SUM_TOTALAMOUNT DESC LIMIT 10 ;");
+            return data.orders.size();
+        });
+    }
+}
+
+// Macro: bulk_insert with that view kept current batch by batch
+static void benchViewMaintenance(const Dataset& data, Sampler& sampler) {
+    for (size_t r = 0; r < sampler.getRepetitions(); ++r) {
+        Database db;
+        loadDatabase(db, data, false);
+        db.setOutput(nullptr);
+        db.executeStatement(customerTotalsView);
+        sampler.measure([&] {
+            insertRows(db, "ORDERS", data.orders);
+            return data.orders.size();
+        });
+    }
+}
+
+// Macro: UPDATE or DELETE against a freshly loaded table each repetition
+static void benchModify(const Dataset& data, const std::string& sql, Sampler& sampler) {
+    SQLParser::Query query = SQLParser::parse(sql);
+    for (size_t r = 0; r < sampler.getRepetitions(); ++r) {
+        Database db;
+        loadDatabase(db, data, true);
+        sampler.measure([&] {
+            db.executeQuery(query);
+            return data.orders.size();
+        });
+    }
+}
+
+struct Benchmark {
+    std::string name;
+    std::function<void(const Dataset&, Sampler&)> run;
+};
+
+static std::vector<Benchmark> allBenchmarks() {
+    return {
+        {"micro/validate/int", [](const Dataset& d, Sampler& s) { benchValidation(d, "ORDERS", "ORDERID", s); }},
+        {"micro/validate/double", [](const Dataset& d, Sampler& s) { benchValidation(d, "ORDERS", "TOTALAMOUNT", s); }},
+        {"micro/validate/datetime", [](const Dataset& d, Sampler& s) { benchValidation(d, "ORDERS", "ORDERDATE", s); }},
+        {"micro/validate/varchar", [](const Dataset& d, Sampler& s) { benchValidation(d, "CUSTOMERS", "EMAIL", s); }},
+        {"micro/parse/select", [](const Dataset& d, Sampler& s) { benchParser(d, false, s); }},
+        {"micro/parse/insert", [](const Dataset& d, Sampler& s) { benchParser(d, true, s); }},
+        {"micro/predicate/numeric", [](const Dataset& d, Sampler& s) { benchPredicate(d, "TotalAmount > 1000000", s); }},
+        {"micro/predicate/string", [](const Dataset& d, Sampler& s) { benchPredicate(d, "OrderDate = 'never'", s); }},
+        {"micro/predicate/and_or", [](const Dataset& d, Sampler& s) {
+             benchPredicate(d, "TotalAmount < 0 AND CustomerID = 1 OR OrderID = 0", s);
+         }},
+        {"micro/predicate/like", [](const Dataset& d, Sampler& s) { benchPredicate(d, "OrderDate LIKE '%never%'", s); }},
+        {"micro/predicate/in_list", [](const Dataset& d, Sampler& s) {
+             // 100 amounts no order has (they have two decimals), spread over the range zone maps see
+             std::string list;
+             for (int i = 0; i < 100; ++i) {
+                 list += (i == 0 ? "" : " , ") + std::to_string(i * 10) + ".005";
+             }
+             benchPredicate(d, "TotalAmount IN ( " + list + " )", s);
+         }},
+        {"micro/pk_lookup", benchPrimaryKeyLookup},
+        {"macro/bulk_insert", benchBulkInsert},
+        {"macro/bulk_insert_cdc", benchBulkInsertCaptured},
+        {"macro/single_row_insert", benchSingleRowInsert},
+        {"macro/filtered_scan", [](const Dataset& d, Sampler& s) {
+             benchSelect(d, "SELECT OrderID , TotalAmount FROM Orders WHERE TotalAmount > 900 ;", s);
+         }},
+        {"macro/range_scan", [](const Dataset& d, Sampler& s) {
+             // The most recent 1% of orders: a time-range query over an append-mostly table
+             const std::string& since = d.orders[d.scale - std::max<size_t>(d.scale / 100, 1)].at("ORDERDATE");
+             benchSelect(d, "SELECT OrderID , TotalAmount FROM Orders WHERE OrderDate >= '" + since + "' ;", s);
+         }},
+        {"macro/like_search", [](const Dataset& d, Sampler& s) { benchLikeSearch(d, false, s); }},
+        {"macro/like_search_trigram", [](const Dataset& d, Sampler& s) { benchLikeSearch(d, true, s); }},
+        {"macro/join", [](const Dataset& d, Sampler& s) {
+             benchSelect(d, "SELECT Orders.OrderID , Customers.Email FROM Orders INNER JOIN Customers ON "
+                            "Orders.CustomerID = Customers.CustomerID WHERE Orders.TotalAmount > 900 ;", s);
+         }},
+        {"macro/join_all", [](const Dataset& d, Sampler& s) {
+             benchSelect(d, "SELECT COUNT(*) FROM Orders INNER JOIN Customers ON "
+                            "Orders.CustomerID = Customers.CustomerID ;", s);
+         }},
+        {"macro/band_join", [](const Dataset& d, Sampler& s) {
+             // Orders priced below each of ten products: a range of the sorted amounts per product
+             benchSelect(d, "SELECT COUNT(*) FROM Products INNER JOIN Orders ON Orders.TotalAmount < Products.Price "
+                            "WHERE Products.ProductID <= 10 ;", s);
+         }},
+        {"macro/group_by", [](const Dataset& d, Sampler& s) {
+             benchSelect(d, "SELECT CustomerID , COUNT(*) , SUM(TotalAmount) FROM Orders GROUP BY CustomerID "
+                            "ORDER BY SUM(TotalAmount) DESC LIMIT 10 ;", s);
+         }},
+        {"macro/group_by_cached", [](const Dataset& d, Sampler& s) {
+             benchCachedSelect(d, "SELECT CustomerID , COUNT(*) , SUM(TotalAmount) FROM Orders GROUP BY CustomerID "
+                                  "ORDER BY SUM(TotalAmount) DESC LIMIT 10 ;", s);
+         }},
+        {"macro/group_by_view", benchViewSelect},
+        {"macro/bulk_insert_view", benchViewMaintenance},
+        {"macro/update", [](const Dataset& d, Sampler& s) {
+             benchModify(d, "UPDATE Orders SET TotalAmount = 1.00 WHERE OrderID <= " + std::to_string(d.scale / 10) + " ;", s);
+         }},
+        {"macro/delete", [](const Dataset& d, Sampler& s) {
+             benchModify(d, "DELETE FROM Orders WHERE OrderID > " + std::to_string(d.scale - d.scale / 10) + " ;", s);
+         }},
+    };
+}
+
+static std::string jsonEscape(const std::string& text) {
+    std::string escaped;
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            escaped += '\\';
+        }
+        escaped += c;
+    }
+    return escaped;
+}
+
+static void writeJson(std::ostream& out, const std::vector<BenchmarkResult>& results, size_t repetitions) {
+    out << "{\n";
+    out << "  \"suite\": \"RelationalDatabaseBench\",\n";
+#ifdef __VERSION__
+    out << "  \"compiler\": \"" << jsonEscape(__VERSION__) << "\",\n";
+#endif
+#ifdef NDEBUG
+    out << "  \"assertions\": false,\n";
+#else
+    out << "  \"assertions\": true,\n";
+#endif
+    out << "  \"repetitions\": " << repetitions << ",\n";
+    out << "  \"results\": [";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const BenchmarkResult& result = results[i];
+        std::vector<double> sorted = result.samplesMs;
+        std::sort(sorted.begin(), sorted.end());
+        double median = sorted[sorted.size() / 2];
+        double nsPerOp = result.operations ? median * 1e6 / result.operations : 0.0;
+
+        out << (i ? "," : "") << "\n    {\"name\": \"" << jsonEscape(result.name) << "\""
+            << ", \"scale\": " << result.scale
+            << ", \"operations\": " << result.operations
+            << ", \"min_ms\": " << sorted.front()
+            << ", \"median_ms\": " << median
+            << ", \"max_ms\": " << sorted.back()
+            << ", \"ns_per_op\": " << nsPerOp
+            << ", \"ops_per_sec\": " << (median > 0 ? result.operations * 1e3 / median : 0.0)
+            << ", \"samples_ms\": [";
+        for (size_t s = 0; s < result.samplesMs.size(); ++s) {
+            out << (s ? ", " : "") << result.samplesMs[s];
+        }
+        out << "]}";
+    }
+    out << "\n  ]\n}\n";
+}
+
+static std::vector<size_t> parseScales(const std::string& list) {
+    std::vector<size_t> scales;
+    std::stringstream stream(list);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        double scale = std::stod(item); // accepts 1e5 as well as 100000
+        if (scale < 1 || scale > 1e7) {
+            throw std::invalid_argument("Scale must be between 1 and 1e7: " + item);
+        }
+        scales.push_back(static_cast<size_t>(scale));
+    }
+    return scales;
+}
+
+int main(int argc, char* argv[]) {
+    std::vector<size_t> scales = {1000, 10000, 100000};
+    size_t repetitions = 5;
+    std::string filter;
+    std::string outputPath;
+
+    try {
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (arg == "--scales" && i + 1 < argc) {
+                scales = parseScales(argv[++i]);
+            } else if (arg == "--repetitions" && i + 1 < argc) {
+                repetitions = std::max(1, std::stoi(argv[++i]));
+            } else if (arg == "--filter" && i + 1 < argc) {
+                filter = argv[++i];
+            } else if (arg == "--output" && i + 1 < argc) {
+                outputPath = argv[++i];
+            } else {
+                std::cerr << "Usage: " << argv[0]
+                          << " [--scales 1e3,1e4,...] [--repetitions N] [--filter SUBSTRING] [--output FILE]" << std::endl;
+                return 1;
+            }
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Invalid argument: " << e.what() << std::endl;
+        return 1;
+    }
+
+    // The engine reports to std::cout; silence it while benchmarks run
+    NullBuffer discarded;
+    std::streambuf* console = std::cout.rdbuf(&discarded);
+
+    std::vector<BenchmarkResult> results;
+    for (size_t scale : scales) {
+        std::cerr << "Generating data for scale " << scale << "..." << std::endl;
+        Dataset data(scale);
+        for (const Benchmark& benchmark : allBenchmarks()) {
+            if (!filter.empty() && benchmark.name.find(filter) == std::string::npos) {
+                continue;
+            }
+            std::cerr << "  " << benchmark.name << std::endl;
+            BenchmarkResult result;
+            result.name = benchmark.name;
+            result.scale = scale;
+            Sampler sampler(result, repetitions);
+            try {
+                benchmark.run(data, sampler);
+            } catch (const std::exception& e) {
+                std::cout.rdbuf(console);
+                std::cerr << "Benchmark " << benchmark.name << " failed: " << e.what() << std::endl;
+                return 1;
+            }
+            results.push_back(std::move(result));
+        }
+    }
+    std::cout.rdbuf(console);
+
+    if (outputPath.empty()) {
+        writeJson(std::cout, results, repetitions);
+    } else {
+        std::ofstream file(outputPath);
+        if (!file) {
+            std::cerr << "Cannot write " << outputPath << std::endl;
+            return 1;
+        }
+        writeJson(file, results, repetitions);
+    }
+    return 0;
+}
@@ -0,0 +1,117 @@
+#include "DataGenerator.h"
+#include <cstdio>
+#include <ctime>
+
+DataGenerator::DataGenerator(uint64_t seed) : random(seed) {}
+
+const char* DataGenerator::customersSchema() {
+    return "CREATE TABLE Customers ( CustomerID INT PRIMARY_KEY , FirstName VARCHAR(50) NOT_EMPTY , "
+           "LastName VARCHAR(50) NOT_EMPTY , Email VARCHAR(100) NOT_EMPTY , Phone VARCHAR(20) );";
+}
+
+const char* DataGenerator::productsSchema() {
+    return "CREATE TABLE Products ( ProductID INT PRIMARY_KEY , Name VARCHAR(255) NOT_EMPTY , "
+           "Description VARCHAR(512) , Price DOUBLE NOT_EMPTY , InStock INT NOT_EMPTY );";
+}
+
+const char* DataGenerator::ordersSchema() {
+    return "CREATE TABLE Orders ( OrderID INT PRIMARY_KEY , CustomerID INT FOREIGN_KEY_REFERENCES Customers.CustomerID , "
+           "OrderDate DATETIME NOT_EMPTY , TotalAmount DOUBLE NOT_EMPTY );";
+}
+
+std::string DataGenerator::word(size_t minLength, size_t maxLength) {
+    std::uniform_int_distribution<size_t> length(minLength, maxLength);
+    std::uniform_int_distribution<int> letter('a', 'z');
+    std::string result(length(random), ' ');
+    for (char& c : result) {
+        c = static_cast<char>(letter(random));
+    }
+    result[0] = static_cast<char>(result[0] - 'a' + 'A');
+    return result;
+}
+
+std::vector<DataGenerator::Record> DataGenerator::customers(size_t count) {
+    std::vector<Record> rows;
+    rows.reserve(count);
+    std::uniform_int_distribution<int> phone(1000, 9999);
+    for (size_t id = 1; id <= count; ++id) {
+        std::string firstName = word(3, 10);
+        std::string lastName = word(4, 12);
+        rows.push_back({
+            {"CUSTOMERID", std::to_string(id)},
+            {"FIRSTNAME", firstName},
+            {"LASTNAME", lastName},
+            {"EMAIL", firstName + "." + lastName + std::to_string(id) + "@example.com"},
+            {"PHONE", "555-" + std::to_string(phone(random))},
+        });
+    }
+    return rows;
+}
+
+std::vector<DataGenerator::Record> DataGenerator::products(size_t count) {
+    std::vector<Record> rows;
+    rows.reserve(count);
+    std::uniform_int_distribution<int> cents(100, 200000);
+    std::uniform_int_distribution<int> stock(0, 500);
+    std::uniform_int_distribution<int> descriptionWords(5, 40);
+    for (size_t id = 1; id <= count; ++id) {
+        std::string description;
+        for (int i = descriptionWords(random); i > 0; --i) {
+            description += (description.empty() ? "" : " ") + word(2, 9);
+        }
+        char price[32];
+        std::snprintf(price, sizeof(price), "%.2f", cents(random) / 100.0);
+        rows.push_back({
+            {"PRODUCTID", std::to_string(id)},
+            {"NAME", word(4, 16)},
+            {"DESCRIPTION", description.substr(0, 512)},
+            {"PRICE", price},
+            {"INSTOCK", std::to_string(stock(random))},
+        });
+    }
+    return rows;
+}
+
+std::vector<DataGenerator::Record> DataGenerator::orders(size_t count, size_t customerCount) {
+    std::vector<Record> rows;
+    rows.reserve(count);
+    std::uniform_int_distribution<size_t> customer(1, customerCount);
+    std::uniform_int_distribution<int> cents(500, 100000);
+    std::uniform_int_distribution<int> gap(1, 600);
+    uint64_t timestamp = 0;
+    for (size_t id = 1; id <= count; ++id) {
+        // Orders arrive in id and date order, like an append-mostly fact table
+        timestamp += gap(random);
+        char amount[32];
+        std::snprintf(amount, sizeof(amount), "%.2f", cents(random) / 100.0);
+        rows.push_back({
+            {"ORDERID", std::to_string(id)},
+            {"CUSTOMERID", std::to_string(customer(random))},
+            {"ORDERDATE", formatDateTime(timestamp)},
+            {"TOTALAMOUNT", amount},
+        });
+    }
+    return rows;
+}
+
+SQLParser::Query DataGenerator::insertQuery(const std::string& table, const std::vector<Record>& rows,
+                                            size_t begin, size_t end) {
+    SQLParser::Query query;
+    query.operation = "INSERT";
+    query.table = table;
+    for (const auto& [field, value] : rows.at(begin)) {
+        query.fields.push_back(field);
+    }
+    query.multiValues.assign(rows.begin() + begin, rows.begin() + end);
+    return query;
+}
+
+std::string DataGenerator::formatDateTime(uint64_t secondsSince2020) {
+    const std::time_t epoch2020 = 1577836800;
+    std::time_t timestamp = epoch2020 + static_cast<std::time_t>(secondsSince2020);
+    std::tm parts;
+    gmtime_r(&timestamp, &parts);
+    char buffer[20];
+    std::strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S", &parts);
+    return buffer;
+}
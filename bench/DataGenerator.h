@@ -0,0 +1,45 @@
+#ifndef DATAGENERATOR_H
+#define DATAGENERATOR_H
+
+#include <cstdint>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+#include "sql/SQLParser.h"
+
+// Deterministic synthetic rows for the Customers / Products / Orders schemas
+// of testing/creating_tables.txt. The same seed always yields the same data,
+// so runs of different builds are comparable.
+class DataGenerator {
+public:
+    using Record = std::map<std::string, std::string>;
+
+    explicit DataGenerator(uint64_t seed = 42);
+
+    // CREATE TABLE statements matching testing/creating_tables.txt
+    static const char* customersSchema();
+    static const char* productsSchema();
+    static const char* ordersSchema();
+
+    // Rows with ids 1..count
+    std::vector<Record> customers(size_t count);
+    std::vector<Record> products(size_t count);
+
+    // Orders with ids 1..count, increasing OrderDate and CustomerIDs in 1..customerCount
+    std::vector<Record> orders(size_t count, size_t customerCount);
+
+    // INSERT query for a slice of rows, as the parser would produce it
+    static SQLParser::Query insertQuery(const std::string& table, const std::vector<Record>& rows,
+                                        size_t begin, size_t end);
+
+    // Format seconds since 2020-01-01 00:00:00 as a DATETIME value
+    static std::string formatDateTime(uint64_t secondsSince2020);
+
+private:
+    std::mt19937_64 random;
+
+    std::string word(size_t minLength, size_t maxLength);
+};
+
+#endif // DATAGENERATOR_H
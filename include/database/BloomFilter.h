@@ -0,0 +1,34 @@
+#ifndef BLOOMFILTER_H
+#define BLOOMFILTER_H
+
+#include <cstdint>
+#include <memory_resource>
+#include <string_view>
+#include <vector>
+
+// Split-block Bloom filter over strings. Each key maps to one 32-byte block
+// and sets one bit in each of the block's eight words, so a lookup touches a
+// single cache line. About 10 bits per key give a ~1% false positive rate.
+class BloomFilter {
+public:
+    BloomFilter(size_t expectedKeys, std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+    void insert(std::string_view key);
+
+    // False means the key was never inserted; true may be a false positive
+    bool mayContain(std::string_view key) const;
+
+    size_t sizeBytes() const { return blocks.size() * sizeof(Block); }
+
+private:
+    struct alignas(32) Block {
+        uint32_t words[8];
+    };
+    std::pmr::vector<Block> blocks;
+
+    static uint64_t hash(std::string_view key);
+    size_t blockIndex(uint64_t hash) const;
+    static uint32_t bitFor(uint64_t hash, int word);
+};
+
+#endif // BLOOMFILTER_H
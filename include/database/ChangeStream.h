@@ -0,0 +1,145 @@
+#ifndef CHANGESTREAM_H
+#define CHANGESTREAM_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Table.h"
+
+// One row inserted, updated or deleted
+struct ChangeEvent {
+    uint64_t sequence = 0;          // Position in the stream, from 1, without gaps
+    int64_t timestampMicros = 0;    // Wall clock when the change was applied
+    std::string table;
+    TableChange::Kind kind = TableChange::Kind::Insert;
+    std::map<std::string, std::string> before;  // Update and Delete: the row as it was
+    std::map<std::string, std::string> after;   // Insert and Update: the row as it is now
+};
+
+// Change data capture: every row change of the tables it watches, in the
+// order applied, numbered by sequence. Changes are collected while a
+// statement runs and published together once it has finished, so a
+// statement's rows reach the sinks in one write and cascaded changes come
+// with the statement that caused them.
+//
+// Subscribers are reached three ways: callbacks in this process, a JSONL
+// file appended to (one object per line, tailed like any log), and a Unix
+// socket whose clients name the sequence to resume from. The most recent
+// events are retained in memory for callbacks and socket clients that resume
+// from an earlier sequence; older ones are read back from the file, if any.
+//
+// Socket clients are written to by a thread of their own: publish only
+// queues a batch for each client, and a client whose queue falls too far
+// behind is disconnected rather than holding up the others.
+class ChangeStream : public TableObserver {
+public:
+    using Callback = std::function<void(const std::vector<ChangeEvent>& events)>;
+
+    ChangeStream() = default;
+    ~ChangeStream() override;
+
+    ChangeStream(const ChangeStream&) = delete;
+    ChangeStream& operator=(const ChangeStream&) = delete;
+
+    // Append every published batch to a JSONL file. An existing file is
+    // continued: numbering resumes after its last sequence.
+    void openFile(const std::string& path);
+
+    // Serve the stream on a Unix socket. A client may first send a line
+    // "FROM n" to receive the events from sequence n on; every client then
+    // receives each published batch as JSONL.
+    void listen(const std::string& socketPath);
+
+    // Call back with the events from 'fromSequence' on, then with each
+    // published batch. 0 starts with the next batch. Throws if events from
+    // 'fromSequence' are neither retained nor in the file. Returns an id for
+    // unsubscribe.
+    size_t subscribe(uint64_t fromSequence, Callback callback);
+    void unsubscribe(size_t id);
+
+    // Events kept in memory for resuming subscribers (default 100000)
+    void setRetention(size_t events);
+
+    // Sequence of the last event published, 0 before the first
+    uint64_t getLastSequence() const;
+
+    // Hand the events collected since the last publish to every subscriber
+    void publish();
+
+    void tableChanged(const Table& table, const TableChange& change) override;
+
+    static std::string toJson(const ChangeEvent& event);
+    static ChangeEvent fromJson(const std::string& line);
+
+    // Events of a change stream file from 'fromSequence' on; throws
+    // std::runtime_error on a malformed line
+    static std::vector<ChangeEvent> read(const std::string& path, uint64_t fromSequence = 0);
+
+private:
+    using Batch = std::shared_ptr<const std::vector<ChangeEvent>>;
+
+    struct Subscriber {
+        size_t id;
+        Callback callback;
+    };
+
+    // A socket client and the JSONL text queued for it. Only the writer
+    // thread sends to and closes the socket; a client is not written to
+    // until its replay is queued.
+    struct Client {
+        int fd = -1;
+        std::deque<std::shared_ptr<const std::string>> queue;
+        size_t offset = 0;          // Bytes of the first text already sent
+        size_t queuedBytes = 0;
+        bool ready = false;
+        bool closing = false;       // Close once the queue is sent
+        bool dropped = false;
+    };
+
+    // Text a client may have queued before it is disconnected
+    static constexpr size_t clientQueueLimit = 16 * 1024 * 1024;
+
+    mutable std::mutex mutex;       // Retention, subscribers and socket clients
+    uint64_t nextSequence = 1;
+    std::vector<ChangeEvent> pending;
+
+    // Published batches, shared with the callbacks rather than copied; whole
+    // batches are dropped while the rest still hold 'retention' events
+    std::deque<Batch> retained;
+    size_t retainedEvents = 0;
+    size_t retention = 100000;
+    std::vector<Subscriber> subscribers;
+    size_t nextSubscriberId = 1;
+
+    std::ofstream file;
+    std::string filePath;
+
+    std::string socketPath;
+    int listenFd = -1;
+    std::vector<std::shared_ptr<Client>> clients;
+    std::condition_variable clientsQueued;
+    std::thread acceptor;
+    std::thread writer;
+    std::atomic<bool> stopping{false};
+
+    void acceptClients();
+    void writeClients();
+    static bool sendAll(int fd, const std::string& data);
+    static void enqueue(Client& client, std::shared_ptr<const std::string> text);
+    std::vector<ChangeEvent> retainedFrom(uint64_t fromSequence, uint64_t& fileBefore) const;
+    std::vector<ChangeEvent> fileEvents(uint64_t fromSequence, uint64_t beforeSequence) const;
+    void trimRetained();
+    static void appendJson(std::string& out, const ChangeEvent& event);
+};
+
+#endif // CHANGESTREAM_H
@@ -0,0 +1,48 @@
+#ifndef COLUMNBATCH_H
+#define COLUMNBATCH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+// Rows passed between executor operators, up to 'capacity' at a time and
+// stored column by column. A row is its row id in each source table joined
+// so far plus views of the columns later operators read; values an operator
+// computes (aggregates) live in the query arena. Filters narrow 'selection'
+// instead of moving values.
+struct ColumnBatch {
+    static constexpr size_t capacity = 1024;
+    static constexpr size_t noRow = static_cast<size_t>(-1);
+
+    size_t rowCount = 0;
+    std::vector<std::vector<size_t>> rowIds;            // source -> row id of each row
+    std::vector<std::vector<std::string_view>> columns; // column -> value of each row, a null view if absent
+    std::vector<uint32_t> selection;                    // live rows, ascending
+
+    // Empty the batch for a layout, keeping its storage. Every column has a
+    // slot per possible row, so operators fill rows in by position.
+    void reset(size_t columnCount, size_t sourceCount) {
+        rowCount = 0;
+        selection.clear();
+        rowIds.resize(sourceCount);
+        for (auto& ids : rowIds) {
+            ids.resize(capacity, noRow);
+        }
+        columns.resize(columnCount);
+        for (auto& values : columns) {
+            values.resize(capacity);
+        }
+    }
+
+    // Add a selected row; its ids and values are whatever the slots held
+    size_t appendRow() {
+        selection.push_back(static_cast<uint32_t>(rowCount));
+        return rowCount++;
+    }
+
+    bool full() const { return rowCount == capacity; }
+    size_t selectedCount() const { return selection.size(); }
+};
+
+#endif // COLUMNBATCH_H
@@ -5,16 +5,21 @@
 #include <string>
 #include <stdexcept>
 
+// Tag identifying the concrete constraint without a virtual call or string compare
+enum class ConstraintKind { NotEmpty, PrimaryKey, ForeignKey };
+
 class Constraint {
 public:
     virtual ~Constraint() {}
     virtual std::string getName() const = 0;
+    virtual ConstraintKind getKind() const = 0;
     virtual void check(const std::string& value) const = 0;
 };
 
 class NotEmptyConstraint : public Constraint {
 public:
     std::string getName() const override { return "NOT_EMPTY"; }
+    ConstraintKind getKind() const override { return ConstraintKind::NotEmpty; }
     void check(const std::string& value) const override {
         if (value.empty()) {
             throw std::runtime_error("Value cannot be empty.");
@@ -25,6 +30,7 @@ public:
 class PrimaryKeyConstraint : public Constraint {
 public:
     std::string getName() const override { return "PRIMARY_KEY"; }
+    ConstraintKind getKind() const override { return ConstraintKind::PrimaryKey; }
     void check(const std::string& value) const override {
         // Should be enforced at the table level
     }
@@ -32,10 +38,13 @@ public:
 
 class ForeignKeyConstraint : public Constraint {
 public:
-    ForeignKeyConstraint(const std::string& referencedTable, const std::string& referencedColumn)
-        : referencedTable(referencedTable), referencedColumn(referencedColumn) {}
+    ForeignKeyConstraint(const std::string& referencedTable, const std::string& referencedColumn,
+                         bool cascadeOnDelete = false, bool cascadeOnUpdate = false)
+        : referencedTable(referencedTable), referencedColumn(referencedColumn),
+          cascadeOnDelete(cascadeOnDelete), cascadeOnUpdate(cascadeOnUpdate) {}
 
     std::string getName() const override { return "FOREIGN_KEY_REFERENCES"; }
+    ConstraintKind getKind() const override { return ConstraintKind::ForeignKey; }
 
     void check(const std::string& value) const override {
         // Should be enforced at the table level
@@ -44,9 +53,16 @@ public:
     const std::string& getReferencedTable() const { return referencedTable; }
     const std::string& getReferencedColumn() const { return referencedColumn; }
 
+    // Whether deleting / re-keying a referenced row cascades to the referencing rows
+    // instead of being rejected
+    bool cascadesOnDelete() const { return cascadeOnDelete; }
+    bool cascadesOnUpdate() const { return cascadeOnUpdate; }
+
 private:
     std::string referencedTable;
     std::string referencedColumn;
+    bool cascadeOnDelete;
+    bool cascadeOnUpdate;
 };
 
 #endif // CONSTRAINT_H
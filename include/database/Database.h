@@ -3,34 +3,144 @@
 
 #include <string>
 #include <map>
+#include <memory>
+#include <ostream>
 #include "Field.h"
+#include "Datatype.h"
+#include "QueryPlan.h"
+#include "MemoryTracker.h"
+#include "ResultCache.h"
 #include "../sql/SQLParser.h"
+#include "../reldb/ResultSet.h"
 
 class Table;
+class QueryLogWriter;
+class MaterializedView;
+class ChangeStream;
+
+// What a statement produced, for callers that consume it in-process
+struct QueryResult {
+    std::vector<ResultColumn> columns;                      // SELECT output columns, in order
+    std::vector<std::map<std::string, std::string>> rows;   // SELECT rows, keyed by column name
+    size_t rowsAffected = 0;
+};
+
 class Database {
 public:
+    // A column of some table that references another table's primary key
+    struct ForeignKeyReference {
+        Table* table;
+        std::string fieldName;
+        const ForeignKeyConstraint* constraint;
+    };
+
     // Constructor
     Database();
 
     // Destructor
     ~Database();
 
+    // Parse and execute one SQL statement, recording its metrics. What it
+    // produced is stored in 'result' when given.
+    void executeStatement(const std::string& sql, QueryResult* result = nullptr);
+
+    // Execute a statement parsed beforehand from 'sql', recording it like
+    // executeStatement does
+    void executePrepared(const std::string& sql, const SQLParser::Query& query, QueryResult* result = nullptr);
+
     // Execute a parsed SQL query
-    void executeQuery(const SQLParser::Query& query);
+    void executeQuery(const SQLParser::Query& query, QueryResult* result = nullptr);
+
+    // Where status messages, result tables and plans are printed (std::cout
+    // by default); nullptr prints nothing and skips the formatting
+    void setOutput(std::ostream* out);
+
+    // Append every statement run through executeStatement to the log (nullptr stops capturing)
+    void setQueryLog(QueryLogWriter* log);
+
+    // Rows inserted, updated, deleted or returned by the last query
+    size_t getLastRowsAffected() const;
+
+    // Re-analyze a table before planning once this fraction of its rows has
+    // changed since its statistics were gathered
+    void setAnalyzeFraction(double fraction);
+
+    // Most memory one query may hold (0: unlimited). A join over budget
+    // spills to temporary files; a query with no spill path fails.
+    static constexpr size_t defaultQueryMemoryLimit = size_t(1) << 30;
+    void setQueryMemoryLimit(size_t bytes);
+
+    // Threads a large join's hash table is built on (0, the default: one per core)
+    void setJoinThreads(size_t threads);
+
+    // Bytes of SELECT results kept for repeated queries (0, the default,
+    // disables the cache). A cached result is served while none of the
+    // tables it read has changed.
+    void setResultCacheLimit(size_t bytes);
+
+    // Capture the row changes of every table, views excepted, into the
+    // stream, published after each statement (nullptr stops capturing). The
+    // stream must outlive the database or be detached first.
+    void setChangeStream(ChangeStream* stream);
+
+    // Memory held by each table and by queries (the \memory command)
+    void writeMemoryReport(std::ostream& out) const;
+
     Table* getTable(const std::string& tableName) const;
+
+    // All foreign keys that point at the given table
+    std::vector<ForeignKeyReference> getReferencingFields(const std::string& tableName) const;
     std::vector<std::map<std::string, std::string>> executeSelectQuery(const SQLParser::Query& query);
 
+    // Choose how a SELECT runs (scan, join algorithm and order, filter
+    // placement). Tables named in 'substitutes' are read instead of the
+    // database's tables of that name (a materialized view's changed rows).
+    SelectPlan planSelectQuery(const SQLParser::Query& query,
+                               const std::map<std::string, Table*>& substitutes = {}) const;
+
+    // Run a planned SELECT, recording per-operator statistics in the plan
+    std::vector<std::map<std::string, std::string>> executeSelectPlan(SelectPlan& plan);
+
+    // Output columns of a SELECT: the selected fields in order or, for '*',
+    // every column of the tables read, in the order the result rows hold them
+    std::vector<ResultColumn> describeColumns(const SQLParser::Query& query) const;
+
 
 private:
     std::map<std::string, Table*> tables; // Map of table names to Table objects
+    QueryLogWriter* queryLog = nullptr;
+    ChangeStream* changeStream = nullptr;
+    std::ostream* output;
+    size_t lastRowsAffected = 0;
+    double analyzeFraction = 0.1;
+    size_t queryMemoryLimit = defaultQueryMemoryLimit;
+    size_t joinThreads = 0;
+    MemoryTracker queryMemory;      // Parent of every query's tracker
+    size_t lastQueryPeak = 0;
+    ResultCache resultCache;
+    std::map<std::string, std::unique_ptr<MaterializedView>> views; // Their tables are in 'tables'
 
     // Methods to handle different query types
+    void dispatchQuery(const SQLParser::Query& query, QueryResult* result);
+
+    // Log and time a statement, parsing 'sql' unless it is already 'prepared'
+    void runStatement(const std::string& sql, const SQLParser::Query* prepared, QueryResult* result);
     void createTable(const SQLParser::Query& query);
     void insertIntoTable(const SQLParser::Query& query);
     void selectFromTable(const SQLParser::Query& query);
     void updateTable(const SQLParser::Query& query);
     void deleteFromTable(const SQLParser::Query& query);
     void dropTable(const SQLParser::Query& query);
+    void createIndex(const SQLParser::Query& query);
+    void dropIndex(const SQLParser::Query& query);
+    void createMaterializedView(const SQLParser::Query& query);
+    void refreshMaterializedView(const SQLParser::Query& query);
+    void dropMaterializedView(const SQLParser::Query& query);
+    void explainSelectQuery(const SQLParser::Query& query);
+    void analyzeTables(const SQLParser::Query& query);
+
+    // Refresh the statistics of the tables a SELECT reads that changed too much
+    void refreshStatistics(const SQLParser::Query& query);
 
     // Helper method to create a Field from ColumnDefinition
     Field* createField(const SQLParser::ColumnDefinition& colDef);
@@ -3,6 +3,7 @@
 
 #include <string>
 #include <stdexcept>
+#include "../reldb/DataKind.h"
 
 // Base class for data types
 class DataType {
@@ -10,6 +11,7 @@ public:
     virtual void validate(const std::string& value) const = 0;
     virtual ~DataType() = default;
     virtual std::string getName() const = 0;
+    virtual DataKind getKind() const = 0;
 };
 
 // Varchar data type
@@ -19,6 +21,8 @@ public:
     VarcharType(size_t maxLength);
     void validate(const std::string& value) const override;
     std::string getName() const override { return "VARCHAR"; }
+    DataKind getKind() const override { return DataKind::Varchar; }
+    size_t getMaxLength() const { return maxLength; }
 };
 
 // Integer data type
@@ -26,6 +30,7 @@ class IntType : public DataType {
 public:
     void validate(const std::string& value) const override;
     std::string getName() const override { return "INT"; }
+    DataKind getKind() const override { return DataKind::Int; }
 };
 
 // Long Integer data type
@@ -33,6 +38,7 @@ class LongIntType : public DataType {
 public:
     void validate(const std::string& value) const override;
     std::string getName() const override { return "LONGINT"; }
+    DataKind getKind() const override { return DataKind::LongInt; }
 };
 
 // Double data type
@@ -40,6 +46,7 @@ class DoubleType : public DataType {
 public:
     void validate(const std::string& value) const override;
     std::string getName() const override { return "DOUBLE"; }
+    DataKind getKind() const override { return DataKind::Double; }
 };
 
 // DateTime data type (basic validation example)
@@ -47,6 +54,7 @@ class DateTimeType : public DataType {
 public:
     void validate(const std::string& value) const override;
     std::string getName() const override { return "DATETIME"; }
+    DataKind getKind() const override { return DataKind::DateTime; }
 };
 
 #endif // DATATYPE_H
@@ -0,0 +1,155 @@
+#ifndef HASHJOIN_H
+#define HASHJOIN_H
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "BloomFilter.h"
+#include "Predicate.h"
+#include "QueryArena.h"
+#include "QueryPlan.h"
+#include "SpillFile.h"
+
+class Table;
+
+// A Bloom filter pushed into a scan: rows whose value in 'column' is not in
+// the filter cannot survive a later join and are dropped on the spot
+struct JoinKeyFilter {
+    std::string column;        // unqualified column of the scanned table
+    const BloomFilter* bloom;
+};
+
+// Build side of an equi-join: the joined table's rows chained by join key,
+// plus a Bloom filter of those keys for the probe side's scan. Everything is
+// allocated in the query arena.
+//
+// The table is radix-partitioned: rows are scattered by the high bits of
+// their key hash into partitions of a few thousand rows, each with an
+// open-addressing table of its own, so a partition stays in the CPU cache
+// while it is built and probed. Large builds split reading the keys,
+// scattering and building the partitions across worker threads, and large
+// probes (lookupPartitioned) are scattered by the same bits and probed a
+// partition at a time across them.
+//
+// When the hash table would not fit in what is left of the arena's memory
+// budget, the build spills instead (a Grace hash join): the row ids are
+// partitioned by key hash into temporary files, the probe side partitions
+// its rows the same way (partitionOf), and each partition is then joined on
+// its own with a hash table (loadPartition) that is freed before the next
+// one is built.
+class JoinHashTable {
+public:
+    // Hash the rows of 'table' that satisfy 'predicates' on 'column',
+    // skipping rows rejected by 'filters', on up to 'threads' threads (0: one
+    // per core). The build is timed and counted in 'stats' when given. With
+    // 'keepRowIds' the ids of those rows are kept for getRowIds.
+    JoinHashTable(const Table& table, const std::string& column, const std::vector<Predicate>& predicates,
+                  const std::vector<JoinKeyFilter>& filters, QueryArena& arena, OperatorStats* stats = nullptr,
+                  size_t threads = 0, bool keepRowIds = false);
+
+    JoinHashTable(const JoinHashTable&) = delete;
+    JoinHashTable& operator=(const JoinHashTable&) = delete;
+
+    const BloomFilter& getBloomFilter() const { return bloom; }
+    const Table& getTable() const { return table; }
+    const std::string& getColumn() const { return column; }
+
+    bool isSpilled() const { return !partitions.empty(); }
+
+    // Every qualifying row, keyed or not (NULL), in scan order; empty unless
+    // kept. Outer and anti-joins read the rows no key lookup reaches.
+    const std::vector<size_t>& getRowIds() const { return keptRows; }
+
+    static constexpr size_t noRow = static_cast<size_t>(-1);
+
+    // In-memory build: the first match of the key, then the next match with
+    // the same key, in table order; noRow past the last. getRow gives the
+    // row id of a match.
+    size_t lookup(std::string_view key) const { return find(hashKey(key), key); }
+    size_t nextMatch(size_t match) const { return entries[match].next; }
+    size_t getRow(size_t match) const { return entries[match].row; }
+
+    // lookup for the selected rows of a batch column, into 'matches' by
+    // selection position. Slots are prefetched a few rows ahead so the
+    // cache misses of consecutive probes overlap.
+    void lookupBatch(const std::string_view* keys, const std::vector<uint32_t>& selection,
+                     std::vector<size_t>& matches) const;
+
+    // lookup for many keys at once, into 'matches' by key position: the keys
+    // are radix-partitioned like the build rows and the partitions probed on
+    // the build's worker threads, each taking the next partition left. Too
+    // few keys for two threads are probed in order as by lookupBatch. The
+    // threads used are counted in 'stats' when given. Only worth gathering
+    // keys for when probesInParallel(): partitioned, with threads to spare.
+    bool probesInParallel() const;
+    void lookupPartitioned(const std::vector<std::string_view>& keys, std::vector<size_t>& matches,
+                           OperatorStats* stats = nullptr) const;
+
+    // Spilled build: the partitions, the one holding a key's build rows, and
+    // an in-memory hash table of one partition's rows allocated in 'arena'
+    // (null when it has none)
+    size_t getPartitionCount() const { return partitions.size(); }
+    size_t partitionOf(std::string_view key) const;
+    std::unique_ptr<JoinHashTable> loadPartition(size_t partition, QueryArena& arena) const;
+
+private:
+    static constexpr size_t maxPartitions = 256;
+
+    // In-memory build of the given rows of 'table'
+    JoinHashTable(const Table& table, const std::string& column, const size_t* rowIds, size_t rowCount,
+                  QueryArena& arena, size_t threads);
+
+    // A keyed build row, stored with its partition
+    struct Entry {
+        uint64_t hash;
+        std::string_view key;
+        size_t row;
+        size_t next;                // Next entry with the same key, or noRow
+    };
+
+    const Table& table;
+    std::string column;
+    std::pmr::vector<Entry> entries;        // Grouped by partition, in table order within each
+    std::pmr::vector<uint32_t> slots;       // Per partition a power of two of them: entry + 1, 0 if empty
+    std::pmr::vector<size_t> slotStart;     // Partition -> its first slot; one more at the end
+    unsigned partitionBits = 0;
+    BloomFilter bloom;
+    std::vector<SpillFile> partitions;      // Spilled build: row ids by key hash
+    std::vector<size_t> keptRows;           // Row ids kept on request
+    size_t threads;
+
+    static uint64_t hashKey(std::string_view key);
+
+    size_t slotPartition(uint64_t hash) const { return (hash >> 32) >> (32 - partitionBits); }
+
+    size_t find(uint64_t hash, std::string_view key) const {
+        size_t partition = slotPartition(hash);
+        const uint32_t* partitionSlots = slots.data() + slotStart[partition];
+        size_t mask = slotStart[partition + 1] - slotStart[partition] - 1;
+        for (size_t slot = hash & mask;; slot = (slot + 1) & mask) {
+            uint32_t entry = partitionSlots[slot];
+            if (entry == 0) {
+                return noRow;
+            }
+            const Entry& candidate = entries[entry - 1];
+            if (candidate.hash == hash && candidate.key == key) {
+                return entry - 1;
+            }
+        }
+    }
+
+    // Heap bytes an in-memory build of 'rows' rows would take
+    static size_t estimateBytes(size_t rows);
+
+    void build(const size_t* rowIds, size_t rowCount, QueryArena& arena, OperatorStats& stats);
+
+    void spill(const std::vector<size_t>& rowIds, size_t budget, OperatorStats& stats);
+};
+
+#endif // HASHJOIN_H
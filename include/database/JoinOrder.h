@@ -0,0 +1,60 @@
+#ifndef JOINORDER_H
+#define JOINORDER_H
+
+#include <cstddef>
+#include <vector>
+
+// Chooses the order of a multi-way equi-join from estimated sizes. Plans are
+// left-deep, matching the executor: the first relation is scanned, and each
+// later one is hashed and probed with the rows joined so far. A relation may
+// only follow once a join condition connects it to those rows, so no plan
+// contains a cross product.
+//
+// The cost of a plan is the number of rows flowing between its operators
+// plus the rows it hashes, the latter weighted by buildCost. Every table is
+// scanned once whatever the order, so scans are left out. A join's output is
+// estimated as |L| * |R| / max(distinct keys on either side).
+class JoinOrder {
+public:
+    // A join condition between two relations
+    struct Edge {
+        size_t left;
+        size_t right;
+        double leftDistinct;  // Distinct join keys on each side
+        double rightDistinct;
+    };
+
+    // Up to this many relations every connected order is costed by dynamic
+    // programming over subsets; beyond it orders are built greedily
+    static constexpr size_t exhaustiveLimit = 12;
+
+    // 'rows' holds each relation's estimated size after its own filters.
+    // Returns the relations in join order. Throws std::runtime_error when
+    // the edges do not connect every relation.
+    static std::vector<size_t> choose(const std::vector<double>& rows, const std::vector<Edge>& edges);
+
+    // Estimated rows once 'next' is joined to the relations flagged in
+    // 'joined', which currently number 'joinedRows'
+    static double estimateJoinRows(const std::vector<double>& rows, const std::vector<Edge>& edges,
+                                   const std::vector<bool>& joined, double joinedRows, size_t next);
+
+private:
+    // Hashing a row costs about twice as much as probing with one
+    static constexpr double buildCost = 2.0;
+
+    JoinOrder(const std::vector<double>& rows, const std::vector<Edge>& edges);
+
+    std::vector<double> rows;
+    std::vector<Edge> edges;
+
+    // Estimated rows once 'next' is joined to the relations for which
+    // 'joined(relation)' is true, given their current size; 0 when no edge
+    // connects them
+    template <typename Joined>
+    double joinRows(Joined joined, double joinedRows, size_t next) const;
+
+    std::vector<size_t> chooseExhaustive() const;
+    std::vector<size_t> chooseGreedy() const;
+};
+
+#endif // JOINORDER_H
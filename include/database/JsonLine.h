@@ -0,0 +1,35 @@
+#ifndef JSONLINE_H
+#define JSONLINE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+// Write a JSON string literal, escaping quotes, backslashes and control characters
+void writeJsonString(std::ostream& out, const std::string& text);
+void writeJsonString(std::string& out, const std::string& text);
+
+// Reader for the flat and nested objects the JSONL logs write: string keys,
+// and string, integer, null or object values
+class JsonLineReader {
+public:
+    explicit JsonLineReader(const std::string& text) : text(text) {}
+
+    void expect(char c);
+    bool consume(char c);
+    bool peekString();
+    std::string readString();
+    int64_t readInteger();
+
+    // Consume a null literal if one comes next
+    bool consumeNull();
+
+private:
+    const std::string& text;
+    size_t position = 0;
+
+    void skipSpace();
+};
+
+#endif // JSONLINE_H
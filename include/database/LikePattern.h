@@ -0,0 +1,45 @@
+#ifndef LIKEPATTERN_H
+#define LIKEPATTERN_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+// A LIKE pattern compiled once per query. '%' matches any run of characters
+// and '_' any single character (byte); everything else matches itself.
+//
+// The pattern is split at each '%' into literal segments. The first segment
+// is anchored at the start of the value and the last at its end, unless a
+// '%' precedes or follows them; the segments in between are found left to
+// right. So 'abc%' is a prefix compare, '%abc' a suffix compare and '%abc%'
+// a single substring search, which memchr drives to candidate positions.
+class LikePattern {
+public:
+    explicit LikePattern(std::string_view pattern);
+
+    bool matches(std::string_view value) const;
+
+    // Characters every match starts with (up to the first wildcard)
+    const std::string& getPrefix() const { return prefix; }
+
+    // Runs of characters every match holds literally: the segments split
+    // further at each '_'
+    std::vector<std::string_view> getLiterals() const;
+
+private:
+    struct Segment {
+        std::string text;
+        bool wildcards = false;     // Holds a '_'
+    };
+
+    std::vector<Segment> segments;
+    bool anchoredStart = true;      // No leading '%'
+    bool anchoredEnd = true;        // No trailing '%'
+    size_t minLength = 0;           // Characters the segments need in all
+    std::string prefix;
+
+    static bool matchAt(const Segment& segment, std::string_view value, size_t position);
+    static size_t find(const Segment& segment, std::string_view value, size_t from);
+};
+
+#endif // LIKEPATTERN_H
@@ -0,0 +1,122 @@
+#ifndef MATERIALIZEDVIEW_H
+#define MATERIALIZEDVIEW_H
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+#include "QueryPlan.h"
+#include "Table.h"
+#include "../sql/SQLParser.h"
+
+class Database;
+
+// A SELECT whose result is kept in a table of its own and maintained as the
+// tables it reads change (CREATE MATERIALIZED VIEW name AS SELECT ...).
+//
+// Each change to a source table is applied as a delta. The changed rows are
+// put in a scratch table of the source's name, and the view's query runs
+// with that table in place of the source, joined with the other sources as
+// they are now. Rows leaving the source are subtracted and rows entering it
+// added. The other sources are narrowed to the delta's join keys by an IN
+// list, so the row index answers the join where the key is a primary key.
+//
+// Without aggregates the view keeps every result row, located by value.
+// With GROUP BY or aggregates each group keeps running counts and sums, and
+// for MIN and MAX a count of each value, so losing the extreme finds the next
+// one. Only the rows of the groups a delta touched are rewritten.
+class MaterializedView : public TableObserver {
+public:
+    // Check the definition and create the view's table, which the database
+    // takes ownership of; refresh() fills it
+    MaterializedView(Database& database, const std::string& name, const std::string& definition);
+    ~MaterializedView() override;
+
+    MaterializedView(const MaterializedView&) = delete;
+    MaterializedView& operator=(const MaterializedView&) = delete;
+
+    const std::string& getName() const { return name; }
+    const std::string& getDefinition() const { return definition; }
+    Table* getTable() const { return table; }
+
+    // Tables the query reads
+    const std::vector<std::string>& getSources() const { return sources; }
+
+    // Compute the whole result again (REFRESH MATERIALIZED VIEW)
+    void refresh();
+
+    void tableChanged(const Table& source, const TableChange& change) override;
+
+private:
+    using Row = std::map<std::string, std::string>;
+
+    // Order of MIN and MAX: the order conditions compare in
+    struct ValueOrder {
+        bool operator()(const std::string& lhs, const std::string& rhs) const;
+    };
+
+    struct Accumulator {
+        size_t count = 0;           // Non-NULL values (rows, for COUNT(*))
+        int64_t integerSum = 0;     // Integer values only
+        double sum = 0.0;           // Every value
+        size_t nonIntegers = 0;     // While 0 the sum is exact
+        std::map<std::string, size_t, ValueOrder> values; // MIN and MAX: value -> rows holding it
+    };
+
+    struct Group {
+        static constexpr size_t noRow = static_cast<size_t>(-1);
+        size_t row = noRow;         // Position in the view's table
+        size_t rows = 0;            // Input rows in the group
+        Row plainValues;            // Selected group columns, as the row query names them
+        std::vector<Accumulator> accumulators;
+    };
+
+    struct OutputColumn {
+        std::string output;         // As the query names it
+        std::string column;         // In the view's table
+        bool aggregate = false;
+        AggregateSpec spec;
+    };
+
+    Database& database;
+    std::string name;
+    std::string definition;
+    SQLParser::Query query;
+    Table* table;
+    std::vector<std::string> sources;
+    std::vector<OutputColumn> outputs;
+    bool aggregated = false;
+
+    // Aggregated views read the rows before aggregation: the group columns,
+    // the selected columns and the aggregates' arguments
+    SQLParser::Query rowQuery;
+    std::vector<size_t> aggregateOutputs;   // Positions in 'outputs' of the aggregates
+
+    // Per source: its changed rows, and the join columns of other sources
+    // paired with its own column they equal
+    std::map<std::string, std::unique_ptr<Table>> deltas;
+    std::map<std::string, std::vector<std::pair<std::string, std::string>>> joinKeys;
+
+    std::unordered_map<std::string, std::vector<size_t>> rowsByValue; // No aggregates: row -> positions
+    std::unordered_map<std::string, Group> groups;                    // Aggregates: group key -> group
+
+    std::vector<Row> runDelta(const std::string& sourceName, const std::vector<Row>& rows);
+    void applyChange(const std::string& sourceName, const TableChange& change);
+
+    Row viewRow(const Row& result) const;
+    std::string encodeRow(const Row& row) const;
+    void addRows(const std::vector<Row>& results);
+    void removeRows(const std::vector<Row>& results);
+
+    void fold(const std::vector<Row>& rows, int sign, std::unordered_set<std::string>& touched);
+    void writeGroups(const std::unordered_set<std::string>& touched);
+    Row groupRow(const Group& group) const;
+    static std::string aggregateResult(const AggregateSpec& spec, const Accumulator& accumulator);
+};
+
+#endif // MATERIALIZEDVIEW_H
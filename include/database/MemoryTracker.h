@@ -0,0 +1,75 @@
+#ifndef MEMORYTRACKER_H
+#define MEMORYTRACKER_H
+
+#include <cstddef>
+#include <map>
+#include <memory_resource>
+#include <stdexcept>
+#include <string>
+
+// Thrown when a query needs more memory than its budget allows and has no
+// way to spill the excess to disk
+class MemoryBudgetExceeded : public std::runtime_error {
+public:
+    using std::runtime_error::runtime_error;
+};
+
+// Bytes held against an optional budget (a limit of 0 is unlimited). A child
+// tracker also charges its parent, so the parent sees the sum of its
+// children and its own limit caps them all.
+class MemoryTracker {
+public:
+    explicit MemoryTracker(size_t limit = 0, MemoryTracker* parent = nullptr);
+
+    // Whatever is still held goes back to the parent
+    ~MemoryTracker();
+
+    MemoryTracker(const MemoryTracker&) = delete;
+    MemoryTracker& operator=(const MemoryTracker&) = delete;
+
+    // Charge 'bytes'. Throws MemoryBudgetExceeded, charging nothing, when
+    // this tracker or an ancestor would go over its limit.
+    void consume(size_t bytes);
+
+    // Like consume, but returns false instead of throwing
+    bool tryConsume(size_t bytes);
+
+    void release(size_t bytes);
+
+    size_t getUsed() const { return used; }
+    size_t getPeak() const { return peak; }
+    size_t getLimit() const { return limit; }
+
+    // Bytes that can still be charged before some limit is reached
+    size_t available() const;
+
+private:
+    size_t limit;
+    MemoryTracker* parent;
+    size_t used = 0;
+    size_t peak = 0;
+};
+
+// Memory resource that charges every allocation to a tracker (when given)
+// before passing it upstream, and credits it back on deallocation
+class TrackingResource : public std::pmr::memory_resource {
+public:
+    explicit TrackingResource(MemoryTracker* tracker,
+                              std::pmr::memory_resource* upstream = std::pmr::new_delete_resource());
+
+    MemoryTracker* getTracker() const { return tracker; }
+
+private:
+    MemoryTracker* tracker;
+    std::pmr::memory_resource* upstream;
+
+    void* do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override;
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+};
+
+// Rough heap footprint of a record: a tree node per field plus any string
+// storage that does not fit inline
+size_t estimateRecordBytes(const std::map<std::string, std::string>& record);
+
+#endif // MEMORYTRACKER_H
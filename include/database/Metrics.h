@@ -0,0 +1,136 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+
+// Monotonic counter sharded across threads: each thread increments its own
+// cache line, so hot paths never contend. Reads sum the shards.
+class Counter {
+public:
+    void add(uint64_t n = 1);
+    uint64_t value() const;
+
+private:
+    static constexpr size_t shardCount = 16;
+    struct alignas(64) Shard {
+        std::atomic<uint64_t> value{0};
+    };
+    Shard shards[shardCount];
+};
+
+// HDR-style log-linear histogram of durations in nanoseconds. Every power of
+// two is split into 16 linear sub-buckets, so any recorded value is reported
+// within ~6% of its true value without storing samples.
+class LatencyHistogram {
+public:
+    void record(uint64_t nanos);
+    void record(std::chrono::steady_clock::duration elapsed);
+
+    uint64_t count() const;
+    uint64_t sumNanos() const { return sum.load(std::memory_order_relaxed); }
+
+    // Value (in nanoseconds) at the given quantile, 0 <= q <= 1
+    uint64_t quantile(double q) const;
+
+private:
+    static constexpr int subBucketBits = 4;
+    static constexpr size_t subBuckets = size_t(1) << subBucketBits;
+    static constexpr size_t bucketCount = (64 - subBucketBits + 1) * subBuckets;
+
+    static size_t bucketIndex(uint64_t nanos);
+    static uint64_t bucketMidpoint(size_t index);
+
+    std::atomic<uint64_t> buckets[bucketCount] = {};
+    std::atomic<uint64_t> sum{0};
+};
+
+// Latencies and outcomes of one statement type (SELECT, INSERT, ...)
+struct StatementMetrics {
+    Counter& executed;
+    Counter& errors;
+    LatencyHistogram& parse;
+    LatencyHistogram& plan;
+    LatencyHistogram& execute;
+    LatencyHistogram& total;
+};
+
+// Engine-wide counters touched on hot paths, registered once on first use
+struct EngineMetrics {
+    Counter& rowsScanned;
+    Counter& rowsReturned;
+    Counter& indexLookups;
+    Counter& fullScans;
+    Counter& blocksSkipped;
+    Counter& bloomRowsDropped;
+    Counter& bytesAllocated;
+    Counter& autoAnalyzes;
+    Counter& bytesSpilled;
+    Counter& memoryBudgetExceeded;
+    Counter& resultCacheHits;
+    Counter& resultCacheMisses;
+    Counter& changeEvents;
+    LatencyHistogram& constraintCheck;
+
+    static EngineMetrics& get();
+};
+
+// Process-wide registry of named metrics. Registration takes a lock; the
+// returned objects are stable and lock-free to update.
+class MetricsRegistry {
+public:
+    static MetricsRegistry& instance();
+
+    // 'labels' is the Prometheus label set without braces, e.g. type="SELECT"
+    Counter& counter(const std::string& name, const std::string& help, const std::string& labels = "");
+    LatencyHistogram& histogram(const std::string& name, const std::string& help, const std::string& labels = "");
+
+    StatementMetrics& statement(const std::string& type);
+
+    // Prometheus text exposition format
+    void writePrometheus(std::ostream& out) const;
+
+    // Human-readable summary for the \stats command
+    void writeSummary(std::ostream& out) const;
+
+private:
+    MetricsRegistry() = default;
+
+    using Key = std::pair<std::string, std::string>; // name, labels
+    mutable std::mutex mutex;
+    std::map<std::string, std::string> help;
+    std::map<Key, std::unique_ptr<Counter>> counters;
+    std::map<Key, std::unique_ptr<LatencyHistogram>> histograms;
+    std::map<std::string, std::unique_ptr<StatementMetrics>> statements;
+};
+
+// Periodically writes the registry to a Prometheus text file (for the node
+// exporter's textfile collector). The file is replaced atomically.
+class MetricsExporter {
+public:
+    MetricsExporter(const std::string& path, std::chrono::seconds interval);
+    ~MetricsExporter();
+
+    // Write the file immediately
+    void writeNow() const;
+
+private:
+    std::string path;
+    std::chrono::seconds interval;
+    std::mutex mutex;
+    std::condition_variable wakeUp;
+    bool stopping = false;
+    std::thread worker;
+
+    void run();
+};
+
+#endif // METRICS_H
@@ -0,0 +1,486 @@
+#ifndef OPERATOR_H
+#define OPERATOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "ColumnBatch.h"
+#include "HashJoin.h"
+#include "MemoryTracker.h"
+#include "PipelineRows.h"
+#include "Predicate.h"
+#include "QueryArena.h"
+#include "QueryPlan.h"
+#include "SortedKeys.h"
+
+class Table;
+
+// Physical operator of the batch-at-a-time executor. A parent pulls batches
+// from its child; every call does one batch's worth of work, so dispatching
+// on the operator, finding a column and decoding a predicate are paid once
+// per batch rather than once per row.
+class Operator {
+public:
+    explicit Operator(OperatorStats* stats) : stats(stats) {}
+    virtual ~Operator() = default;
+
+    Operator(const Operator&) = delete;
+    Operator& operator=(const Operator&) = delete;
+
+    // Fill 'batch' with the next rows, at least one of them selected; false
+    // once there are none left. Each call is timed (including the children,
+    // which run inside it) and counted in the operator's stats when given.
+    bool next(ColumnBatch& batch);
+
+protected:
+    virtual bool produce(ColumnBatch& batch) = 0;
+
+    OperatorStats* stats;
+};
+
+// Predicates applied to whole batches. They fold AND/OR left to right like
+// Predicate::combine, and each predicate only looks at the rows whose
+// outcome it can still change.
+class BatchPredicates {
+public:
+    explicit BatchPredicates(std::vector<Predicate> predicates);
+
+    const std::vector<Predicate>& get() const { return predicates; }
+
+    // Narrow 'selection' to the rows satisfying the predicates; columns[i]
+    // holds the values predicates[i] reads, by row position. Returns the
+    // predicate that met a missing value, or null.
+    const Predicate* apply(const std::vector<const std::string_view*>& columns, std::vector<uint32_t>& selection);
+
+private:
+    std::vector<Predicate> predicates;
+    std::vector<uint8_t> matches;   // Outcome so far, by row position
+    std::vector<uint32_t> pending;  // Rows the current predicate can still change
+};
+
+// Rows of a table satisfying the predicates and the pushed-down join
+// filters, as 'source' of the batches. The row index answers point lookups;
+// otherwise one block is read per batch, skipping the blocks the zone map
+// rules out, and the predicates are evaluated a column at a time.
+class ScanOperator : public Operator {
+public:
+    ScanOperator(const Table& table, size_t source, std::vector<Predicate> predicates, std::vector<JoinKeyFilter> filters,
+                 const std::vector<PipelineColumn>& columns, size_t sourceCount, OperatorStats* stats = nullptr);
+
+    // Rows read so far, before the predicates
+    size_t getRowsRead() const { return rowsRead; }
+
+protected:
+    bool produce(ColumnBatch& batch) override;
+
+private:
+    const Table& table;
+    size_t source;
+    BatchPredicates predicates;
+    std::vector<JoinKeyFilter> filters;
+    std::vector<std::pair<size_t, std::string>> carried; // Pipeline columns of this source
+    size_t columnCount;
+    size_t sourceCount;
+
+    bool started = false;
+    bool indexed = false;
+    std::vector<size_t> indexRows;  // Index scan: the rows under the key
+    size_t position = 0;            // Next index row, or next block
+    size_t rowsRead = 0;
+
+    std::vector<std::string> fields;                    // Columns the predicates read
+    std::vector<size_t> fieldOf;                        // Predicate -> its column in 'fields'
+    std::vector<std::vector<std::string_view>> fieldValues;
+
+    void start();
+    bool readChunk(ColumnBatch& batch);
+    void gather(const ColumnBatch& batch, const std::string& column, std::vector<std::string_view>& values) const;
+};
+
+// Rows satisfying predicates over carried columns (WHERE parts spanning tables)
+class FilterOperator : public Operator {
+public:
+    FilterOperator(std::unique_ptr<Operator> child, std::vector<Predicate> predicates, std::vector<size_t> slots,
+                   OperatorStats* stats = nullptr);
+
+protected:
+    bool produce(ColumnBatch& batch) override;
+
+private:
+    std::unique_ptr<Operator> child;
+    BatchPredicates predicates;
+    std::vector<size_t> slots;      // Pipeline column read by each predicate
+};
+
+// Probe side of an equi-join: each input row is joined with the build rows
+// sharing its key and satisfying the other comparisons of the ON clause;
+// they fill in 'source'. Against a spilled build, the input rows are written
+// to a spill file per partition as they arrive; each partition's rows are
+// then read back a batch at a time and probed like an in-memory build
+// against that partition's hash table, built once its turn comes.
+//
+// The join kind decides what else comes out: an outer join adds the rows of
+// its preserved side that found no partner, NULL-extended, the unmatched
+// build rows once the input is done (their ids must have been kept); a
+// semi-join passes on each input row with a partner once, an anti-join
+// each one without. A row NULL-extended for 'probeSource' has no partner,
+// nor has one with a NULL key, whatever the join kind. 'nullAware' (NOT IN)
+// also rules out every row when the build holds a NULL key, and rows with a
+// NULL key unless the build is empty.
+class HashJoinOperator : public Operator {
+public:
+    HashJoinOperator(std::unique_ptr<Operator> child, const JoinHashTable& hashTable, SelectPlan::JoinKind kind,
+                     bool nullAware, size_t probeSource, size_t probeSlot,
+                     const std::vector<SelectPlan::JoinComparison>& comparisons, size_t source,
+                     const std::vector<PipelineColumn>& columns, size_t sourceCount, QueryArena& arena,
+                     OperatorStats* stats = nullptr);
+
+protected:
+    bool produce(ColumnBatch& batch) override;
+
+private:
+    std::unique_ptr<Operator> child;
+    const JoinHashTable& hashTable;
+    const Table& table;
+    SelectPlan::JoinKind kind;
+    bool nullAware;
+    size_t probeSource;
+    size_t probeSlot;
+    const std::vector<SelectPlan::JoinComparison>& comparisons;
+    size_t source;
+    const std::vector<PipelineColumn>& columns;
+    size_t sourceCount;
+    QueryArena& arena;
+    std::vector<std::pair<size_t, std::string>> carried; // Pipeline columns of the build table
+    std::vector<bool> buildMatched;     // Right and Full: build rows with a partner, by row id
+    bool buildHasNull = false;          // nullAware: some build row has a NULL key
+
+    // Where the probe left off: input row and build match
+    ColumnBatch input;
+    std::vector<size_t> firstMatches;   // First match of each selected input row
+    size_t inputPosition = 0;
+    size_t match = JoinHashTable::noRow;
+    bool matched = false;               // The input row has found a partner
+    bool inputDone = false;
+
+    // Against a partitioned hash table, input batches are looked up a block
+    // at a time (lookupPartitioned) and then taken one by one
+    std::vector<ColumnBatch> block;
+    std::vector<std::vector<size_t>> blockMatches;
+    size_t blockSize = 0;
+    size_t blockPosition = 0;
+    std::vector<std::string_view> blockKeys;
+    std::vector<size_t> blockFirstMatches;
+
+    // Spilled build: the input rows of each partition, and one more file of
+    // rows no build row can match; the partition being read back, how far,
+    // and its hash table with the arena it lives in
+    std::vector<SpillFile> inputPartitions;
+    bool partitioned = false;
+    size_t readPartition = 0;
+    size_t readOffset = 0;
+    std::unique_ptr<QueryArena> partitionArena;
+    std::unique_ptr<JoinHashTable> partitionTable;
+    std::vector<char> readBuffer;
+
+    // Right and Full: the next kept build row to check for a partner
+    size_t unmatchedPosition = 0;
+
+    bool probes(size_t probeRowId, std::string_view key) const;
+    bool keepsUnmatched(std::string_view key) const;
+    bool nextInput();
+    bool readBlock();
+    void partitionInput();
+    bool readPartitionInput(ColumnBatch& batch);
+    void appendUnmatchedBuildRows(ColumnBatch& batch);
+};
+
+// Equi-join of rows so far that arrive in key order with a table stored in
+// key order: the joined table's rows are read in order and walked alongside
+// the input, without a hash table. A key below the one before it (rows
+// reordered by a spilled join) is found by binary search instead, so the
+// result never depends on the input's order. Keys match when they are equal
+// as written, as in a hash join.
+class MergeJoinOperator : public Operator {
+public:
+    MergeJoinOperator(std::unique_ptr<Operator> child, const Table& table, const std::vector<Predicate>& predicates,
+                      const std::vector<JoinKeyFilter>& filters, const std::string& buildColumn, size_t probeSlot,
+                      const std::vector<SelectPlan::JoinComparison>& comparisons, size_t source,
+                      const std::vector<PipelineColumn>& columns, size_t sourceCount, QueryArena& arena,
+                      OperatorStats* buildStats = nullptr, OperatorStats* stats = nullptr);
+
+protected:
+    bool produce(ColumnBatch& batch) override;
+
+private:
+    std::unique_ptr<Operator> child;
+    const Table& table;
+    size_t probeSlot;
+    const std::vector<SelectPlan::JoinComparison>& comparisons;
+    size_t source;
+    size_t columnCount;
+    size_t sourceCount;
+    std::vector<std::pair<size_t, std::string>> carried; // Pipeline columns of the joined table
+    SortedKeys keys;                // The joined table's rows, in key order
+
+    // Where the probe left off: input row, its next candidate, and where
+    // the previous key's candidates start
+    ColumnBatch input;
+    size_t inputPosition = 0;
+    size_t candidate = 0;
+    bool matching = false;
+    size_t cursor = 0;
+    std::string_view previousKey;
+    bool inputDone = false;
+};
+
+// Join on comparisons alone (a.ts BETWEEN b.start AND b.end, a.x < b.y). One
+// side is sorted on the column its band comparisons share; each row of the
+// other side finds its partners there as one range by binary search, and
+// the remaining comparisons are checked per pair. Sorting the joined table
+// keeps the input streaming; when the column is the input's, the input is
+// gathered and sorted instead and each joined row searches it. Outer joins
+// (Left, Right, Full) sort the joined table, and add their unmatched rows
+// NULL-extended as HashJoinOperator does.
+class BandJoinOperator : public Operator {
+public:
+    BandJoinOperator(std::unique_ptr<Operator> child, const Table& table, const std::vector<Predicate>& predicates,
+                     const std::vector<JoinKeyFilter>& filters, SelectPlan::JoinKind kind,
+                     const std::vector<SelectPlan::JoinComparison>& band, bool bandOnBuild,
+                     const std::vector<SelectPlan::JoinComparison>& comparisons, size_t source,
+                     const std::vector<PipelineColumn>& columns, size_t sourceCount, QueryArena& arena,
+                     OperatorStats* buildStats = nullptr, OperatorStats* stats = nullptr);
+
+protected:
+    bool produce(ColumnBatch& batch) override;
+
+private:
+    std::unique_ptr<Operator> child;
+    const Table& table;
+    SelectPlan::JoinKind kind;
+    const std::vector<SelectPlan::JoinComparison>& band;
+    bool bandOnBuild;
+    const std::vector<SelectPlan::JoinComparison>& comparisons;
+    size_t source;
+    const std::vector<PipelineColumn>& columns;
+    size_t sourceCount;
+    QueryArena& arena;
+    std::vector<std::pair<size_t, std::string>> carried; // Pipeline columns of the joined table
+    SortedKeys keys;                // The sorted side: joined rows, or gathered input rows
+    std::vector<size_t> buildRows;  // Input sorted: the joined rows that search it; Right and Full: every joined row
+    std::vector<bool> buildMatched; // Right and Full: joined rows with a partner, by row id
+
+    // Input sorted: every input row, by position in 'keys'
+    std::unique_ptr<PipelineRows> inputRows;
+    bool gathered = false;
+
+    // Where the search left off: the row searching, and its candidates
+    ColumnBatch input;
+    size_t position = 0;            // Input row, or joined row when the input is sorted
+    size_t candidate = 0;
+    size_t candidateEnd = 0;
+    bool exact = true;              // The candidates need no check of the band comparisons
+    bool searching = false;
+    bool matched = false;           // Left and Full: the input row has found a partner
+    bool inputDone = false;
+    size_t unmatchedPosition = 0;   // Right and Full: the next joined row to check for a partner
+
+    // Narrow [candidate, candidateEnd) to the keys within the band given
+    // the other side's values; false when one of them is NULL
+    template <typename OtherValue>
+    bool findRange(OtherValue otherValue);
+};
+
+// Hash aggregation. Output rows hold the group columns and then the
+// aggregates; without group columns there is exactly one row. Aggregates
+// are updated a column at a time over each input batch.
+//
+// The groups live in an arena of their own. Once they come close to the
+// query's memory budget, which is checked before each new group, since one
+// batch can bring hundreds, rows of groups already held are still aggregated
+// in place, and rows of new groups are written to spill files partitioned
+// by group key. Each partition is aggregated on its own after the groups
+// in memory are emitted, spilling again with a different split if it is
+// still too large.
+class AggregateOperator : public Operator {
+public:
+    struct Aggregate {
+        AggregateSpec::Function function;
+        size_t slot;                // Input column; SelectPlan::noSlot for COUNT(*)
+        std::string name;
+    };
+
+    AggregateOperator(std::unique_ptr<Operator> child, std::vector<size_t> groupSlots, std::vector<Aggregate> aggregates,
+                      QueryArena& arena, OperatorStats* stats = nullptr);
+
+protected:
+    bool produce(ColumnBatch& batch) override;
+
+private:
+    struct Accumulator {
+        size_t count = 0;
+        int64_t integerSum = 0;
+        double sum = 0.0;
+        bool integral = true;       // Every value so far was an integer and the sum did not overflow
+        std::string_view extreme;   // MIN or MAX so far
+    };
+
+    struct Groups {
+        explicit Groups(QueryArena& arena) : arena(arena), index(&arena), values(&arena), accumulators(&arena) {}
+
+        QueryArena& arena;
+        std::pmr::unordered_map<std::string_view, uint32_t> index; // Group key -> group number
+        std::pmr::vector<std::string_view> values;                 // Group columns of each group
+        std::pmr::vector<Accumulator> accumulators;                // Aggregates of each group
+        size_t count = 0;
+    };
+
+    // Input rows of new groups spilled by an aggregation pass, to be
+    // aggregated by a later one; 'depth' picks the split
+    struct SpilledRows {
+        SpillFile file;
+        unsigned depth;
+    };
+
+    std::unique_ptr<Operator> child;
+    std::vector<size_t> groupSlots;
+    std::vector<Aggregate> aggregates;
+    QueryArena& arena;
+
+    std::unique_ptr<QueryArena> groupsArena;
+    std::unique_ptr<Groups> groups;
+    std::vector<SpilledRows> spilled;   // Latest last, taken first so few files are open at once
+    size_t columnCount = 0;         // Layout of the input rows
+    size_t sourceCount = 0;
+    size_t emitted = 0;
+    bool consumed = false;
+
+    void consume();
+    template <typename NextBatch>
+    void aggregate(NextBatch nextBatch, unsigned depth);
+    std::string_view groupKey(const ColumnBatch& batch, uint32_t row, std::string& key) const;
+    uint32_t findGroup(std::string_view key) const;
+    uint32_t addGroup(const ColumnBatch& batch, uint32_t row, std::string_view key);
+    std::string_view result(const Aggregate& aggregate, const Accumulator& accumulator);
+};
+
+// Sort of all input rows by the keys (ORDER BY). With a limit only the
+// best rows are kept: the buffer is cut back to them whenever it reaches
+// twice the limit, so a top-N query holds O(N) rows.
+//
+// The buffer lives in an arena of its own. When it comes close to the
+// query's memory budget, it is sorted and written out as a run, and the
+// arena freed; the runs are merged at the end, a few rows of each at a time.
+class SortOperator : public Operator {
+public:
+    SortOperator(std::unique_ptr<Operator> child, std::vector<SelectPlan::SortKey> keys, size_t limit, QueryArena& arena,
+                 OperatorStats* stats = nullptr);
+
+protected:
+    bool produce(ColumnBatch& batch) override;
+
+private:
+    struct Rows {
+        explicit Rows(std::pmr::memory_resource* resource)
+            : rowIds(resource), values(resource), numbers(resource), numeric(resource), order(resource) {}
+
+        size_t count = 0;
+        std::pmr::vector<size_t> rowIds;            // sourceCount per row
+        std::pmr::vector<std::string_view> values;  // columnCount per row
+        std::pmr::vector<double> numbers;           // Key values parsed once: keys.size() per row
+        std::pmr::vector<uint8_t> numeric;
+        std::pmr::vector<uint32_t> order;
+    };
+
+    // A sorted run on disk: the rows read from it but not yet merged, and
+    // the next of them decoded, laid out like a row of Rows
+    struct Run {
+        SpillFile file;
+        size_t offset = 0;
+        std::vector<char> rows;
+        size_t position = 0;
+        std::vector<size_t> rowIds;
+        std::vector<std::string_view> values;
+        std::vector<double> numbers;
+        std::vector<uint8_t> numeric;
+    };
+
+    std::unique_ptr<Operator> child;
+    std::vector<SelectPlan::SortKey> keys;
+    size_t limit;
+    QueryArena& arena;
+
+    size_t columnCount = 0;
+    size_t sourceCount = 0;
+    std::unique_ptr<QueryArena> rowsArena;
+    std::unique_ptr<Rows> rows;
+    std::vector<Run> runs;
+    std::vector<size_t> merging;    // Runs with rows left, as a heap on their next row
+    size_t emitted = 0;
+    bool sorted = false;
+
+    void sortInput();
+    bool before(uint32_t a, uint32_t b) const;
+    void keepBest();
+    void orderRows();
+    void writeRun();
+    size_t runRowBytes() const;
+    bool nextRunRow(Run& run);
+    bool runBefore(size_t a, size_t b) const;
+};
+
+// Stop after a number of rows (LIMIT), without pulling further input
+class LimitOperator : public Operator {
+public:
+    LimitOperator(std::unique_ptr<Operator> child, size_t limit, OperatorStats* stats = nullptr);
+
+protected:
+    bool produce(ColumnBatch& batch) override;
+
+private:
+    std::unique_ptr<Operator> child;
+    size_t remaining;
+};
+
+// The output columns of the selected rows, read from the source records
+// through the row ids or from aggregated columns. Output batches hold only
+// the output columns, in the order given.
+class ProjectOperator : public Operator {
+public:
+    ProjectOperator(std::unique_ptr<Operator> child, const std::vector<SelectPlan::OutputColumn>& outputs,
+                    const std::vector<Table*>& sources, OperatorStats* stats = nullptr);
+
+protected:
+    bool produce(ColumnBatch& batch) override;
+
+private:
+    std::unique_ptr<Operator> child;
+    const std::vector<SelectPlan::OutputColumn>& outputs;
+    const std::vector<Table*>& sources;
+    ColumnBatch input;
+};
+
+// End of a plan: drains the root and materializes result rows, keyed by
+// output column name. Absent values are left out of a row. Rows go back to
+// the client, so each is charged to the query's memory tracker when given.
+class ResultSink {
+public:
+    ResultSink(std::vector<std::string> names, MemoryTracker* memory = nullptr);
+
+    void run(Operator& root);
+
+    std::vector<std::map<std::string, std::string>>& getRows() { return rows; }
+
+private:
+    std::vector<std::string> names;
+    MemoryTracker* memory;
+    std::vector<std::map<std::string, std::string>> rows;
+};
+
+#endif // OPERATOR_H
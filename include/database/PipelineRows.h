@@ -0,0 +1,65 @@
+#ifndef PIPELINEROWS_H
+#define PIPELINEROWS_H
+
+#include <cstddef>
+#include <map>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "ColumnBatch.h"
+
+// A column some operator of a join pipeline reads
+struct PipelineColumn {
+    size_t source;       // 0 is the primary table, k the k-th joined table
+    std::string column;  // Unqualified column name
+};
+
+// Late-materialized rows of a join pipeline. Instead of copying whole
+// records, each row holds its row id in every source table joined so far
+// plus views of just the columns later operators read (join keys and WHERE
+// columns). Output columns are fetched through the row ids once the final
+// rows are known. Storage is flat and lives in the query arena.
+class PipelineRows {
+public:
+    static constexpr size_t noRow = static_cast<size_t>(-1);
+
+    PipelineRows(const std::vector<PipelineColumn>& columns, size_t sourceCount, std::pmr::memory_resource* resource);
+
+    size_t size() const { return rowCount; }
+    void reserve(size_t rows);
+
+    const std::vector<PipelineColumn>& getColumns() const { return *columns; }
+    size_t getSourceCount() const { return sourceCount; }
+
+    // Append a row with no sources set, or a copy of another pipeline's row
+    // (same layout); returns its position
+    size_t appendRow();
+    size_t appendRow(const PipelineRows& other, size_t row);
+
+    // Move rows between a pipeline and executor batches of the same layout
+    size_t appendRow(const ColumnBatch& batch, size_t row);
+    void copyRow(size_t row, ColumnBatch& batch) const;
+
+    // Fill in a row's source: its row id and the carried columns read from the record
+    void setSource(size_t row, size_t source, size_t rowId, const std::map<std::string, std::string>& record);
+
+    // Make a row's source NULL, as an outer join does without a match: no
+    // row id, and empty (not null) views of its carried columns
+    void setNullSource(size_t row, size_t source);
+
+    size_t getRowId(size_t row, size_t source) const { return rowIds[row * sourceCount + source]; }
+
+    // Value of a carried column; a null view (data() == nullptr) when the
+    // record has no such field
+    std::string_view getValue(size_t row, size_t column) const { return values[row * columns->size() + column]; }
+
+private:
+    const std::vector<PipelineColumn>* columns;
+    size_t sourceCount;
+    size_t rowCount = 0;
+    std::pmr::vector<size_t> rowIds;           // sourceCount per row
+    std::pmr::vector<std::string_view> values; // columns->size() per row
+};
+
+#endif // PIPELINEROWS_H
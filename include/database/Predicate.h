@@ -0,0 +1,123 @@
+#ifndef PREDICATE_H
+#define PREDICATE_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "LikePattern.h"
+#include "../sql/SQLParser.h"
+
+// A WHERE condition prepared for repeated evaluation: the operator is decoded
+// and the operand parsed once.
+//
+// Two values compare as numbers when both parse completely as numbers, and
+// as strings otherwise. String order is what DATETIME values need, since
+// "YYYY-MM-DD HH:MM:SS" sorts chronologically.
+//
+// LIKE always matches as text, through a LikePattern. IN holds when '='
+// would hold for one of its values; the list is kept as a hash set of
+// numbers and one of strings, so each row costs a lookup however long the
+// list is. BETWEEN holds when both '>=' its lower bound and '<=' its upper
+// one would; the bounds compare as numbers only when both are numbers.
+class Predicate {
+public:
+    enum class Op { Equal, NotEqual, Less, Greater, LessEqual, GreaterEqual, Like, In, Between };
+
+    // Throws std::runtime_error for an unsupported operator
+    explicit Predicate(const SQLParser::Condition& condition);
+
+    // Compile a WHERE clause; throws on an unsupported operator or relation
+    static std::vector<Predicate> compile(const std::vector<SQLParser::Condition>& conditions);
+
+    const std::string& getField() const { return field; }
+    Op getOp() const { return op; }
+    const std::string& getOperand() const { return operand; }   // BETWEEN: the lower bound
+    bool isNumeric() const { return numeric; }   // IN: some value is a number
+    double getNumber() const { return number; }
+    const std::string& getUpperOperand() const { return upperOperand; } // BETWEEN only
+    double getUpperNumber() const { return upperNumber; }
+    const LikePattern* getPattern() const { return pattern.get(); } // LIKE only
+
+    // True if this predicate is OR-ed (rather than AND-ed) onto the ones before it
+    bool isOr() const { return orRelation; }
+
+    bool matches(std::string_view value) const;
+
+    // Evaluate the predicate on values[rows[i]] for every i, storing 1 or 0
+    // in matches[rows[i]]. The operator is decoded once for the whole batch.
+    // Returns false at the first null view (a record without the field).
+    bool matchRows(const std::string_view* values, const uint32_t* rows, size_t count, uint8_t* matches) const;
+
+    // Order of two values under the same rules: negative, zero or positive
+    static int compareValues(std::string_view lhs, std::string_view rhs);
+
+    // The comparison holding with its operands swapped (a < b is b > a)
+    static Op swapOperands(Op op);
+
+    // Key under which equal values meet: numbers by value, anything else as
+    // written. Hash indexes store values under this key.
+    static std::string equalityKey(std::string_view value);
+
+    // True for an '=' or IN predicate whose matches are exactly the values
+    // sharing one of getEqualityKeys() (every one except '=' against NaN)
+    bool hasEqualityKey() const;
+
+    // Equality keys of the operand, or of each distinct IN value but NaN
+    const std::vector<std::string>& getEqualityKeys() const { return equalityKeys; }
+
+    // Number of distinct values of an IN list
+    size_t getListSize() const { return equalityKeys.size(); }
+
+    // True if some number in [min, max] could satisfy the predicate (numeric operand only)
+    bool mayMatchNumbers(double min, double max) const;
+
+    // True if some string in [min, max] could satisfy the predicate under string order
+    bool mayMatchStrings(std::string_view min, std::string_view max) const;
+
+    // Fold per-predicate results left to right with each predicate's AND/OR,
+    // the way the parser records relations. 'test' maps a Predicate to bool.
+    template <typename Test>
+    static bool combine(const std::vector<Predicate>& predicates, Test test) {
+        if (predicates.empty()) {
+            return true;
+        }
+        bool result = test(predicates[0]);
+        for (size_t i = 1; i < predicates.size(); ++i) {
+            if (predicates[i].isOr()) {
+                result = result || test(predicates[i]);
+            } else {
+                result = result && test(predicates[i]);
+            }
+        }
+        return result;
+    }
+
+private:
+    std::string field;
+    Op op;
+    std::string operand;
+    bool numeric;      // the operand parses completely as a number
+    double number;
+    std::string upperOperand; // BETWEEN
+    double upperNumber;
+    bool orRelation;
+    std::vector<std::string> equalityKeys;
+
+    struct ValueSet;
+    std::shared_ptr<const ValueSet> inValues;      // IN, shared by copies of the predicate
+    std::shared_ptr<const LikePattern> pattern;    // LIKE
+
+    bool inList(std::string_view value) const;
+    bool inRange(std::string_view value) const;
+
+    template <typename T>
+    bool holds(const T& lhs, const T& rhs) const;
+
+    template <typename Compare>
+    bool matchRowsWith(Compare compare, const std::string_view* values, const uint32_t* rows, size_t count,
+                       uint8_t* matches) const;
+};
+
+#endif // PREDICATE_H
@@ -0,0 +1,45 @@
+#ifndef QUERYARENA_H
+#define QUERYARENA_H
+
+#include <cstddef>
+#include <memory_resource>
+#include <string_view>
+#include "MemoryTracker.h"
+
+// Per-query bump allocator. Pipeline rows, join hash tables and their Bloom
+// filters are carved out of it and released in one shot when the
+// arena goes out of scope at the end of the query. With a tracker, every
+// chunk taken from the heap is charged to it, so outgrowing the query's
+// budget throws MemoryBudgetExceeded.
+class QueryArena : public std::pmr::memory_resource {
+public:
+    explicit QueryArena(MemoryTracker* tracker = nullptr);
+
+    QueryArena(const QueryArena&) = delete;
+    QueryArena& operator=(const QueryArena&) = delete;
+
+    // Total bytes handed out to the query so far
+    size_t bytesAllocated() const { return allocated; }
+
+    // Tracker charged for the arena's heap chunks, if any
+    MemoryTracker* getTracker() const { return upstream.getTracker(); }
+
+    // Copy a string into the arena and return a view of the copy
+    std::string_view intern(std::string_view value);
+
+    // Concatenate "table.column" into the arena
+    std::string_view qualify(std::string_view table, std::string_view column);
+
+private:
+    void* do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override;
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+
+    // First chunk lives inline so small queries never touch the heap
+    alignas(std::max_align_t) char initialBuffer[16 * 1024];
+    TrackingResource upstream;
+    std::pmr::monotonic_buffer_resource buffer;
+    size_t allocated = 0;
+};
+
+#endif // QUERYARENA_H
@@ -0,0 +1,58 @@
+#ifndef QUERYLOG_H
+#define QUERYLOG_H
+
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// One captured statement
+struct QueryLogEntry {
+    int64_t timestampMicros = 0;   // wall clock at start, microseconds since the Unix epoch
+    uint64_t durationNanos = 0;    // parse + execute
+    size_t rowsAffected = 0;       // rows inserted, updated, deleted or returned
+    std::string type;              // SELECT, INSERT, ... or INVALID if it did not parse
+    std::string statement;
+    std::string error;             // empty if the statement succeeded
+};
+
+// Appends entries to a JSONL file, one object per line, flushed per statement
+// so that a crash loses nothing that already ran
+class QueryLogWriter {
+public:
+    explicit QueryLogWriter(const std::string& path);
+
+    void append(const QueryLogEntry& entry);
+
+private:
+    std::mutex mutex;
+    std::ofstream file;
+};
+
+class QueryLog {
+public:
+    static std::string toJson(const QueryLogEntry& entry);
+    static QueryLogEntry fromJson(const std::string& line);
+
+    // All entries of a log file; throws std::runtime_error on a malformed line
+    static std::vector<QueryLogEntry> read(const std::string& path);
+
+    // Statement text with literals replaced by '?', so that executions of the
+    // same query shape group together
+    static std::string normalize(const std::string& statement);
+
+    // Re-execute the entries through 'execute', which runs one statement and
+    // returns the rows it affected, throwing if it fails. With preservePacing
+    // the original gaps between statements are kept; otherwise they run back
+    // to back. Latency percentiles per statement type are written to 'report'.
+    static void replay(const std::function<size_t(const std::string&)>& execute, const std::vector<QueryLogEntry>& entries,
+                       bool preservePacing, std::ostream& report);
+
+    // Query shapes with executions at or above the threshold, slowest total first
+    static void writeSlowQueryReport(const std::vector<QueryLogEntry>& entries, double thresholdMs, std::ostream& report);
+};
+
+#endif // QUERYLOG_H
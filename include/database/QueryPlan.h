@@ -0,0 +1,179 @@
+#ifndef QUERYPLAN_H
+#define QUERYPLAN_H
+
+#include <chrono>
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "PipelineRows.h"
+#include "Predicate.h"
+#include "../sql/SQLParser.h"
+
+class Table;
+
+// Runtime statistics of one plan operator, reported by EXPLAIN ANALYZE
+struct OperatorStats {
+    size_t rowsIn = 0;
+    size_t rowsOut = 0;
+    size_t loops = 0;
+    double elapsedMs = 0.0;
+    size_t bytesAllocated = 0;
+    size_t bytesSpilled = 0;
+    size_t partitions = 0;          // Hash build: radix partitions
+    size_t workers = 0;             // Hash build: threads it ran on
+};
+
+// Operator tree of a query as printed by EXPLAIN. Nodes are added bottom-up;
+// the last node added is the root.
+class QueryPlan {
+public:
+    struct Node {
+        std::string op;
+        std::string detail;
+        std::vector<size_t> children;
+        OperatorStats stats;
+        double estimatedRows = -1.0; // Planner's estimate of the rows out, if any
+    };
+
+    size_t addNode(const std::string& op, const std::string& detail, const std::vector<size_t>& children = {});
+    Node& getNode(size_t id) { return nodes[id]; }
+    OperatorStats& getStats(size_t id) { return nodes[id].stats; }
+    void setEstimatedRows(size_t id, double rows) { nodes[id].estimatedRows = rows; }
+
+    // Whole-query figures printed under an analyzed plan
+    void setExecutionTime(double executionMs) { this->executionMs = executionMs; }
+    void setPeakMemory(size_t peakBytes) { this->peakBytes = peakBytes; }
+
+    void print(std::ostream& out, bool analyze) const;
+
+private:
+    std::vector<Node> nodes;
+    double executionMs = 0.0;
+    size_t peakBytes = 0;
+
+    void printNode(std::ostream& out, size_t id, size_t depth, bool analyze) const;
+};
+
+// Times one invocation of an operator with a monotonic clock
+class OperatorTimer {
+public:
+    explicit OperatorTimer(OperatorStats& stats);
+    ~OperatorTimer();
+
+private:
+    OperatorStats& stats;
+    std::chrono::steady_clock::time_point start;
+};
+
+// An aggregate of a SELECT list, such as COUNT(*) or SUM(TOTALAMOUNT)
+struct AggregateSpec {
+    enum class Function { Count, Sum, Min, Max, Avg };
+    Function function;
+    std::string argument;  // Column, or "*" for COUNT(*)
+    std::string name;      // As written; the name of the result column
+};
+
+// Recognize an aggregate call; false for a plain column
+bool parseAggregate(const std::string& field, AggregateSpec& spec);
+
+// Physical plan of a SELECT statement, built by Database::planSelectQuery and
+// run by Database::executeSelectPlan as a tree of batch operators: a scan,
+// the joins and a filter, then aggregation, sorting and a limit if asked
+// for, and a projection of the output columns
+struct SelectPlan {
+    static constexpr size_t noSlot = static_cast<size_t>(-1);
+
+    // How a join step finds the joined table's rows for each row so far
+    enum class JoinMethod {
+        Hash,       // Hash table of the joined table on the key
+        Merge,      // Key equality, both sides stored in key order: walked in step
+        Band        // Comparisons only: one side sorted on a column and searched by range
+    };
+
+    // Which rows a join step keeps. Left keeps every row so far and Right
+    // every row of the joined table, NULL-extended when nothing matches;
+    // Full keeps both. Semi keeps the rows so far with a match, once, and
+    // Anti those without one; neither adds the joined table's columns.
+    enum class JoinKind { Inner, Left, Right, Full, Semi, Anti };
+
+    // A join condition on a pair of rows: the carried value of the probe
+    // source 'op' the joined table's value. NULL satisfies no comparison.
+    struct JoinComparison {
+        std::string probeColumn;        // Unqualified column of the probe source
+        size_t probeSlot;               // Its position in pipeline rows
+        Predicate::Op op;
+        std::string buildColumn;        // Column of the joined table
+    };
+
+    struct JoinStep {
+        JoinKind kind;
+        JoinMethod method;
+        Table* table;                   // Joined (build side) table
+        size_t source;                  // Position of 'table' in 'sources'
+        std::vector<SQLParser::Condition> conditions; // The ON clause, for plan output
+        std::string buildColumn;        // Hash and Merge: join key of 'table'
+        size_t probeSource;             // Source the other side of the conditions is from, already joined
+        std::string probeColumn;        // Hash and Merge: join key of the probe source, unqualified
+        std::string probeKey;           // The same column qualified ("TABLE.COLUMN"), for plan output
+        size_t probeSlot;               // Position of the probe column in pipeline rows
+        std::vector<JoinComparison> band;  // Band: the comparisons searched by, all on one column of one side
+        bool bandOnBuild = true;        // Band: that column is the joined table's (else the probe source's)
+        std::vector<JoinComparison> comparisons; // The other ON conditions, checked on each pair
+        bool nullAware = false;         // Anti for NOT IN: a NULL on either side of the key rules a row out
+        std::vector<size_t> bloomFilters; // Joins whose Bloom filters are pushed into this build scan
+        size_t buildNode;
+        size_t joinNode;
+    };
+
+    // A column of the result, read through the final rows' row ids or,
+    // after aggregation, from a column of the aggregated rows
+    struct OutputColumn {
+        std::string name;               // Name in the result
+        size_t source;
+        std::string column;
+        size_t slot = noSlot;           // Aggregated column, if any
+        bool required = true;           // Rows must have it; SELECT * leaves out absent fields
+    };
+
+    struct Aggregate {
+        AggregateSpec spec;
+        size_t slot;                    // Pipeline column of the argument; noSlot for COUNT(*)
+    };
+
+    struct SortKey {
+        size_t slot;                    // Pipeline column or, after aggregation, aggregated column
+        bool descending;
+    };
+
+    Table* primaryTable = nullptr;
+    std::vector<Table*> sources;        // Primary table, each joined table as written, then each subquery's table
+    size_t driver = 0;                  // Source scanned first; the joins add the others to its rows
+    std::vector<JoinStep> joins;        // In the chosen order, each probing with the rows so far
+    std::vector<std::vector<SQLParser::Condition>> scanConditions; // WHERE parts pushed into each source's scan, unqualified
+    std::vector<SQLParser::Condition> filterConditions; // WHERE parts spanning tables, applied after the joins
+    std::vector<PipelineColumn> columns; // Columns carried by pipeline rows: join keys and filter columns
+    std::vector<size_t> filterSlots;    // Pipeline column read by each filter condition
+    std::vector<OutputColumn> outputColumns; // For SELECT *, every column of every table
+    bool aggregated = false;            // GROUP BY or aggregates: rows are grouped before sorting
+    std::vector<size_t> groupSlots;     // Pipeline column of each GROUP BY column
+    std::vector<Aggregate> aggregates;  // Aggregated columns come after the group columns
+    std::vector<SortKey> sortKeys;      // ORDER BY, most significant first
+    long long limit = -1;               // LIMIT, or -1 without one
+    std::vector<size_t> bloomFilters;   // Joins whose Bloom filters are pushed into the driver's scan
+    size_t scanNode = 0;
+    size_t filterNode = 0;              // Only used when filterConditions is not empty
+    size_t aggregateNode = 0;
+    size_t sortNode = 0;
+    size_t limitNode = 0;
+    size_t projectNode = 0;
+    QueryPlan tree;
+};
+
+// Render a WHERE clause or join condition for plan output
+std::string describeConditions(const std::vector<SQLParser::Condition>& conditions);
+
+// Format a byte count for humans (KB or MB)
+std::string formatBytes(size_t bytes);
+
+#endif // QUERYPLAN_H
@@ -0,0 +1,62 @@
+#ifndef RESULTCACHE_H
+#define RESULTCACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Results of read-only SELECTs, kept for queries that are run again
+// unchanged. An entry records the version of every table the query read and
+// is only served while each of them still has that version, so any insert,
+// update or delete of one of those tables retires it. Entries are evicted
+// least recently used first once their estimated size exceeds the limit.
+class ResultCache {
+public:
+    using Rows = std::vector<std::map<std::string, std::string>>;
+    using TableVersions = std::vector<std::pair<std::string, uint64_t>>;
+
+    // Most bytes the cached results may hold; 0 disables the cache and
+    // drops every entry
+    void setLimit(size_t bytes);
+    bool enabled() const { return limit > 0; }
+
+    // The rows cached under 'key' if every table they were read from still
+    // has the recorded version ('currentVersion' returns 0 for a table that
+    // no longer exists); null otherwise. A stale entry is dropped.
+    const Rows* find(const std::string& key, const std::function<uint64_t(const std::string&)>& currentVersion);
+
+    // Cache the rows of a query that read the given tables. Results larger
+    // than the whole cache are not kept.
+    void insert(const std::string& key, TableVersions tables, const Rows& rows);
+
+    // Drop every entry that read the table
+    void eraseTable(const std::string& tableName);
+
+    size_t getBytes() const { return bytes; }
+    size_t getEntryCount() const { return entries.size(); }
+    size_t getLimit() const { return limit; }
+
+private:
+    struct Entry {
+        std::string key;
+        TableVersions tables;
+        Rows rows;
+        size_t bytes = 0;
+    };
+
+    size_t limit = 0;
+    size_t bytes = 0;
+    std::list<Entry> entries;  // Most recently used first
+    std::unordered_map<std::string, std::list<Entry>::iterator> index;
+
+    void erase(std::list<Entry>::iterator entry);
+    void evictTo(size_t target);
+};
+
+#endif // RESULTCACHE_H
@@ -0,0 +1,58 @@
+#ifndef SORTEDKEYS_H
+#define SORTEDKEYS_H
+
+#include <cstddef>
+#include <memory_resource>
+#include <string_view>
+#include <vector>
+
+// Keys of a join column with the row each came from, in ascending order for
+// range search. Keys compare the way Predicate::compareValues does: by value
+// when every key is a number, as strings when none is. A mix of the two (or
+// NaN) has no such order; those keys are kept as added and every search
+// covers all of them, to be compared one by one.
+class SortedKeys {
+public:
+    explicit SortedKeys(std::pmr::memory_resource* resource = std::pmr::get_default_resource()) : entries(resource) {}
+
+    void reserve(size_t keys) { entries.reserve(keys); }
+
+    // Add a key; empty values are NULL, which no comparison holds for, and
+    // are left out
+    void add(std::string_view key, size_t row);
+
+    // Order the keys added so far; 'presorted' when they came in order
+    void sort(bool presorted = false);
+
+    size_t size() const { return entries.size(); }
+    std::string_view key(size_t i) const { return entries[i].key; }
+    size_t row(size_t i) const { return entries[i].row; }
+
+    // True if lowerBound and upperBound can place 'bound' among the keys
+    bool searchable(std::string_view bound) const;
+
+    // First position from 'from' on whose key is not less than (lowerBound)
+    // or greater than (upperBound) a searchable bound. Gallops from 'from',
+    // so a walk through ascending bounds costs about one pass.
+    size_t lowerBound(std::string_view bound, size_t from = 0) const;
+    size_t upperBound(std::string_view bound, size_t from = 0) const;
+
+private:
+    struct Entry {
+        std::string_view key;
+        double number;              // The key's value when it is a number
+        size_t row;
+    };
+
+    std::pmr::vector<Entry> entries;
+    size_t numbers = 0;             // Keys that are numbers
+    bool unordered = false;         // A NaN key
+
+    bool numeric() const { return numbers == entries.size(); }
+
+    // First position from 'from' on for which 'before' is false
+    template <typename Before>
+    size_t search(size_t from, Before before) const;
+};
+
+#endif // SORTEDKEYS_H
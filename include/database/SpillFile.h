@@ -0,0 +1,45 @@
+#ifndef SPILLFILE_H
+#define SPILLFILE_H
+
+#include <cstddef>
+#include <cstdio>
+#include <vector>
+
+// Anonymous temporary file holding operator state that does not fit in the
+// query's memory budget. The operating system removes it once it is closed.
+class SpillFile {
+public:
+    SpillFile();
+    ~SpillFile();
+
+    SpillFile(SpillFile&& other) noexcept;
+    SpillFile& operator=(SpillFile&& other) noexcept;
+    SpillFile(const SpillFile&) = delete;
+    SpillFile& operator=(const SpillFile&) = delete;
+
+    // Append bytes at the end of the file
+    void write(const void* data, size_t bytes);
+
+    // Read 'bytes' starting at 'offset' of what was written
+    void read(size_t offset, void* data, size_t bytes) const;
+
+    size_t size() const { return written; }
+
+    // Fixed-size values, e.g. row ids
+    template <typename T>
+    void writeValues(const std::vector<T>& values) {
+        write(values.data(), values.size() * sizeof(T));
+    }
+
+    template <typename T, typename Allocator>
+    void readValues(std::vector<T, Allocator>& values) const {
+        values.resize(written / sizeof(T));
+        read(0, values.data(), values.size() * sizeof(T));
+    }
+
+private:
+    std::FILE* file;
+    size_t written = 0;
+};
+
+#endif // SPILLFILE_H
@@ -0,0 +1,73 @@
+#ifndef STATISTICS_H
+#define STATISTICS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "Predicate.h"
+
+// HyperLogLog sketch of the number of distinct strings added. 2^precision
+// one-byte registers; the standard error is about 1.04 / sqrt(2^precision).
+class HyperLogLog {
+public:
+    explicit HyperLogLog(int precision = 12);
+
+    void add(std::string_view value);
+    double estimate() const;
+
+private:
+    int precision;
+    std::vector<uint8_t> registers;
+};
+
+// Statistics of one column, gathered by ANALYZE. Empty values stand in for
+// NULL, as in the rest of the engine.
+struct ColumnStatistics {
+    struct CommonValue {
+        std::string value;
+        double frequency;              // Fraction of all rows
+    };
+
+    double nullFraction = 0.0;         // Fraction of rows with an empty value
+    double distinct = 0.0;             // Distinct non-empty values (HyperLogLog estimate)
+    double averageWidth = 0.0;         // Mean length of the non-empty values
+    std::vector<CommonValue> mostCommon;  // Most frequent values, most frequent first
+    std::vector<std::string> histogram;   // Equi-depth bucket bounds of the remaining values
+    bool numericHistogram = false;     // Bounds (and the values) are all numbers, ordered by value
+
+    // Guess for the non-common values matching a LIKE, which neither the
+    // distinct count nor the histogram describe
+    static constexpr double likeFraction = 0.1;
+
+    // Estimated fraction of rows satisfying the predicate
+    double selectivity(const Predicate& predicate) const;
+
+private:
+    double histogramFraction(const Predicate& predicate) const;
+};
+
+// Statistics of a table as of its last ANALYZE
+struct TableStatistics {
+    size_t rowCount = 0;
+    size_t sampledRows = 0;
+    std::map<std::string, ColumnStatistics> columns;
+};
+
+class Statistics {
+public:
+    // Rows read for histograms and most common values; distinct counts see every row
+    static constexpr size_t sampleSize = 30000;
+    static constexpr size_t histogramBuckets = 100;
+    static constexpr size_t mostCommonLimit = 10;
+
+    // Gather statistics of the given columns in one pass over the records:
+    // every value feeds a HyperLogLog sketch while a reservoir sample of the
+    // rows is kept for the other figures
+    static TableStatistics analyze(const std::vector<std::map<std::string, std::string>>& records,
+                                   const std::vector<std::string>& columns);
+};
+
+#endif // STATISTICS_H
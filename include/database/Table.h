@@ -1,14 +1,41 @@
 #ifndef TABLE_H
 #define TABLE_H
 
+#include <cstdint>
 #include <string>
 #include <map>
 #include <vector>
 #include <set>
+#include <unordered_map>
+#include <memory>
 #include "Field.h"
 #include "Database.h"
+#include "HashJoin.h"
+#include "ValidationPlan.h"
+#include "QueryPlan.h"
+#include "Predicate.h"
+#include "ZoneMap.h"
+#include "TrigramIndex.h"
+#include "Statistics.h"
+#include "MemoryTracker.h"
 #include "../sql/SQLParser.h"
 
+// A change to a table's rows, reported to its observers once applied. An
+// update lists each changed row's old and new values at the same position
+// of 'before' and 'after'; an insert has only 'after', a delete only 'before'.
+struct TableChange {
+    enum class Kind { Insert, Update, Delete };
+    Kind kind;
+    std::vector<std::map<std::string, std::string>> before;
+    std::vector<std::map<std::string, std::string>> after;
+};
+
+class TableObserver {
+public:
+    virtual ~TableObserver() = default;
+    virtual void tableChanged(const Table& table, const TableChange& change) = 0;
+};
+
 class Table {
 public:
     // Constructor
@@ -27,41 +54,123 @@ public:
     // Insert a record into the table
     void insertRecord(const std::map<std::string, std::string>& record);
 
-    // Select records based on conditions
-    std::vector<std::map<std::string, std::string>> selectRecords(
-        const std::vector<std::string>& fieldsToSelect,
-        const std::vector<SQLParser::Condition>& conditions) const;
+    // Insert a batch of records; either every record is inserted or none is
+    void insertRecords(const std::vector<std::map<std::string, std::string>>& newRecords);
 
-    // Update records based on conditions
-    void updateRecords(
+    // Update records based on conditions; returns the number of rows updated.
+    // All or nothing: every row is validated before any is changed.
+    size_t updateRecords(
         const std::map<std::string, std::string>& newValues,
         const std::vector<SQLParser::Condition>& conditions);
 
-    void enforceConstraintsOnUpdate(const std::map<std::string, std::string> &originalRecord, const std::map<std::string, std::string> &updatedRecord);
-
-    // Delete records based on conditions
-    void deleteRecords(const std::vector<SQLParser::Condition>& conditions);
+    // Delete records based on conditions; returns the number of rows deleted.
+    // All or nothing, including cascades.
+    size_t deleteRecords(const std::vector<SQLParser::Condition>& conditions);
 
     // Get the name of the table
     std::string getName() const;
 
+    // Observers are told of every change to the rows, in the order the
+    // changes are made; cascades into other tables report there first
+    void addObserver(TableObserver* observer);
+    void removeObserver(TableObserver* observer);
+
+    // Rows computed elsewhere (materialized views): no validation or
+    // constraint checks, but indexes, summaries, the version and observers
+    // are kept up to date. removeRows and setRows take ascending positions.
+    void replaceRows(std::vector<std::map<std::string, std::string>> rows);
+    void appendRows(const std::vector<std::map<std::string, std::string>>& rows);
+    void removeRows(const std::vector<size_t>& rowIds);
+    void setRows(const std::vector<std::pair<size_t, std::map<std::string, std::string>>>& rows);
+
+    // Changes whenever the table's rows or columns do. Versions are drawn
+    // from one process-wide sequence, so a table dropped and created again
+    // never repeats one; 0 is never used.
+    uint64_t getVersion() const { return version; }
+
+    // Estimated heap bytes held by the table
+    struct MemoryUsage {
+        size_t rows = 0;        // The records themselves
+        size_t indexes = 0;     // Unique keys, row index, reverse references and trigram indexes
+        size_t summaries = 0;   // Zone maps and planner statistics
+    };
+    MemoryUsage memoryUsage() const;
+
     // Get all records (for testing or other purposes)
     const std::vector<std::map<std::string, std::string>>& getRecords() const;
 
     // Get the fields of the table
     const std::map<std::string, Field*>& getFields() const;
 
+    // Get the precompiled validation rules of the table
+    const ValidationPlan& getValidationPlan() const;
+
     bool checkForeignKeyConstraint(const std::string& referencedTableName,
                                    const std::string& referencedColumnName,
                                    const std::string& value) const;
 
+    // Probe the unique index of a primary key column
+    bool containsKey(const std::string& fieldName, const std::string& value) const;
+
+    // Number of rows whose foreign key column holds the given value
+    size_t countReferences(const std::string& fieldName, const std::string& value) const;
+
+
+    // Positions of the rows satisfying the predicates and passing every
+    // pushed-down join filter, found by a ScanOperator. Uses the row index or
+    // zone maps where it can; the rows actually read are recorded in
+    // scanStats when given.
+    std::vector<size_t> scanRowIds(const std::vector<Predicate>& predicates, const std::vector<JoinKeyFilter>& filters,
+                                   OperatorStats* scanStats = nullptr) const;
+
+    // Gather column statistics for the planner (ANALYZE)
+    void analyze();
+
+    // Statistics of the last ANALYZE, or null if there was none
+    const TableStatistics* getStatistics() const;
+
+    // True once more rows have been inserted, updated or deleted since the
+    // last ANALYZE than 'fraction' of the rows it saw (plus a small minimum)
+    bool statisticsStale(double fraction) const;
+
+    // Planner estimates: the rows satisfying the predicates, and the number
+    // of distinct values in a column. Cheap; they never scan the table. Column
+    // statistics are used when the table has been analyzed.
+    double estimateRows(const std::vector<Predicate>& predicates) const;
+    double estimateDistinct(const std::string& fieldName) const;
 
-    static std::vector<std::map<std::string, std::string>> performInnerJoin(
-        const std::vector<std::map<std::string, std::string>>& leftRecords,
-        const std::vector<std::map<std::string, std::string>>& rightRecords,
-        const SQLParser::Condition& joinCondition,
-        const std::string& rightTableName,
-        const std::string& leftTableName);
+    // True if every row has a value in the column and the rows are stored
+    // in ascending order of it, all numbers or all strings (a merge join
+    // reads such a column in key order). Checked once per version.
+    bool isSortedOn(const std::string& fieldName) const;
+
+    // The predicate a scan answers from the row index instead of reading
+    // every block: an '=' or IN on a primary key column within a pure
+    // conjunction. Null if there is none.
+    const Predicate* findIndexPredicate(const std::vector<Predicate>& predicates) const;
+
+    // Positions of the rows the row index holds under an indexed predicate's
+    // keys (one probe per IN value), ascending
+    std::vector<size_t> lookupRows(const Predicate& predicate) const;
+
+    // Build a trigram index over a column (CREATE INDEX ... USING TRIGRAM);
+    // throws if the column is missing or already has one
+    void createTrigramIndex(const std::string& indexName, const std::string& fieldName);
+
+    // Drop the named index; false if the table has none by that name
+    bool dropIndex(const std::string& indexName);
+    bool hasIndex(const std::string& indexName) const;
+
+    // The predicate a scan answers from a trigram index when no row index
+    // applies: a LIKE on an indexed column with a literal run of three
+    // characters, within a pure conjunction. Null if there is none.
+    const Predicate* findTrigramPredicate(const std::vector<Predicate>& predicates) const;
+
+    // Rows that may satisfy a trigram predicate, ascending; the predicate
+    // still has to be checked on each
+    std::vector<size_t> trigramCandidates(const Predicate& predicate) const;
+
+    const ZoneMap& getZoneMap() const { return zoneMap; }
 
      std::string name;
      std::vector<std::map<std::string, std::string>> records;
@@ -69,14 +178,67 @@ public:
 private:
     Database* database;
     std::map<std::string, Field*> fields;
+    ValidationPlan validationPlan;
 
     // Indexes for enforcing constraints (e.g., primary keys)
     std::map<std::string, std::set<std::string>> uniqueFields; // Field name -> set of unique values
 
+    // Row index of every primary key column: equality key -> row positions
+    std::map<std::string, std::unordered_multimap<std::string, size_t>> rowIndex;
+
+    // Reverse-reference index of every foreign key column: referenced value ->
+    // positions of the rows holding it. Kept alongside the row index, so
+    // cascades from the referenced table find their rows without a scan.
+    std::map<std::string, std::unordered_map<std::string, std::vector<size_t>>> referenceRows;
+
+    // Trigram indexes: column -> index
+    std::map<std::string, std::unique_ptr<TrigramIndex>> trigramIndexes;
+
+    // Min/max summaries of every block of rows, for skipping blocks during scans
+    ZoneMap zoneMap;
+
+    // Planner statistics and the rows changed since they were gathered
+    std::unique_ptr<TableStatistics> statistics;
+    size_t modifiedRows = 0;
+
+    uint64_t version = nextVersion();
+
+    // isSortedOn results: column -> version checked at and the answer
+    mutable std::map<std::string, std::pair<uint64_t, bool>> sortedColumns;
+    static uint64_t nextVersion();
+
+    std::vector<TableObserver*> observers;
+    void notify(const TableChange& change);
+
     // Helper methods to enforce table-level constraints
     void enforceConstraintsOnInsert(const std::map<std::string, std::string>& record);
-    bool evaluateConditions(const std::map<std::string, std::string>& record, const std::vector<SQLParser::Condition>& conditions) const;
-    bool evaluateCondition(const std::map<std::string, std::string>& record, const SQLParser::Condition& condition) const;
+    void enforceForeignKeys(const std::vector<std::map<std::string, std::string>>& newRecords) const;
+    std::map<std::string, std::map<std::string, std::string>> enforceConstraintsOnUpdate(
+        const std::vector<size_t>& rowIds, const std::map<std::string, std::string>& newValues) const;
+    void enforceReferencesOnUpdate(const std::map<std::string, std::map<std::string, std::string>>& keyChanges);
+    void checkReferencesOnUpdate(const std::map<std::string, std::map<std::string, std::string>>& keyChanges) const;
+    void cascadeUpdates(const std::map<std::string, std::map<std::string, std::string>>& keyChanges);
+    void checkReferencesOnDelete(const std::vector<size_t>& rowIds) const;
+    std::set<std::string> referencedKeys(const Database::ForeignKeyReference& reference,
+                                         const std::vector<size_t>& rowIds) const;
+
+    // Index maintenance for a single record
+    void indexRecord(const std::map<std::string, std::string>& record, size_t rowId);
+    void reindexValue(const std::string& fieldName, const std::string& oldValue, const std::string& newValue, size_t rowId);
+    void rebuildRowIndex();
+    void rebuildIndexes();
+
+    // Remove the given rows (ascending positions) in a single compaction pass,
+    // cascading to referencing tables first. Restrictions must already be checked.
+    void deleteRows(const std::vector<size_t>& rowIds);
+    void cascadeDeletes(const std::vector<size_t>& rowIds);
+
+    // Cascades from a referenced table. A cascaded update of a primary key
+    // column moves the keys of this table too; referencedKeyChanges lists them.
+    std::vector<size_t> findReferencingRows(const std::string& fieldName, const std::set<std::string>& values) const;
+    std::map<std::string, std::map<std::string, std::string>> referencedKeyChanges(
+        const std::string& fieldName, const std::map<std::string, std::string>& changes) const;
+    void updateReferencing(const std::string& fieldName, const std::map<std::string, std::string>& changes);
 
     // Memory management helpers
     void clearFields();
@@ -0,0 +1,63 @@
+#ifndef TRIGRAMINDEX_H
+#define TRIGRAMINDEX_H
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "LikePattern.h"
+
+// Substring index over one column (CREATE INDEX ... USING TRIGRAM). Every
+// run of three bytes of a value is a trigram, and each trigram keeps the
+// ascending positions of the rows whose value holds it.
+//
+// A value matching LIKE '%foo%' holds every trigram of 'foo', so the rows
+// in all of their posting lists are the only candidates; the scan still
+// evaluates the predicate on each of them. Patterns without a literal run of
+// three characters give no trigram and cannot use the index.
+class TrigramIndex {
+public:
+    TrigramIndex(const std::string& name, const std::string& column);
+
+    const std::string& getName() const { return name; }
+    const std::string& getColumn() const { return column; }
+
+    // Index every row again
+    void build(const std::vector<std::map<std::string, std::string>>& records);
+
+    // Index a newly appended row
+    void insert(size_t rowId, std::string_view value);
+
+    // Move a row from its old value's trigrams to its new value's
+    void update(size_t rowId, std::string_view oldValue, std::string_view newValue);
+
+    // Drop the given rows (ascending positions) and renumber the rows after
+    // them, as the table's compaction does
+    void removeRows(const std::vector<size_t>& rowIds);
+
+    // True if the pattern holds a trigram to look up
+    static bool canFilter(const LikePattern& pattern);
+
+    // Rows that may match the pattern, ascending: the intersection of the
+    // posting lists of its trigrams. The pattern must pass canFilter.
+    std::vector<size_t> candidates(const LikePattern& pattern) const;
+
+    // Upper bound on the candidates: the length of the shortest posting list
+    size_t estimateCandidates(const LikePattern& pattern) const;
+
+    // Estimated heap bytes held by the posting lists
+    size_t memoryUsage() const;
+
+private:
+    std::string name;
+    std::string column;
+    std::unordered_map<uint32_t, std::vector<uint32_t>> postings; // Trigram -> ascending row positions
+
+    // Distinct trigrams of a value, ascending
+    static std::vector<uint32_t> trigramsOf(std::string_view value);
+    static std::vector<uint32_t> trigramsOf(const LikePattern& pattern);
+};
+
+#endif // TRIGRAMINDEX_H
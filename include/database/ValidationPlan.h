@@ -0,0 +1,55 @@
+#ifndef VALIDATIONPLAN_H
+#define VALIDATIONPLAN_H
+
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "Field.h"
+
+// Per-table validation plan, built once as fields are added. Each column's
+// type and constraints are flattened into enum tags so that validating a row
+// needs no heap allocation, virtual call or constraint name comparison.
+class ValidationPlan {
+public:
+    struct ColumnRule {
+        std::string name;
+        DataKind kind;
+        size_t maxLength;                            // VARCHAR only
+        bool notEmpty;
+        bool primaryKey;
+        const ForeignKeyConstraint* foreignKey;      // nullptr if the column is not a foreign key
+    };
+
+    // Add a column's rules to the plan
+    void addField(const Field& field);
+
+    // Rules in column-name order (the order of Table::getFields)
+    const std::vector<ColumnRule>& getColumns() const { return columns; }
+
+    // Rules of a single column, or nullptr if the table has no such column
+    const ColumnRule* findColumn(const std::string& name) const;
+
+    // Indexes into getColumns() of primary key and foreign key columns
+    const std::vector<size_t>& getPrimaryKeyColumns() const { return primaryKeyColumns; }
+    const std::vector<size_t>& getForeignKeyColumns() const { return foreignKeyColumns; }
+
+    // Check a value against a column's type and value-level constraints.
+    // Returns nullptr on success, otherwise a static error message.
+    static const char* check(const ColumnRule& rule, std::string_view value);
+
+    // Validate every column of a record; throws std::invalid_argument on the first violation
+    void validateRecord(const std::map<std::string, std::string>& record) const;
+
+    // Validate one value; throws std::invalid_argument on violation
+    static void validateValue(const ColumnRule& rule, std::string_view value);
+
+private:
+    std::vector<ColumnRule> columns;
+    std::vector<size_t> primaryKeyColumns;
+    std::vector<size_t> foreignKeyColumns;
+
+    void rebuildColumnLists();
+};
+
+#endif // VALIDATIONPLAN_H
@@ -0,0 +1,27 @@
+#ifndef VALUEPARSER_H
+#define VALUEPARSER_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// Allocation-free parsers for column values. They never throw: each returns
+// false when the text is not a complete, in-range value of the type.
+class ValueParser {
+public:
+    static bool parseInt(std::string_view text, int32_t& out);
+    static bool parseLongInt(std::string_view text, int64_t& out);
+    static bool parseDouble(std::string_view text, double& out);
+
+    // "YYYY-MM-DD HH:MM:SS" with calendar ranges (month lengths, leap years) checked
+    static bool parseDateTime(std::string_view text);
+
+    // Read the leading number of a value the way std::stod does (leading
+    // whitespace and trailing text are allowed). False if no number is found.
+    static bool parseLeadingDouble(std::string_view text, double& out);
+
+    // Shortest text that reads back as the same double (SUM and AVG results)
+    static std::string formatDouble(double value);
+};
+
+#endif // VALUEPARSER_H
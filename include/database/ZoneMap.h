@@ -0,0 +1,67 @@
+#ifndef ZONEMAP_H
+#define ZONEMAP_H
+
+#include <map>
+#include <string>
+#include <vector>
+#include "Predicate.h"
+
+// Per-block column summaries used to skip blocks a WHERE clause cannot match.
+// Rows are grouped into fixed-size blocks by position; for every column each
+// block records the range of its numeric values, the string range of all its
+// non-empty values and how many values are empty (our NULL).
+class ZoneMap {
+public:
+    static constexpr size_t blockSize = 1024;
+
+    // Summarize the given columns (sorted by name, as in Table::getFields)
+    void setColumns(const std::vector<std::string>& columnNames);
+
+    // Summarize everything again
+    void rebuild(const std::vector<std::map<std::string, std::string>>& records);
+
+    // Summarize blocks from the one holding 'firstRow' onwards; rows after it
+    // have moved (deletion) and the block count may shrink
+    void rebuildFrom(const std::vector<std::map<std::string, std::string>>& records, size_t firstRow);
+
+    // Summarize one block again after some of its rows changed
+    void rebuildBlock(const std::vector<std::map<std::string, std::string>>& records, size_t block);
+
+    // Fold a newly appended row into the last block
+    void append(const std::map<std::string, std::string>& record, size_t rowId);
+
+    // Fold a row's new values into its block. The summary only widens, which
+    // keeps it safe until rebuildBlock tightens it again.
+    void widen(const std::map<std::string, std::string>& record, size_t rowId);
+
+    size_t getBlockCount() const { return blocks.size(); }
+
+    // Estimated heap bytes held by the summaries
+    size_t memoryUsage() const;
+
+    // False only if no row of the block can satisfy the predicates
+    bool mayMatch(size_t block, const std::vector<Predicate>& predicates) const;
+
+private:
+    struct ColumnSummary {
+        size_t emptyCount = 0;
+        size_t numberCount = 0;      // values that parse completely as numbers
+        size_t valueCount = 0;       // non-empty values
+        bool hasNaN = false;         // NaN has no place in a range; the block is never skipped on it
+        double minNumber = 0.0;
+        double maxNumber = 0.0;
+        std::string minString;       // over all non-empty values, numeric or not
+        std::string maxString;
+
+        void add(const std::string& value);
+        bool mayMatch(const Predicate& predicate) const;
+    };
+
+    std::vector<std::string> columns;
+    std::vector<std::vector<ColumnSummary>> blocks;   // block -> column
+
+    int columnIndex(const std::string& name) const;
+    void addRow(std::vector<ColumnSummary>& block, const std::map<std::string, std::string>& record) const;
+};
+
+#endif // ZONEMAP_H
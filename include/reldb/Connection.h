@@ -0,0 +1,48 @@
+#ifndef CONNECTION_H
+#define CONNECTION_H
+
+#include <cstddef>
+#include <memory>
+#include <ostream>
+#include <string>
+#include "ResultSet.h"
+#include "Statement.h"
+
+class Database;
+class QueryLogWriter;
+class ChangeStream;
+
+// An in-process database. Statements report through their ResultSet, errors
+// as exceptions; nothing is printed unless an output stream is set.
+class Connection {
+public:
+    Connection();
+    ~Connection();
+
+    Connection(Connection&&) noexcept;
+    Connection& operator=(Connection&&) noexcept;
+    Connection(const Connection&) = delete;
+    Connection& operator=(const Connection&) = delete;
+
+    // Parse and execute one statement
+    ResultSet execute(const std::string& sql);
+
+    // Parse a statement to execute later, possibly many times
+    Statement prepare(const std::string& sql);
+
+    // Print status messages, result tables and plans the way the CLI does
+    void setOutput(std::ostream* out);
+
+    void setQueryLog(QueryLogWriter* log);
+    void setAnalyzeFraction(double fraction);
+    void setQueryMemoryLimit(size_t bytes);
+    void setJoinThreads(size_t threads);
+    void setResultCacheLimit(size_t bytes);
+    void setChangeStream(ChangeStream* stream);
+    void writeMemoryReport(std::ostream& out) const;
+
+private:
+    std::unique_ptr<Database> database;
+};
+
+#endif // CONNECTION_H
@@ -0,0 +1,7 @@
+#ifndef DATAKIND_H
+#define DATAKIND_H
+
+// Tag identifying the concrete data type without a virtual call or string compare
+enum class DataKind { Varchar, Int, LongInt, Double, DateTime };
+
+#endif // DATAKIND_H
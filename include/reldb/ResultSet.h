@@ -0,0 +1,76 @@
+#ifndef RESULTSET_H
+#define RESULTSET_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "DataKind.h"
+
+struct QueryResult;
+
+// A column of a SELECT result and the type of the table column it comes from
+struct ResultColumn {
+    std::string name;
+    DataKind kind;
+};
+
+// A run of result rows laid out a column at a time. The values point into the
+// ResultSet that filled the batch and are valid as long as it is.
+class ResultBatch {
+public:
+    size_t rowCount() const { return rows; }
+    size_t columnCount() const { return columns ? columns->size() : 0; }
+    const ResultColumn& getColumn(size_t column) const { return (*columns)[column]; }
+
+    // Empty values are NULL
+    bool isNull(size_t column, size_t row) const { return getText(column, row).empty(); }
+    std::string_view getText(size_t column, size_t row) const { return (*values)[column][first + row]; }
+
+    // Typed reads; throw std::runtime_error when the value is NULL or not a number
+    int64_t getInt(size_t column, size_t row) const;
+    double getDouble(size_t column, size_t row) const;
+
+private:
+    friend class ResultSet;
+
+    const std::vector<ResultColumn>* columns = nullptr;
+    const std::vector<std::vector<std::string>>* values = nullptr;  // The ResultSet's values[column][row]
+    size_t first = 0;
+    size_t rows = 0;
+};
+
+// What one statement produced: the rows of a SELECT, read back in batches,
+// and the number of rows the statement affected. The rows are stored a
+// column at a time when the result is built, so a batch is only a window
+// onto them.
+class ResultSet {
+public:
+    static constexpr size_t defaultBatchSize = 1024;
+
+    const std::vector<ResultColumn>& getColumns() const { return columns; }
+    size_t getRowsAffected() const { return rowsAffected; }
+    size_t rowCount() const { return rows; }
+
+    // Fill 'batch' with up to 'batchSize' of the rows not returned yet; false
+    // once there are none left
+    bool nextBatch(ResultBatch& batch, size_t batchSize = defaultBatchSize);
+
+    // Start again from the first row
+    void rewind() { position = 0; }
+
+private:
+    friend class Connection;
+    friend class Statement;
+
+    explicit ResultSet(QueryResult&& result);
+
+    std::vector<ResultColumn> columns;
+    std::vector<std::vector<std::string>> values;   // values[column][row]; absent values are empty
+    size_t rows = 0;
+    size_t rowsAffected = 0;
+    size_t position = 0;
+};
+
+#endif // RESULTSET_H
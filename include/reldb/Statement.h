@@ -0,0 +1,38 @@
+#ifndef STATEMENT_H
+#define STATEMENT_H
+
+#include <memory>
+#include <string>
+#include "ResultSet.h"
+
+class Database;
+
+// A statement parsed once and executable any number of times. It belongs to
+// the Connection that prepared it and must not outlive it.
+class Statement {
+public:
+    ~Statement();
+
+    Statement(Statement&&) noexcept;
+    Statement& operator=(Statement&&) noexcept;
+    Statement(const Statement&) = delete;
+    Statement& operator=(const Statement&) = delete;
+
+    ResultSet execute();
+
+    const std::string& getSql() const { return sql; }
+
+private:
+    friend class Connection;
+
+    // The parsed query, kept out of this header with the parser
+    struct Parsed;
+
+    Statement(Database& database, std::string sql);
+
+    Database* database;
+    std::string sql;
+    std::unique_ptr<Parsed> parsed;
+};
+
+#endif // STATEMENT_H
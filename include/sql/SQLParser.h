@@ -1,23 +1,33 @@
 #ifndef SQLPARSER_H
 #define SQLPARSER_H
 
+#include <memory>
 #include <string>
 #include <vector>
 #include <map>
 
 class SQLParser {
 public:
+    struct Query;
 
     struct Condition {
-        std::string field;
+        std::string field;     // Empty for EXISTS
         std::string op;
-        std::string value;
+        std::string value;     // For IN, the list as written; for BETWEEN, "low AND high"; with a subquery, its SELECT as written
         std::string relation;  // Relation with the next condition (AND, OR, or empty)
+        std::vector<std::string> values; // IN list, or the two BETWEEN bounds, unquoted
+        std::shared_ptr<Query> subquery; // [NOT] EXISTS and [NOT] IN ( SELECT ... )
     };
 
     struct Join {
         std::string table;
         std::string onCondition;  // Join condition
+        std::string type = "INNER"; // INNER, LEFT, RIGHT or FULL
+    };
+
+    struct OrderKey {
+        std::string field;
+        bool descending = false;
     };
 
     struct ColumnDefinition {
@@ -27,6 +37,8 @@ public:
         // New fields to store foreign key reference details
         std::string referencedTable;
         std::string referencedColumn;
+        bool onDeleteCascade = false;
+        bool onUpdateCascade = false;
     };
     
     // Struct to hold parsed query components
@@ -36,9 +48,18 @@ public:
         std::string table;
         std::vector<Condition> conditions;
         std::vector<Join> joins;
+        std::vector<std::string> groupBy;   // GROUP BY columns
+        std::vector<OrderKey> orderBy;      // ORDER BY keys, most significant first
+        long long limit = -1;               // LIMIT n, or -1 without one
         std::map<std::string, std::string> values; // For single set of values (used in UPDATE)
         std::vector<std::map<std::string, std::string>> multiValues; // For multiple sets of values (used in INSERT)
         std::vector<ColumnDefinition> columns; // For CREATE TABLE columns
+        std::string indexName;       // CREATE INDEX / DROP INDEX; the indexed column is in 'fields'
+        std::string indexMethod;     // CREATE INDEX ... USING method
+        bool materializedView = false; // CREATE / REFRESH / DROP MATERIALIZED VIEW; the view is 'table'
+        std::string viewQuery;       // CREATE MATERIALIZED VIEW: the defining SELECT
+        bool explain = false;        // EXPLAIN: print the plan instead of the rows
+        bool explainAnalyze = false; // EXPLAIN ANALYZE: run the query and report per-operator statistics
     };
 
     // Method to parse a SQL query string
@@ -0,0 +1,52 @@
+#include "../../include/database/BloomFilter.h"
+#include <functional>
+
+// Odd multipliers that pick an independent bit in each word of a block
+static const uint32_t salts[8] = {
+    0x47b6137bU, 0x44974d91U, 0x8824ad5bU, 0xa2b7289dU,
+    0x705495c7U, 0x2df1424bU, 0x9efc4947U, 0x5c6bfb31U,
+};
+
+BloomFilter::BloomFilter(size_t expectedKeys, std::pmr::memory_resource* resource)
+    : blocks(resource) {
+    // 256 bits per block, ~10 bits per key
+    size_t blockCount = (expectedKeys * 10 + 255) / 256;
+    blocks.assign(blockCount > 0 ? blockCount : 1, Block{});
+}
+
+uint64_t BloomFilter::hash(std::string_view key) {
+    // Finalize the library hash (murmur2) so both halves are well mixed
+    uint64_t h = std::hash<std::string_view>()(key);
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return h;
+}
+
+size_t BloomFilter::blockIndex(uint64_t hash) const {
+    // Map the high half onto [0, blocks) without a division
+    return static_cast<size_t>(((hash >> 32) * blocks.size()) >> 32);
+}
+
+uint32_t BloomFilter::bitFor(uint64_t hash, int word) {
+    return uint32_t(1) << ((static_cast<uint32_t>(hash) * salts[word]) >> 27);
+}
+
+void BloomFilter::insert(std::string_view key) {
+    uint64_t h = hash(key);
+    Block& block = blocks[blockIndex(h)];
+    for (int word = 0; word < 8; ++word) {
+        block.words[word] |= bitFor(h, word);
+    }
+}
+
+bool BloomFilter::mayContain(std::string_view key) const {
+    uint64_t h = hash(key);
+    const Block& block = blocks[blockIndex(h)];
+    for (int word = 0; word < 8; ++word) {
+        if ((block.words[word] & bitFor(h, word)) == 0) {
+            return false;
+        }
+    }
+    return true;
+}
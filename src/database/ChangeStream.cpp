@@ -0,0 +1,576 @@
+#include "../../include/database/ChangeStream.h"
+#include "../../include/database/JsonLine.h"
+#include "../../include/database/Metrics.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <poll.h>
+#include <sstream>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+ChangeStream::~ChangeStream() {
+    try {
+        publish();
+    } catch (const std::exception&) {
+        // A failing subscriber must not stop the shutdown
+    }
+    if (listenFd >= 0) {
+        stopping = true;
+        ::shutdown(listenFd, SHUT_RDWR);
+        acceptor.join();
+        {
+            // The writer sees 'stopping' or is already waiting to be woken
+            std::lock_guard<std::mutex> lock(mutex);
+        }
+        clientsQueued.notify_all();
+        writer.join();
+        ::close(listenFd);
+        ::unlink(socketPath.c_str());
+    }
+    for (const auto& client : clients) {
+        ::close(client->fd);
+    }
+}
+
+void ChangeStream::openFile(const std::string& path) {
+    // Continue the numbering of an existing file
+    {
+        std::ifstream existing(path);
+        std::string line;
+        std::string last;
+        while (std::getline(existing, line)) {
+            if (line.find_first_not_of(" \t\r") != std::string::npos) {
+                last = line;
+            }
+        }
+        if (!last.empty()) {
+            uint64_t sequence = fromJson(last).sequence;
+            std::lock_guard<std::mutex> lock(mutex);
+            nextSequence = std::max(nextSequence, sequence + 1);
+        }
+    }
+    file.open(path, std::ios::app);
+    if (!file) {
+        throw std::runtime_error("Unable to open change stream file: " + path);
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    filePath = path;
+}
+
+void ChangeStream::listen(const std::string& path) {
+    if (listenFd >= 0) {
+        throw std::runtime_error("The change stream already listens on " + socketPath);
+    }
+    sockaddr_un address{};
+    if (path.size() >= sizeof(address.sun_path)) {
+        throw std::runtime_error("Socket path too long: " + path);
+    }
+    address.sun_family = AF_UNIX;
+    std::strcpy(address.sun_path, path.c_str());
+
+    int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        throw std::runtime_error("Unable to create socket: " + std::string(std::strerror(errno)));
+    }
+    ::unlink(path.c_str());
+    if (::bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 || ::listen(fd, 16) < 0) {
+        std::string error = std::strerror(errno);
+        ::close(fd);
+        throw std::runtime_error("Unable to listen on " + path + ": " + error);
+    }
+    socketPath = path;
+    listenFd = fd;
+    acceptor = std::thread(&ChangeStream::acceptClients, this);
+    writer = std::thread(&ChangeStream::writeClients, this);
+}
+
+void ChangeStream::acceptClients() {
+    while (!stopping) {
+        int fd = ::accept(listenFd, nullptr, nullptr);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            return;
+        }
+
+        // A client that does not name a sequence promptly gets live batches only
+        timeval timeout{0, 200000};
+        ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        std::string request;
+        char c;
+        while (request.size() < 64 && ::recv(fd, &c, 1, 0) == 1 && c != '\n') {
+            request += c;
+        }
+        uint64_t from = 0;
+        std::istringstream words(request);
+        std::string keyword;
+        if (words >> keyword && keyword == "FROM" && !(words >> from)) {
+            from = 0;
+        }
+
+        // The client takes live batches from here on. The replay goes
+        // ahead of them once read, which may take the file.
+        auto client = std::make_shared<Client>();
+        client->fd = fd;
+        std::string text;
+        bool attached = false;
+        try {
+            std::vector<ChangeEvent> replay;
+            uint64_t fileBefore = 0;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                replay = retainedFrom(from, fileBefore);
+                clients.push_back(client);
+                attached = true;
+            }
+            if (fileBefore != 0) {
+                std::vector<ChangeEvent> older = fileEvents(from, fileBefore);
+                replay.insert(replay.begin(), std::make_move_iterator(older.begin()),
+                              std::make_move_iterator(older.end()));
+            }
+            for (const auto& event : replay) {
+                appendJson(text, event);
+                text += '\n';
+            }
+        } catch (const std::exception& e) {
+            std::string error = "{\"error\":";
+            writeJsonString(error, e.what());
+            error += "}\n";
+            if (!attached) {
+                sendAll(fd, error);
+                ::close(fd);
+                continue;
+            }
+            // The error is all the client gets before the writer closes it
+            text = std::move(error);
+            std::lock_guard<std::mutex> lock(mutex);
+            client->queue.clear();
+            client->queuedBytes = 0;
+            client->closing = true;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!text.empty()) {
+            client->queuedBytes += text.size();
+            client->queue.push_front(std::make_shared<const std::string>(std::move(text)));
+        }
+        client->ready = true;
+        clientsQueued.notify_one();
+    }
+}
+
+// Send the queued text to the socket clients without ever blocking on one:
+// sends that would block wait for the socket to drain, while clients that
+// fail are closed. Once stopping, what is queued gets a second to go out.
+void ChangeStream::writeClients() {
+    std::unique_lock<std::mutex> lock(mutex);
+    std::vector<std::shared_ptr<Client>> waiting;
+    std::vector<pollfd> polls;
+    auto deadline = std::chrono::steady_clock::time_point::max();
+    while (true) {
+        waiting.clear();
+        for (const auto& client : clients) {
+            while (client->ready && !client->dropped && !client->queue.empty()) {
+                const std::string& text = *client->queue.front();
+                ssize_t written = ::send(client->fd, text.data() + client->offset, text.size() - client->offset,
+                                         MSG_NOSIGNAL | MSG_DONTWAIT);
+                if (written < 0 && errno == EINTR) {
+                    continue;
+                }
+                if (written < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                    waiting.push_back(client);
+                    break;
+                }
+                if (written <= 0) {
+                    client->dropped = true;
+                    break;
+                }
+                client->offset += static_cast<size_t>(written);
+                client->queuedBytes -= static_cast<size_t>(written);
+                if (client->offset == text.size()) {
+                    client->queue.pop_front();
+                    client->offset = 0;
+                }
+            }
+            if (client->closing && client->queue.empty()) {
+                client->dropped = true;
+            }
+        }
+        clients.erase(std::remove_if(clients.begin(), clients.end(),
+                                     [](const std::shared_ptr<Client>& client) {
+                                         if (!client->dropped) {
+                                             return false;
+                                         }
+                                         ::close(client->fd);
+                                         return true;
+                                     }),
+                      clients.end());
+
+        if (stopping) {
+            deadline = std::min(deadline, std::chrono::steady_clock::now() + std::chrono::seconds(1));
+            if (waiting.empty() || std::chrono::steady_clock::now() >= deadline) {
+                return;
+            }
+        }
+        if (waiting.empty()) {
+            clientsQueued.wait(lock);
+            continue;
+        }
+
+        // Wait a little for a full socket to drain; batches queued meanwhile
+        // for the others go out on the next round
+        polls.clear();
+        for (const auto& client : waiting) {
+            polls.push_back({client->fd, POLLOUT, 0});
+        }
+        lock.unlock();
+        ::poll(polls.data(), polls.size(), 50);
+        lock.lock();
+    }
+}
+
+bool ChangeStream::sendAll(int fd, const std::string& data) {
+    size_t sent = 0;
+    while (sent < data.size()) {
+        ssize_t written = ::send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+        if (written <= 0) {
+            return false;
+        }
+        sent += static_cast<size_t>(written);
+    }
+    return true;
+}
+
+size_t ChangeStream::subscribe(uint64_t fromSequence, Callback callback) {
+    std::vector<ChangeEvent> replay;
+    uint64_t fileBefore = 0;
+    size_t id;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        replay = retainedFrom(fromSequence, fileBefore);
+        id = nextSubscriberId++;
+        subscribers.push_back({id, callback});
+    }
+    if (fileBefore != 0) {
+        std::vector<ChangeEvent> older;
+        try {
+            older = fileEvents(fromSequence, fileBefore);
+        } catch (const std::exception&) {
+            unsubscribe(id);
+            throw;
+        }
+        replay.insert(replay.begin(), std::make_move_iterator(older.begin()), std::make_move_iterator(older.end()));
+    }
+    if (!replay.empty()) {
+        callback(replay);
+    }
+    return id;
+}
+
+void ChangeStream::unsubscribe(size_t id) {
+    std::lock_guard<std::mutex> lock(mutex);
+    subscribers.erase(std::remove_if(subscribers.begin(), subscribers.end(),
+                                     [id](const Subscriber& subscriber) { return subscriber.id == id; }),
+                      subscribers.end());
+}
+
+void ChangeStream::setRetention(size_t events) {
+    std::lock_guard<std::mutex> lock(mutex);
+    retention = events;
+    trimRetained();
+}
+
+// Called with the mutex held
+void ChangeStream::trimRetained() {
+    while (!retained.empty() && retainedEvents - retained.front()->size() >= retention) {
+        retainedEvents -= retained.front()->size();
+        retained.pop_front();
+    }
+}
+
+uint64_t ChangeStream::getLastSequence() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return nextSequence - pending.size() - 1;
+}
+
+// Called with the mutex held. Events older than those retained are left to
+// be read from the file, outside the lock: 'fileBefore' is set to the first
+// sequence that is not.
+std::vector<ChangeEvent> ChangeStream::retainedFrom(uint64_t fromSequence, uint64_t& fileBefore) const {
+    fileBefore = 0;
+    uint64_t published = nextSequence - pending.size();
+    if (fromSequence == 0 || fromSequence >= published) {
+        return {};
+    }
+    uint64_t oldest = retained.empty() ? published : retained.front()->front().sequence;
+    if (fromSequence < oldest) {
+        if (filePath.empty()) {
+            throw std::out_of_range("Change stream no longer retains sequence " + std::to_string(fromSequence) +
+                                    "; the oldest retained is " + std::to_string(oldest));
+        }
+        fileBefore = oldest;
+    }
+    std::vector<ChangeEvent> events;
+    for (const auto& batch : retained) {
+        if (batch->back().sequence < fromSequence) {
+            continue;
+        }
+        for (const auto& event : *batch) {
+            if (event.sequence >= fromSequence) {
+                events.push_back(event);
+            }
+        }
+    }
+    return events;
+}
+
+// Published events are flushed to the file, so those before the retained
+// ones are all there unless the file was cut. Reading stops short of the
+// end, which a publish may be writing meanwhile.
+std::vector<ChangeEvent> ChangeStream::fileEvents(uint64_t fromSequence, uint64_t beforeSequence) const {
+    std::ifstream in(filePath);
+    std::vector<ChangeEvent> events;
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.find_first_not_of(" \t\r") == std::string::npos) {
+            continue;
+        }
+        ChangeEvent event = fromJson(line);
+        if (event.sequence >= beforeSequence) {
+            break;
+        }
+        if (event.sequence >= fromSequence) {
+            events.push_back(std::move(event));
+        }
+    }
+    if (events.empty() || events.front().sequence != fromSequence) {
+        throw std::out_of_range("Change stream file " + filePath + " does not hold sequence " +
+                                std::to_string(fromSequence));
+    }
+    return events;
+}
+
+void ChangeStream::tableChanged(const Table& table, const TableChange& change) {
+    int64_t now = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    size_t rows = change.kind == TableChange::Kind::Insert ? change.after.size() : change.before.size();
+    std::lock_guard<std::mutex> lock(mutex);
+    pending.reserve(pending.size() + rows);
+    for (size_t i = 0; i < rows; ++i) {
+        ChangeEvent event;
+        event.sequence = nextSequence++;
+        event.timestampMicros = now;
+        event.table = table.getName();
+        event.kind = change.kind;
+        if (change.kind != TableChange::Kind::Insert) {
+            event.before = change.before[i];
+        }
+        if (change.kind != TableChange::Kind::Delete) {
+            event.after = change.after[i];
+        }
+        pending.push_back(std::move(event));
+    }
+}
+
+void ChangeStream::publish() {
+    Batch batch;
+    std::vector<Subscriber> current;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (pending.empty()) {
+            return;
+        }
+        batch = std::make_shared<const std::vector<ChangeEvent>>(std::move(pending));
+        pending.clear();
+
+        // The batch is formatted once for the file and every socket client
+        std::string text;
+        if (file.is_open() || !clients.empty()) {
+            for (const auto& event : *batch) {
+                appendJson(text, event);
+                text += '\n';
+            }
+        }
+        if (file.is_open()) {
+            file.write(text.data(), static_cast<std::streamsize>(text.size()));
+            file.flush();
+        }
+        if (!clients.empty()) {
+            auto shared = std::make_shared<const std::string>(std::move(text));
+            for (const auto& client : clients) {
+                enqueue(*client, shared);
+            }
+            clientsQueued.notify_one();
+        }
+
+        retained.push_back(batch);
+        retainedEvents += batch->size();
+        trimRetained();
+        current = subscribers;
+    }
+    EngineMetrics::get().changeEvents.add(batch->size());
+
+    // Callbacks run without the lock, so they may subscribe or unsubscribe
+    for (const auto& subscriber : current) {
+        subscriber.callback(*batch);
+    }
+}
+
+// Called with the mutex held. A client that lags too far behind is left for
+// the writer to close.
+void ChangeStream::enqueue(Client& client, std::shared_ptr<const std::string> text) {
+    if (client.dropped || client.closing) {
+        return;
+    }
+    if (client.queuedBytes + text->size() > clientQueueLimit) {
+        client.dropped = true;
+        client.queue.clear();
+        return;
+    }
+    client.queuedBytes += text->size();
+    client.queue.push_back(std::move(text));
+}
+
+static const char* kindName(TableChange::Kind kind) {
+    switch (kind) {
+        case TableChange::Kind::Insert:
+            return "INSERT";
+        case TableChange::Kind::Update:
+            return "UPDATE";
+        default:
+            return "DELETE";
+    }
+}
+
+// Empty values are NULL
+static void writeRow(std::string& out, const std::map<std::string, std::string>& row) {
+    out += '{';
+    bool first = true;
+    for (const auto& [column, value] : row) {
+        if (!first) {
+            out += ',';
+        }
+        first = false;
+        writeJsonString(out, column);
+        out += ':';
+        if (value.empty()) {
+            out += "null";
+        } else {
+            writeJsonString(out, value);
+        }
+    }
+    out += '}';
+}
+
+static std::map<std::string, std::string> readRow(JsonLineReader& reader) {
+    std::map<std::string, std::string> row;
+    reader.expect('{');
+    if (reader.consume('}')) {
+        return row;
+    }
+    do {
+        std::string column = reader.readString();
+        reader.expect(':');
+        row[column] = reader.consumeNull() ? "" : reader.readString();
+    } while (reader.consume(','));
+    reader.expect('}');
+    return row;
+}
+
+std::string ChangeStream::toJson(const ChangeEvent& event) {
+    std::string out;
+    appendJson(out, event);
+    return out;
+}
+
+void ChangeStream::appendJson(std::string& out, const ChangeEvent& event) {
+    out += "{\"seq\":";
+    out += std::to_string(event.sequence);
+    out += ",\"ts\":";
+    out += std::to_string(event.timestampMicros);
+    out += ",\"table\":";
+    writeJsonString(out, event.table);
+    out += ",\"op\":\"";
+    out += kindName(event.kind);
+    out += '"';
+    if (event.kind != TableChange::Kind::Insert) {
+        out += ",\"before\":";
+        writeRow(out, event.before);
+    }
+    if (event.kind != TableChange::Kind::Delete) {
+        out += ",\"after\":";
+        writeRow(out, event.after);
+    }
+    out += '}';
+}
+
+ChangeEvent ChangeStream::fromJson(const std::string& line) {
+    ChangeEvent event;
+    JsonLineReader reader(line);
+    reader.expect('{');
+    if (reader.consume('}')) {
+        return event;
+    }
+    do {
+        std::string key = reader.readString();
+        reader.expect(':');
+        if (key == "before") {
+            event.before = readRow(reader);
+        } else if (key == "after") {
+            event.after = readRow(reader);
+        } else if (reader.peekString()) {
+            std::string value = reader.readString();
+            if (key == "table") {
+                event.table = value;
+            } else if (key == "op") {
+                event.kind = value == "UPDATE" ? TableChange::Kind::Update
+                           : value == "DELETE" ? TableChange::Kind::Delete
+                                               : TableChange::Kind::Insert;
+            }
+        } else {
+            int64_t value = reader.readInteger();
+            if (key == "seq") {
+                event.sequence = static_cast<uint64_t>(value);
+            } else if (key == "ts") {
+                event.timestampMicros = value;
+            }
+        }
+    } while (reader.consume(','));
+    reader.expect('}');
+    return event;
+}
+
+std::vector<ChangeEvent> ChangeStream::read(const std::string& path, uint64_t fromSequence) {
+    std::ifstream in(path);
+    if (!in) {
+        throw std::runtime_error("Unable to open change stream file: " + path);
+    }
+
+    std::vector<ChangeEvent> events;
+    std::string line;
+    size_t lineNumber = 0;
+    while (std::getline(in, line)) {
+        ++lineNumber;
+        if (line.find_first_not_of(" \t\r") == std::string::npos) {
+            continue;
+        }
+        try {
+            ChangeEvent event = fromJson(line);
+            if (event.sequence >= fromSequence) {
+                events.push_back(std::move(event));
+            }
+        } catch (const std::exception& e) {
+            throw std::runtime_error(path + ":" + std::to_string(lineNumber) + ": " + e.what());
+        }
+    }
+    return events;
+}
@@ -1,5 +1,12 @@
 #include "../../include/database/Database.h"
 #include "../../include/database/Table.h"
+#include "../../include/database/ChangeStream.h"
+#include "../../include/database/MaterializedView.h"
+#include "../../include/database/ValueParser.h"
+#include "../../include/database/Metrics.h"
+#include "../../include/database/QueryLog.h"
+#include "../../include/database/JoinOrder.h"
+#include "../../include/database/Operator.h"
 #include <iostream>
 #include <iomanip>
 #include <vector>
@@ -8,36 +15,234 @@
 #include <algorithm> // For std::max
 #include <functional> // For std::greater
 #include <cctype>    // For std::isdigit
+#include <string_view>
+#include <chrono>
+#include <cmath>
+#include <sstream>
+#include <memory>
+#include <set>
+#include <numeric>
 
 #define _PRETTY_PRINT
 
-Database::Database() {}
+Database::Database() : output(&std::cout) {}
 
 Database::~Database() {
+    // Views stop observing their sources while the tables still exist
+    views.clear();
+
     // Delete all tables to free memory
     for (auto& pair : tables) {
         delete pair.second;
     }
 }
 
-void Database::executeQuery(const SQLParser::Query& query) {
-    if (query.operation == "CREATE") {
+// Label under which a statement's metrics are recorded
+static std::string statementType(const SQLParser::Query& query) {
+    return query.explain ? "EXPLAIN" : query.operation;
+}
+
+void Database::executeStatement(const std::string& sql, QueryResult* result) {
+    runStatement(sql, nullptr, result);
+}
+
+void Database::executePrepared(const std::string& sql, const SQLParser::Query& query, QueryResult* result) {
+    runStatement(sql, &query, result);
+}
+
+void Database::runStatement(const std::string& sql, const SQLParser::Query* prepared, QueryResult* result) {
+    auto start = std::chrono::steady_clock::now();
+    QueryLogEntry logEntry;
+    if (queryLog) {
+        logEntry.timestampMicros = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+        logEntry.statement = sql;
+    }
+    // Capture the outcome once the statement has finished, successfully or not
+    auto capture = [&](const std::string& type, const std::string& error) {
+        if (!queryLog) {
+            return;
+        }
+        logEntry.type = type;
+        logEntry.error = error;
+        logEntry.durationNanos = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start).count();
+        logEntry.rowsAffected = error.empty() ? lastRowsAffected : 0;
+        queryLog->append(logEntry);
+    };
+
+    SQLParser::Query parsed;
+    if (!prepared) {
+        try {
+            parsed = SQLParser::parse(sql);
+        } catch (const std::exception& e) {
+            MetricsRegistry::instance().statement("INVALID").errors.add();
+            capture("INVALID", e.what());
+            throw;
+        }
+    }
+    const SQLParser::Query& query = prepared ? *prepared : parsed;
+
+    std::string type = statementType(query);
+    StatementMetrics& metrics = MetricsRegistry::instance().statement(type);
+    if (!prepared) {
+        metrics.parse.record(std::chrono::steady_clock::now() - start);
+    }
+
+    try {
+        executeQuery(query, result);
+    } catch (const std::exception& e) {
+        metrics.total.record(std::chrono::steady_clock::now() - start);
+        capture(type, e.what());
+        throw;
+    }
+    metrics.total.record(std::chrono::steady_clock::now() - start);
+    capture(type, "");
+}
+
+void Database::executeQuery(const SQLParser::Query& query, QueryResult* result) {
+    StatementMetrics& metrics = MetricsRegistry::instance().statement(statementType(query));
+    auto start = std::chrono::steady_clock::now();
+    lastRowsAffected = 0;
+    if (result) {
+        *result = QueryResult();
+    }
+    try {
+        dispatchQuery(query, result);
+    } catch (...) {
+        // Whatever the statement changed before failing is still published
+        if (changeStream) {
+            changeStream->publish();
+        }
+        metrics.errors.add();
+        metrics.execute.record(std::chrono::steady_clock::now() - start);
+        throw;
+    }
+    if (changeStream) {
+        changeStream->publish();
+    }
+    if (result) {
+        result->rowsAffected = lastRowsAffected;
+    }
+    metrics.executed.add();
+    metrics.execute.record(std::chrono::steady_clock::now() - start);
+}
+
+void Database::dispatchQuery(const SQLParser::Query& query, QueryResult* result) {
+    if (query.explain) {
+        explainSelectQuery(query);
+    } else if ((query.operation == "INSERT" || query.operation == "UPDATE" || query.operation == "DELETE") &&
+               views.count(query.table) > 0) {
+        throw std::runtime_error("Cannot modify materialized view " + query.table + " directly");
+    } else if (query.operation == "CREATE" && query.materializedView) {
+        createMaterializedView(query);
+    } else if (query.operation == "CREATE" && !query.indexName.empty()) {
+        createIndex(query);
+    } else if (query.operation == "CREATE") {
         createTable(query);
     } else if (query.operation == "INSERT") {
         insertIntoTable(query);
     } else if (query.operation == "SELECT") {
-        executeSelectQuery(query);
+        std::vector<std::map<std::string, std::string>> rows = executeSelectQuery(query);
+        if (result) {
+            result->columns = describeColumns(query);
+            result->rows = std::move(rows);
+        }
     } else if (query.operation == "UPDATE") {
         updateTable(query);
     } else if (query.operation == "DELETE") {
         deleteFromTable(query);
+    } else if (query.operation == "REFRESH") {
+        refreshMaterializedView(query);
+    } else if (query.operation == "DROP" && query.materializedView) {
+        dropMaterializedView(query);
+    } else if (query.operation == "DROP" && !query.indexName.empty()) {
+        dropIndex(query);
     } else if (query.operation == "DROP"){
         dropTable(query);
+    } else if (query.operation == "ANALYZE") {
+        analyzeTables(query);
     }else {
         throw std::runtime_error("Unsupported operation: " + query.operation);
     }
 }
 
+void Database::setQueryLog(QueryLogWriter* log) {
+    queryLog = log;
+}
+
+void Database::setOutput(std::ostream* out) {
+    output = out;
+}
+
+size_t Database::getLastRowsAffected() const {
+    return lastRowsAffected;
+}
+
+void Database::setQueryMemoryLimit(size_t bytes) {
+    queryMemoryLimit = bytes;
+}
+
+void Database::setJoinThreads(size_t threads) {
+    joinThreads = threads;
+}
+
+void Database::setResultCacheLimit(size_t bytes) {
+    resultCache.setLimit(bytes);
+}
+
+void Database::setChangeStream(ChangeStream* stream) {
+    for (const auto& [name, table] : tables) {
+        if (views.count(name) > 0) {
+            continue;
+        }
+        if (changeStream) {
+            table->removeObserver(changeStream);
+        }
+        if (stream) {
+            table->addObserver(stream);
+        }
+    }
+    changeStream = stream;
+}
+
+void Database::writeMemoryReport(std::ostream& out) const {
+    out << std::left << std::setw(16) << "TABLE" << std::right
+        << std::setw(12) << "ROWS" << std::setw(12) << "RECORDS" << std::setw(12) << "INDEXES"
+        << std::setw(12) << "SUMMARIES" << std::setw(12) << "TOTAL" << "\n";
+    Table::MemoryUsage total;
+    for (const auto& [name, table] : tables) {
+        Table::MemoryUsage usage = table->memoryUsage();
+        out << std::left << std::setw(16) << name << std::right
+            << std::setw(12) << table->records.size() << std::setw(12) << formatBytes(usage.rows)
+            << std::setw(12) << formatBytes(usage.indexes) << std::setw(12) << formatBytes(usage.summaries)
+            << std::setw(12) << formatBytes(usage.rows + usage.indexes + usage.summaries) << "\n";
+        total.rows += usage.rows;
+        total.indexes += usage.indexes;
+        total.summaries += usage.summaries;
+    }
+    out << std::left << std::setw(28) << "(all tables)" << std::right << std::setw(12) << formatBytes(total.rows)
+        << std::setw(12) << formatBytes(total.indexes) << std::setw(12) << formatBytes(total.summaries)
+        << std::setw(12) << formatBytes(total.rows + total.indexes + total.summaries) << "\n\n";
+
+    out << std::left << std::setw(36) << "query memory budget" << std::right
+        << (queryMemoryLimit > 0 ? formatBytes(queryMemoryLimit) : "unlimited") << "\n";
+    out << std::left << std::setw(36) << "query memory in use" << std::right << formatBytes(queryMemory.getUsed()) << "\n";
+    out << std::left << std::setw(36) << "last query peak" << std::right << formatBytes(lastQueryPeak) << "\n";
+    out << std::left << std::setw(36) << "largest query peak" << std::right << formatBytes(queryMemory.getPeak()) << "\n";
+    if (resultCache.enabled()) {
+        out << std::left << std::setw(36) << "result cache" << std::right << formatBytes(resultCache.getBytes()) << " of "
+            << formatBytes(resultCache.getLimit()) << " in " << resultCache.getEntryCount() << " results\n";
+    }
+}
+
+void Database::setAnalyzeFraction(double fraction) {
+    if (fraction < 0.0) {
+        throw std::invalid_argument("Analyze fraction must not be negative");
+    }
+    analyzeFraction = fraction;
+}
+
 Table* Database::getTable(const std::string& tableName) const {
     auto it = tables.find(tableName);
     if (it != tables.end()) {
@@ -47,18 +252,143 @@ Table* Database::getTable(const std::string& tableName) const {
     }
 }
 
+std::vector<Database::ForeignKeyReference> Database::getReferencingFields(const std::string& tableName) const {
+    std::vector<ForeignKeyReference> references;
+    for (const auto& [name, table] : tables) {
+        const ValidationPlan& plan = table->getValidationPlan();
+        for (size_t column : plan.getForeignKeyColumns()) {
+            const ValidationPlan::ColumnRule& rule = plan.getColumns()[column];
+            if (rule.foreignKey->getReferencedTable() == tableName) {
+                references.push_back({table, rule.name, rule.foreignKey});
+            }
+        }
+    }
+    return references;
+}
+
 void Database::dropTable(const SQLParser::Query& query) {
     // Find the table
     auto it = tables.find(query.table);
     if (it == tables.end()) {
         throw std::runtime_error("Table not found: " + query.table);
     }
+    if (views.count(query.table) > 0) {
+        throw std::runtime_error(query.table + " is a materialized view; use DROP MATERIALIZED VIEW");
+    }
+    for (const auto& [name, view] : views) {
+        const std::vector<std::string>& sources = view->getSources();
+        if (std::find(sources.begin(), sources.end(), query.table) != sources.end()) {
+            throw std::runtime_error("Cannot drop table " + query.table + ": materialized view " + name + " reads it");
+        }
+    }
+    // A referenced table stays as long as a foreign key points at it
+    for (const auto& reference : getReferencingFields(query.table)) {
+        if (reference.table != it->second) {
+            throw std::runtime_error("Cannot drop table " + query.table + ": it is referenced by " +
+                                     reference.table->getName() + "." + reference.fieldName);
+        }
+    }
 
-    // Delete the table
+    // Delete the table and the results read from it
     delete it->second;
     tables.erase(it);
+    resultCache.eraseTable(query.table);
+
+    if (output) {
+        *output << "Table '" << query.table << "' dropped successfully." << std::endl;
+    }
+}
+
+void Database::createIndex(const SQLParser::Query& query) {
+    Table* table = getTable(query.table);
+    if (!table) {
+        throw std::runtime_error("Table not found: " + query.table);
+    }
+    // Index names are unique across the database, as DROP INDEX takes only the name
+    for (const auto& [name, other] : tables) {
+        if (other->hasIndex(query.indexName)) {
+            throw std::runtime_error("Index already exists: " + query.indexName);
+        }
+    }
+    table->createTrigramIndex(query.indexName, query.fields.at(0));
+
+    if (output) {
+        *output << "Index '" << query.indexName << "' created successfully." << std::endl;
+    }
+}
+
+void Database::dropIndex(const SQLParser::Query& query) {
+    bool dropped = false;
+    for (const auto& [name, table] : tables) {
+        dropped = dropped || table->dropIndex(query.indexName);
+    }
+    if (!dropped) {
+        throw std::runtime_error("Index not found: " + query.indexName);
+    }
+
+    if (output) {
+        *output << "Index '" << query.indexName << "' dropped successfully." << std::endl;
+    }
+}
+
+void Database::createMaterializedView(const SQLParser::Query& query) {
+    if (tables.find(query.table) != tables.end()) {
+        throw std::runtime_error("Table already exists: " + query.table);
+    }
+    auto view = std::make_unique<MaterializedView>(*this, query.table, query.viewQuery);
+    tables[query.table] = view->getTable();
+    MaterializedView* created = view.get();
+    views[query.table] = std::move(view);
+    try {
+        created->refresh();
+    } catch (...) {
+        views.erase(query.table);
+        delete tables[query.table];
+        tables.erase(query.table);
+        throw;
+    }
+
+    if (output) {
+        *output << "Materialized view '" << query.table << "' created with " << created->getTable()->records.size()
+                << " rows." << std::endl;
+    }
+}
+
+void Database::refreshMaterializedView(const SQLParser::Query& query) {
+    auto it = views.find(query.table);
+    if (it == views.end()) {
+        throw std::runtime_error("Materialized view not found: " + query.table);
+    }
+    it->second->refresh();
 
-    std::cout << "Table '" << query.table << "' dropped successfully." << std::endl;
+    if (output) {
+        *output << "Materialized view '" << query.table << "' refreshed with " << it->second->getTable()->records.size()
+                << " rows." << std::endl;
+    }
+}
+
+void Database::dropMaterializedView(const SQLParser::Query& query) {
+    auto it = views.find(query.table);
+    if (it == views.end()) {
+        throw std::runtime_error("Materialized view not found: " + query.table);
+    }
+    for (const auto& [name, view] : views) {
+        const std::vector<std::string>& sources = view->getSources();
+        if (std::find(sources.begin(), sources.end(), query.table) != sources.end()) {
+            throw std::runtime_error("Cannot drop materialized view " + query.table + ": materialized view " + name +
+                                     " reads it");
+        }
+    }
+
+    // The view stops observing before its table goes
+    views.erase(it);
+    delete tables[query.table];
+    tables.erase(query.table);
+    resultCache.eraseTable(query.table);
+
+    if (output) {
+        *output << "Materialized view '" << query.table << "' dropped successfully." << std::endl;
+    }
 }
 
 void Database::createTable(const SQLParser::Query& query) {
@@ -77,35 +407,48 @@ void Database::createTable(const SQLParser::Query& query) {
 
     // Add the table to the database
     tables[query.table] = newTable;
+    if (changeStream) {
+        newTable->addObserver(changeStream);
+    }
+
+    if (!output) {
+        return;
+    }
+    std::ostream& out = *output;
+    out << "Table '" << query.table << "' created successfully." << std::endl;
 
-    std::cout << "Table '" << query.table << "' created successfully." << std::endl;
-    
     for (const auto& pair : newTable->getFields()) {
         Field* field = pair.second;
-        std::cout << field->getName() << ":";
+        out << field->getName() << ":";
 
         // Print data type
-        std::cout << " " << field->getDataType()->getName() << std::endl;
+        out << " " << field->getDataType()->getName() << std::endl;
 
-        std::cout << "Constraints: ";
+        out << "Constraints: ";
 
         // Print constraints
         for (const auto& constraint : field->getConstraints()) {
-            std::cout << constraint->getName();
+            out << constraint->getName();
 
             // Print referenced table and column for foreign key constraints
             if (constraint->getName() == "FOREIGN_KEY_REFERENCES") {
                 ForeignKeyConstraint* fkConstraint = dynamic_cast<ForeignKeyConstraint*>(constraint);
-                std::cout << " " << fkConstraint->getReferencedTable() << "." << fkConstraint->getReferencedColumn();
+                out << " " << fkConstraint->getReferencedTable() << "." << fkConstraint->getReferencedColumn();
+                if (fkConstraint->cascadesOnDelete()) {
+                    out << " ON_DELETE_CASCADE";
+                }
+                if (fkConstraint->cascadesOnUpdate()) {
+                    out << " ON_UPDATE_CASCADE";
+                }
             }
 
             // Print comma after each constraint except the last one
             if(constraint != field->getConstraints().back()) {
-                std::cout << ", ";
+                out << ", ";
             }
         }
 
-        std::cout << std::endl << std::endl;
+        out << std::endl << std::endl;
     }
 }
 
@@ -142,7 +485,8 @@ Field* Database::createField(const SQLParser::ColumnDefinition& colDef) {
             constraints.push_back(new PrimaryKeyConstraint());
         }else if (constraintStr == "FOREIGN_KEY_REFERENCES") {
             constraints.push_back(new ForeignKeyConstraint(
-                colDef.referencedTable, colDef.referencedColumn));
+                colDef.referencedTable, colDef.referencedColumn,
+                colDef.onDeleteCascade, colDef.onUpdateCascade));
         } else {
             throw std::runtime_error("Unsupported constraint: " + constraintStr);
         }
@@ -162,7 +506,9 @@ void Database::insertIntoTable(const SQLParser::Query& query) {
     }
     Table* table = it->second;
 
-    // Insert records
+    // Build all records first so the table can validate them as one batch
+    std::vector<std::map<std::string, std::string>> records;
+    records.reserve(query.multiValues.size());
     for (const auto& recordValues : query.multiValues) {
         std::map<std::string, std::string> record;
 
@@ -173,19 +519,27 @@ void Database::insertIntoTable(const SQLParser::Query& query) {
         // Map field names to values
         for (size_t i = 0; i < query.fields.size(); ++i) {
             record[query.fields[i]] = recordValues.at(query.fields[i]);
-            std::cout << query.fields[i] << " : " << recordValues.at(query.fields[i]) << std::endl;
+            if (output) {
+                *output << query.fields[i] << " : " << recordValues.at(query.fields[i]) << std::endl;
+            }
         }
 
-        table->insertRecord(record);
+        records.push_back(std::move(record));
+    }
+
+    // Insert records
+    table->insertRecords(records);
+    lastRowsAffected = records.size();
+
+    if (output) {
+        *output << std::endl;
     }
-    
-    std::cout << std::endl;
 }
 
-void printQueryResults(const std::vector<std::map<std::string, std::string>>& results) {
+static void printQueryResults(const std::vector<std::map<std::string, std::string>>& results, std::ostream& out) {
     // Check if results are empty
     if (results.empty()) {
-        std::cout << "No records found." << std::endl;
+        out << "No records found." << std::endl;
         return;
     }
 
@@ -210,25 +564,25 @@ void printQueryResults(const std::vector<std::map<std::string, std::string>>& re
 
     // Function to print a separator line
     auto printSeparator = [&]() {
-        std::cout << "+";
+        out << "+";
         for (const auto& column : columns) {
-            std::cout << std::string(columnWidths[column] + 2, '-') << "+";
+            out << std::string(columnWidths[column] + 2, '-') << "+";
         }
-        std::cout << std::endl;
+        out << std::endl;
     };
 
     // Print the header
     printSeparator();
-    std::cout << "|";
+    out << "|";
     for (const auto& column : columns) {
-        std::cout << " " << std::left << std::setw(columnWidths[column]) << column << " |";
+        out << " " << std::left << std::setw(columnWidths[column]) << column << " |";
     }
-    std::cout << std::endl;
+    out << std::endl;
     printSeparator();
 
     // Print each record
     for (const auto& record : results) {
-        std::cout << "|";
+        out << "|";
         for (const auto& column : columns) {
             auto it = record.find(column);
             std::string value = (it != record.end()) ? it->second : "";
@@ -237,12 +591,12 @@ void printQueryResults(const std::vector<std::map<std::string, std::string>>& re
                 return std::isdigit(c) || c == '.' || c == '-';
             });
             if (isNumeric) {
-                std::cout << " " << std::right << std::setw(columnWidths[column]) << value << " |";
+                out << " " << std::right << std::setw(columnWidths[column]) << value << " |";
             } else {
-                std::cout << " " << std::left << std::setw(columnWidths[column]) << value << " |";
+                out << " " << std::left << std::setw(columnWidths[column]) << value << " |";
             }
         }
-        std::cout << std::endl;
+        out << std::endl;
     }
     printSeparator();
 }
@@ -260,9 +614,11 @@ void Database::updateTable(const SQLParser::Query& query) {
     const std::map<std::string, std::string>& newValues = query.values;
 
     // Update records
-    table->updateRecords(newValues, query.conditions);
+    lastRowsAffected = table->updateRecords(newValues, query.conditions);
 
-    std::cout << "Records updated in table '" << query.table << "'." << std::endl;
+    if (output) {
+        *output << "Records updated in table '" << query.table << "'." << std::endl;
+    }
 }
 
 
@@ -275,137 +631,1196 @@ void Database::deleteFromTable(const SQLParser::Query& query) {
     Table* table = it->second;
 
     // Delete records
-    table->deleteRecords(query.conditions);
-
-    std::cout << "Records deleted from table '" << query.table << "'." << std::endl;
-}
-
-bool evaluateCombinedConditions(
-    const std::map<std::string, std::string>& record,
-    const std::vector<SQLParser::Condition>& conditions) {
-
-    bool result = true;
-    std::string lastRelation = "AND";
-
-    for (const auto& condition : conditions) {
-        // Extract the value from the record
-        auto it = record.find(condition.field);
-        if (it == record.end()) {
-            throw std::runtime_error("Field not found in record: " + condition.field);
-        }
-        std::string fieldValue = it->second;
-
-        // Compare with the condition value
-        bool conditionResult = false;
-        if (condition.op == "=" || condition.op == "==") {
-            try{
-                conditionResult = std::stod(fieldValue) == std::stod(condition.value);
-            }catch(std::invalid_argument& e){
-                conditionResult = (fieldValue == condition.value);
-            }
-            // std::cout <<  "Should not reach here" << std::endl;
-        } else if (condition.op == "!=" || condition.op == "<>") {
-            try{
-                conditionResult = std::stod(fieldValue) != std::stod(condition.value);
-            }catch(std::invalid_argument& e){
-                conditionResult = (fieldValue != condition.value);
-            }
-            // std::cout <<  "Should not reach here" << std::endl;
-        } else if (condition.op == "<") {
-            conditionResult = (std::stod(fieldValue) < std::stod(condition.value));
-        } else if (condition.op == ">") {
-            conditionResult = (std::stod(fieldValue) > std::stod(condition.value));
-        } else if (condition.op == "<=") {
-            conditionResult = (std::stod(fieldValue) <= std::stod(condition.value));
-        } else if (condition.op == ">=") {
-            conditionResult = (std::stod(fieldValue) >= std::stod(condition.value));
+    lastRowsAffected = table->deleteRecords(query.conditions);
+
+    if (output) {
+        *output << "Records deleted from table '" << query.table << "'." << std::endl;
+    }
+}
+
+// Strip the "table." prefix from a possibly qualified column name
+static std::string unqualifiedName(const std::string& name) {
+    size_t dotPos = name.find('.');
+    return dotPos != std::string::npos ? name.substr(dotPos + 1) : name;
+}
+
+// True if the (possibly qualified) column name belongs to the given table
+static bool referencesTable(const std::string& name, const Table& table) {
+    size_t dotPos = name.find('.');
+    if (dotPos != std::string::npos) {
+        return name.compare(0, dotPos, table.getName()) == 0 && dotPos == table.getName().size();
+    }
+    return table.getFields().count(name) > 0;
+}
+
+// Source and unqualified column named by a qualified "TABLE.COLUMN" name; the
+// source is sources.size() when no table of the query has that column
+static std::pair<size_t, std::string> resolveColumn(const std::vector<Table*>& sources, const std::string& name) {
+    for (size_t source = 0; source < sources.size(); ++source) {
+        // The first table with a matching name wins, as in the joined rows
+        if (name.find('.') != std::string::npos && referencesTable(name, *sources[source])) {
+            std::string column = unqualifiedName(name);
+            if (sources[source]->getFields().count(column) > 0) {
+                return {source, column};
+            }
+            break;
+        }
+    }
+    return {sources.size(), ""};
+}
+
+// X BETWEEN low AND high as X >= low followed by AND X <= high. Only exact
+// where nothing is OR-ed onto the pair: joins and correlations use each
+// bound on its own.
+static std::vector<SQLParser::Condition> splitBetween(const SQLParser::Condition& condition) {
+    if (condition.op != "BETWEEN") {
+        return {condition};
+    }
+    SQLParser::Condition lower = condition;
+    lower.op = ">=";
+    lower.value = condition.values[0];
+    lower.values.clear();
+    SQLParser::Condition upper = lower;
+    upper.op = "<=";
+    upper.value = condition.values[1];
+    upper.relation = "AND";
+    return {lower, upper};
+}
+
+// Split a WHERE clause into its top-level AND-ed parts. Relations fold left
+// to right, so everything up to the last OR forms one part and each
+// condition AND-ed on after it is a part of its own (a BETWEEN two).
+static std::vector<std::vector<SQLParser::Condition>> splitConjuncts(const std::vector<SQLParser::Condition>& conditions) {
+    size_t lastOr = 0;
+    for (size_t i = 1; i < conditions.size(); ++i) {
+        if (conditions[i].relation == "OR") {
+            lastOr = i;
+        }
+    }
+    std::vector<std::vector<SQLParser::Condition>> parts;
+    for (size_t i = 0; i < conditions.size(); ++i) {
+        if (i <= lastOr && i > 0) {
+            parts.back().push_back(conditions[i]);
+        } else if (i > lastOr || lastOr == 0) {
+            for (const auto& bound : splitBetween(conditions[i])) {
+                parts.push_back({bound});
+            }
         } else {
-            throw std::runtime_error("Unsupported operator in condition: " + condition.op);
+            parts.push_back({conditions[i]});
+        }
+    }
+    return parts;
+}
+
+// True if some condition is [NOT] EXISTS or [NOT] IN with a subquery
+static bool hasSubquery(const std::vector<SQLParser::Condition>& conditions) {
+    return std::any_of(conditions.begin(), conditions.end(),
+                       [](const SQLParser::Condition& condition) { return condition.subquery != nullptr; });
+}
+
+// "Index Scan" when the table answers the conditions from its row index,
+// "Trigram Index Scan" when a trigram index narrows a LIKE to candidates
+static std::string scanOperator(const Table& table, const std::vector<SQLParser::Condition>& conditions) {
+    std::vector<Predicate> predicates = Predicate::compile(conditions);
+    if (table.findIndexPredicate(predicates)) {
+        return "Index Scan";
+    }
+    return table.findTrigramPredicate(predicates) ? "Trigram Index Scan" : "Seq Scan";
+}
+
+// Position of a column in the plan's pipeline rows, adding it if needed
+static size_t carryColumn(SelectPlan& plan, size_t source, const std::string& column) {
+    for (size_t i = 0; i < plan.columns.size(); ++i) {
+        if (plan.columns[i].source == source && plan.columns[i].column == column) {
+            return i;
+        }
+    }
+    plan.columns.push_back({source, column});
+    return plan.columns.size() - 1;
+}
+
+// Source and column of a GROUP BY, ORDER BY or aggregate column: qualified,
+// or unqualified when the query reads a single table
+static std::pair<size_t, std::string> resolveField(const std::vector<Table*>& sources, const std::string& name) {
+    if (sources.size() == 1 && name.find('.') == std::string::npos) {
+        return sources[0]->getFields().count(name) > 0 ? std::make_pair(size_t(0), name) : std::make_pair(size_t(1), std::string());
+    }
+    return resolveColumn(sources, name);
+}
+
+// A subquery condition resolved against the tables of the outer query: the
+// outer source it is correlated with, every correlation as outer column
+// 'op' subquery column (for IN, first the equality of the two columns),
+// the same as written for plan output, and the subquery's own WHERE parts,
+// unqualified, to push into its scan
+struct SubqueryJoin {
+    size_t probeSource;
+    std::vector<SelectPlan::JoinComparison> comparisons;
+    std::vector<SQLParser::Condition> conditions;
+    std::vector<SQLParser::Condition> scanConditions;
+};
+
+static SubqueryJoin resolveSubquery(const SQLParser::Condition& condition, const Table& table,
+                                    const std::vector<Table*>& sources) {
+    const SQLParser::Query& subquery = *condition.subquery;
+    if (!subquery.joins.empty() || !subquery.groupBy.empty() || !subquery.orderBy.empty() || subquery.limit >= 0) {
+        throw std::runtime_error("A subquery may only read and filter one table: " + condition.value);
+    }
+    for (const Table* source : sources) {
+        if (source->getName() == table.getName()) {
+            throw std::runtime_error("A subquery cannot read a table of the outer query: " + table.getName());
+        }
+    }
+
+    // A column of the subquery's table, qualified or not; empty if it has none
+    auto innerColumn = [&](const std::string& name) {
+        if (name.find('.') != std::string::npos && !referencesTable(name, table)) {
+            return std::string();
+        }
+        std::string column = unqualifiedName(name);
+        return table.getFields().count(column) > 0 ? column : std::string();
+    };
+    SubqueryJoin join{sources.size(), {}, {}, {}};
+    auto correlate = [&](const std::string& outerName, Predicate::Op op, const std::string& column,
+                         SQLParser::Condition written) {
+        auto [source, outerColumn] = resolveField(sources, outerName);
+        if (source == sources.size()) {
+            throw std::runtime_error("Field not found in record: " + outerName);
         }
+        if (join.probeSource != sources.size() && join.probeSource != source) {
+            throw std::runtime_error("A subquery may only be correlated with one table of the outer query: " +
+                                     condition.value);
+        }
+        join.probeSource = source;
+        join.comparisons.push_back({outerColumn, 0, op, column});
+        written.relation = join.conditions.empty() ? "" : "AND";
+        join.conditions.push_back(written);
+    };
 
-        // Combine condition results based on logical relations
-        if (lastRelation == "AND") {
-            result = result && conditionResult;
-        } else if (lastRelation == "OR") {
-            result = result || conditionResult;
+    if (condition.op == "IN" || condition.op == "NOT IN") {
+        std::string column = subquery.fields.size() == 1 ? innerColumn(subquery.fields[0]) : "";
+        if (column.empty()) {
+            throw std::runtime_error("An IN subquery must select one column of its table: " + condition.value);
+        }
+        auto [source, outerColumn] = resolveField(sources, condition.field);
+        std::string field = source < sources.size() ? sources[source]->getName() + "." + outerColumn : condition.field;
+        SQLParser::Condition written;
+        written.field = field;
+        written.op = "=";
+        written.value = table.getName() + "." + column;
+        correlate(condition.field, Predicate::Op::Equal, column, written);
+    }
+    for (auto& part : splitConjuncts(subquery.conditions)) {
+        if (hasSubquery(part)) {
+            throw std::runtime_error("Subqueries cannot be nested: " + condition.value);
         }
 
-        lastRelation = condition.relation.empty() ? "AND" : condition.relation;
+        // A correlation compares a column of the subquery's table with a
+        // qualified column of the outer query
+        const SQLParser::Condition& first = part.front();
+        std::string value = first.value;
+        std::transform(value.begin(), value.end(), value.begin(), ::toupper);
+        bool outerValue = value.find('.') != std::string::npos && resolveColumn(sources, value).first < sources.size();
+        bool outerField = first.field.find('.') != std::string::npos &&
+                          resolveColumn(sources, first.field).first < sources.size();
+        if (part.size() == 1 && (outerValue || outerField)) {
+            Predicate::Op op = Predicate(first).getOp();
+            if (op == Predicate::Op::Like || op == Predicate::Op::In) {
+                throw std::runtime_error("Unsupported operator in subquery correlation: " + first.op);
+            }
+            std::string column = innerColumn(outerValue ? first.field : value);
+            if (column.empty()) {
+                throw std::runtime_error("Column not found in subquery condition: " + (outerValue ? first.field : value));
+            }
+            // The value is a column too, shown upper-cased like the field
+            SQLParser::Condition written = first;
+            written.value = value;
+            correlate(outerValue ? value : first.field, outerValue ? Predicate::swapOperands(op) : op, column, written);
+            continue;
+        }
+        for (auto& inner : part) {
+            std::string column = innerColumn(inner.field);
+            if (column.empty()) {
+                throw std::runtime_error("Field not found in record: " + inner.field);
+            }
+            inner.field = column;
+            if (&inner == &part.front()) {
+                inner.relation = join.scanConditions.empty() ? "" : "AND";
+            }
+            join.scanConditions.push_back(inner);
+        }
     }
 
-    return result;
+    bool equality = std::any_of(join.comparisons.begin(), join.comparisons.end(), [](const auto& comparison) {
+        return comparison.op == Predicate::Op::Equal;
+    });
+    if (!equality) {
+        throw std::runtime_error("A subquery must be correlated with the outer query by an equality: " + condition.value);
+    }
+    // NOT IN is answered for the whole column at once: one NULL in it rules
+    // out every row
+    if (condition.op == "NOT IN" && join.comparisons.size() > 1) {
+        throw std::runtime_error("NOT IN cannot be correlated with the outer query; use NOT EXISTS: " + condition.value);
+    }
+    return join;
 }
 
-std::vector<std::map<std::string, std::string>> Database::executeSelectQuery(const SQLParser::Query& query) {
+// Aggregated column of an aggregate, adding it (and carrying its argument) if needed
+static size_t aggregateSlot(SelectPlan& plan, const AggregateSpec& spec) {
+    for (size_t i = 0; i < plan.aggregates.size(); ++i) {
+        if (plan.aggregates[i].spec.name == spec.name) {
+            return plan.groupSlots.size() + i;
+        }
+    }
+    size_t slot = SelectPlan::noSlot;
+    if (spec.argument != "*") {
+        auto [source, column] = resolveField(plan.sources, spec.argument);
+        if (source == plan.sources.size()) {
+            throw std::invalid_argument("Field not found: " + spec.argument);
+        }
+        slot = carryColumn(plan, source, column);
+    }
+    plan.aggregates.push_back({spec, slot});
+    return plan.groupSlots.size() + plan.aggregates.size() - 1;
+}
+
+// Work out the output columns, and with GROUP BY, aggregates or ORDER BY the
+// columns they read, before the scans are described
+static void resolveOutput(const SQLParser::Query& query, SelectPlan& plan) {
+    const std::vector<Table*>& sources = plan.sources;
+    bool selectAll = query.fields.size() == 1 && query.fields[0] == "*";
+    plan.limit = query.limit;
+    plan.aggregated = !query.groupBy.empty();
+    for (const auto& field : query.fields) {
+        AggregateSpec spec;
+        plan.aggregated = plan.aggregated || parseAggregate(field, spec);
+    }
+
+    if (!plan.aggregated) {
+        if (selectAll) {
+            // Every column of every table; rows without a value leave it out
+            for (size_t source = 0; source < sources.size(); ++source) {
+                for (const auto& [fieldName, field] : sources[source]->getFields()) {
+                    std::string name = query.joins.empty() ? fieldName : sources[source]->getName() + "." + fieldName;
+                    plan.outputColumns.push_back({name, source, fieldName, SelectPlan::noSlot, false});
+                }
+            }
+        } else {
+            for (const auto& field : query.fields) {
+                auto [source, column] = query.joins.empty() ? std::make_pair(size_t(0), field) : resolveColumn(sources, field);
+                if (source == sources.size()) {
+                    throw std::invalid_argument("Field not found: " + field);
+                }
+                plan.outputColumns.push_back({field, source, column});
+            }
+        }
+        for (const auto& key : query.orderBy) {
+            auto [source, column] = resolveField(sources, key.field);
+            if (source == sources.size()) {
+                throw std::invalid_argument("Field not found: " + key.field);
+            }
+            plan.sortKeys.push_back({carryColumn(plan, source, column), key.descending});
+        }
+        return;
+    }
+
+    // Aggregated rows hold the group columns, then the aggregates
+    if (selectAll) {
+        throw std::invalid_argument("SELECT * cannot be used with GROUP BY or aggregates");
+    }
+    std::vector<std::pair<size_t, std::string>> groupColumns;
+    for (const auto& name : query.groupBy) {
+        groupColumns.push_back(resolveField(sources, name));
+        if (groupColumns.back().first == sources.size()) {
+            throw std::invalid_argument("Field not found: " + name);
+        }
+        plan.groupSlots.push_back(carryColumn(plan, groupColumns.back().first, groupColumns.back().second));
+    }
+    auto groupSlot = [&](const std::string& name) {
+        auto column = resolveField(sources, name);
+        auto it = std::find(groupColumns.begin(), groupColumns.end(), column);
+        if (it == groupColumns.end()) {
+            throw std::invalid_argument("Column " + name + " must appear in GROUP BY or in an aggregate");
+        }
+        return static_cast<size_t>(it - groupColumns.begin());
+    };
+    for (const auto& field : query.fields) {
+        AggregateSpec spec;
+        size_t slot = parseAggregate(field, spec) ? aggregateSlot(plan, spec) : groupSlot(field);
+        plan.outputColumns.push_back({field, 0, "", slot});
+    }
+    for (const auto& key : query.orderBy) {
+        AggregateSpec spec;
+        size_t slot = parseAggregate(key.field, spec) ? aggregateSlot(plan, spec) : groupSlot(key.field);
+        plan.sortKeys.push_back({slot, key.descending});
+    }
+}
+
+// Aggregate, Sort, Limit and Project nodes on top of 'current'
+static void addOutputNodes(const SQLParser::Query& query, SelectPlan& plan, size_t current, double currentRows) {
+    QueryPlan& tree = plan.tree;
+    if (plan.aggregated) {
+        std::string detail;
+        double groups = 1.0;
+        for (size_t i = 0; i < query.groupBy.size(); ++i) {
+            detail += (i == 0 ? "Group: " : ", ") + query.groupBy[i];
+            const PipelineColumn& column = plan.columns[plan.groupSlots[i]];
+            groups *= plan.sources[column.source]->estimateDistinct(column.column);
+        }
+        for (size_t i = 0; i < plan.aggregates.size(); ++i) {
+            detail += std::string(i > 0 ? ", " : detail.empty() ? "Aggregates: " : " Aggregates: ") + plan.aggregates[i].spec.name;
+        }
+        plan.aggregateNode = tree.addNode("Aggregate", detail, {current});
+        currentRows = query.groupBy.empty() ? 1.0 : std::max(1.0, std::min(groups, currentRows));
+        tree.setEstimatedRows(plan.aggregateNode, currentRows);
+        current = plan.aggregateNode;
+    }
+    if (!query.orderBy.empty()) {
+        std::string detail;
+        for (const auto& key : query.orderBy) {
+            detail += (detail.empty() ? "Key: " : ", ") + key.field + (key.descending ? " DESC" : "");
+        }
+        plan.sortNode = tree.addNode("Sort", detail, {current});
+        tree.setEstimatedRows(plan.sortNode, currentRows);
+        current = plan.sortNode;
+    }
+    if (plan.limit >= 0) {
+        plan.limitNode = tree.addNode("Limit", std::to_string(plan.limit), {current});
+        currentRows = std::min(currentRows, static_cast<double>(plan.limit));
+        tree.setEstimatedRows(plan.limitNode, currentRows);
+        current = plan.limitNode;
+    }
+
+    std::string output;
+    for (const auto& field : query.fields) {
+        output += (output.empty() ? "" : ", ") + field;
+    }
+    plan.projectNode = tree.addNode("Project", output, {current});
+}
+
+SelectPlan Database::planSelectQuery(const SQLParser::Query& query,
+                                     const std::map<std::string, Table*>& substitutes) const {
+    auto findTable = [&](const std::string& tableName) {
+        auto substitute = substitutes.find(tableName);
+        return substitute != substitutes.end() ? substitute->second : getTable(tableName);
+    };
+
     //check if the table exists
-    if (tables.find(query.table) == tables.end()) {
+    Table* primaryTable = findTable(query.table);
+    if (!primaryTable) {
         throw std::runtime_error("Table not found: " + query.table);
-    } 
+    }
 
-    // Get the primary table
-    Table& primaryTable = *tables.at(query.table);
+    SelectPlan plan;
+    plan.primaryTable = primaryTable;
+    QueryPlan& tree = plan.tree;
 
-    // If there are no joins, use selectRecords directly
-    if (query.joins.empty()) {
-        std::vector<std::map<std::string, std::string>> finalResults = primaryTable.selectRecords(query.fields, query.conditions);
-        printQueryResults(finalResults);
-        return finalResults;
-    }
+    // Without joins or subqueries the WHERE clause is evaluated inside the scan
+    if (query.joins.empty() && !hasSubquery(query.conditions)) {
+        plan.sources.push_back(primaryTable);
+        plan.scanConditions.push_back(query.conditions);
+        resolveOutput(query, plan);
 
-    // Process INNER JOINs
-    std::vector<std::map<std::string, std::string>> result;
-    std::vector<std::map<std::string, std::string>> currentRecords = primaryTable.records;
+        std::string scanDetail = "on " + primaryTable->getName();
+        if (!query.conditions.empty()) {
+            scanDetail += " Filter: " + describeConditions(query.conditions);
+        }
+        plan.scanNode = tree.addNode(scanOperator(*primaryTable, query.conditions), scanDetail);
+        double scanRows = primaryTable->estimateRows(Predicate::compile(query.conditions));
+        tree.setEstimatedRows(plan.scanNode, scanRows);
+        addOutputNodes(query, plan, plan.scanNode, scanRows);
+        return plan;
+    }
 
+    // Resolve every ON clause to the two tables it connects: each of its
+    // conditions compares a column of the joined table with one of the same
+    // table written before it
+    struct JoinEdge {
+        struct Comparison {
+            std::string columns[2];
+            Predicate::Op op;           // columns[0] 'op' columns[1]
+        };
+        std::vector<SQLParser::Condition> conditions;
+        size_t sources[2];
+        std::vector<Comparison> comparisons;
+        SelectPlan::JoinKind kind;
+        std::vector<SQLParser::Condition> filters; // Constant comparisons on the joined table
+    };
+    std::vector<JoinEdge> edges;
+    std::vector<Table*>& sources = plan.sources;
+    sources.push_back(primaryTable);
     for (const auto& join : query.joins) {
-        // Check if the joined table exists
-        if (tables.find(join.table) == tables.end()) {
+        Table* joinTable = findTable(join.table);
+        if (!joinTable) {
             throw std::runtime_error("Table not found: " + join.table);
         }
-        
-        // Get the joined table
-        Table& joinTable = *tables.at(join.table);
 
-        // Parse the join condition
-        std::vector<SQLParser::Condition> joinConditions;
-        SQLParser::parse_conditions(join.onCondition, joinConditions);
-        SQLParser::Condition joinCondition = joinConditions[0];
+        // Parse the join conditions
+        JoinEdge edge{{}, {sources.size(), sources.size()}, {}, SelectPlan::JoinKind::Inner, {}};
+        if (join.type == "LEFT") {
+            edge.kind = SelectPlan::JoinKind::Left;
+        } else if (join.type == "RIGHT") {
+            edge.kind = SelectPlan::JoinKind::Right;
+        } else if (join.type == "FULL") {
+            edge.kind = SelectPlan::JoinKind::Full;
+        }
+        std::vector<SQLParser::Condition> written;
+        SQLParser::parse_conditions(join.onCondition, written);
+        std::vector<SQLParser::Condition> conditions;
+        for (const auto& condition : written) {
+            for (const auto& bound : splitBetween(condition)) {
+                conditions.push_back(bound);
+            }
+        }
+        if (conditions.empty()) {
+            throw std::runtime_error("Invalid join condition: " + join.onCondition);
+        }
+        for (const auto& condition : conditions) {
+            if (&condition != &conditions.front() && condition.relation != "AND") {
+                throw std::runtime_error("Join conditions must be combined with AND: " + join.onCondition);
+            }
+
+            // A column of the joined table compared with a constant filters
+            // that table's scan: a LEFT JOIN still keeps the rows of the
+            // other side left without a partner. RIGHT and FULL joins must
+            // keep every joined row, so they cannot filter it.
+            bool valueIsColumn = referencesTable(condition.value, *joinTable) ||
+                                 std::any_of(sources.begin(), sources.end(), [&](const Table* source) {
+                                     return referencesTable(condition.value, *source);
+                                 });
+            if (!valueIsColumn) {
+                if (!referencesTable(condition.field, *joinTable)) {
+                    throw std::runtime_error("Only a column of the joined table can be compared with a constant in a "
+                                             "join condition: " + condition.field);
+                }
+                if (edge.kind == SelectPlan::JoinKind::Right || edge.kind == SelectPlan::JoinKind::Full) {
+                    throw std::runtime_error("A " + join.type + " JOIN keeps every row of " + joinTable->getName() +
+                                             ", so its join condition cannot compare it with a constant: " +
+                                             join.onCondition);
+                }
+                SQLParser::Condition filter = condition;
+                filter.field = unqualifiedName(condition.field);
+                edge.filters.push_back(filter);
+                continue;
+            }
+            edge.conditions.push_back(condition);
+            edge.conditions.back().relation = edge.conditions.size() > 1 ? "AND" : "";
+
+            Predicate::Op op = Predicate(condition).getOp();
+            if (op == Predicate::Op::Like || op == Predicate::Op::In) {
+                throw std::runtime_error("Unsupported operator in join condition: " + condition.op);
+            }
 
-        // Perform INNER JOIN
-        result = Table::performInnerJoin(currentRecords,joinTable.records,joinCondition,joinTable.getName(),this->getTable(query.table)->getName());
+            // Work out which side of the condition refers to the joined table
+            std::string joinedName = condition.value; // 'value' holds the right field
+            std::string otherName = condition.field;
+            if (!referencesTable(joinedName, *joinTable) && referencesTable(otherName, *joinTable)) {
+                std::swap(joinedName, otherName);
+                op = Predicate::swapOperands(op);
+            }
 
-        // Update currentRecords for the next join (if any)
-        currentRecords = result;
+            size_t otherSource = sources.size();
+            for (size_t source = 0; source < sources.size() && otherSource == sources.size(); ++source) {
+                if (referencesTable(otherName, *sources[source])) {
+                    otherSource = source;
+                }
+            }
+            if (otherSource == sources.size()) {
+                throw std::runtime_error("Column not found in join condition: " + otherName);
+            }
+            if (edge.sources[0] != sources.size() && edge.sources[0] != otherSource) {
+                throw std::runtime_error("A join condition may only compare the joined table with one other table: " +
+                                         join.onCondition);
+            }
+            edge.sources[0] = otherSource;
+            edge.comparisons.push_back({{unqualifiedName(otherName), unqualifiedName(joinedName)}, op});
+        }
+        bool ordering = std::any_of(edge.comparisons.begin(), edge.comparisons.end(), [](const auto& comparison) {
+            return comparison.op != Predicate::Op::NotEqual;
+        });
+        if (!ordering) {
+            throw std::runtime_error("A join needs an equality or an ordering comparison: " + join.onCondition);
+        }
+        edges.push_back(edge);
+        sources.push_back(joinTable);
     }
 
-    // Apply WHERE conditions to the combined records
-    std::vector<std::map<std::string, std::string>> filteredResults;
-    for (const auto& record : currentRecords) {
-        if (evaluateCombinedConditions(record, query.conditions)) {
-            filteredResults.push_back(record);
+    // Outer joins keep rows without a match, so they run in the order
+    // written. A table is nullable when some outer join may NULL-extend it:
+    // the joined table of a LEFT JOIN, the tables before a RIGHT JOIN, and
+    // both sides of a FULL JOIN.
+    bool outer = false;
+    std::vector<bool> nullable(sources.size(), false);
+    for (size_t i = 0; i < edges.size(); ++i) {
+        SelectPlan::JoinKind kind = edges[i].kind;
+        outer = outer || kind != SelectPlan::JoinKind::Inner;
+        if (kind == SelectPlan::JoinKind::Left || kind == SelectPlan::JoinKind::Full) {
+            nullable[i + 1] = true;
+        }
+        if (kind == SelectPlan::JoinKind::Right || kind == SelectPlan::JoinKind::Full) {
+            std::fill(nullable.begin(), nullable.begin() + i + 1, true);
         }
     }
 
-    // Select the requested fields
-    std::vector<std::map<std::string, std::string>> finalResults;
-    for (const auto& record : filteredResults) {
-        std::map<std::string, std::string> selectedRecord;
-        if (query.fields.size() == 1 && query.fields[0] == "*") {
-            selectedRecord = record; // Select all fields
+    // Subquery conditions become joins of their own, further down; they
+    // must be AND-ed with the rest of the WHERE clause
+    std::vector<SQLParser::Condition> subqueryConditions;
+    std::vector<SQLParser::Condition> whereConditions;
+    for (auto& part : splitConjuncts(query.conditions)) {
+        if (!hasSubquery(part)) {
+            whereConditions.insert(whereConditions.end(), part.begin(), part.end());
+        } else if (part.size() == 1) {
+            subqueryConditions.push_back(part.front());
         } else {
-            for (const auto& fieldName : query.fields) {
-                auto it = record.find(fieldName);
-                if (it != record.end()) {
-                    selectedRecord[fieldName] = it->second;
-                } else {
-                    throw std::invalid_argument("Field not found: " + fieldName);
+            throw std::runtime_error("A subquery condition must be AND-ed with the rest of the WHERE clause");
+        }
+    }
+    if (!whereConditions.empty()) {
+        whereConditions.front().relation = "";
+    }
+
+    // Push every part of the WHERE clause that reads a single table into
+    // that table's scan, so the join only sees qualifying rows. Parts
+    // spanning tables stay in a Filter above the joins, as do those on a
+    // nullable table, which must also see the rows NULL-extended for it.
+    Predicate::compile(whereConditions); // Reject bad operators and relations up front
+    plan.scanConditions.resize(sources.size());
+    for (size_t i = 0; i < edges.size(); ++i) {
+        for (auto& filter : edges[i].filters) {
+            filter.relation = plan.scanConditions[i + 1].empty() ? "" : "AND";
+            plan.scanConditions[i + 1].push_back(filter);
+        }
+    }
+    for (auto& part : splitConjuncts(whereConditions)) {
+        size_t partSource = sources.size();
+        for (const auto& condition : part) {
+            size_t source = resolveField(sources, condition.field).first;
+            if (source == sources.size()) {
+                throw std::runtime_error("Field not found in record: " + condition.field);
+            }
+            partSource = partSource == sources.size() || partSource == source ? source : sources.size() + 1;
+        }
+        if (partSource > sources.size() || nullable[partSource]) {
+            plan.filterConditions.insert(plan.filterConditions.end(), part.begin(), part.end());
+            continue;
+        }
+        auto& pushed = plan.scanConditions[partSource];
+        for (auto& condition : part) {
+            condition.field = unqualifiedName(condition.field);
+            if (&condition == &part.front()) {
+                condition.relation = pushed.empty() ? "" : "AND";
+            }
+            pushed.push_back(condition);
+        }
+    }
+
+    // Choose the join order from each table's estimated rows after its
+    // pushed-down filters and the distinct keys on either side of each join
+    std::vector<double> estimatedRows;
+    for (size_t source = 0; source < sources.size(); ++source) {
+        estimatedRows.push_back(sources[source]->estimateRows(Predicate::compile(plan.scanConditions[source])));
+    }
+    // A join without an equality is taken to keep about a third of the
+    // pairs for each ordering comparison
+    std::vector<JoinOrder::Edge> orderEdges;
+    for (const auto& edge : edges) {
+        double distinct[2] = {1.0, 1.0};
+        auto equality = std::find_if(edge.comparisons.begin(), edge.comparisons.end(), [](const auto& comparison) {
+            return comparison.op == Predicate::Op::Equal;
+        });
+        for (int side = 0; side < 2; ++side) {
+            if (equality != edge.comparisons.end()) {
+                distinct[side] = sources[edge.sources[side]]->estimateDistinct(equality->columns[side]);
+                continue;
+            }
+            for (const auto& comparison : edge.comparisons) {
+                distinct[side] *= comparison.op != Predicate::Op::NotEqual ? 3.0 : 1.0;
+            }
+        }
+        orderEdges.push_back({edge.sources[0], edge.sources[1], distinct[0], distinct[1]});
+    }
+    std::vector<size_t> order(sources.size());
+    std::iota(order.begin(), order.end(), size_t(0));
+    if (!outer) {
+        order = JoinOrder::choose(estimatedRows, orderEdges);
+    }
+
+    // Each later table is joined through the edge reaching the tables
+    // joined before it. With an equality it is hashed on its key, or merged
+    // when the key already orders both sides; otherwise one side is sorted
+    // on a column of the comparisons and searched by range. An outer join
+    // always hashes or sorts its joined table, which then records the rows
+    // that found a match.
+    plan.driver = order[0];
+    std::vector<bool> joined(sources.size(), false);
+    std::vector<size_t> stepOf(sources.size(), 0);
+    joined[plan.driver] = true;
+    bool ordered = true; // Rows so far are in the driver's table order
+    for (size_t position = 1; position < order.size(); ++position) {
+        size_t source = order[position];
+        for (const auto& edge : edges) {
+            int side = edge.sources[1] == source ? 1 : edge.sources[0] == source ? 0 : -1;
+            if (side < 0 || !joined[edge.sources[1 - side]]) {
+                continue;
+            }
+            SelectPlan::JoinStep step{};
+            step.kind = edge.kind;
+            step.table = sources[source];
+            step.source = source;
+            step.conditions = edge.conditions;
+            step.probeSource = edge.sources[1 - side];
+
+            // Every comparison as probe value 'op' joined value
+            std::vector<SelectPlan::JoinComparison> comparisons;
+            for (const auto& comparison : edge.comparisons) {
+                comparisons.push_back({comparison.columns[1 - side], 0,
+                                       side == 1 ? comparison.op : Predicate::swapOperands(comparison.op),
+                                       comparison.columns[side]});
+            }
+            auto equality = std::find_if(comparisons.begin(), comparisons.end(), [](const auto& comparison) {
+                return comparison.op == Predicate::Op::Equal;
+            });
+            if (equality != comparisons.end()) {
+                step.buildColumn = equality->buildColumn;
+                step.probeColumn = equality->probeColumn;
+                step.probeKey = sources[step.probeSource]->getName() + "." + step.probeColumn;
+                comparisons.erase(equality);
+                bool merge = ordered && step.kind == SelectPlan::JoinKind::Inner && step.probeSource == plan.driver && step.table->isSortedOn(step.buildColumn) &&
+                             sources[plan.driver]->isSortedOn(step.probeColumn);
+                step.method = merge ? SelectPlan::JoinMethod::Merge : SelectPlan::JoinMethod::Hash;
+                step.comparisons = std::move(comparisons);
+            } else {
+                // The band is the ordering comparisons sharing the first one's
+                // joined column, or its probe column if more share that
+                const auto& first = *std::find_if(comparisons.begin(), comparisons.end(), [](const auto& comparison) {
+                    return comparison.op != Predicate::Op::NotEqual;
+                });
+                auto inBand = [&](const SelectPlan::JoinComparison& comparison, bool onBuild) {
+                    return comparison.op != Predicate::Op::NotEqual &&
+                           (onBuild ? comparison.buildColumn == first.buildColumn : comparison.probeColumn == first.probeColumn);
+                };
+                auto shared = [&](bool onBuild) {
+                    return std::count_if(comparisons.begin(), comparisons.end(),
+                                         [&](const auto& comparison) { return inBand(comparison, onBuild); });
+                };
+                step.method = SelectPlan::JoinMethod::Band;
+                step.bandOnBuild = step.kind != SelectPlan::JoinKind::Inner || shared(true) >= shared(false);
+                for (auto& comparison : comparisons) {
+                    (inBand(comparison, step.bandOnBuild) ? step.band : step.comparisons).push_back(std::move(comparison));
                 }
+                // Rows then come out in the joined table's order of that column
+                ordered = ordered && step.bandOnBuild;
+            }
+            plan.joins.push_back(std::move(step));
+            break;
+        }
+        stepOf[source] = plan.joins.size() - 1;
+        joined[source] = true;
+
+        // The probe side of an inner hash join only keeps rows whose key may
+        // be in this join's table, unless an outer join must still keep them
+        const auto& step = plan.joins.back();
+        if (step.method != SelectPlan::JoinMethod::Hash || step.kind != SelectPlan::JoinKind::Inner ||
+            nullable[step.probeSource]) {
+            continue;
+        }
+        if (step.probeSource == plan.driver) {
+            plan.bloomFilters.push_back(plan.joins.size() - 1);
+        } else {
+            plan.joins[stepOf[step.probeSource]].bloomFilters.push_back(plan.joins.size() - 1);
+        }
+    }
+
+    // Pipeline rows carry only what later operators read: the columns the
+    // joins compare, those of the remaining filter and those grouped,
+    // aggregated or sorted on. Output columns are fetched at the end.
+    for (auto& step : plan.joins) {
+        if (step.method != SelectPlan::JoinMethod::Band) {
+            step.probeSlot = carryColumn(plan, step.probeSource, step.probeColumn);
+        }
+        for (auto* comparisons : {&step.band, &step.comparisons}) {
+            for (auto& comparison : *comparisons) {
+                comparison.probeSlot = carryColumn(plan, step.probeSource, comparison.probeColumn);
+            }
+        }
+    }
+    for (const auto& condition : plan.filterConditions) {
+        auto [source, column] = resolveField(sources, condition.field);
+        plan.filterSlots.push_back(carryColumn(plan, source, column));
+    }
+    resolveOutput(query, plan);
+
+    // Each subquery condition then joins the subquery's table to the rows so
+    // far, by a hash semi-join (EXISTS, IN) or anti-join (NOT EXISTS, NOT
+    // IN) on the first equality correlating the two. Its table is a source
+    // of its own, which neither the output nor the outer WHERE clause sees.
+    std::vector<Table*> visible = sources;
+    for (const auto& condition : subqueryConditions) {
+        Table* table = findTable(condition.subquery->table);
+        if (!table) {
+            throw std::runtime_error("Table not found: " + condition.subquery->table);
+        }
+        SubqueryJoin subquery = resolveSubquery(condition, *table, visible);
+
+        SelectPlan::JoinStep step{};
+        step.kind = condition.op == "EXISTS" || condition.op == "IN" ? SelectPlan::JoinKind::Semi
+                                                                     : SelectPlan::JoinKind::Anti;
+        step.method = SelectPlan::JoinMethod::Hash;
+        step.nullAware = condition.op == "NOT IN";
+        step.table = table;
+        step.source = sources.size();
+        step.conditions = std::move(subquery.conditions);
+        step.probeSource = subquery.probeSource;
+        auto equality = std::find_if(subquery.comparisons.begin(), subquery.comparisons.end(), [](const auto& comparison) {
+            return comparison.op == Predicate::Op::Equal;
+        });
+        step.buildColumn = equality->buildColumn;
+        step.probeColumn = equality->probeColumn;
+        step.probeKey = sources[step.probeSource]->getName() + "." + step.probeColumn;
+        subquery.comparisons.erase(equality);
+        step.comparisons = std::move(subquery.comparisons);
+        step.probeSlot = carryColumn(plan, step.probeSource, step.probeColumn);
+        for (auto& comparison : step.comparisons) {
+            comparison.probeSlot = carryColumn(plan, step.probeSource, comparison.probeColumn);
+        }
+
+        sources.push_back(table);
+        plan.scanConditions.push_back(std::move(subquery.scanConditions));
+        estimatedRows.push_back(table->estimateRows(Predicate::compile(plan.scanConditions.back())));
+        plan.joins.push_back(std::move(step));
+        if (plan.joins.back().kind != SelectPlan::JoinKind::Semi || nullable[subquery.probeSource]) {
+            continue;
+        }
+        if (subquery.probeSource == plan.driver) {
+            plan.bloomFilters.push_back(plan.joins.size() - 1);
+        } else {
+            plan.joins[stepOf[subquery.probeSource]].bloomFilters.push_back(plan.joins.size() - 1);
+        }
+    }
+
+    auto describeScan = [&](size_t source, const std::vector<size_t>& joinIds) {
+        std::string detail = "on " + sources[source]->getName();
+        if (!plan.scanConditions[source].empty()) {
+            detail += " Filter: " + describeConditions(plan.scanConditions[source]);
+        }
+        std::string carried;
+        for (const auto& column : plan.columns) {
+            if (column.source == source) {
+                carried += (carried.empty() ? "" : ", ") + column.column;
+            }
+        }
+        if (!carried.empty()) {
+            detail += " Columns: " + carried;
+        }
+        for (size_t i = 0; i < joinIds.size(); ++i) {
+            detail += (i == 0 ? " Bloom Filter: " : ", ") + plan.joins[joinIds[i]].probeKey;
+        }
+        return detail;
+    };
+
+    plan.scanNode = tree.addNode(scanOperator(*sources[plan.driver], plan.scanConditions[plan.driver]),
+                                 describeScan(plan.driver, plan.bloomFilters));
+    tree.setEstimatedRows(plan.scanNode, estimatedRows[plan.driver]);
+    size_t current = plan.scanNode;
+
+    // Joins run in the chosen order; each reads its table and joins it
+    // with the rows produced so far
+    double currentRows = estimatedRows[plan.driver];
+    joined.assign(sources.size(), false);
+    joined[plan.driver] = true;
+    for (auto& step : plan.joins) {
+        std::string buildDetail = "(build) " + scanOperator(*step.table, plan.scanConditions[step.source]) + " " +
+                                  describeScan(step.source, step.bloomFilters);
+        std::string joinDetail = describeConditions(step.conditions);
+        std::string buildOp = "Hash";
+        std::string joinOp = "Hash";
+        if (step.method == SelectPlan::JoinMethod::Merge) {
+            buildOp = "Scan";
+            joinOp = "Merge";
+        } else if (step.method == SelectPlan::JoinMethod::Band) {
+            const auto& first = step.band.front();
+            if (step.bandOnBuild) {
+                buildOp = "Sort";
+                buildDetail += " Sort Key: " + step.table->getName() + "." + first.buildColumn;
+            } else {
+                buildOp = "Scan";
+                joinDetail += " Sort Key: " + sources[step.probeSource]->getName() + "." + first.probeColumn;
+            }
+            joinOp = "Band";
+        }
+        static const char* const kindNames[] = {"", " Left", " Right", " Full", " Semi", " Anti"};
+        joinOp += kindNames[static_cast<size_t>(step.kind)] + std::string(" Join");
+        step.buildNode = tree.addNode(buildOp, buildDetail);
+        tree.setEstimatedRows(step.buildNode, estimatedRows[step.source]);
+        step.joinNode = tree.addNode(joinOp, joinDetail, {current, step.buildNode});
+
+        // A semi-join keeps the share of probe keys the subquery holds, the
+        // anti-join the rest; an outer join at least the rows it preserves
+        double buildRows = estimatedRows[step.source];
+        if (step.kind == SelectPlan::JoinKind::Semi || step.kind == SelectPlan::JoinKind::Anti) {
+            double probeDistinct = std::max(1.0, sources[step.probeSource]->estimateDistinct(step.probeColumn));
+            double buildDistinct = std::min(buildRows, step.table->estimateDistinct(step.buildColumn));
+            double matched = std::min(1.0, buildDistinct / probeDistinct);
+            currentRows = std::max(1.0, currentRows * (step.kind == SelectPlan::JoinKind::Semi ? matched : 1.0 - matched));
+        } else {
+            double joinedRows = JoinOrder::estimateJoinRows(estimatedRows, orderEdges, joined, currentRows, step.source);
+            if (step.kind == SelectPlan::JoinKind::Left || step.kind == SelectPlan::JoinKind::Full) {
+                joinedRows = std::max(joinedRows, currentRows);
+            }
+            if (step.kind == SelectPlan::JoinKind::Right || step.kind == SelectPlan::JoinKind::Full) {
+                joinedRows = std::max(joinedRows, buildRows);
+            }
+            currentRows = joinedRows;
+        }
+        tree.setEstimatedRows(step.joinNode, currentRows);
+        joined[step.source] = true;
+        current = step.joinNode;
+    }
+
+    // What is left of the WHERE clause is applied once, on top of the combined rows
+    if (!plan.filterConditions.empty()) {
+        plan.filterNode = tree.addNode("Filter", describeConditions(plan.filterConditions), {current});
+        current = plan.filterNode;
+    }
+    addOutputNodes(query, plan, current, currentRows);
+    return plan;
+}
+
+// Rough heap footprint of materialized result rows
+static size_t estimateResultBytes(const std::vector<std::map<std::string, std::string>>& results) {
+    size_t bytes = (results.capacity() - results.size()) * sizeof(std::map<std::string, std::string>);
+    for (const auto& record : results) {
+        bytes += estimateRecordBytes(record);
+    }
+    return bytes;
+}
+
+std::vector<std::map<std::string, std::string>> Database::executeSelectPlan(SelectPlan& plan) {
+    QueryPlan& tree = plan.tree;
+
+    // Everything the query holds is charged to its own tracker, within the budget
+    MemoryTracker memory(queryMemoryLimit, &queryMemory);
+    struct PeakRecorder {
+        const MemoryTracker& memory;
+        size_t& peak;
+        ~PeakRecorder() { peak = memory.getPeak(); }
+    } peakRecorder{memory, lastQueryPeak};
+
+    // Every hash table and aggregation or sort state lives in this arena and
+    // is released when the query returns
+    QueryArena arena(&memory);
+
+    // Build every hash table before scanning, the last join first, so that
+    // each build scan can already use the Bloom filters of the joins after it
+    std::vector<std::unique_ptr<JoinHashTable>> hashTables(plan.joins.size());
+    auto pushedFilters = [&](const std::vector<size_t>& joinIds) {
+        std::vector<JoinKeyFilter> filters;
+        for (size_t joinId : joinIds) {
+            filters.push_back({plan.joins[joinId].probeColumn, &hashTables[joinId]->getBloomFilter()});
+        }
+        return filters;
+    };
+    // Right and full outer joins and NOT IN also read the build rows no key
+    // lookup reaches, so their tables keep the row ids
+    for (size_t i = plan.joins.size(); i-- > 0;) {
+        const auto& step = plan.joins[i];
+        if (step.method == SelectPlan::JoinMethod::Hash) {
+            bool keepRowIds = step.kind == SelectPlan::JoinKind::Right || step.kind == SelectPlan::JoinKind::Full ||
+                              step.nullAware;
+            hashTables[i] = std::make_unique<JoinHashTable>(*step.table, step.buildColumn,
+                                                            Predicate::compile(plan.scanConditions[step.source]),
+                                                            pushedFilters(step.bloomFilters), arena,
+                                                            &tree.getStats(step.buildNode), joinThreads, keepRowIds);
+        }
+    }
+
+    // The operator tree: scan, joins in the chosen order, the cross-table
+    // WHERE parts, then aggregation, sorting and the limit
+    size_t sourceCount = plan.sources.size();
+    std::unique_ptr<Operator> root = std::make_unique<ScanOperator>(
+        *plan.sources[plan.driver], plan.driver, Predicate::compile(plan.scanConditions[plan.driver]),
+        pushedFilters(plan.bloomFilters), plan.columns, sourceCount, &tree.getStats(plan.scanNode));
+    for (size_t i = 0; i < plan.joins.size(); ++i) {
+        const auto& step = plan.joins[i];
+        OperatorStats* buildStats = &tree.getStats(step.buildNode);
+        OperatorStats* joinStats = &tree.getStats(step.joinNode);
+        switch (step.method) {
+            case SelectPlan::JoinMethod::Hash:
+                root = std::make_unique<HashJoinOperator>(std::move(root), *hashTables[i], step.kind, step.nullAware,
+                                                          step.probeSource, step.probeSlot, step.comparisons, step.source,
+                                                          plan.columns, sourceCount, arena, joinStats);
+                break;
+            case SelectPlan::JoinMethod::Merge:
+                root = std::make_unique<MergeJoinOperator>(std::move(root), *step.table,
+                                                           Predicate::compile(plan.scanConditions[step.source]),
+                                                           pushedFilters(step.bloomFilters), step.buildColumn, step.probeSlot,
+                                                           step.comparisons, step.source, plan.columns, sourceCount, arena,
+                                                           buildStats, joinStats);
+                break;
+            case SelectPlan::JoinMethod::Band:
+                root = std::make_unique<BandJoinOperator>(std::move(root), *step.table,
+                                                          Predicate::compile(plan.scanConditions[step.source]),
+                                                          pushedFilters(step.bloomFilters), step.kind, step.band,
+                                                          step.bandOnBuild,
+                                                          step.comparisons, step.source, plan.columns, sourceCount, arena,
+                                                          buildStats, joinStats);
+                break;
+        }
+    }
+    if (!plan.filterConditions.empty()) {
+        root = std::make_unique<FilterOperator>(std::move(root), Predicate::compile(plan.filterConditions), plan.filterSlots,
+                                                &tree.getStats(plan.filterNode));
+    }
+    if (plan.aggregated) {
+        std::vector<AggregateOperator::Aggregate> aggregates;
+        for (const auto& aggregate : plan.aggregates) {
+            aggregates.push_back({aggregate.spec.function, aggregate.slot, aggregate.spec.name});
+        }
+        root = std::make_unique<AggregateOperator>(std::move(root), plan.groupSlots, std::move(aggregates), arena,
+                                                   &tree.getStats(plan.aggregateNode));
+    }
+    if (!plan.sortKeys.empty()) {
+        size_t limit = plan.limit >= 0 ? static_cast<size_t>(plan.limit) : SIZE_MAX;
+        root = std::make_unique<SortOperator>(std::move(root), plan.sortKeys, limit, arena, &tree.getStats(plan.sortNode));
+    }
+    if (plan.limit >= 0) {
+        root = std::make_unique<LimitOperator>(std::move(root), static_cast<size_t>(plan.limit), &tree.getStats(plan.limitNode));
+    }
+    ProjectOperator project(std::move(root), plan.outputColumns, plan.sources, &tree.getStats(plan.projectNode));
+
+    // Results cannot spill: they go back to the client
+    std::vector<std::string> names;
+    for (const auto& output : plan.outputColumns) {
+        names.push_back(output.name);
+    }
+    ResultSink sink(std::move(names), &memory);
+    sink.run(project);
+    std::vector<std::map<std::string, std::string>> finalResults = std::move(sink.getRows());
+
+    tree.getStats(plan.projectNode).bytesAllocated = estimateResultBytes(finalResults);
+    tree.setPeakMemory(memory.getPeak());
+    EngineMetrics::get().bytesAllocated.add(arena.bytesAllocated());
+    return finalResults;
+}
+
+void Database::analyzeTables(const SQLParser::Query& query) {
+    std::vector<Table*> analyzed;
+    if (query.table.empty()) {
+        for (const auto& [name, table] : tables) {
+            analyzed.push_back(table);
+        }
+    } else {
+        Table* table = getTable(query.table);
+        if (!table) {
+            throw std::runtime_error("Table not found: " + query.table);
+        }
+        analyzed.push_back(table);
+    }
+
+    lastRowsAffected = analyzed.size();
+    for (Table* table : analyzed) {
+        table->analyze();
+        if (!output) {
+            continue;
+        }
+        const TableStatistics& statistics = *table->getStatistics();
+        *output << "Table '" << table->getName() << "' analyzed: " << statistics.rowCount << " rows ("
+                  << statistics.sampledRows << " sampled)." << std::endl;
+
+        // One summary row per column
+        std::vector<std::map<std::string, std::string>> summary;
+        for (const auto& [column, stats] : statistics.columns) {
+            std::ostringstream nullFraction, width;
+            nullFraction << std::fixed << std::setprecision(3) << stats.nullFraction;
+            width << std::fixed << std::setprecision(1) << stats.averageWidth;
+            summary.push_back({{"COLUMN", column},
+                               {"DISTINCT", std::to_string(std::llround(stats.distinct))},
+                               {"NULL_FRAC", nullFraction.str()},
+                               {"AVG_WIDTH", width.str()},
+                               {"MCV", std::to_string(stats.mostCommon.size())},
+                               {"HISTOGRAM", std::to_string(stats.histogram.empty() ? 0 : stats.histogram.size() - 1)}});
+        }
+        printQueryResults(summary, *output);
+    }
+}
+
+// Every table a SELECT reads: its own, the joined ones and those of its subqueries
+static std::vector<std::string> tablesRead(const SQLParser::Query& query) {
+    std::vector<std::string> names = {query.table};
+    for (const auto& join : query.joins) {
+        names.push_back(join.table);
+    }
+    for (const auto& condition : query.conditions) {
+        if (condition.subquery) {
+            names.push_back(condition.subquery->table);
+        }
+    }
+    return names;
+}
+
+void Database::refreshStatistics(const SQLParser::Query& query) {
+    for (const auto& name : tablesRead(query)) {
+        Table* table = getTable(name);
+        if (table && table->statisticsStale(analyzeFraction)) {
+            table->analyze();
+            EngineMetrics::get().autoAnalyzes.add();
+        }
+    }
+}
+
+// Result cache key of a SELECT: its parsed parts, so spacing and keyword
+// case do not matter. Fields are separated by a control character no
+// parsed part holds.
+static std::string resultCacheKey(const SQLParser::Query& query) {
+    std::string key = query.table;
+    auto add = [&](const std::string& part) {
+        key += '\x1f';
+        key += part;
+    };
+    for (const auto& field : query.fields) {
+        add(field);
+    }
+    for (const auto& join : query.joins) {
+        add(join.type + " JOIN " + join.table);
+        add(join.onCondition);
+    }
+    for (const auto& condition : query.conditions) {
+        add("WHERE " + condition.field);
+        add(condition.op);
+        add(condition.subquery ? "(" + resultCacheKey(*condition.subquery) + ")" : condition.value);
+        add(condition.relation);
+    }
+    for (const auto& column : query.groupBy) {
+        add("GROUP " + column);
+    }
+    for (const auto& order : query.orderBy) {
+        add((order.descending ? "DESC " : "ASC ") + order.field);
+    }
+    add("LIMIT " + std::to_string(query.limit));
+    return key;
+}
+
+std::vector<std::map<std::string, std::string>> Database::executeSelectQuery(const SQLParser::Query& query) {
+    // A repeated query over unchanged tables is answered by one lookup
+    std::string cacheKey;
+    if (resultCache.enabled()) {
+        cacheKey = resultCacheKey(query);
+        auto currentVersion = [this](const std::string& name) {
+            Table* table = getTable(name);
+            return table ? table->getVersion() : 0;
+        };
+        if (const ResultCache::Rows* cached = resultCache.find(cacheKey, currentVersion)) {
+            EngineMetrics::get().rowsReturned.add(cached->size());
+            lastRowsAffected = cached->size();
+            if (output) {
+                printQueryResults(*cached, *output);
             }
+            return *cached;
+        }
+    }
+
+    refreshStatistics(query);
+    auto planStart = std::chrono::steady_clock::now();
+    SelectPlan plan = planSelectQuery(query);
+    MetricsRegistry::instance().statement("SELECT").plan.record(std::chrono::steady_clock::now() - planStart);
+
+    std::vector<std::map<std::string, std::string>> finalResults = executeSelectPlan(plan);
+    EngineMetrics::get().rowsReturned.add(finalResults.size());
+    lastRowsAffected = finalResults.size();
+
+    if (resultCache.enabled()) {
+        ResultCache::TableVersions versions;
+        for (const auto& name : tablesRead(query)) {
+            versions.emplace_back(name, getTable(name)->getVersion());
         }
-        finalResults.push_back(selectedRecord);
+        resultCache.insert(cacheKey, std::move(versions), finalResults);
     }
 
-    printQueryResults(finalResults);
+    if (output) {
+        printQueryResults(finalResults, *output);
+    }
 
     return finalResults;
 }
 
+std::vector<ResultColumn> Database::describeColumns(const SQLParser::Query& query) const {
+    std::vector<const Table*> sources = {getTable(query.table)};
+    for (const auto& join : query.joins) {
+        sources.push_back(getTable(join.table));
+    }
+
+    // Type of a column, qualified ("TABLE.COLUMN") or of the only table
+    auto kindOf = [&](const std::string& name) {
+        size_t dotPos = name.find('.');
+        for (const Table* table : sources) {
+            if (!table || (dotPos != std::string::npos && name.compare(0, dotPos, table->getName()) != 0)) {
+                continue;
+            }
+            auto it = table->getFields().find(unqualifiedName(name));
+            if (it != table->getFields().end()) {
+                return it->second->getDataType()->getKind();
+            }
+        }
+        return DataKind::Varchar;
+    };
+
+    std::vector<std::string> names;
+    if (query.fields.size() == 1 && query.fields[0] == "*") {
+        // Rows are maps, so their columns come out sorted by name
+        std::set<std::string> columns;
+        for (const Table* table : sources) {
+            for (const auto& [fieldName, field] : table->getFields()) {
+                columns.insert(query.joins.empty() ? fieldName : table->getName() + "." + fieldName);
+            }
+        }
+        names.assign(columns.begin(), columns.end());
+    } else {
+        names = query.fields;
+    }
+
+    // Counts are whole numbers, averages never are, and the rest follow
+    // their argument (a SUM of anything but integers is a double)
+    std::vector<ResultColumn> columns;
+    for (const auto& name : names) {
+        AggregateSpec spec;
+        if (!parseAggregate(name, spec)) {
+            columns.push_back({name, kindOf(name)});
+            continue;
+        }
+        DataKind kind = spec.argument == "*" ? DataKind::LongInt : kindOf(spec.argument);
+        switch (spec.function) {
+            case AggregateSpec::Function::Count:
+                kind = DataKind::LongInt;
+                break;
+            case AggregateSpec::Function::Sum:
+                kind = kind == DataKind::Int || kind == DataKind::LongInt ? DataKind::LongInt : DataKind::Double;
+                break;
+            case AggregateSpec::Function::Avg:
+                kind = DataKind::Double;
+                break;
+            default:
+                break;
+        }
+        columns.push_back({name, kind});
+    }
+    return columns;
+}
+
+void Database::explainSelectQuery(const SQLParser::Query& query) {
+    refreshStatistics(query);
+    auto planStart = std::chrono::steady_clock::now();
+    SelectPlan plan = planSelectQuery(query);
+    MetricsRegistry::instance().statement("EXPLAIN").plan.record(std::chrono::steady_clock::now() - planStart);
+
+    if (query.explainAnalyze) {
+        // Run the query, discarding the rows, to collect per-operator statistics
+        auto start = std::chrono::steady_clock::now();
+        executeSelectPlan(plan);
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        plan.tree.setExecutionTime(elapsed.count());
+    }
+
+    if (output) {
+        plan.tree.print(*output, query.explainAnalyze);
+    }
+}
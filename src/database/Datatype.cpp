@@ -1,5 +1,5 @@
 #include "../../include/database/Datatype.h"
-#include <regex>
+#include "../../include/database/ValueParser.h"
 
 // Varchar constructor
 VarcharType::VarcharType(size_t maxLength) : maxLength(maxLength) {}
@@ -13,49 +13,32 @@ void VarcharType::validate(const std::string& value) const {
 
 // Integer validation
 void IntType::validate(const std::string& value) const {
-    try {
-        size_t idx;
-        std::stoi(value, &idx);
-        if (idx != value.size()) {
-            throw std::invalid_argument("Invalid value for Int");
-        }
-    } catch (...) {
+    int32_t parsed;
+    if (!ValueParser::parseInt(value, parsed)) {
         throw std::invalid_argument("Invalid value for Int");
     }
 }
 
 // LongInt validation
 void LongIntType::validate(const std::string& value) const {
-    try {
-        size_t idx;
-        std::stol(value, &idx);
-        if (idx != value.size()) {
-            throw std::invalid_argument("Invalid value for LongInt");
-        }
-    } catch (...) {
+    int64_t parsed;
+    if (!ValueParser::parseLongInt(value, parsed)) {
         throw std::invalid_argument("Invalid value for LongInt");
     }
 }
 
 // Double validation
 void DoubleType::validate(const std::string& value) const {
-    try {
-        size_t idx;
-        std::stod(value, &idx);
-        if (idx != value.size()) {
-            throw std::invalid_argument("Invalid value for Double");
-        }
-    } catch (...) {
+    double parsed;
+    if (!ValueParser::parseDouble(value, parsed)) {
         throw std::invalid_argument("Invalid value for Double");
     }
 }
 
 // DateTime validation
 void DateTimeType::validate(const std::string& value) const {
-    // Regex pattern for ISO 8601 date-time format: YYYY-MM-DD HH:MM:SS
-    std::regex pattern(R"(\d{4}-\d{2}-\d{2} \d{2}:\d{2}:\d{2})");
-    if (!std::regex_match(value, pattern)) {
+    // ISO 8601 date-time format: YYYY-MM-DD HH:MM:SS, with calendar ranges checked
+    if (!ValueParser::parseDateTime(value)) {
         throw std::invalid_argument("Invalid value for DateTime");
     }
-    // Further validation can be added to check actual date and time values
 }
@@ -0,0 +1,383 @@
+#include "../../include/database/HashJoin.h"
+#include "../../include/database/Table.h"
+#include "../../include/database/Metrics.h"
+#include <algorithm>
+#include <cstdint>
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <optional>
+#include <thread>
+
+// Row ids gathered per partition before they are written out
+static constexpr size_t spillBufferRows = 4096;
+
+// Rows per partition of an in-memory build: with their slots about 256 KB,
+// the size of a core's L2 cache
+static constexpr size_t partitionRows = 4096;
+static constexpr unsigned maxPartitionBits = 14;
+
+// Fewer rows than this per worker are not worth a thread, in a build and in
+// a partitioned probe
+static constexpr size_t rowsPerWorker = 32768;
+static constexpr size_t probesPerWorker = 8192;
+
+// Probes ahead of the one being answered whose slot is prefetched
+static constexpr size_t prefetchDistance = 8;
+
+// Run work(0) .. work(workers - 1) on as many threads, the caller's
+// included; the first exception thrown is rethrown once all have finished
+template <typename Work>
+static void runWorkers(size_t workers, const Work& work) {
+    if (workers <= 1) {
+        work(0);
+        return;
+    }
+    std::vector<std::exception_ptr> errors(workers);
+    std::vector<std::thread> threads;
+    threads.reserve(workers - 1);
+    for (size_t worker = 1; worker < workers; ++worker) {
+        threads.emplace_back([&work, &errors, worker] {
+            try {
+                work(worker);
+            } catch (...) {
+                errors[worker] = std::current_exception();
+            }
+        });
+    }
+    try {
+        work(0);
+    } catch (...) {
+        errors[0] = std::current_exception();
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    for (const auto& error : errors) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+}
+
+JoinHashTable::JoinHashTable(const Table& table, const std::string& column, const std::vector<Predicate>& predicates,
+                             const std::vector<JoinKeyFilter>& filters, QueryArena& arena, OperatorStats* stats,
+                             size_t threads, bool keepRowIds)
+    : table(table), column(column), entries(&arena), slots(&arena), slotStart(&arena), bloom(0, &arena),
+      threads(threads) {
+    OperatorStats ignoredStats;
+    OperatorStats& buildStats = stats ? *stats : ignoredStats;
+    size_t bytesBefore = arena.bytesAllocated();
+    std::optional<OperatorTimer> timer(std::in_place, buildStats);
+
+    // The filter is sized for the rows that qualify, not the whole table
+    std::vector<size_t> scanned = table.scanRowIds(predicates, filters, &buildStats);
+    bloom = BloomFilter(scanned.size(), &arena);
+
+    MemoryTracker* tracker = arena.getTracker();
+    if (tracker && estimateBytes(scanned.size()) > tracker->available()) {
+        spill(scanned, tracker->available(), buildStats);
+    } else {
+        build(scanned.data(), scanned.size(), arena, buildStats);
+    }
+    if (keepRowIds) {
+        keptRows = std::move(scanned);
+    }
+
+    timer.reset();
+    buildStats.bytesAllocated += arena.bytesAllocated() - bytesBefore;
+}
+
+JoinHashTable::JoinHashTable(const Table& table, const std::string& column, const size_t* rowIds, size_t rowCount,
+                             QueryArena& arena, size_t threads)
+    : table(table), column(column), entries(&arena), slots(&arena), slotStart(&arena), bloom(rowCount, &arena),
+      threads(threads) {
+    OperatorStats ignoredStats;
+    build(rowIds, rowCount, arena, ignoredStats);
+}
+
+uint64_t JoinHashTable::hashKey(std::string_view key) {
+    // Finalize the library hash so the high bits (partition) and the low
+    // bits (slot) are independent
+    uint64_t h = std::hash<std::string_view>()(key);
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return h;
+}
+
+size_t JoinHashTable::estimateBytes(size_t rows) {
+    // The hash and key read per row, its entry, and up to four slots
+    return rows * (sizeof(uint64_t) + sizeof(std::string_view) + sizeof(Entry) + 4 * sizeof(uint32_t));
+}
+
+void JoinHashTable::build(const size_t* rowIds, size_t rowCount, QueryArena& arena, OperatorStats& stats) {
+    const auto& records = table.records;
+    while (partitionBits < maxPartitionBits && (rowCount >> partitionBits) > partitionRows) {
+        ++partitionBits;
+    }
+    size_t partitionCount = size_t(1) << partitionBits;
+
+    size_t workers = threads > 0 ? threads : std::max<size_t>(std::thread::hardware_concurrency(), 1);
+    workers = std::max<size_t>(std::min(workers, rowCount / rowsPerWorker), 1);
+    size_t chunk = (rowCount + workers - 1) / workers;
+
+    // Everything is allocated up front: the arena is not shared between threads
+    std::pmr::vector<uint64_t> hashes(rowCount, &arena);
+    std::pmr::vector<std::string_view> keys(rowCount, &arena);
+    std::vector<std::vector<size_t>> histograms(workers, std::vector<size_t>(partitionCount, 0));
+
+    // Read each row's key once and count the rows of each partition
+    runWorkers(workers, [&](size_t worker) {
+        std::vector<size_t>& histogram = histograms[worker];
+        size_t end = std::min(rowCount, (worker + 1) * chunk);
+        for (size_t i = worker * chunk; i < end; ++i) {
+            const auto& record = records[rowIds[i]];
+            auto it = record.find(column);
+            if (it == record.end() || it->second.empty()) {
+                continue;
+            }
+            keys[i] = it->second;
+            hashes[i] = hashKey(keys[i]);
+            ++histogram[slotPartition(hashes[i])];
+        }
+    });
+
+    // Each worker scatters into its own range of every partition, after the
+    // ranges of the workers before it, which keeps the table's row order
+    slotStart.assign(partitionCount + 1, 0);
+    std::vector<size_t> partitionStart(partitionCount + 1, 0);
+    for (size_t partition = 0; partition < partitionCount; ++partition) {
+        size_t rows = 0;
+        for (size_t worker = 0; worker < workers; ++worker) {
+            size_t count = histograms[worker][partition];
+            histograms[worker][partition] = partitionStart[partition] + rows;
+            rows += count;
+        }
+        partitionStart[partition + 1] = partitionStart[partition] + rows;
+        size_t partitionSlots = 1;
+        while (partitionSlots < 2 * rows) {
+            partitionSlots *= 2;
+        }
+        slotStart[partition + 1] = slotStart[partition] + partitionSlots;
+    }
+    entries.resize(partitionStart[partitionCount]);
+    slots.assign(slotStart[partitionCount], 0);
+
+    runWorkers(workers, [&](size_t worker) {
+        std::vector<size_t>& offsets = histograms[worker];
+        size_t end = std::min(rowCount, (worker + 1) * chunk);
+        for (size_t i = worker * chunk; i < end; ++i) {
+            if (keys[i].empty()) {
+                continue;
+            }
+            entries[offsets[slotPartition(hashes[i])]++] = {hashes[i], keys[i], rowIds[i], noRow};
+        }
+    });
+
+    // Build the partitions' tables, each worker taking the next partition
+    // left. Equal keys are chained in reverse so each chain keeps the
+    // table's row order.
+    std::atomic<size_t> nextPartition{0};
+    std::vector<size_t> distinctKeys(partitionCount, 0);
+    runWorkers(workers, [&](size_t) {
+        size_t partition;
+        while ((partition = nextPartition.fetch_add(1)) < partitionCount) {
+            uint32_t* partitionSlots = slots.data() + slotStart[partition];
+            size_t mask = slotStart[partition + 1] - slotStart[partition] - 1;
+            for (size_t entry = partitionStart[partition + 1]; entry-- > partitionStart[partition];) {
+                Entry& current = entries[entry];
+                size_t slot = current.hash & mask;
+                while (partitionSlots[slot] != 0) {
+                    Entry& head = entries[partitionSlots[slot] - 1];
+                    if (head.hash == current.hash && head.key == current.key) {
+                        break;
+                    }
+                    slot = (slot + 1) & mask;
+                }
+                if (partitionSlots[slot] == 0) {
+                    ++distinctKeys[partition];
+                } else {
+                    current.next = partitionSlots[slot] - 1;
+                }
+                partitionSlots[slot] = static_cast<uint32_t>(entry + 1);
+            }
+        }
+    });
+
+    // The Bloom filter takes each distinct key once
+    for (uint32_t slot : slots) {
+        if (slot != 0) {
+            bloom.insert(entries[slot - 1].key);
+        }
+    }
+
+    for (size_t distinct : distinctKeys) {
+        stats.rowsOut += distinct;
+    }
+    stats.workers = std::max(stats.workers, workers);
+    stats.partitions = std::max(stats.partitions, partitionCount);
+}
+
+void JoinHashTable::lookupBatch(const std::string_view* keys, const std::vector<uint32_t>& selection,
+                                std::vector<size_t>& matches) const {
+    size_t count = selection.size();
+    matches.resize(count);
+
+    // Hash every key first (kept in 'matches' until answered), then probe
+    // with the slot of a later row in flight
+    for (size_t i = 0; i < count; ++i) {
+        matches[i] = hashKey(keys[selection[i]]);
+    }
+    for (size_t i = 0; i < count; ++i) {
+        if (i + prefetchDistance < count) {
+            uint64_t ahead = matches[i + prefetchDistance];
+            size_t partition = slotPartition(ahead);
+            size_t mask = slotStart[partition + 1] - slotStart[partition] - 1;
+            __builtin_prefetch(slots.data() + slotStart[partition] + (ahead & mask));
+        }
+        std::string_view key = keys[selection[i]];
+        matches[i] = !key.empty() ? find(matches[i], key) : noRow;
+    }
+}
+
+bool JoinHashTable::probesInParallel() const {
+    return partitionBits > 0 && (threads > 0 ? threads : std::thread::hardware_concurrency()) > 1;
+}
+
+void JoinHashTable::lookupPartitioned(const std::vector<std::string_view>& keys, std::vector<size_t>& matches,
+                                      OperatorStats* stats) const {
+    size_t count = keys.size();
+    size_t partitionCount = size_t(1) << partitionBits;
+    matches.assign(count, noRow);
+
+    size_t workers = threads > 0 ? threads : std::max<size_t>(std::thread::hardware_concurrency(), 1);
+    workers = std::max<size_t>(std::min(workers, count / probesPerWorker), 1);
+    size_t chunk = (count + workers - 1) / workers;
+
+    // Hash each key and count the keys of each partition, as the build does;
+    // NULL keys match nothing
+    std::vector<uint64_t> hashes(count);
+    if (workers == 1) {
+        // On one thread, probing in key order with the slots prefetched
+        // costs less than scattering the keys first
+        for (size_t i = 0; i < count; ++i) {
+            hashes[i] = hashKey(keys[i]);
+        }
+        for (size_t i = 0; i < count; ++i) {
+            if (i + prefetchDistance < count) {
+                uint64_t ahead = hashes[i + prefetchDistance];
+                size_t partition = slotPartition(ahead);
+                size_t mask = slotStart[partition + 1] - slotStart[partition] - 1;
+                __builtin_prefetch(slots.data() + slotStart[partition] + (ahead & mask));
+            }
+            if (!keys[i].empty()) {
+                matches[i] = find(hashes[i], keys[i]);
+            }
+        }
+        return;
+    }
+    std::vector<std::vector<size_t>> histograms(workers, std::vector<size_t>(partitionCount, 0));
+    runWorkers(workers, [&](size_t worker) {
+        std::vector<size_t>& histogram = histograms[worker];
+        size_t end = std::min(count, (worker + 1) * chunk);
+        for (size_t i = worker * chunk; i < end; ++i) {
+            if (!keys[i].empty()) {
+                hashes[i] = hashKey(keys[i]);
+                ++histogram[slotPartition(hashes[i])];
+            }
+        }
+    });
+
+    std::vector<size_t> partitionStart(partitionCount + 1, 0);
+    for (size_t partition = 0; partition < partitionCount; ++partition) {
+        size_t rows = 0;
+        for (size_t worker = 0; worker < workers; ++worker) {
+            size_t keysOfWorker = histograms[worker][partition];
+            histograms[worker][partition] = partitionStart[partition] + rows;
+            rows += keysOfWorker;
+        }
+        partitionStart[partition + 1] = partitionStart[partition] + rows;
+    }
+    std::vector<uint32_t> positions(partitionStart[partitionCount]);
+    runWorkers(workers, [&](size_t worker) {
+        std::vector<size_t>& offsets = histograms[worker];
+        size_t end = std::min(count, (worker + 1) * chunk);
+        for (size_t i = worker * chunk; i < end; ++i) {
+            if (!keys[i].empty()) {
+                positions[offsets[slotPartition(hashes[i])]++] = static_cast<uint32_t>(i);
+            }
+        }
+    });
+
+    // Each worker probes the next partition left, whose slots then stay in its cache
+    std::atomic<size_t> nextPartition{0};
+    runWorkers(workers, [&](size_t) {
+        size_t partition;
+        while ((partition = nextPartition.fetch_add(1)) < partitionCount) {
+            size_t end = partitionStart[partition + 1];
+            for (size_t i = partitionStart[partition]; i < end; ++i) {
+                if (i + prefetchDistance < end) {
+                    __builtin_prefetch(keys[positions[i + prefetchDistance]].data());
+                }
+                uint32_t position = positions[i];
+                matches[position] = find(hashes[position], keys[position]);
+            }
+        }
+    });
+    if (stats) {
+        stats->workers = std::max(stats->workers, workers);
+    }
+}
+
+size_t JoinHashTable::partitionOf(std::string_view key) const {
+    // Mix the hash so partitions do not follow the hash table's own bucket choice
+    uint64_t hash = std::hash<std::string_view>()(key) * 0x9e3779b97f4a7c15ULL;
+    return (hash >> 32) & (partitions.size() - 1);
+}
+
+void JoinHashTable::spill(const std::vector<size_t>& rowIds, size_t budget, OperatorStats& stats) {
+    // Enough partitions (a power of two) for one partition's hash table to
+    // take at most half of the budget
+    size_t partitionBudget = std::max<size_t>(budget / 2, 1);
+    size_t needed = estimateBytes(rowIds.size());
+    size_t count = 2;
+    while (count < maxPartitions && needed / count > partitionBudget) {
+        count *= 2;
+    }
+    partitions.resize(count);
+
+    const auto& records = table.records;
+    std::vector<std::vector<size_t>> buffers(count);
+    size_t spilledRows = 0;
+    for (size_t row : rowIds) {
+        auto it = records[row].find(column);
+        if (it == records[row].end() || it->second.empty()) {
+            continue;
+        }
+        bloom.insert(it->second);
+        size_t partition = partitionOf(it->second);
+        buffers[partition].push_back(row);
+        if (buffers[partition].size() == spillBufferRows) {
+            partitions[partition].writeValues(buffers[partition]);
+            buffers[partition].clear();
+        }
+        ++spilledRows;
+    }
+    for (size_t partition = 0; partition < count; ++partition) {
+        partitions[partition].writeValues(buffers[partition]);
+        stats.bytesSpilled += partitions[partition].size();
+    }
+    stats.rowsOut += spilledRows;
+}
+
+std::unique_ptr<JoinHashTable> JoinHashTable::loadPartition(size_t partition, QueryArena& arena) const {
+    std::pmr::vector<size_t> buildRows(&arena);
+    partitions[partition].readValues(buildRows);
+    if (buildRows.empty()) {
+        return nullptr;
+    }
+    // The constructor is private, so not through make_unique
+    return std::unique_ptr<JoinHashTable>(
+        new JoinHashTable(table, column, buildRows.data(), buildRows.size(), arena, threads));
+}
@@ -0,0 +1,138 @@
+#include "../../include/database/JoinOrder.h"
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+
+JoinOrder::JoinOrder(const std::vector<double>& rows, const std::vector<Edge>& edges)
+    : rows(rows), edges(edges) {
+    // Empty inputs would zero every estimate; a relation holds at least a row,
+    // and a side never has more distinct keys than rows
+    for (double& count : this->rows) {
+        count = std::max(count, 1.0);
+    }
+    for (Edge& edge : this->edges) {
+        edge.leftDistinct = std::clamp(edge.leftDistinct, 1.0, this->rows[edge.left]);
+        edge.rightDistinct = std::clamp(edge.rightDistinct, 1.0, this->rows[edge.right]);
+    }
+}
+
+template <typename Joined>
+double JoinOrder::joinRows(Joined joined, double joinedRows, size_t next) const {
+    double result = joinedRows * rows[next];
+    bool connected = false;
+    for (const Edge& edge : edges) {
+        if ((edge.left == next && joined(edge.right)) || (edge.right == next && joined(edge.left))) {
+            result /= std::max(edge.leftDistinct, edge.rightDistinct);
+            connected = true;
+        }
+    }
+    return connected ? std::max(result, 1.0) : 0.0;
+}
+
+std::vector<size_t> JoinOrder::choose(const std::vector<double>& rows, const std::vector<Edge>& edges) {
+    JoinOrder order(rows, edges);
+    return rows.size() <= exhaustiveLimit ? order.chooseExhaustive() : order.chooseGreedy();
+}
+
+double JoinOrder::estimateJoinRows(const std::vector<double>& rows, const std::vector<Edge>& edges,
+                                   const std::vector<bool>& joined, double joinedRows, size_t next) {
+    JoinOrder order(rows, edges);
+    return order.joinRows([&](size_t relation) { return joined[relation]; }, joinedRows, next);
+}
+
+std::vector<size_t> JoinOrder::chooseExhaustive() const {
+    // best[S]: cheapest left-deep plan joining exactly the relations in S
+    struct Entry {
+        double cost = std::numeric_limits<double>::infinity();
+        double rows = 0.0;
+        size_t last = 0;
+    };
+    size_t count = rows.size();
+    uint64_t all = (uint64_t(1) << count) - 1;
+    std::vector<Entry> best(all + 1);
+    for (size_t relation = 0; relation < count; ++relation) {
+        best[uint64_t(1) << relation] = {rows[relation], rows[relation], relation};
+    }
+
+    // Subsets only grow, so every subset is final before it is extended
+    for (uint64_t joined = 1; joined < all; ++joined) {
+        const Entry& current = best[joined];
+        if (current.cost == std::numeric_limits<double>::infinity()) {
+            continue; // Not connected
+        }
+        for (size_t next = 0; next < count; ++next) {
+            uint64_t bit = uint64_t(1) << next;
+            if (joined & bit) {
+                continue;
+            }
+            double outputRows = joinRows([&](size_t relation) { return (joined >> relation) & 1; }, current.rows, next);
+            if (outputRows == 0.0) {
+                continue;
+            }
+            // Hash the new relation; the rows so far probe it and the result flows on
+            double cost = current.cost + buildCost * rows[next] + outputRows;
+            Entry& candidate = best[joined | bit];
+            if (cost < candidate.cost) {
+                candidate = {cost, outputRows, next};
+            }
+        }
+    }
+    if (best[all].cost == std::numeric_limits<double>::infinity()) {
+        throw std::runtime_error("Join conditions do not connect every table");
+    }
+
+    // Walk the choices back from the full set
+    std::vector<size_t> order(count);
+    uint64_t joined = all;
+    for (size_t position = count; position-- > 0;) {
+        order[position] = best[joined].last;
+        joined &= ~(uint64_t(1) << best[joined].last);
+    }
+    return order;
+}
+
+std::vector<size_t> JoinOrder::chooseGreedy() const {
+    // From every starting relation, keep adding the connected relation that
+    // is cheapest to add next; keep the cheapest of those orders
+    std::vector<size_t> bestOrder;
+    double bestCost = std::numeric_limits<double>::infinity();
+    for (size_t start = 0; start < rows.size(); ++start) {
+        std::vector<bool> joined(rows.size(), false);
+        std::vector<size_t> order = {start};
+        joined[start] = true;
+        double currentRows = rows[start];
+        double cost = rows[start];
+
+        while (order.size() < rows.size()) {
+            size_t chosen = rows.size();
+            double chosenRows = 0.0;
+            double chosenCost = 0.0;
+            for (size_t next = 0; next < rows.size(); ++next) {
+                if (joined[next]) {
+                    continue;
+                }
+                double outputRows = joinRows([&](size_t relation) { return joined[relation]; }, currentRows, next);
+                double stepCost = buildCost * rows[next] + outputRows;
+                if (outputRows > 0.0 && (chosen == rows.size() || stepCost < chosenCost)) {
+                    chosen = next;
+                    chosenRows = outputRows;
+                    chosenCost = stepCost;
+                }
+            }
+            if (chosen == rows.size()) {
+                throw std::runtime_error("Join conditions do not connect every table");
+            }
+            cost += chosenCost;
+            currentRows = chosenRows;
+            joined[chosen] = true;
+            order.push_back(chosen);
+        }
+
+        if (cost < bestCost) {
+            bestCost = cost;
+            bestOrder = order;
+        }
+    }
+    return bestOrder;
+}
@@ -0,0 +1,105 @@
+#include "../../include/database/JsonLine.h"
+#include <cctype>
+#include <cstdio>
+#include <stdexcept>
+
+void writeJsonString(std::string& out, const std::string& text) {
+    out += '"';
+    for (char c : text) {
+        switch (c) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    char escaped[8];
+                    std::snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<int>(c));
+                    out += escaped;
+                } else {
+                    out += c;
+                }
+        }
+    }
+    out += '"';
+}
+
+void writeJsonString(std::ostream& out, const std::string& text) {
+    std::string literal;
+    writeJsonString(literal, text);
+    out << literal;
+}
+
+void JsonLineReader::expect(char c) {
+    skipSpace();
+    if (position >= text.size() || text[position] != c) {
+        throw std::runtime_error(std::string("Malformed log line: expected '") + c + "'");
+    }
+    ++position;
+}
+
+bool JsonLineReader::consume(char c) {
+    skipSpace();
+    if (position < text.size() && text[position] == c) {
+        ++position;
+        return true;
+    }
+    return false;
+}
+
+bool JsonLineReader::peekString() {
+    skipSpace();
+    return position < text.size() && text[position] == '"';
+}
+
+std::string JsonLineReader::readString() {
+    expect('"');
+    std::string value;
+    while (position < text.size() && text[position] != '"') {
+        char c = text[position++];
+        if (c != '\\') {
+            value += c;
+            continue;
+        }
+        if (position >= text.size()) {
+            break;
+        }
+        char escaped = text[position++];
+        switch (escaped) {
+            case 'n': value += '\n'; break;
+            case 'r': value += '\r'; break;
+            case 't': value += '\t'; break;
+            case 'u':
+                value += static_cast<char>(std::stoi(text.substr(position, 4), nullptr, 16));
+                position += 4;
+                break;
+            default: value += escaped;
+        }
+    }
+    expect('"');
+    return value;
+}
+
+int64_t JsonLineReader::readInteger() {
+    skipSpace();
+    size_t length = 0;
+    int64_t value = std::stoll(text.substr(position), &length);
+    position += length;
+    return value;
+}
+
+bool JsonLineReader::consumeNull() {
+    skipSpace();
+    if (text.compare(position, 4, "null") == 0) {
+        position += 4;
+        return true;
+    }
+    return false;
+}
+
+void JsonLineReader::skipSpace() {
+    while (position < text.size() && std::isspace(static_cast<unsigned char>(text[position]))) {
+        ++position;
+    }
+}
@@ -0,0 +1,132 @@
+#include "../../include/database/LikePattern.h"
+#include <algorithm>
+#include <cstring>
+
+LikePattern::LikePattern(std::string_view pattern) {
+    anchoredStart = pattern.empty() || pattern.front() != '%';
+    anchoredEnd = pattern.empty() || pattern.back() != '%';
+
+    // Literal runs between the '%'s; consecutive '%'s leave nothing between them
+    Segment segment;
+    for (char c : pattern) {
+        if (c == '%') {
+            if (!segment.text.empty()) {
+                segments.push_back(std::move(segment));
+                segment = Segment();
+            }
+            continue;
+        }
+        segment.text += c;
+        segment.wildcards = segment.wildcards || c == '_';
+    }
+    if (!segment.text.empty() || segments.empty()) {
+        segments.push_back(std::move(segment));
+    }
+
+    for (const auto& literal : segments) {
+        minLength += literal.text.size();
+    }
+    if (anchoredStart) {
+        prefix = segments.front().text.substr(0, segments.front().text.find('_'));
+    }
+}
+
+std::vector<std::string_view> LikePattern::getLiterals() const {
+    std::vector<std::string_view> literals;
+    for (const auto& segment : segments) {
+        std::string_view text = segment.text;
+        while (!text.empty()) {
+            size_t end = std::min(text.find('_'), text.size());
+            if (end > 0) {
+                literals.push_back(text.substr(0, end));
+            }
+            text.remove_prefix(std::min(end + 1, text.size()));
+        }
+    }
+    return literals;
+}
+
+bool LikePattern::matchAt(const Segment& segment, std::string_view value, size_t position) {
+    const std::string& text = segment.text;
+    if (!segment.wildcards) {
+        return std::memcmp(value.data() + position, text.data(), text.size()) == 0;
+    }
+    for (size_t i = 0; i < text.size(); ++i) {
+        if (text[i] != '_' && text[i] != value[position + i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// First position at or after 'from' where the segment matches, or npos
+size_t LikePattern::find(const Segment& segment, std::string_view value, size_t from) {
+    const std::string& text = segment.text;
+    if (value.size() < from + text.size()) {
+        return std::string_view::npos;
+    }
+    size_t last = value.size() - text.size();
+    if (segment.wildcards || text.empty()) {
+        for (size_t position = from; position <= last; ++position) {
+            if (matchAt(segment, value, position)) {
+                return position;
+            }
+        }
+        return std::string_view::npos;
+    }
+
+    // Jump between occurrences of the first character
+    const char* data = value.data();
+    for (size_t position = from; position <= last;) {
+        const void* hit = std::memchr(data + position, text[0], last - position + 1);
+        if (!hit) {
+            break;
+        }
+        position = static_cast<const char*>(hit) - data;
+        if (std::memcmp(data + position + 1, text.data() + 1, text.size() - 1) == 0) {
+            return position;
+        }
+        ++position;
+    }
+    return std::string_view::npos;
+}
+
+bool LikePattern::matches(std::string_view value) const {
+    if (value.size() < minLength) {
+        return false;
+    }
+    if (segments.size() == 1 && anchoredStart && anchoredEnd) {
+        return value.size() == minLength && matchAt(segments[0], value, 0);
+    }
+
+    size_t first = 0;
+    size_t last = segments.size();
+    size_t position = 0;
+    if (anchoredStart) {
+        if (!matchAt(segments[0], value, 0)) {
+            return false;
+        }
+        position = segments[0].text.size();
+        ++first;
+    }
+    size_t end = value.size();
+    if (anchoredEnd && first < last) {
+        const Segment& tail = segments[last - 1];
+        if (end - position < tail.text.size() || !matchAt(tail, value, end - tail.text.size())) {
+            return false;
+        }
+        end -= tail.text.size();
+        --last;
+    }
+
+    // The leftmost match of each middle segment leaves the most room for the rest
+    std::string_view middle = value.substr(0, end);
+    for (size_t i = first; i < last; ++i) {
+        position = find(segments[i], middle, position);
+        if (position == std::string_view::npos) {
+            return false;
+        }
+        position += segments[i].text.size();
+    }
+    return true;
+}
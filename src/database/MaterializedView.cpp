@@ -0,0 +1,521 @@
+#include "../../include/database/MaterializedView.h"
+#include "../../include/database/Database.h"
+#include "../../include/database/Predicate.h"
+#include "../../include/database/ValueParser.h"
+#include <algorithm>
+#include <limits>
+#include <set>
+#include <stdexcept>
+#include <string_view>
+
+// View columns hold computed values, so only the kind of each type matters
+static DataType* makeType(DataKind kind) {
+    switch (kind) {
+        case DataKind::Int:
+            return new IntType();
+        case DataKind::LongInt:
+            return new LongIntType();
+        case DataKind::Double:
+            return new DoubleType();
+        case DataKind::DateTime:
+            return new DateTimeType();
+        default:
+            return new VarcharType(std::numeric_limits<size_t>::max());
+    }
+}
+
+static std::string tableOf(const std::string& name) {
+    size_t dotPos = name.find('.');
+    return dotPos == std::string::npos ? "" : name.substr(0, dotPos);
+}
+
+static std::string columnOf(const std::string& name) {
+    size_t dotPos = name.find('.');
+    return dotPos == std::string::npos ? name : name.substr(dotPos + 1);
+}
+
+static std::string functionName(AggregateSpec::Function function) {
+    switch (function) {
+        case AggregateSpec::Function::Count:
+            return "COUNT";
+        case AggregateSpec::Function::Sum:
+            return "SUM";
+        case AggregateSpec::Function::Min:
+            return "MIN";
+        case AggregateSpec::Function::Max:
+            return "MAX";
+        default:
+            return "AVG";
+    }
+}
+
+// Column name in the view's table: the column without its table, or for an
+// aggregate the function and its argument (SUM(ORDERS.TOTALAMOUNT) ->
+// SUM_TOTALAMOUNT, COUNT(*) -> COUNT). The table is kept where leaving it
+// out would make two names equal.
+static std::string columnName(const std::string& output, const AggregateSpec* spec, bool qualified) {
+    std::string column = spec ? spec->argument : output;
+    if (!qualified) {
+        column = columnOf(column);
+    }
+    std::replace(column.begin(), column.end(), '.', '_');
+    if (!spec) {
+        return column;
+    }
+    return spec->argument == "*" ? functionName(spec->function) : functionName(spec->function) + "_" + column;
+}
+
+bool MaterializedView::ValueOrder::operator()(const std::string& lhs, const std::string& rhs) const {
+    return Predicate::compareValues(lhs, rhs) < 0;
+}
+
+MaterializedView::MaterializedView(Database& database, const std::string& name, const std::string& definition)
+    : database(database), name(name), definition(definition), query(SQLParser::parse(definition)), table(nullptr) {
+    if (query.operation != "SELECT" || query.explain) {
+        throw std::invalid_argument("A materialized view must be defined by a SELECT statement");
+    }
+    if (!query.orderBy.empty() || query.limit >= 0) {
+        throw std::invalid_argument("ORDER BY and LIMIT are not supported in a materialized view");
+    }
+    // Deltas are joined row by row, which only inner joins allow
+    for (const auto& condition : query.conditions) {
+        if (condition.subquery) {
+            throw std::invalid_argument("Subqueries are not supported in a materialized view");
+        }
+    }
+    sources.push_back(query.table);
+    for (const auto& join : query.joins) {
+        if (join.type != "INNER") {
+            throw std::invalid_argument("A materialized view supports only inner joins");
+        }
+        sources.push_back(join.table);
+    }
+    for (size_t i = 0; i < sources.size(); ++i) {
+        if (!database.getTable(sources[i])) {
+            throw std::runtime_error("Table not found: " + sources[i]);
+        }
+        if (std::find(sources.begin(), sources.begin() + i, sources[i]) != sources.begin() + i) {
+            throw std::invalid_argument("A materialized view cannot read a table twice: " + sources[i]);
+        }
+    }
+
+    // Planning reports unknown columns and misplaced aggregates
+    database.planSelectQuery(query);
+
+    aggregated = !query.groupBy.empty();
+    std::vector<ResultColumn> resultColumns = database.describeColumns(query);
+    for (const auto& resultColumn : resultColumns) {
+        OutputColumn output;
+        output.output = resultColumn.name;
+        output.aggregate = parseAggregate(resultColumn.name, output.spec);
+        aggregated = aggregated || output.aggregate;
+        outputs.push_back(output);
+    }
+
+    // Name the view's columns, keeping the table where names would collide
+    std::map<std::string, size_t> uses;
+    for (auto& output : outputs) {
+        output.column = columnName(output.output, output.aggregate ? &output.spec : nullptr, false);
+        ++uses[output.column];
+    }
+    std::set<std::string> columnNames;
+    for (auto& output : outputs) {
+        if (uses[output.column] > 1) {
+            output.column = columnName(output.output, output.aggregate ? &output.spec : nullptr, true);
+        }
+        if (!columnNames.insert(output.column).second) {
+            throw std::invalid_argument("Duplicate column in materialized view: " + output.column);
+        }
+    }
+
+    if (aggregated) {
+        rowQuery = query;
+        rowQuery.fields.clear();
+        rowQuery.groupBy.clear();
+        auto addField = [&](const std::string& field) {
+            if (std::find(rowQuery.fields.begin(), rowQuery.fields.end(), field) == rowQuery.fields.end()) {
+                rowQuery.fields.push_back(field);
+            }
+        };
+        for (const auto& column : query.groupBy) {
+            addField(column);
+        }
+        for (size_t i = 0; i < outputs.size(); ++i) {
+            const OutputColumn& output = outputs[i];
+            if (!output.aggregate) {
+                addField(output.output);
+                continue;
+            }
+            aggregateOutputs.push_back(i);
+            if (output.spec.argument == "*") {
+                continue;
+            }
+            // Sums are kept as numbers, so the values must be numbers
+            SQLParser::Query argumentQuery = query;
+            argumentQuery.fields = {output.spec.argument};
+            argumentQuery.groupBy.clear();
+            DataKind kind = database.describeColumns(argumentQuery).at(0).kind;
+            if ((output.spec.function == AggregateSpec::Function::Sum ||
+                 output.spec.function == AggregateSpec::Function::Avg) &&
+                kind != DataKind::Int && kind != DataKind::LongInt && kind != DataKind::Double) {
+                throw std::invalid_argument("A materialized view can only sum numeric columns: " + output.output);
+            }
+            addField(output.spec.argument);
+        }
+        // COUNT(*) alone still needs a column to read
+        if (rowQuery.fields.empty()) {
+            const Table* primary = database.getTable(query.table);
+            std::string first = primary->getFields().begin()->first;
+            rowQuery.fields.push_back(query.joins.empty() ? first : query.table + "." + first);
+        }
+    }
+
+    // Scratch tables for the deltas, and the join columns each delta narrows
+    for (const auto& sourceName : sources) {
+        auto delta = std::make_unique<Table>(sourceName, &database);
+        for (const auto& [fieldName, field] : database.getTable(sourceName)->getFields()) {
+            delta->addField(new Field(fieldName, makeType(field->getDataType()->getKind()), {}));
+        }
+        deltas[sourceName] = std::move(delta);
+        joinKeys[sourceName];
+    }
+    for (const auto& join : query.joins) {
+        std::vector<SQLParser::Condition> conditions;
+        SQLParser::parse_conditions(join.onCondition, conditions);
+        // Only the equalities of an ON clause pin the other side's key
+        for (const auto& condition : conditions) {
+            if (condition.op != "=" && condition.op != "==") {
+                continue;
+            }
+            std::string left = tableOf(condition.field);
+            std::string right = tableOf(condition.value);
+            if (left != right && joinKeys.count(left) > 0 && joinKeys.count(right) > 0) {
+                joinKeys[left].emplace_back(condition.value, columnOf(condition.field));
+                joinKeys[right].emplace_back(condition.field, columnOf(condition.value));
+            }
+        }
+    }
+
+    table = new Table(name, &database);
+    for (size_t i = 0; i < outputs.size(); ++i) {
+        table->addField(new Field(outputs[i].column, makeType(resultColumns[i].kind), {}));
+    }
+    for (const auto& sourceName : sources) {
+        database.getTable(sourceName)->addObserver(this);
+    }
+}
+
+MaterializedView::~MaterializedView() {
+    for (const auto& sourceName : sources) {
+        if (Table* source = database.getTable(sourceName)) {
+            source->removeObserver(this);
+        }
+    }
+}
+
+void MaterializedView::refresh() {
+    std::vector<Row> results;
+    if (!aggregated) {
+        SelectPlan plan = database.planSelectQuery(query);
+        results = database.executeSelectPlan(plan);
+        rowsByValue.clear();
+        std::vector<Row> rows;
+        rows.reserve(results.size());
+        for (const auto& result : results) {
+            rows.push_back(viewRow(result));
+            rowsByValue[encodeRow(rows.back())].push_back(rows.size() - 1);
+        }
+        table->replaceRows(std::move(rows));
+        return;
+    }
+
+    SelectPlan plan = database.planSelectQuery(rowQuery);
+    results = database.executeSelectPlan(plan);
+    groups.clear();
+    std::unordered_set<std::string> touched;
+    if (query.groupBy.empty()) {
+        groups[""].accumulators.resize(aggregateOutputs.size());
+    }
+    fold(results, 1, touched);
+
+    std::vector<Row> rows;
+    rows.reserve(groups.size());
+    for (auto& [key, group] : groups) {
+        group.row = rows.size();
+        rows.push_back(groupRow(group));
+    }
+    table->replaceRows(std::move(rows));
+}
+
+void MaterializedView::tableChanged(const Table& source, const TableChange& change) {
+    try {
+        applyChange(source.getName(), change);
+    } catch (const std::exception&) {
+        // The view may be half updated; computing it again puts it right
+        refresh();
+    }
+}
+
+void MaterializedView::applyChange(const std::string& sourceName, const TableChange& change) {
+    std::vector<Row> removed = runDelta(sourceName, change.before);
+    std::vector<Row> added = runDelta(sourceName, change.after);
+    if (!aggregated) {
+        removeRows(removed);
+        addRows(added);
+        return;
+    }
+    std::unordered_set<std::string> touched;
+    fold(removed, -1, touched);
+    fold(added, 1, touched);
+    writeGroups(touched);
+}
+
+std::vector<MaterializedView::Row> MaterializedView::runDelta(const std::string& sourceName, const std::vector<Row>& rows) {
+    if (rows.empty()) {
+        return {};
+    }
+    SQLParser::Query deltaQuery = aggregated ? rowQuery : query;
+
+    // Only rows of the other tables sharing a join key with the delta can join it
+    for (const auto& [column, sourceColumn] : joinKeys.at(sourceName)) {
+        std::set<std::string> keys;
+        for (const auto& row : rows) {
+            auto it = row.find(sourceColumn);
+            if (it != row.end() && !it->second.empty()) {
+                keys.insert(it->second);
+            }
+        }
+        if (keys.empty()) {
+            return {};
+        }
+        SQLParser::Condition condition;
+        condition.field = column;
+        condition.op = "IN";
+        condition.values.assign(keys.begin(), keys.end());
+        condition.value = "( ";
+        for (const auto& key : keys) {
+            condition.value += (condition.value.size() > 2 ? " , " : "") + key;
+        }
+        condition.value += " )";
+        // Conditions fold left to right, so the key narrows the whole WHERE
+        condition.relation = deltaQuery.conditions.empty() ? "" : "AND";
+        deltaQuery.conditions.push_back(condition);
+    }
+
+    Table& delta = *deltas.at(sourceName);
+    delta.replaceRows(rows);
+    SelectPlan plan = database.planSelectQuery(deltaQuery, {{sourceName, &delta}});
+    std::vector<Row> results = database.executeSelectPlan(plan);
+    delta.replaceRows({});
+    return results;
+}
+
+MaterializedView::Row MaterializedView::viewRow(const Row& result) const {
+    Row row;
+    for (const auto& output : outputs) {
+        auto it = result.find(output.output);
+        row[output.column] = it != result.end() ? it->second : "";
+    }
+    return row;
+}
+
+// Values in column order, each prefixed with its length
+std::string MaterializedView::encodeRow(const Row& row) const {
+    std::string key;
+    for (const auto& [column, value] : row) {
+        key += std::to_string(value.size());
+        key += ':';
+        key += value;
+    }
+    return key;
+}
+
+void MaterializedView::addRows(const std::vector<Row>& results) {
+    std::vector<Row> rows;
+    rows.reserve(results.size());
+    size_t position = table->records.size();
+    for (const auto& result : results) {
+        rows.push_back(viewRow(result));
+        rowsByValue[encodeRow(rows.back())].push_back(position++);
+    }
+    table->appendRows(rows);
+}
+
+void MaterializedView::removeRows(const std::vector<Row>& results) {
+    if (results.empty()) {
+        return;
+    }
+    std::vector<size_t> positions;
+    for (const auto& result : results) {
+        auto it = rowsByValue.find(encodeRow(viewRow(result)));
+        if (it == rowsByValue.end()) {
+            throw std::logic_error("Materialized view " + name + " lost track of a row");
+        }
+        positions.push_back(it->second.back());
+        it->second.pop_back();
+        if (it->second.empty()) {
+            rowsByValue.erase(it);
+        }
+    }
+    std::sort(positions.begin(), positions.end());
+    table->removeRows(positions);
+
+    // The rows after each removed one moved down
+    for (auto& [key, rows] : rowsByValue) {
+        for (size_t& row : rows) {
+            row -= std::lower_bound(positions.begin(), positions.end(), row) - positions.begin();
+        }
+    }
+}
+
+void MaterializedView::fold(const std::vector<Row>& rows, int sign, std::unordered_set<std::string>& touched) {
+    for (const auto& row : rows) {
+        std::string key;
+        for (const auto& column : query.groupBy) {
+            auto it = row.find(column);
+            std::string_view value = it != row.end() ? std::string_view(it->second) : std::string_view();
+            key += std::to_string(value.size());
+            key += ':';
+            key += value;
+        }
+        Group& group = groups[key];
+        if (group.accumulators.empty()) {
+            group.accumulators.resize(aggregateOutputs.size());
+        }
+        if (group.rows == 0 && sign > 0) {
+            group.plainValues.clear();
+            for (const auto& output : outputs) {
+                auto it = row.find(output.output);
+                if (!output.aggregate && it != row.end()) {
+                    group.plainValues[output.output] = it->second;
+                }
+            }
+        }
+        if (sign < 0 && group.rows == 0) {
+            throw std::logic_error("Materialized view " + name + " lost track of a group");
+        }
+        group.rows += sign;
+        touched.insert(key);
+
+        for (size_t a = 0; a < aggregateOutputs.size(); ++a) {
+            const AggregateSpec& spec = outputs[aggregateOutputs[a]].spec;
+            Accumulator& accumulator = group.accumulators[a];
+            if (spec.argument == "*") {
+                accumulator.count += sign;
+                continue;
+            }
+            auto it = row.find(spec.argument);
+            if (it == row.end() || it->second.empty()) {
+                continue; // NULL
+            }
+            const std::string& value = it->second;
+            accumulator.count += sign;
+            switch (spec.function) {
+                case AggregateSpec::Function::Sum:
+                case AggregateSpec::Function::Avg: {
+                    double number = 0.0;
+                    ValueParser::parseDouble(value, number);
+                    accumulator.sum += sign * number;
+                    int64_t integer;
+                    if (ValueParser::parseLongInt(value, integer)) {
+                        accumulator.integerSum += sign * integer;
+                    } else {
+                        accumulator.nonIntegers += sign;
+                    }
+                    break;
+                }
+                case AggregateSpec::Function::Min:
+                case AggregateSpec::Function::Max: {
+                    size_t& count = accumulator.values[value];
+                    count += sign;
+                    if (count == 0) {
+                        accumulator.values.erase(value);
+                    }
+                    break;
+                }
+                default:
+                    break;
+            }
+        }
+    }
+}
+
+// Rewrite the rows of the touched groups: emptied groups leave the view,
+// new ones are appended and the rest are changed in place
+void MaterializedView::writeGroups(const std::unordered_set<std::string>& touched) {
+    std::vector<size_t> emptied;
+    std::vector<std::pair<size_t, Row>> changed;
+    std::vector<Group*> added;
+    std::vector<Row> addedRows;
+    for (const auto& key : touched) {
+        auto it = groups.find(key);
+        Group& group = it->second;
+        if (group.rows == 0 && !query.groupBy.empty()) {
+            if (group.row != Group::noRow) {
+                emptied.push_back(group.row);
+            }
+            groups.erase(it);
+            continue;
+        }
+        Row row = groupRow(group);
+        if (group.row == Group::noRow) {
+            added.push_back(&group);
+            addedRows.push_back(std::move(row));
+        } else if (table->records[group.row] != row) {
+            changed.emplace_back(group.row, std::move(row));
+        }
+    }
+    std::sort(changed.begin(), changed.end(),
+              [](const auto& lhs, const auto& rhs) { return lhs.first < rhs.first; });
+    table->setRows(changed);
+
+    if (!emptied.empty()) {
+        std::sort(emptied.begin(), emptied.end());
+        table->removeRows(emptied);
+        for (auto& [key, group] : groups) {
+            if (group.row != Group::noRow) {
+                group.row -= std::lower_bound(emptied.begin(), emptied.end(), group.row) - emptied.begin();
+            }
+        }
+    }
+    size_t position = table->records.size();
+    for (Group* group : added) {
+        group->row = position++;
+    }
+    table->appendRows(addedRows);
+}
+
+MaterializedView::Row MaterializedView::groupRow(const Group& group) const {
+    Row row;
+    size_t a = 0;
+    for (const auto& output : outputs) {
+        if (output.aggregate) {
+            row[output.column] = aggregateResult(output.spec, group.accumulators[a++]);
+        } else {
+            auto it = group.plainValues.find(output.output);
+            row[output.column] = it != group.plainValues.end() ? it->second : "";
+        }
+    }
+    return row;
+}
+
+// The values the aggregate operator would produce for the same rows
+std::string MaterializedView::aggregateResult(const AggregateSpec& spec, const Accumulator& accumulator) {
+    if (spec.function == AggregateSpec::Function::Count) {
+        return std::to_string(accumulator.count);
+    }
+    if (accumulator.count == 0) {
+        return ""; // NULL
+    }
+    switch (spec.function) {
+        case AggregateSpec::Function::Sum:
+            return accumulator.nonIntegers == 0 ? std::to_string(accumulator.integerSum)
+                                                : ValueParser::formatDouble(accumulator.sum);
+        case AggregateSpec::Function::Avg:
+            return ValueParser::formatDouble(accumulator.sum / accumulator.count);
+        case AggregateSpec::Function::Min:
+            return accumulator.values.begin()->first;
+        default:
+            return accumulator.values.rbegin()->first;
+    }
+}
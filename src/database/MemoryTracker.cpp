@@ -0,0 +1,84 @@
+#include "../../include/database/MemoryTracker.h"
+#include "../../include/database/Metrics.h"
+#include <algorithm>
+#include <cstdint>
+
+size_t estimateRecordBytes(const std::map<std::string, std::string>& record) {
+    size_t bytes = sizeof(record);
+    for (const auto& [key, value] : record) {
+        bytes += 4 * sizeof(void*) + 2 * sizeof(std::string);
+        bytes += key.size() > 15 ? key.capacity() : 0;
+        bytes += value.size() > 15 ? value.capacity() : 0;
+    }
+    return bytes;
+}
+
+MemoryTracker::MemoryTracker(size_t limit, MemoryTracker* parent)
+    : limit(limit), parent(parent) {}
+
+MemoryTracker::~MemoryTracker() {
+    if (parent) {
+        parent->release(used);
+    }
+}
+
+void MemoryTracker::consume(size_t bytes) {
+    if (!tryConsume(bytes)) {
+        EngineMetrics::get().memoryBudgetExceeded.add();
+        throw MemoryBudgetExceeded("Query memory budget exceeded: " + std::to_string(bytes) + " more bytes requested with " +
+                                   std::to_string(used) + " of " + std::to_string(limit) + " in use");
+    }
+}
+
+bool MemoryTracker::tryConsume(size_t bytes) {
+    if (limit > 0 && used + bytes > limit) {
+        return false;
+    }
+    if (parent && !parent->tryConsume(bytes)) {
+        return false;
+    }
+    used += bytes;
+    peak = std::max(peak, used);
+    return true;
+}
+
+void MemoryTracker::release(size_t bytes) {
+    bytes = std::min(bytes, used);
+    used -= bytes;
+    if (parent) {
+        parent->release(bytes);
+    }
+}
+
+size_t MemoryTracker::available() const {
+    size_t own = limit > 0 ? limit - std::min(used, limit) : SIZE_MAX;
+    return parent ? std::min(own, parent->available()) : own;
+}
+
+TrackingResource::TrackingResource(MemoryTracker* tracker, std::pmr::memory_resource* upstream)
+    : tracker(tracker), upstream(upstream) {}
+
+void* TrackingResource::do_allocate(size_t bytes, size_t alignment) {
+    if (tracker) {
+        tracker->consume(bytes);
+    }
+    try {
+        return upstream->allocate(bytes, alignment);
+    } catch (...) {
+        if (tracker) {
+            tracker->release(bytes);
+        }
+        throw;
+    }
+}
+
+void TrackingResource::do_deallocate(void* p, size_t bytes, size_t alignment) {
+    upstream->deallocate(p, bytes, alignment);
+    if (tracker) {
+        tracker->release(bytes);
+    }
+}
+
+bool TrackingResource::do_is_equal(const std::pmr::memory_resource& other) const noexcept {
+    return this == &other;
+}
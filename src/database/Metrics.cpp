@@ -0,0 +1,267 @@
+#include "../../include/database/Metrics.h"
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+// Each thread sticks to one shard, assigned round-robin on first use
+static size_t currentShard(size_t shardCount) {
+    static std::atomic<size_t> nextShard{0};
+    thread_local size_t shard = nextShard.fetch_add(1, std::memory_order_relaxed);
+    return shard % shardCount;
+}
+
+void Counter::add(uint64_t n) {
+    shards[currentShard(shardCount)].value.fetch_add(n, std::memory_order_relaxed);
+}
+
+uint64_t Counter::value() const {
+    uint64_t total = 0;
+    for (const auto& shard : shards) {
+        total += shard.value.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+size_t LatencyHistogram::bucketIndex(uint64_t nanos) {
+    if (nanos < subBuckets) {
+        return static_cast<size_t>(nanos);
+    }
+    int msb = 63 - __builtin_clzll(nanos);
+    int shift = msb - subBucketBits;
+    return static_cast<size_t>(shift + 1) * subBuckets + ((nanos >> shift) - subBuckets);
+}
+
+uint64_t LatencyHistogram::bucketMidpoint(size_t index) {
+    if (index < subBuckets) {
+        return index;
+    }
+    int shift = static_cast<int>(index / subBuckets) - 1;
+    uint64_t lower = (subBuckets + index % subBuckets) << shift;
+    return lower + ((uint64_t(1) << shift) >> 1);
+}
+
+void LatencyHistogram::record(uint64_t nanos) {
+    buckets[bucketIndex(nanos)].fetch_add(1, std::memory_order_relaxed);
+    sum.fetch_add(nanos, std::memory_order_relaxed);
+}
+
+void LatencyHistogram::record(std::chrono::steady_clock::duration elapsed) {
+    record(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+}
+
+uint64_t LatencyHistogram::count() const {
+    uint64_t total = 0;
+    for (const auto& bucket : buckets) {
+        total += bucket.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+uint64_t LatencyHistogram::quantile(double q) const {
+    uint64_t total = count();
+    if (total == 0) {
+        return 0;
+    }
+    uint64_t rank = static_cast<uint64_t>(q * static_cast<double>(total - 1)) + 1;
+    uint64_t seen = 0;
+    for (size_t i = 0; i < bucketCount; ++i) {
+        seen += buckets[i].load(std::memory_order_relaxed);
+        if (seen >= rank) {
+            return bucketMidpoint(i);
+        }
+    }
+    return bucketMidpoint(bucketCount - 1);
+}
+
+MetricsRegistry& MetricsRegistry::instance() {
+    static MetricsRegistry registry;
+    return registry;
+}
+
+Counter& MetricsRegistry::counter(const std::string& name, const std::string& helpText, const std::string& labels) {
+    std::lock_guard<std::mutex> lock(mutex);
+    help.emplace(name, helpText);
+    auto& slot = counters[{name, labels}];
+    if (!slot) {
+        slot = std::make_unique<Counter>();
+    }
+    return *slot;
+}
+
+LatencyHistogram& MetricsRegistry::histogram(const std::string& name, const std::string& helpText, const std::string& labels) {
+    std::lock_guard<std::mutex> lock(mutex);
+    help.emplace(name, helpText);
+    auto& slot = histograms[{name, labels}];
+    if (!slot) {
+        slot = std::make_unique<LatencyHistogram>();
+    }
+    return *slot;
+}
+
+StatementMetrics& MetricsRegistry::statement(const std::string& type) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = statements.find(type);
+        if (it != statements.end()) {
+            return *it->second;
+        }
+    }
+
+    std::string labels = "type=\"" + type + "\"";
+    auto metrics = std::make_unique<StatementMetrics>(StatementMetrics{
+        counter("reldb_statements_total", "Statements executed, by type.", labels),
+        counter("reldb_statement_errors_total", "Statements that failed, by type.", labels),
+        histogram("reldb_parse_seconds", "Time spent parsing statements.", labels),
+        histogram("reldb_plan_seconds", "Time spent planning statements.", labels),
+        histogram("reldb_execute_seconds", "Time spent executing statements.", labels),
+        histogram("reldb_statement_seconds", "End-to-end statement latency.", labels),
+    });
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto& slot = statements[type];
+    if (!slot) {
+        slot = std::move(metrics);
+    }
+    return *slot;
+}
+
+EngineMetrics& EngineMetrics::get() {
+    static EngineMetrics metrics{
+        MetricsRegistry::instance().counter("reldb_rows_scanned_total", "Rows read by table scans."),
+        MetricsRegistry::instance().counter("reldb_rows_returned_total", "Rows returned to clients."),
+        MetricsRegistry::instance().counter("reldb_index_lookups_total", "Lookups answered by an index."),
+        MetricsRegistry::instance().counter("reldb_full_scans_total", "Full passes over a table."),
+        MetricsRegistry::instance().counter("reldb_blocks_skipped_total", "Row blocks skipped by zone maps during scans."),
+        MetricsRegistry::instance().counter("reldb_bloom_rows_dropped_total", "Rows dropped in scans by join Bloom filters."),
+        MetricsRegistry::instance().counter("reldb_query_bytes_allocated_total", "Bytes allocated by query arenas."),
+        MetricsRegistry::instance().counter("reldb_auto_analyze_total", "Tables re-analyzed before planning because their statistics were stale."),
+        MetricsRegistry::instance().counter("reldb_spill_bytes_total", "Bytes written to spill files by operators over their memory budget."),
+        MetricsRegistry::instance().counter("reldb_memory_budget_exceeded_total", "Queries stopped for exceeding their memory budget."),
+        MetricsRegistry::instance().counter("reldb_result_cache_hits_total", "SELECTs answered from the result cache."),
+        MetricsRegistry::instance().counter("reldb_result_cache_misses_total", "SELECTs the result cache had no current result for."),
+        MetricsRegistry::instance().counter("reldb_change_events_total", "Row changes published to the change stream."),
+        MetricsRegistry::instance().histogram("reldb_constraint_check_seconds", "Time spent validating rows and checking constraints."),
+    };
+    return metrics;
+}
+
+// Prometheus sample line: name{labels} value
+static void writeSample(std::ostream& out, const std::string& name, const std::string& labels, double value) {
+    out << name;
+    if (!labels.empty()) {
+        out << "{" << labels << "}";
+    }
+    out << " " << value << "\n";
+}
+
+void MetricsRegistry::writePrometheus(std::ostream& out) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    out << std::setprecision(9);
+
+    std::string lastName;
+    for (const auto& [key, counter] : counters) {
+        const auto& [name, labels] = key;
+        if (name != lastName) {
+            out << "# HELP " << name << " " << help.at(name) << "\n";
+            out << "# TYPE " << name << " counter\n";
+            lastName = name;
+        }
+        writeSample(out, name, labels, static_cast<double>(counter->value()));
+    }
+
+    // Histograms are exposed as summaries: the HDR buckets give accurate quantiles
+    static const double quantiles[] = {0.5, 0.9, 0.95, 0.99, 0.999};
+    lastName.clear();
+    for (const auto& [key, histogram] : histograms) {
+        const auto& [name, labels] = key;
+        if (name != lastName) {
+            out << "# HELP " << name << " " << help.at(name) << "\n";
+            out << "# TYPE " << name << " summary\n";
+            lastName = name;
+        }
+        std::string separator = labels.empty() ? "" : ",";
+        for (double q : quantiles) {
+            std::ostringstream quantileLabel;
+            quantileLabel << labels << separator << "quantile=\"" << q << "\"";
+            writeSample(out, name, quantileLabel.str(), histogram->quantile(q) / 1e9);
+        }
+        writeSample(out, name + "_sum", labels, histogram->sumNanos() / 1e9);
+        writeSample(out, name + "_count", labels, static_cast<double>(histogram->count()));
+    }
+}
+
+void MetricsRegistry::writeSummary(std::ostream& out) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto millis = [](uint64_t nanos) { return nanos / 1e6; };
+
+    out << std::left << std::setw(10) << "STATEMENT" << std::right
+        << std::setw(10) << "COUNT" << std::setw(10) << "ERRORS"
+        << std::setw(12) << "P50 MS" << std::setw(12) << "P95 MS" << std::setw(12) << "P99 MS"
+        << std::setw(12) << "PARSE P99" << std::setw(12) << "PLAN P99" << std::setw(12) << "EXEC P99" << "\n";
+    out << std::fixed << std::setprecision(3);
+    for (const auto& [type, metrics] : statements) {
+        out << std::left << std::setw(10) << type << std::right
+            << std::setw(10) << metrics->executed.value() << std::setw(10) << metrics->errors.value()
+            << std::setw(12) << millis(metrics->total.quantile(0.5))
+            << std::setw(12) << millis(metrics->total.quantile(0.95))
+            << std::setw(12) << millis(metrics->total.quantile(0.99))
+            << std::setw(12) << millis(metrics->parse.quantile(0.99))
+            << std::setw(12) << millis(metrics->plan.quantile(0.99))
+            << std::setw(12) << millis(metrics->execute.quantile(0.99)) << "\n";
+    }
+
+    out << "\n";
+    for (const auto& [key, counter] : counters) {
+        if (key.second.empty()) {
+            out << std::left << std::setw(36) << key.first << std::right << counter->value() << "\n";
+        }
+    }
+    for (const auto& [key, histogram] : histograms) {
+        if (key.second.empty()) {
+            out << std::left << std::setw(36) << key.first << std::right
+                << "count=" << histogram->count()
+                << " p50=" << millis(histogram->quantile(0.5)) << " ms"
+                << " p99=" << millis(histogram->quantile(0.99)) << " ms\n";
+        }
+    }
+    out.unsetf(std::ios_base::floatfield);
+}
+
+MetricsExporter::MetricsExporter(const std::string& path, std::chrono::seconds interval)
+    : path(path), interval(interval), worker(&MetricsExporter::run, this) {}
+
+MetricsExporter::~MetricsExporter() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wakeUp.notify_one();
+    worker.join();
+    writeNow();
+}
+
+void MetricsExporter::writeNow() const {
+    // Write to a temporary file and rename it so scrapers never see a partial file
+    std::string temporaryPath = path + ".tmp";
+    {
+        std::ofstream file(temporaryPath, std::ios::trunc);
+        if (!file) {
+            return;
+        }
+        MetricsRegistry::instance().writePrometheus(file);
+    }
+    std::rename(temporaryPath.c_str(), path.c_str());
+}
+
+void MetricsExporter::run() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!stopping) {
+        if (wakeUp.wait_for(lock, interval, [this] { return stopping; })) {
+            break;
+        }
+        lock.unlock();
+        writeNow();
+        lock.lock();
+    }
+}
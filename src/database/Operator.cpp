@@ -0,0 +1,1498 @@
+#include "../../include/database/Operator.h"
+#include "../../include/database/Table.h"
+#include "../../include/database/Metrics.h"
+#include "../../include/database/ValueParser.h"
+#include "../../include/database/ZoneMap.h"
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+
+// A scan reads one zone map block per batch
+static_assert(ZoneMap::blockSize <= ColumnBatch::capacity, "a block must fit in a batch");
+
+bool Operator::next(ColumnBatch& batch) {
+    if (!stats) {
+        return produce(batch);
+    }
+    OperatorTimer timer(*stats);
+    bool produced = produce(batch);
+    if (produced) {
+        stats->rowsOut += batch.selectedCount();
+    }
+    return produced;
+}
+
+BatchPredicates::BatchPredicates(std::vector<Predicate> predicates)
+    : predicates(std::move(predicates)), matches(ColumnBatch::capacity) {}
+
+const Predicate* BatchPredicates::apply(const std::vector<const std::string_view*>& columns, std::vector<uint32_t>& selection) {
+    if (predicates.empty()) {
+        return nullptr;
+    }
+    if (!predicates[0].matchRows(columns[0], selection.data(), selection.size(), matches.data())) {
+        return &predicates[0];
+    }
+
+    // An AND can only turn rows that still match false, an OR only rows that
+    // do not match true; either way the new outcome is the predicate's own
+    for (size_t i = 1; i < predicates.size(); ++i) {
+        uint8_t undecided = predicates[i].isOr() ? 0 : 1;
+        pending.clear();
+        for (uint32_t row : selection) {
+            if (matches[row] == undecided) {
+                pending.push_back(row);
+            }
+        }
+        if (!predicates[i].matchRows(columns[i], pending.data(), pending.size(), matches.data())) {
+            return &predicates[i];
+        }
+    }
+
+    size_t kept = 0;
+    for (uint32_t row : selection) {
+        if (matches[row]) {
+            selection[kept++] = row;
+        }
+    }
+    selection.resize(kept);
+    return nullptr;
+}
+
+ScanOperator::ScanOperator(const Table& table, size_t source, std::vector<Predicate> predicates,
+                           std::vector<JoinKeyFilter> filters, const std::vector<PipelineColumn>& columns,
+                           size_t sourceCount, OperatorStats* stats)
+    : Operator(stats), table(table), source(source), predicates(std::move(predicates)), filters(std::move(filters)),
+      columnCount(columns.size()), sourceCount(sourceCount) {
+    for (size_t slot = 0; slot < columns.size(); ++slot) {
+        if (columns[slot].source == source) {
+            carried.emplace_back(slot, columns[slot].column);
+        }
+    }
+
+    // Each column a predicate reads is gathered once per batch
+    for (const auto& predicate : this->predicates.get()) {
+        auto it = std::find(fields.begin(), fields.end(), predicate.getField());
+        fieldOf.push_back(it - fields.begin());
+        if (it == fields.end()) {
+            fields.push_back(predicate.getField());
+        }
+    }
+    fieldValues.assign(fields.size() + 1, std::vector<std::string_view>(ColumnBatch::capacity));
+}
+
+void ScanOperator::start() {
+    started = true;
+    if (const Predicate* indexed = table.findIndexPredicate(predicates.get())) {
+        this->indexed = true;
+        indexRows = table.lookupRows(*indexed);
+        EngineMetrics::get().indexLookups.add();
+    } else if (const Predicate* like = table.findTrigramPredicate(predicates.get())) {
+        // Candidates from the trigram index; the predicates below verify them
+        this->indexed = true;
+        indexRows = table.trigramCandidates(*like);
+        EngineMetrics::get().indexLookups.add();
+    } else {
+        EngineMetrics::get().fullScans.add();
+    }
+}
+
+bool ScanOperator::readChunk(ColumnBatch& batch) {
+    batch.reset(columnCount, sourceCount);
+    std::vector<size_t>& ids = batch.rowIds[source];
+
+    if (indexed) {
+        // Index scans read only the rows the index holds under the keys
+        if (position >= indexRows.size()) {
+            return false;
+        }
+        size_t end = std::min(indexRows.size(), position + ColumnBatch::capacity);
+        for (; position < end; ++position) {
+            ids[batch.appendRow()] = indexRows[position];
+        }
+    } else {
+        const ZoneMap& zoneMap = table.getZoneMap();
+        size_t skipped = 0;
+        while (position < zoneMap.getBlockCount() && !predicates.get().empty() &&
+               !zoneMap.mayMatch(position, predicates.get())) {
+            ++position;
+            ++skipped;
+        }
+        if (skipped > 0) {
+            EngineMetrics::get().blocksSkipped.add(skipped);
+        }
+        if (position >= zoneMap.getBlockCount()) {
+            return false;
+        }
+        size_t begin = position * ZoneMap::blockSize;
+        size_t end = std::min(table.records.size(), begin + ZoneMap::blockSize);
+        ++position;
+        for (size_t rowId = begin; rowId < end; ++rowId) {
+            ids[batch.appendRow()] = rowId;
+        }
+        EngineMetrics::get().rowsScanned.add(end - begin);
+    }
+
+    rowsRead += batch.rowCount;
+    if (stats) {
+        stats->rowsIn += batch.rowCount;
+    }
+    return true;
+}
+
+void ScanOperator::gather(const ColumnBatch& batch, const std::string& column, std::vector<std::string_view>& values) const {
+    const std::vector<size_t>& ids = batch.rowIds[source];
+    for (uint32_t row : batch.selection) {
+        const auto& record = table.records[ids[row]];
+        auto it = record.find(column);
+        values[row] = it != record.end() ? std::string_view(it->second) : std::string_view();
+    }
+}
+
+bool ScanOperator::produce(ColumnBatch& batch) {
+    if (!started) {
+        start();
+    }
+    std::vector<const std::string_view*> predicateColumns(fieldOf.size());
+    while (readChunk(batch)) {
+        if (!fields.empty()) {
+            for (size_t field = 0; field < fields.size(); ++field) {
+                gather(batch, fields[field], fieldValues[field]);
+            }
+            for (size_t i = 0; i < fieldOf.size(); ++i) {
+                predicateColumns[i] = fieldValues[fieldOf[i]].data();
+            }
+            if (const Predicate* missing = predicates.apply(predicateColumns, batch.selection)) {
+                throw std::invalid_argument("Field not found in condition: " + missing->getField());
+            }
+        }
+
+        // Rows a later join would reject are dropped here, before anyone reads more of them
+        if (!filters.empty()) {
+            size_t before = batch.selectedCount();
+            std::vector<std::string_view>& keys = fieldValues.back();
+            for (const auto& filter : filters) {
+                gather(batch, filter.column, keys);
+                size_t kept = 0;
+                for (uint32_t row : batch.selection) {
+                    if (!keys[row].empty() && filter.bloom->mayContain(keys[row])) {
+                        batch.selection[kept++] = row;
+                    }
+                }
+                batch.selection.resize(kept);
+            }
+            EngineMetrics::get().bloomRowsDropped.add(before - batch.selectedCount());
+        }
+
+        for (const auto& [slot, column] : carried) {
+            gather(batch, column, batch.columns[slot]);
+        }
+        if (batch.selectedCount() > 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+FilterOperator::FilterOperator(std::unique_ptr<Operator> child, std::vector<Predicate> predicates, std::vector<size_t> slots,
+                               OperatorStats* stats)
+    : Operator(stats), child(std::move(child)), predicates(std::move(predicates)), slots(std::move(slots)) {}
+
+bool FilterOperator::produce(ColumnBatch& batch) {
+    std::vector<const std::string_view*> columns(slots.size());
+    while (child->next(batch)) {
+        if (stats) {
+            stats->rowsIn += batch.selectedCount();
+        }
+        for (size_t i = 0; i < slots.size(); ++i) {
+            columns[i] = batch.columns[slots[i]].data();
+        }
+        if (const Predicate* missing = predicates.apply(columns, batch.selection)) {
+            throw std::runtime_error("Field not found in record: " + missing->getField());
+        }
+        if (batch.selectedCount() > 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Pipeline columns read from the records of 'source'
+static std::vector<std::pair<size_t, std::string>> carriedColumns(const std::vector<PipelineColumn>& columns, size_t source) {
+    std::vector<std::pair<size_t, std::string>> carried;
+    for (size_t slot = 0; slot < columns.size(); ++slot) {
+        if (columns[slot].source == source) {
+            carried.emplace_back(slot, columns[slot].column);
+        }
+    }
+    return carried;
+}
+
+// Fill in 'source' of the batch's last row from one of its table's records.
+// Only row ids and carried columns are copied, never whole records.
+static void setJoinedSource(ColumnBatch& batch, size_t source, size_t rowId, const std::map<std::string, std::string>& record,
+                            const std::vector<std::pair<size_t, std::string>>& carried) {
+    size_t joined = batch.rowCount - 1;
+    batch.rowIds[source][joined] = rowId;
+    for (const auto& [slot, column] : carried) {
+        auto it = record.find(column);
+        batch.columns[slot][joined] = it != record.end() ? std::string_view(it->second) : std::string_view();
+    }
+}
+
+// Make 'source' of the batch's last row NULL, as an outer join does
+// without a match: no row id, and empty (not null) carried values
+static void setNullSource(ColumnBatch& batch, size_t source, const std::vector<std::pair<size_t, std::string>>& carried) {
+    size_t joined = batch.rowCount - 1;
+    batch.rowIds[source][joined] = ColumnBatch::noRow;
+    for (const auto& [slot, column] : carried) {
+        batch.columns[slot][joined] = std::string_view("");
+    }
+}
+
+// Append a row of the joined table alone, every source before it NULL
+static void appendJoinedRow(ColumnBatch& batch, size_t source, size_t rowId, const std::map<std::string, std::string>& record,
+                            const std::vector<std::pair<size_t, std::string>>& carried) {
+    size_t joined = batch.appendRow();
+    for (auto& ids : batch.rowIds) {
+        ids[joined] = ColumnBatch::noRow;
+    }
+    for (auto& values : batch.columns) {
+        values[joined] = std::string_view("");
+    }
+    setJoinedSource(batch, source, rowId, record, carried);
+}
+
+// Append an input row to the batch, its sources so far and carried columns
+static void appendInputRow(ColumnBatch& batch, const ColumnBatch& input, uint32_t row) {
+    size_t joined = batch.appendRow();
+    for (size_t s = 0; s < batch.rowIds.size(); ++s) {
+        batch.rowIds[s][joined] = input.rowIds[s][row];
+    }
+    for (size_t column = 0; column < batch.columns.size(); ++column) {
+        batch.columns[column][joined] = input.columns[column][row];
+    }
+}
+
+// True if a row so far and a record of the joined table satisfy every
+// comparison; probeValue(slot) reads the row's carried columns. '=' and
+// '<>' compare values as written, like join keys; the others in the order
+// of Predicate::compareValues. NULL (or no value) satisfies none.
+template <typename ProbeValue>
+static bool comparisonsHold(const std::vector<SelectPlan::JoinComparison>& comparisons, ProbeValue probeValue,
+                            const std::map<std::string, std::string>& record) {
+    for (const auto& comparison : comparisons) {
+        std::string_view probe = probeValue(comparison.probeSlot);
+        auto it = record.find(comparison.buildColumn);
+        if (probe.empty() || it == record.end() || it->second.empty()) {
+            return false;
+        }
+        std::string_view build = it->second;
+        bool holds = false;
+        switch (comparison.op) {
+            case Predicate::Op::Equal: holds = probe == build; break;
+            case Predicate::Op::NotEqual: holds = probe != build; break;
+            case Predicate::Op::Less: holds = Predicate::compareValues(probe, build) < 0; break;
+            case Predicate::Op::Greater: holds = Predicate::compareValues(probe, build) > 0; break;
+            case Predicate::Op::LessEqual: holds = Predicate::compareValues(probe, build) <= 0; break;
+            case Predicate::Op::GreaterEqual: holds = Predicate::compareValues(probe, build) >= 0; break;
+            default: break;
+        }
+        if (!holds) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Row ids of the joined table's qualifying rows, in table order
+static std::vector<size_t> scanJoinedRows(const Table& table, const std::vector<Predicate>& predicates,
+                                          const std::vector<JoinKeyFilter>& filters, OperatorStats& stats) {
+    std::vector<size_t> rowIds = table.scanRowIds(predicates, filters, &stats);
+    if (!std::is_sorted(rowIds.begin(), rowIds.end())) {
+        std::sort(rowIds.begin(), rowIds.end()); // Index scans return rows in key order
+    }
+    return rowIds;
+}
+
+HashJoinOperator::HashJoinOperator(std::unique_ptr<Operator> child, const JoinHashTable& hashTable,
+                                   SelectPlan::JoinKind kind, bool nullAware, size_t probeSource, size_t probeSlot,
+                                   const std::vector<SelectPlan::JoinComparison>& comparisons, size_t source,
+                                   const std::vector<PipelineColumn>& columns, size_t sourceCount, QueryArena& arena,
+                                   OperatorStats* stats)
+    : Operator(stats), child(std::move(child)), hashTable(hashTable), table(hashTable.getTable()), kind(kind),
+      nullAware(nullAware), probeSource(probeSource), probeSlot(probeSlot), comparisons(comparisons), source(source),
+      columns(columns), sourceCount(sourceCount), arena(arena), carried(carriedColumns(columns, source)) {
+    if (kind == SelectPlan::JoinKind::Right || kind == SelectPlan::JoinKind::Full) {
+        buildMatched.resize(table.records.size(), false);
+    }
+    if (nullAware) {
+        const std::string& buildColumn = hashTable.getColumn();
+        for (size_t row : hashTable.getRowIds()) {
+            auto it = table.records[row].find(buildColumn);
+            if (it == table.records[row].end() || it->second.empty()) {
+                buildHasNull = true;
+                break;
+            }
+        }
+    }
+}
+
+bool HashJoinOperator::probes(size_t probeRowId, std::string_view key) const {
+    if (probeRowId == ColumnBatch::noRow) {
+        return false;
+    }
+    return !key.empty(); // NULL equals nothing, for every join kind
+}
+
+// Whether an input row without a partner comes out: NULL-extended for
+// Left and Full, as it is for Anti
+bool HashJoinOperator::keepsUnmatched(std::string_view key) const {
+    switch (kind) {
+        case SelectPlan::JoinKind::Left:
+        case SelectPlan::JoinKind::Full:
+            return true;
+        case SelectPlan::JoinKind::Anti:
+            // x NOT IN (...) is unknown for a NULL x, unless the list is empty
+            return !nullAware || !key.empty() || hashTable.getRowIds().empty();
+        default:
+            return false;
+    }
+}
+
+void HashJoinOperator::appendUnmatchedBuildRows(ColumnBatch& batch) {
+    if (buildMatched.empty()) {
+        return;
+    }
+    const std::vector<size_t>& buildRows = hashTable.getRowIds();
+    while (!batch.full() && unmatchedPosition < buildRows.size()) {
+        size_t buildRow = buildRows[unmatchedPosition++];
+        if (!buildMatched[buildRow]) {
+            appendJoinedRow(batch, source, buildRow, table.records[buildRow], carried);
+        }
+    }
+}
+
+bool HashJoinOperator::produce(ColumnBatch& batch) {
+    if (nullAware && buildHasNull) {
+        return false; // x NOT IN a list holding NULL is never true
+    }
+
+    batch.reset(columns.size(), sourceCount);
+    const auto& records = table.records;
+    bool filtering = kind == SelectPlan::JoinKind::Semi || kind == SelectPlan::JoinKind::Anti;
+    while (!batch.full()) {
+        // Find the next input row with a partner, passing on those kept without one
+        if (match == JoinHashTable::noRow) {
+            if (inputPosition >= input.selectedCount()) {
+                if (inputDone || !nextInput()) {
+                    inputDone = true;
+                    break;
+                }
+                inputPosition = 0;
+                continue;
+            }
+            uint32_t row = input.selection[inputPosition];
+            std::string_view key = input.columns[probeSlot][row];
+            match = probes(input.rowIds[probeSource][row], key) ? firstMatches[inputPosition] : JoinHashTable::noRow;
+            matched = false;
+            if (match == JoinHashTable::noRow) {
+                ++inputPosition;
+                if (keepsUnmatched(key)) {
+                    appendInputRow(batch, input, row);
+                    if (!filtering) {
+                        setNullSource(batch, source, carried);
+                    }
+                }
+                continue;
+            }
+        }
+
+        uint32_t row = input.selection[inputPosition];
+        const JoinHashTable& matches = partitionTable ? *partitionTable : hashTable;
+        size_t buildRow = matches.getRow(match);
+        match = matches.nextMatch(match);
+        const auto& record = records[buildRow];
+        bool holds = comparisons.empty() ||
+                     comparisonsHold(comparisons, [&](size_t slot) { return input.columns[slot][row]; }, record);
+        if (holds) {
+            matched = true;
+            if (!buildMatched.empty()) {
+                buildMatched[buildRow] = true;
+            }
+            if (filtering) {
+                match = JoinHashTable::noRow; // One partner decides
+            }
+        }
+        if (match == JoinHashTable::noRow) {
+            ++inputPosition;
+            if (kind == SelectPlan::JoinKind::Semi ? matched : !matched && keepsUnmatched(input.columns[probeSlot][row])) {
+                appendInputRow(batch, input, row);
+                if (!filtering) {
+                    setNullSource(batch, source, carried);
+                }
+                continue;
+            }
+        }
+        if (holds && !filtering) {
+            appendInputRow(batch, input, row);
+            setJoinedSource(batch, source, buildRow, record, carried);
+        }
+    }
+    if (inputDone) {
+        appendUnmatchedBuildRows(batch);
+    }
+    return batch.selectedCount() > 0;
+}
+
+// A spilled input row is its row ids and the views of its carried columns.
+// Batch values stay valid for the whole query (they view table records or
+// the query arena), so the views read back are as good as those written.
+static constexpr size_t spillBufferBytes = 8192;
+
+static size_t spilledRowBytes(const ColumnBatch& batch) {
+    return batch.rowIds.size() * sizeof(size_t) + batch.columns.size() * sizeof(std::string_view);
+}
+
+static void writeSpilledRow(std::vector<char>& buffer, const ColumnBatch& batch, uint32_t row) {
+    size_t offset = buffer.size();
+    buffer.resize(offset + spilledRowBytes(batch));
+    char* bytes = buffer.data() + offset;
+    for (const auto& ids : batch.rowIds) {
+        std::memcpy(bytes, &ids[row], sizeof(size_t));
+        bytes += sizeof(size_t);
+    }
+    for (const auto& values : batch.columns) {
+        std::memcpy(bytes, &values[row], sizeof(std::string_view));
+        bytes += sizeof(std::string_view);
+    }
+}
+
+static const char* readSpilledRow(const char* bytes, ColumnBatch& batch) {
+    size_t row = batch.appendRow();
+    for (auto& ids : batch.rowIds) {
+        std::memcpy(&ids[row], bytes, sizeof(size_t));
+        bytes += sizeof(size_t);
+    }
+    for (auto& values : batch.columns) {
+        std::memcpy(&values[row], bytes, sizeof(std::string_view));
+        bytes += sizeof(std::string_view);
+    }
+    return bytes;
+}
+
+// Read the next batch of spilled rows of a layout, from 'offset' on; false
+// once the file is done
+static bool readSpilledBatch(const SpillFile& file, size_t& offset, size_t columnCount, size_t sourceCount,
+                             std::vector<char>& buffer, ColumnBatch& batch) {
+    batch.reset(columnCount, sourceCount);
+    if (offset >= file.size()) {
+        return false;
+    }
+    size_t rowBytes = spilledRowBytes(batch);
+    size_t rows = std::min(ColumnBatch::capacity, (file.size() - offset) / rowBytes);
+    buffer.resize(rows * rowBytes);
+    file.read(offset, buffer.data(), buffer.size());
+    offset += buffer.size();
+    const char* bytes = buffer.data();
+    for (size_t i = 0; i < rows; ++i) {
+        bytes = readSpilledRow(bytes, batch);
+    }
+    return true;
+}
+
+// Input batches looked up together against a partitioned hash table: with
+// all cores probing, enough rows for a few of them
+static constexpr size_t probeBlockBatches = 32;
+
+// The next batch of input rows, with the first match of each looked up
+bool HashJoinOperator::nextInput() {
+    if (blockPosition >= blockSize && !readBlock()) {
+        return false;
+    }
+    std::swap(input, block[blockPosition]);
+    std::swap(firstMatches, blockMatches[blockPosition]);
+    ++blockPosition;
+    return true;
+}
+
+// Read the next block of input batches and look them up: one batch, or up
+// to probeBlockBatches of them when the hash table probed can spread them
+// over threads. A spilled join's block stays within one partition.
+bool HashJoinOperator::readBlock() {
+    if (block.empty()) {
+        block.resize(probeBlockBatches);
+        blockMatches.resize(probeBlockBatches);
+    }
+    blockSize = 0;
+    blockPosition = 0;
+    const JoinHashTable* probing = &hashTable;
+    if (hashTable.isSpilled()) {
+        if (!partitioned) {
+            partitionInput();
+        }
+        if (!readPartitionInput(block[0])) {
+            return false;
+        }
+        blockSize = 1;
+        probing = partitionTable.get();
+        while (probing && probing->probesInParallel() && blockSize < probeBlockBatches &&
+               readSpilledBatch(inputPartitions[readPartition], readOffset, columns.size(), sourceCount, readBuffer,
+                                block[blockSize])) {
+            ++blockSize;
+        }
+    } else {
+        while (blockSize < (hashTable.probesInParallel() ? probeBlockBatches : 1) && child->next(block[blockSize])) {
+            if (stats) {
+                stats->rowsIn += block[blockSize].selectedCount();
+            }
+            ++blockSize;
+        }
+        if (blockSize == 0) {
+            return false;
+        }
+    }
+
+    if (!probing) {
+        for (size_t b = 0; b < blockSize; ++b) {
+            blockMatches[b].assign(block[b].selectedCount(), JoinHashTable::noRow);
+        }
+        return true;
+    }
+    if (blockSize == 1) {
+        probing->lookupBatch(block[0].columns[probeSlot].data(), block[0].selection, blockMatches[0]);
+        return true;
+    }
+    blockKeys.clear();
+    for (size_t b = 0; b < blockSize; ++b) {
+        for (uint32_t row : block[b].selection) {
+            blockKeys.push_back(block[b].columns[probeSlot][row]);
+        }
+    }
+    probing->lookupPartitioned(blockKeys, blockFirstMatches, stats);
+    auto first = blockFirstMatches.begin();
+    for (size_t b = 0; b < blockSize; ++b) {
+        blockMatches[b].assign(first, first + block[b].selectedCount());
+        first += block[b].selectedCount();
+    }
+    return true;
+}
+
+// Drain the input into a spill file per build partition, through a small
+// buffer each. Rows that can have no partner go to one more file if they
+// come out anyway (Left, Full, Anti) and are dropped otherwise.
+void HashJoinOperator::partitionInput() {
+    partitioned = true;
+    size_t partitionCount = hashTable.getPartitionCount();
+    inputPartitions.resize(partitionCount + 1);
+    std::vector<std::vector<char>> buffers(partitionCount + 1);
+    bool keepsInput = kind == SelectPlan::JoinKind::Left || kind == SelectPlan::JoinKind::Full ||
+                      kind == SelectPlan::JoinKind::Anti;
+    ColumnBatch arriving;
+    while (child->next(arriving)) {
+        if (stats) {
+            stats->rowsIn += arriving.selectedCount();
+        }
+        for (uint32_t row : arriving.selection) {
+            std::string_view key = arriving.columns[probeSlot][row];
+            size_t partition = partitionCount;
+            if (probes(arriving.rowIds[probeSource][row], key) && hashTable.getBloomFilter().mayContain(key)) {
+                partition = hashTable.partitionOf(key);
+            } else if (!keepsInput) {
+                continue;
+            }
+            writeSpilledRow(buffers[partition], arriving, row);
+            if (buffers[partition].size() >= spillBufferBytes) {
+                inputPartitions[partition].write(buffers[partition].data(), buffers[partition].size());
+                buffers[partition].clear();
+            }
+        }
+    }
+    for (size_t partition = 0; partition <= partitionCount; ++partition) {
+        inputPartitions[partition].write(buffers[partition].data(), buffers[partition].size());
+        if (stats) {
+            stats->bytesSpilled += inputPartitions[partition].size();
+        }
+    }
+}
+
+// Read the next batch of spilled input rows into 'batch'. Each partition's
+// hash table is built when its rows are first read and freed with its arena
+// before the next one; a partition without build rows is skipped unless its
+// rows come out unmatched.
+bool HashJoinOperator::readPartitionInput(ColumnBatch& batch) {
+    bool keepsInput = kind == SelectPlan::JoinKind::Left || kind == SelectPlan::JoinKind::Full ||
+                      kind == SelectPlan::JoinKind::Anti;
+    for (; readPartition < inputPartitions.size(); ++readPartition, readOffset = 0) {
+        const SpillFile& file = inputPartitions[readPartition];
+        if (readOffset == 0) {
+            partitionTable.reset();
+            partitionArena.reset();
+            if (file.size() == 0) {
+                continue;
+            }
+            if (readPartition < hashTable.getPartitionCount()) {
+                partitionArena = std::make_unique<QueryArena>(arena.getTracker());
+                partitionTable = hashTable.loadPartition(readPartition, *partitionArena);
+            }
+            if (!partitionTable && !keepsInput) {
+                continue;
+            }
+        }
+        if (readSpilledBatch(file, readOffset, columns.size(), sourceCount, readBuffer, batch)) {
+            return true;
+        }
+    }
+    partitionTable.reset();
+    partitionArena.reset();
+    return false;
+}
+
+MergeJoinOperator::MergeJoinOperator(std::unique_ptr<Operator> child, const Table& table,
+                                     const std::vector<Predicate>& predicates, const std::vector<JoinKeyFilter>& filters,
+                                     const std::string& buildColumn, size_t probeSlot,
+                                     const std::vector<SelectPlan::JoinComparison>& comparisons, size_t source,
+                                     const std::vector<PipelineColumn>& columns, size_t sourceCount, QueryArena& arena,
+                                     OperatorStats* buildStats, OperatorStats* stats)
+    : Operator(stats), child(std::move(child)), table(table), probeSlot(probeSlot), comparisons(comparisons),
+      source(source), columnCount(columns.size()), sourceCount(sourceCount), carried(carriedColumns(columns, source)),
+      keys(&arena) {
+    OperatorStats ignoredStats;
+    OperatorStats& scanStats = buildStats ? *buildStats : ignoredStats;
+    size_t bytesBefore = arena.bytesAllocated();
+    {
+        OperatorTimer timer(scanStats);
+        std::vector<size_t> rowIds = scanJoinedRows(table, predicates, filters, scanStats);
+        keys.reserve(rowIds.size());
+        for (size_t row : rowIds) {
+            auto it = table.records[row].find(buildColumn);
+            if (it != table.records[row].end()) {
+                keys.add(it->second, row);
+            }
+        }
+        // The planner checked that the table is stored in key order
+        keys.sort(true);
+        scanStats.rowsOut += keys.size();
+    }
+    scanStats.bytesAllocated += arena.bytesAllocated() - bytesBefore;
+}
+
+bool MergeJoinOperator::produce(ColumnBatch& batch) {
+    batch.reset(columnCount, sourceCount);
+    const auto& records = table.records;
+    while (!batch.full()) {
+        // Position the next input row at the first build row with its key
+        if (!matching) {
+            if (inputPosition >= input.selectedCount()) {
+                if (inputDone || !child->next(input)) {
+                    inputDone = true;
+                    break;
+                }
+                inputPosition = 0;
+                if (stats) {
+                    stats->rowsIn += input.selectedCount();
+                }
+                continue;
+            }
+            std::string_view key = input.columns[probeSlot][input.selection[inputPosition]];
+            if (key.empty() || !keys.searchable(key)) {
+                ++inputPosition;
+                continue;
+            }
+            // A key not below the previous one continues from where that one's matches start
+            size_t from = !previousKey.empty() && Predicate::compareValues(key, previousKey) >= 0 ? cursor : 0;
+            cursor = candidate = keys.lowerBound(key, from);
+            previousKey = key;
+            matching = true;
+        }
+
+        uint32_t row = input.selection[inputPosition];
+        std::string_view key = input.columns[probeSlot][row];
+        if (candidate >= keys.size() || Predicate::compareValues(keys.key(candidate), key) != 0) {
+            matching = false;
+            ++inputPosition;
+            continue;
+        }
+        size_t buildRow = keys.row(candidate);
+        bool equal = keys.key(candidate++) == key;
+        const auto& record = records[buildRow];
+        if (!equal || (!comparisons.empty() &&
+                       !comparisonsHold(comparisons, [&](size_t slot) { return input.columns[slot][row]; }, record))) {
+            continue;
+        }
+        appendInputRow(batch, input, row);
+        setJoinedSource(batch, source, buildRow, record, carried);
+    }
+    return batch.selectedCount() > 0;
+}
+
+BandJoinOperator::BandJoinOperator(std::unique_ptr<Operator> child, const Table& table,
+                                   const std::vector<Predicate>& predicates, const std::vector<JoinKeyFilter>& filters,
+                                   SelectPlan::JoinKind kind, const std::vector<SelectPlan::JoinComparison>& band,
+                                   bool bandOnBuild, const std::vector<SelectPlan::JoinComparison>& comparisons,
+                                   size_t source, const std::vector<PipelineColumn>& columns, size_t sourceCount,
+                                   QueryArena& arena, OperatorStats* buildStats, OperatorStats* stats)
+    : Operator(stats), child(std::move(child)), table(table), kind(kind), band(band), bandOnBuild(bandOnBuild),
+      comparisons(comparisons), source(source), columns(columns), sourceCount(sourceCount), arena(arena),
+      carried(carriedColumns(columns, source)), keys(&arena) {
+    OperatorStats ignoredStats;
+    OperatorStats& scanStats = buildStats ? *buildStats : ignoredStats;
+    size_t bytesBefore = arena.bytesAllocated();
+    {
+        OperatorTimer timer(scanStats);
+        buildRows = scanJoinedRows(table, predicates, filters, scanStats);
+        if (bandOnBuild) {
+            // Sort the joined rows on the column the band comparisons share
+            keys.reserve(buildRows.size());
+            for (size_t row : buildRows) {
+                auto it = table.records[row].find(band.front().buildColumn);
+                if (it != table.records[row].end()) {
+                    keys.add(it->second, row);
+                }
+            }
+            keys.sort();
+            if (kind == SelectPlan::JoinKind::Right || kind == SelectPlan::JoinKind::Full) {
+                buildMatched.resize(table.records.size(), false);
+            } else {
+                buildRows.clear();
+                buildRows.shrink_to_fit();
+            }
+        }
+        scanStats.rowsOut += bandOnBuild ? keys.size() : buildRows.size();
+    }
+    scanStats.bytesAllocated += arena.bytesAllocated() - bytesBefore;
+}
+
+template <typename OtherValue>
+bool BandJoinOperator::findRange(OtherValue otherValue) {
+    candidate = 0;
+    candidateEnd = keys.size();
+    exact = true;
+    for (const auto& comparison : band) {
+        std::string_view bound = otherValue(comparison);
+        if (bound.empty()) {
+            return false;
+        }
+        // A bound that cannot be placed among the keys leaves the range
+        // open; the candidates are then checked one by one
+        if (!keys.searchable(bound)) {
+            exact = false;
+            continue;
+        }
+        // Written with the sorted column first: key 'op' bound
+        Predicate::Op op = bandOnBuild ? Predicate::swapOperands(comparison.op) : comparison.op;
+        switch (op) {
+            case Predicate::Op::Greater: candidate = std::max(candidate, keys.upperBound(bound)); break;
+            case Predicate::Op::GreaterEqual: candidate = std::max(candidate, keys.lowerBound(bound)); break;
+            case Predicate::Op::Less: candidateEnd = std::min(candidateEnd, keys.lowerBound(bound)); break;
+            case Predicate::Op::LessEqual: candidateEnd = std::min(candidateEnd, keys.upperBound(bound)); break;
+            default: exact = false; break;
+        }
+    }
+    return true;
+}
+
+bool BandJoinOperator::produce(ColumnBatch& batch) {
+    batch.reset(columns.size(), sourceCount);
+    const auto& records = table.records;
+
+    // Each input row searches the sorted joined rows
+    bool keepsInput = kind == SelectPlan::JoinKind::Left || kind == SelectPlan::JoinKind::Full;
+    while (bandOnBuild && !batch.full()) {
+        if (!searching) {
+            if (position >= input.selectedCount()) {
+                if (inputDone || !child->next(input)) {
+                    inputDone = true;
+                    break;
+                }
+                position = 0;
+                if (stats) {
+                    stats->rowsIn += input.selectedCount();
+                }
+                continue;
+            }
+            uint32_t row = input.selection[position];
+            matched = false;
+            searching = findRange([&](const SelectPlan::JoinComparison& comparison) {
+                return input.columns[comparison.probeSlot][row];
+            });
+        }
+        if (!searching || candidate >= candidateEnd) {
+            searching = false;
+            if (keepsInput && !matched) {
+                appendInputRow(batch, input, input.selection[position]);
+                setNullSource(batch, source, carried);
+            }
+            ++position;
+            continue;
+        }
+
+        uint32_t row = input.selection[position];
+        size_t buildRow = keys.row(candidate++);
+        const auto& record = records[buildRow];
+        auto probeValue = [&](size_t slot) { return input.columns[slot][row]; };
+        if ((exact || comparisonsHold(band, probeValue, record)) && comparisonsHold(comparisons, probeValue, record)) {
+            matched = true;
+            if (!buildMatched.empty()) {
+                buildMatched[buildRow] = true;
+            }
+            appendInputRow(batch, input, row);
+            setJoinedSource(batch, source, buildRow, record, carried);
+        }
+    }
+    if (bandOnBuild) {
+        // Right and Full: then the joined rows no input row matched
+        while (inputDone && !buildMatched.empty() && !batch.full() && unmatchedPosition < buildRows.size()) {
+            size_t buildRow = buildRows[unmatchedPosition++];
+            if (!buildMatched[buildRow]) {
+                appendJoinedRow(batch, source, buildRow, records[buildRow], carried);
+            }
+        }
+        return batch.selectedCount() > 0;
+    }
+
+    // The input is gathered and sorted, and each joined row searches it
+    if (!gathered) {
+        inputRows = std::make_unique<PipelineRows>(columns, sourceCount, &arena);
+        while (child->next(input)) {
+            if (stats) {
+                stats->rowsIn += input.selectedCount();
+            }
+            for (uint32_t row : input.selection) {
+                size_t gatheredRow = inputRows->appendRow(input, row);
+                keys.add(inputRows->getValue(gatheredRow, band.front().probeSlot), gatheredRow);
+            }
+        }
+        keys.sort();
+        gathered = true;
+    }
+    while (!batch.full() && position < buildRows.size()) {
+        const auto& record = records[buildRows[position]];
+        if (!searching) {
+            searching = findRange([&](const SelectPlan::JoinComparison& comparison) {
+                auto it = record.find(comparison.buildColumn);
+                return it != record.end() ? std::string_view(it->second) : std::string_view();
+            });
+            if (!searching) {
+                ++position;
+                continue;
+            }
+        }
+        if (candidate >= candidateEnd) {
+            searching = false;
+            ++position;
+            continue;
+        }
+
+        size_t inputRow = keys.row(candidate++);
+        auto probeValue = [&](size_t slot) { return inputRows->getValue(inputRow, slot); };
+        if ((exact || comparisonsHold(band, probeValue, record)) && comparisonsHold(comparisons, probeValue, record)) {
+            inputRows->copyRow(inputRow, batch);
+            setJoinedSource(batch, source, buildRows[position], record, carried);
+        }
+    }
+    return batch.selectedCount() > 0;
+}
+
+AggregateOperator::AggregateOperator(std::unique_ptr<Operator> child, std::vector<size_t> groupSlots,
+                                     std::vector<Aggregate> aggregates, QueryArena& arena, OperatorStats* stats)
+    : Operator(stats), child(std::move(child)), groupSlots(std::move(groupSlots)), aggregates(std::move(aggregates)),
+      arena(arena) {}
+
+// True once an operator's own arena should spill rather than grow: its
+// next chunk (about what it holds) and the next batch would take more than
+// half of the budget left, the rest being kept for the operators above
+static bool nearBudget(const QueryArena& own, size_t batchBytes) {
+    MemoryTracker* tracker = own.getTracker();
+    return tracker && tracker->available() / 2 < 2 * own.bytesAllocated() + batchBytes;
+}
+
+// Groups a pass holds before it may spill, the partitions a spill splits
+// into, and the partition of a group key 'depth' spills deep; each depth
+// splits the keys differently
+static constexpr size_t groupsBeforeSpill = 64;
+static constexpr size_t groupPartitions = 16;
+static constexpr uint32_t noGroup = static_cast<uint32_t>(-1);
+
+static size_t groupPartition(std::string_view key, unsigned depth) {
+    uint64_t h = std::hash<std::string_view>()(key) + depth * 0x9e3779b97f4a7c15ULL;
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return h % groupPartitions;
+}
+
+std::string_view AggregateOperator::groupKey(const ColumnBatch& batch, uint32_t row, std::string& key) const {
+    // One column is its own key; several are joined, each prefixed with its length
+    if (groupSlots.size() == 1) {
+        return batch.columns[groupSlots[0]][row];
+    }
+    key.clear();
+    for (size_t slot : groupSlots) {
+        std::string_view value = batch.columns[slot][row];
+        uint32_t length = static_cast<uint32_t>(value.size());
+        key.append(reinterpret_cast<const char*>(&length), sizeof(length));
+        key.append(value);
+    }
+    return key;
+}
+
+// The group with the given key, or noGroup
+uint32_t AggregateOperator::findGroup(std::string_view key) const {
+    auto it = groups->index.find(key);
+    return it != groups->index.end() ? it->second : noGroup;
+}
+
+// A new group for the row with the given key. Group values point into the
+// records, which outlive the query; a missing value groups with the empty
+// ones (both are NULL). A pass spills only once it holds groupsBeforeSpill
+// groups, so a budget without room for those is too small to aggregate in.
+uint32_t AggregateOperator::addGroup(const ColumnBatch& batch, uint32_t row, std::string_view key) {
+    try {
+        groups->index.emplace(groupSlots.size() == 1 ? key : groups->arena.intern(key), static_cast<uint32_t>(groups->count));
+        for (size_t slot : groupSlots) {
+            std::string_view value = batch.columns[slot][row];
+            groups->values.push_back(value.data() != nullptr ? value : std::string_view(""));
+        }
+        groups->accumulators.resize(groups->accumulators.size() + aggregates.size());
+    } catch (const MemoryBudgetExceeded& e) {
+        throw MemoryBudgetExceeded("Query memory budget too small to aggregate: GROUP BY needs room for " +
+                                   std::to_string(groupsBeforeSpill) + " groups before it can spill (" + e.what() + ")");
+    }
+    return static_cast<uint32_t>(groups->count++);
+}
+
+// Add a value to a SUM or AVG, exactly while every value is an integer
+static void addNumber(int64_t& integerSum, double& sum, bool& integral, std::string_view value, const std::string& name) {
+    double number;
+    if (!ValueParser::parseDouble(value, number)) {
+        throw std::runtime_error("Cannot aggregate non-numeric value '" + std::string(value) + "' in " + name);
+    }
+    sum += number;
+    int64_t integer;
+    if (integral && ValueParser::parseLongInt(value, integer) &&
+        (integer >= 0 ? integerSum <= std::numeric_limits<int64_t>::max() - integer
+                      : integerSum >= std::numeric_limits<int64_t>::min() - integer)) {
+        integerSum += integer;
+    } else {
+        integral = false;
+    }
+}
+
+void AggregateOperator::consume() {
+    consumed = true;
+    aggregate([this](ColumnBatch& input) {
+        if (!child->next(input)) {
+            return false;
+        }
+        if (stats) {
+            stats->rowsIn += input.selectedCount();
+        }
+        return true;
+    }, 0);
+}
+
+// One aggregation pass: the rows 'nextBatch' fills in go into fresh groups,
+// or, once those come close to the budget, the rows of new groups to spill
+// files for the passes after it
+template <typename NextBatch>
+void AggregateOperator::aggregate(NextBatch nextBatch, unsigned depth) {
+    groups.reset();
+    groupsArena = std::make_unique<QueryArena>(arena.getTracker());
+    groups = std::make_unique<Groups>(*groupsArena);
+    if (groupSlots.empty()) {
+        groups->accumulators.resize(aggregates.size());
+        groups->count = 1;
+    }
+
+    ColumnBatch input;
+    std::vector<uint32_t> groupOf(ColumnBatch::capacity, 0);
+    std::string key;
+    size_t width = aggregates.size();
+    size_t groupBytes = 4 * sizeof(void*) + groupSlots.size() * sizeof(std::string_view) + width * sizeof(Accumulator);
+    std::vector<SpillFile> partitions;
+    std::vector<std::vector<char>> buffers;
+    while (nextBatch(input)) {
+        columnCount = input.columns.size();
+        sourceCount = input.rowIds.size();
+        if (!groupSlots.empty()) {
+            size_t kept = 0;
+            for (uint32_t row : input.selection) {
+                std::string_view lookupKey = groupKey(input, row, key);
+                groupOf[row] = findGroup(lookupKey);
+                if (groupOf[row] == noGroup && partitions.empty()) {
+                    if (groups->count >= groupsBeforeSpill && nearBudget(*groupsArena, groupBytes)) {
+                        partitions.resize(groupPartitions);
+                        buffers.resize(groupPartitions);
+                    } else {
+                        groupOf[row] = addGroup(input, row, lookupKey);
+                    }
+                }
+                if (groupOf[row] != noGroup) {
+                    input.selection[kept++] = row;
+                    continue;
+                }
+                std::vector<char>& buffer = buffers[groupPartition(lookupKey, depth)];
+                writeSpilledRow(buffer, input, row);
+                if (buffer.size() >= spillBufferBytes) {
+                    partitions[groupPartition(lookupKey, depth)].write(buffer.data(), buffer.size());
+                    buffer.clear();
+                }
+            }
+            input.selection.resize(kept);
+        }
+
+        // One aggregate at a time over the whole batch
+        for (size_t a = 0; a < aggregates.size(); ++a) {
+            const Aggregate& aggregate = aggregates[a];
+            Accumulator* states = groups->accumulators.data() + a;
+            if (aggregate.slot == SelectPlan::noSlot) {
+                for (uint32_t row : input.selection) {
+                    ++states[groupOf[row] * width].count;
+                }
+                continue;
+            }
+            const std::string_view* values = input.columns[aggregate.slot].data();
+            for (uint32_t row : input.selection) {
+                std::string_view value = values[row];
+                if (value.empty()) {
+                    continue; // NULL
+                }
+                Accumulator& state = states[groupOf[row] * width];
+                switch (aggregate.function) {
+                    case AggregateSpec::Function::Count:
+                        break;
+                    case AggregateSpec::Function::Sum:
+                    case AggregateSpec::Function::Avg:
+                        addNumber(state.integerSum, state.sum, state.integral, value, aggregate.name);
+                        break;
+                    case AggregateSpec::Function::Min:
+                        if (state.count == 0 || Predicate::compareValues(value, state.extreme) < 0) {
+                            state.extreme = value;
+                        }
+                        break;
+                    case AggregateSpec::Function::Max:
+                        if (state.count == 0 || Predicate::compareValues(value, state.extreme) > 0) {
+                            state.extreme = value;
+                        }
+                        break;
+                }
+                ++state.count;
+            }
+        }
+    }
+
+    for (size_t partition = 0; partition < partitions.size(); ++partition) {
+        partitions[partition].write(buffers[partition].data(), buffers[partition].size());
+        if (partitions[partition].size() == 0) {
+            continue;
+        }
+        if (stats) {
+            stats->bytesSpilled += partitions[partition].size();
+        }
+        spilled.push_back({std::move(partitions[partition]), depth + 1});
+    }
+}
+
+std::string_view AggregateOperator::result(const Aggregate& aggregate, const Accumulator& accumulator) {
+    if (aggregate.function == AggregateSpec::Function::Count) {
+        return arena.intern(std::to_string(accumulator.count));
+    }
+    if (accumulator.count == 0) {
+        return ""; // NULL
+    }
+    switch (aggregate.function) {
+        case AggregateSpec::Function::Sum:
+            return arena.intern(accumulator.integral ? std::to_string(accumulator.integerSum) : ValueParser::formatDouble(accumulator.sum));
+        case AggregateSpec::Function::Avg:
+            return arena.intern(ValueParser::formatDouble(accumulator.sum / accumulator.count));
+        default:
+            return accumulator.extreme;
+    }
+}
+
+bool AggregateOperator::produce(ColumnBatch& batch) {
+    if (!consumed) {
+        consume();
+    }
+
+    // The groups held, then those of each spilled partition in turn
+    while (emitted >= groups->count) {
+        if (spilled.empty()) {
+            return false;
+        }
+        SpilledRows rows = std::move(spilled.back());
+        spilled.pop_back();
+        size_t offset = 0;
+        std::vector<char> buffer;
+        aggregate([&](ColumnBatch& input) {
+            return readSpilledBatch(rows.file, offset, columnCount, sourceCount, buffer, input);
+        }, rows.depth);
+        emitted = 0;
+    }
+
+    size_t groupWidth = groupSlots.size();
+    batch.reset(groupWidth + aggregates.size(), 0);
+    while (!batch.full() && emitted < groups->count) {
+        size_t row = batch.appendRow();
+        for (size_t g = 0; g < groupWidth; ++g) {
+            batch.columns[g][row] = groups->values[emitted * groupWidth + g];
+        }
+        for (size_t a = 0; a < aggregates.size(); ++a) {
+            batch.columns[groupWidth + a][row] = result(aggregates[a], groups->accumulators[emitted * aggregates.size() + a]);
+        }
+        ++emitted;
+    }
+    return true;
+}
+
+SortOperator::SortOperator(std::unique_ptr<Operator> child, std::vector<SelectPlan::SortKey> keys, size_t limit,
+                           QueryArena& arena, OperatorStats* stats)
+    : Operator(stats), child(std::move(child)), keys(std::move(keys)), limit(limit), arena(arena),
+      rowsArena(std::make_unique<QueryArena>(arena.getTracker())), rows(std::make_unique<Rows>(rowsArena.get())) {}
+
+// Values compare as numbers when both are numbers, as strings otherwise;
+// negative when the first row goes first
+static int compareSortKeys(const std::vector<SelectPlan::SortKey>& keys, const std::string_view* valuesA,
+                           const double* numbersA, const uint8_t* numericA, const std::string_view* valuesB,
+                           const double* numbersB, const uint8_t* numericB) {
+    for (size_t k = 0; k < keys.size(); ++k) {
+        int comparison;
+        if (numericA[k] && numericB[k]) {
+            comparison = numbersA[k] < numbersB[k] ? -1 : numbersB[k] < numbersA[k] ? 1 : 0;
+        } else {
+            int result = valuesA[keys[k].slot].compare(valuesB[keys[k].slot]);
+            comparison = result < 0 ? -1 : result > 0 ? 1 : 0;
+        }
+        if (comparison != 0) {
+            return keys[k].descending ? -comparison : comparison;
+        }
+    }
+    return 0;
+}
+
+// Ties keep the input order
+bool SortOperator::before(uint32_t a, uint32_t b) const {
+    size_t keyCount = keys.size();
+    int comparison = compareSortKeys(keys, rows->values.data() + a * columnCount, rows->numbers.data() + a * keyCount,
+                                     rows->numeric.data() + a * keyCount, rows->values.data() + b * columnCount,
+                                     rows->numbers.data() + b * keyCount, rows->numeric.data() + b * keyCount);
+    return comparison != 0 ? comparison < 0 : a < b;
+}
+
+// Cut the buffer back to the 'limit' best rows, keeping their input order.
+// They move to a fresh arena, which lets go of what the old one grew to.
+void SortOperator::keepBest() {
+    std::pmr::vector<uint32_t>& order = rows->order;
+    order.resize(rows->count);
+    std::iota(order.begin(), order.end(), 0);
+    auto by = [this](uint32_t a, uint32_t b) { return before(a, b); };
+    std::nth_element(order.begin(), order.begin() + (limit - 1), order.end(), by);
+    order.resize(limit);
+    std::sort(order.begin(), order.end());
+
+    size_t keyCount = keys.size();
+    auto keptArena = std::make_unique<QueryArena>(arena.getTracker());
+    auto kept = std::make_unique<Rows>(keptArena.get());
+    for (size_t row : order) {
+        kept->rowIds.insert(kept->rowIds.end(), rows->rowIds.begin() + row * sourceCount,
+                            rows->rowIds.begin() + (row + 1) * sourceCount);
+        kept->values.insert(kept->values.end(), rows->values.begin() + row * columnCount,
+                            rows->values.begin() + (row + 1) * columnCount);
+        kept->numbers.insert(kept->numbers.end(), rows->numbers.begin() + row * keyCount,
+                             rows->numbers.begin() + (row + 1) * keyCount);
+        kept->numeric.insert(kept->numeric.end(), rows->numeric.begin() + row * keyCount,
+                             rows->numeric.begin() + (row + 1) * keyCount);
+    }
+    kept->count = limit;
+    rows = std::move(kept);
+    rowsArena = std::move(keptArena);
+}
+
+// Put the buffered rows in order, only the first 'limit' of them
+void SortOperator::orderRows() {
+    std::pmr::vector<uint32_t>& order = rows->order;
+    order.resize(rows->count);
+    std::iota(order.begin(), order.end(), 0);
+    auto by = [this](uint32_t a, uint32_t b) { return before(a, b); };
+    if (limit < rows->count) {
+        std::partial_sort(order.begin(), order.begin() + limit, order.end(), by);
+        order.resize(limit);
+    } else {
+        std::sort(order.begin(), order.end(), by);
+    }
+}
+
+// A run row: its row ids, values, parsed keys and which keys are numbers
+size_t SortOperator::runRowBytes() const {
+    return sourceCount * sizeof(size_t) + columnCount * sizeof(std::string_view) +
+           keys.size() * (sizeof(double) + sizeof(uint8_t));
+}
+
+// Sort the buffer out to a run and start a new one. Values are written as
+// views, which stay valid for the whole query.
+void SortOperator::writeRun() {
+    orderRows();
+    size_t keyCount = keys.size();
+    Run run;
+    std::vector<char> buffer;
+    auto append = [&buffer](const void* data, size_t bytes) {
+        const char* begin = static_cast<const char*>(data);
+        buffer.insert(buffer.end(), begin, begin + bytes);
+    };
+    for (uint32_t row : rows->order) {
+        append(rows->rowIds.data() + row * sourceCount, sourceCount * sizeof(size_t));
+        append(rows->values.data() + row * columnCount, columnCount * sizeof(std::string_view));
+        append(rows->numbers.data() + row * keyCount, keyCount * sizeof(double));
+        append(rows->numeric.data() + row * keyCount, keyCount * sizeof(uint8_t));
+        if (buffer.size() >= spillBufferBytes) {
+            run.file.write(buffer.data(), buffer.size());
+            buffer.clear();
+        }
+    }
+    run.file.write(buffer.data(), buffer.size());
+    if (stats) {
+        stats->bytesSpilled += run.file.size();
+    }
+    runs.push_back(std::move(run));
+
+    rows.reset();
+    rowsArena = std::make_unique<QueryArena>(arena.getTracker());
+    rows = std::make_unique<Rows>(rowsArena.get());
+}
+
+// Decode the next row of a run, reading a few hundred rows at a time;
+// false once the run is done
+bool SortOperator::nextRunRow(Run& run) {
+    size_t rowBytes = runRowBytes();
+    if (run.position >= run.rows.size()) {
+        if (run.offset >= run.file.size()) {
+            return false;
+        }
+        run.rows.resize(std::min<size_t>(256 * rowBytes, run.file.size() - run.offset));
+        run.file.read(run.offset, run.rows.data(), run.rows.size());
+        run.offset += run.rows.size();
+        run.position = 0;
+    }
+
+    size_t keyCount = keys.size();
+    run.rowIds.resize(sourceCount);
+    run.values.resize(columnCount);
+    run.numbers.resize(keyCount);
+    run.numeric.resize(keyCount);
+    const char* bytes = run.rows.data() + run.position;
+    std::memcpy(run.rowIds.data(), bytes, sourceCount * sizeof(size_t));
+    bytes += sourceCount * sizeof(size_t);
+    std::memcpy(static_cast<void*>(run.values.data()), bytes, columnCount * sizeof(std::string_view));
+    bytes += columnCount * sizeof(std::string_view);
+    std::memcpy(run.numbers.data(), bytes, keyCount * sizeof(double));
+    bytes += keyCount * sizeof(double);
+    std::memcpy(run.numeric.data(), bytes, keyCount * sizeof(uint8_t));
+    run.position += rowBytes;
+    return true;
+}
+
+// Ties go to the earlier run, which holds the earlier input
+bool SortOperator::runBefore(size_t a, size_t b) const {
+    const Run& x = runs[a];
+    const Run& y = runs[b];
+    int comparison = compareSortKeys(keys, x.values.data(), x.numbers.data(), x.numeric.data(), y.values.data(),
+                                     y.numbers.data(), y.numeric.data());
+    return comparison != 0 ? comparison < 0 : a < b;
+}
+
+void SortOperator::sortInput() {
+    sorted = true;
+    ColumnBatch input;
+    while (child->next(input)) {
+        if (stats) {
+            stats->rowsIn += input.selectedCount();
+        }
+        columnCount = input.columns.size();
+        sourceCount = input.rowIds.size();
+        // Growing the vectors may double them, so room is kept for twice the batch
+        if (rows->count > 0 && nearBudget(*rowsArena, 2 * input.selectedCount() * runRowBytes())) {
+            writeRun();
+        }
+        for (uint32_t row : input.selection) {
+            for (size_t source = 0; source < sourceCount; ++source) {
+                rows->rowIds.push_back(input.rowIds[source][row]);
+            }
+            for (size_t column = 0; column < columnCount; ++column) {
+                rows->values.push_back(input.columns[column][row]);
+            }
+            // Keys are parsed once here rather than in every comparison
+            for (const auto& key : keys) {
+                double number = 0.0;
+                rows->numeric.push_back(ValueParser::parseDouble(input.columns[key.slot][row], number));
+                rows->numbers.push_back(number);
+            }
+            ++rows->count;
+        }
+        if (limit > 0 && limit < rows->count && rows->count >= 2 * std::max(limit, ColumnBatch::capacity / 2)) {
+            keepBest();
+        }
+    }
+
+    if (runs.empty()) {
+        orderRows();
+        return;
+    }
+    if (rows->count > 0) {
+        writeRun();
+    }
+    auto after = [this](size_t a, size_t b) { return runBefore(b, a); };
+    for (size_t run = 0; run < runs.size(); ++run) {
+        if (nextRunRow(runs[run])) {
+            merging.push_back(run);
+        }
+    }
+    std::make_heap(merging.begin(), merging.end(), after);
+}
+
+bool SortOperator::produce(ColumnBatch& batch) {
+    if (!sorted) {
+        sortInput();
+    }
+
+    if (runs.empty()) {
+        const std::pmr::vector<uint32_t>& order = rows->order;
+        if (emitted >= order.size()) {
+            return false;
+        }
+        batch.reset(columnCount, sourceCount);
+        while (!batch.full() && emitted < order.size()) {
+            size_t row = order[emitted++];
+            size_t position = batch.appendRow();
+            for (size_t source = 0; source < sourceCount; ++source) {
+                batch.rowIds[source][position] = rows->rowIds[row * sourceCount + source];
+            }
+            for (size_t column = 0; column < columnCount; ++column) {
+                batch.columns[column][position] = rows->values[row * columnCount + column];
+            }
+        }
+        return true;
+    }
+
+    // Merge the runs: take the first row among their next rows, then move
+    // that run on
+    if (merging.empty() || emitted >= limit) {
+        return false;
+    }
+    auto after = [this](size_t a, size_t b) { return runBefore(b, a); };
+    batch.reset(columnCount, sourceCount);
+    while (!batch.full() && !merging.empty() && emitted < limit) {
+        std::pop_heap(merging.begin(), merging.end(), after);
+        Run& run = runs[merging.back()];
+        size_t position = batch.appendRow();
+        for (size_t source = 0; source < sourceCount; ++source) {
+            batch.rowIds[source][position] = run.rowIds[source];
+        }
+        for (size_t column = 0; column < columnCount; ++column) {
+            batch.columns[column][position] = run.values[column];
+        }
+        ++emitted;
+        if (nextRunRow(run)) {
+            std::push_heap(merging.begin(), merging.end(), after);
+        } else {
+            merging.pop_back();
+        }
+    }
+    return true;
+}
+
+LimitOperator::LimitOperator(std::unique_ptr<Operator> child, size_t limit, OperatorStats* stats)
+    : Operator(stats), child(std::move(child)), remaining(limit) {}
+
+bool LimitOperator::produce(ColumnBatch& batch) {
+    if (remaining == 0 || !child->next(batch)) {
+        return false;
+    }
+    if (stats) {
+        stats->rowsIn += batch.selectedCount();
+    }
+    if (batch.selectedCount() > remaining) {
+        batch.selection.resize(remaining);
+    }
+    remaining -= batch.selectedCount();
+    return true;
+}
+
+ProjectOperator::ProjectOperator(std::unique_ptr<Operator> child, const std::vector<SelectPlan::OutputColumn>& outputs,
+                                 const std::vector<Table*>& sources, OperatorStats* stats)
+    : Operator(stats), child(std::move(child)), outputs(outputs), sources(sources) {}
+
+bool ProjectOperator::produce(ColumnBatch& batch) {
+    if (!child->next(input)) {
+        return false;
+    }
+    if (stats) {
+        stats->rowsIn += input.selectedCount();
+    }
+
+    size_t count = input.selectedCount();
+    batch.reset(outputs.size(), 0);
+    for (size_t i = 0; i < count; ++i) {
+        batch.appendRow();
+    }
+    for (size_t o = 0; o < outputs.size(); ++o) {
+        const SelectPlan::OutputColumn& output = outputs[o];
+        std::string_view* values = batch.columns[o].data();
+        if (output.slot != SelectPlan::noSlot) {
+            const std::string_view* aggregated = input.columns[output.slot].data();
+            for (size_t i = 0; i < count; ++i) {
+                values[i] = aggregated[input.selection[i]];
+            }
+        } else {
+            const auto& records = sources[output.source]->records;
+            const std::vector<size_t>& ids = input.rowIds[output.source];
+            for (size_t i = 0; i < count; ++i) {
+                size_t id = ids[input.selection[i]];
+                if (id == ColumnBatch::noRow) {
+                    values[i] = std::string_view(""); // NULL-extended by an outer join
+                    continue;
+                }
+                const auto& record = records[id];
+                auto it = record.find(output.column);
+                values[i] = it != record.end() ? std::string_view(it->second) : std::string_view();
+            }
+        }
+        if (output.required) {
+            for (size_t i = 0; i < count; ++i) {
+                if (values[i].data() == nullptr) {
+                    throw std::invalid_argument("Field not found: " + output.name);
+                }
+            }
+        }
+    }
+    return true;
+}
+
+ResultSink::ResultSink(std::vector<std::string> names, MemoryTracker* memory)
+    : names(std::move(names)), memory(memory) {}
+
+void ResultSink::run(Operator& root) {
+    ColumnBatch batch;
+    while (root.next(batch)) {
+        for (uint32_t row : batch.selection) {
+            std::map<std::string, std::string> record;
+            for (size_t column = 0; column < names.size(); ++column) {
+                std::string_view value = batch.columns[column][row];
+                if (value.data() != nullptr) {
+                    record.emplace_hint(record.end(), names[column], value);
+                }
+            }
+            if (memory) {
+                try {
+                    memory->consume(estimateRecordBytes(record));
+                } catch (const MemoryBudgetExceeded& e) {
+                    // Unlike the operators, the result cannot spill
+                    throw MemoryBudgetExceeded("Query memory budget too small for the result: " +
+                                               std::to_string(rows.size()) + " rows fit (" + e.what() + ")");
+                }
+            }
+            rows.push_back(std::move(record));
+        }
+    }
+}
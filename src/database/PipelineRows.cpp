@@ -0,0 +1,67 @@
+#include "../../include/database/PipelineRows.h"
+
+PipelineRows::PipelineRows(const std::vector<PipelineColumn>& columns, size_t sourceCount,
+                           std::pmr::memory_resource* resource)
+    : columns(&columns), sourceCount(sourceCount), rowIds(resource), values(resource) {}
+
+void PipelineRows::reserve(size_t rows) {
+    rowIds.reserve(rows * sourceCount);
+    values.reserve(rows * columns->size());
+}
+
+size_t PipelineRows::appendRow() {
+    rowIds.resize(rowIds.size() + sourceCount, noRow);
+    values.resize(values.size() + columns->size());
+    return rowCount++;
+}
+
+size_t PipelineRows::appendRow(const PipelineRows& other, size_t row) {
+    auto idsBegin = other.rowIds.begin() + row * sourceCount;
+    rowIds.insert(rowIds.end(), idsBegin, idsBegin + sourceCount);
+    auto valuesBegin = other.values.begin() + row * columns->size();
+    values.insert(values.end(), valuesBegin, valuesBegin + columns->size());
+    return rowCount++;
+}
+
+size_t PipelineRows::appendRow(const ColumnBatch& batch, size_t row) {
+    for (size_t source = 0; source < sourceCount; ++source) {
+        rowIds.push_back(batch.rowIds[source][row]);
+    }
+    for (size_t column = 0; column < columns->size(); ++column) {
+        values.push_back(batch.columns[column][row]);
+    }
+    return rowCount++;
+}
+
+void PipelineRows::copyRow(size_t row, ColumnBatch& batch) const {
+    size_t position = batch.appendRow();
+    for (size_t source = 0; source < sourceCount; ++source) {
+        batch.rowIds[source][position] = getRowId(row, source);
+    }
+    for (size_t column = 0; column < columns->size(); ++column) {
+        batch.columns[column][position] = getValue(row, column);
+    }
+}
+
+void PipelineRows::setSource(size_t row, size_t source, size_t rowId, const std::map<std::string, std::string>& record) {
+    rowIds[row * sourceCount + source] = rowId;
+    std::string_view* rowValues = values.data() + row * columns->size();
+    for (size_t i = 0; i < columns->size(); ++i) {
+        const PipelineColumn& column = (*columns)[i];
+        if (column.source != source) {
+            continue;
+        }
+        auto it = record.find(column.column);
+        rowValues[i] = it != record.end() ? std::string_view(it->second) : std::string_view();
+    }
+}
+
+void PipelineRows::setNullSource(size_t row, size_t source) {
+    rowIds[row * sourceCount + source] = noRow;
+    std::string_view* rowValues = values.data() + row * columns->size();
+    for (size_t i = 0; i < columns->size(); ++i) {
+        if ((*columns)[i].source == source) {
+            rowValues[i] = std::string_view("");
+        }
+    }
+}
@@ -0,0 +1,270 @@
+#include "../../include/database/Predicate.h"
+#include "../../include/database/ValueParser.h"
+#include <charconv>
+#include <cmath>
+#include <functional>
+#include <stdexcept>
+#include <unordered_set>
+
+static Predicate::Op parseOp(const std::string& op) {
+    if (op == "=" || op == "==") return Predicate::Op::Equal;
+    if (op == "!=" || op == "<>") return Predicate::Op::NotEqual;
+    if (op == "<") return Predicate::Op::Less;
+    if (op == ">") return Predicate::Op::Greater;
+    if (op == "<=") return Predicate::Op::LessEqual;
+    if (op == ">=") return Predicate::Op::GreaterEqual;
+    if (op == "LIKE") return Predicate::Op::Like;
+    if (op == "IN") return Predicate::Op::In;
+    if (op == "BETWEEN") return Predicate::Op::Between;
+    throw std::runtime_error("Unsupported operator in condition: " + op);
+}
+
+// The values of an IN list. A value that parses as a number can only equal
+// the numbers of the list, and any other value only its other strings.
+struct Predicate::ValueSet {
+    std::unordered_set<double> numbers;
+    std::vector<std::string> text;                  // Holds what 'strings' points to
+    std::unordered_set<std::string_view> strings;
+};
+
+Predicate::Predicate(const SQLParser::Condition& condition)
+    : field(condition.field), op(parseOp(condition.op)), operand(condition.value), number(0.0),
+      upperNumber(0.0), orRelation(condition.relation == "OR") {
+    if (condition.subquery) {
+        throw std::runtime_error("A subquery can only be used in the WHERE clause of a SELECT: " + operand);
+    }
+    numeric = op != Op::Like && op != Op::In && ValueParser::parseDouble(operand, number);
+    if (op == Op::Equal) {
+        equalityKeys.push_back(equalityKey(operand));
+    } else if (op == Op::Like) {
+        pattern = std::make_shared<const LikePattern>(operand);
+    } else if (op == Op::In) {
+        if (condition.values.empty()) {
+            throw std::runtime_error("Empty IN list for " + field);
+        }
+        auto values = std::make_shared<ValueSet>();
+        values->text.reserve(condition.values.size());
+        for (const auto& value : condition.values) {
+            double parsed;
+            if (!ValueParser::parseDouble(value, parsed)) {
+                values->text.push_back(value);
+                values->strings.insert(values->text.back());
+            } else if (!std::isnan(parsed)) {
+                values->numbers.insert(parsed == 0.0 ? 0.0 : parsed); // -0 equals 0
+            }
+        }
+        for (double value : values->numbers) {
+            char buffer[32];
+            auto [end, ec] = std::to_chars(buffer, buffer + sizeof(buffer), value);
+            equalityKeys.push_back("n" + std::string(buffer, end));
+        }
+        for (std::string_view value : values->strings) {
+            equalityKeys.push_back("s" + std::string(value));
+        }
+        numeric = !values->numbers.empty();
+        inValues = std::move(values);
+    } else if (op == Op::Between) {
+        if (condition.values.size() != 2) {
+            throw std::runtime_error("BETWEEN needs a lower and an upper bound for " + field);
+        }
+        operand = condition.values[0];
+        upperOperand = condition.values[1];
+        numeric = ValueParser::parseDouble(operand, number) && ValueParser::parseDouble(upperOperand, upperNumber);
+    }
+}
+
+std::vector<Predicate> Predicate::compile(const std::vector<SQLParser::Condition>& conditions) {
+    std::vector<Predicate> predicates;
+    predicates.reserve(conditions.size());
+    for (size_t i = 0; i < conditions.size(); ++i) {
+        const std::string& relation = conditions[i].relation;
+        if (i > 0 && relation != "AND" && relation != "OR") {
+            throw std::runtime_error("Unknown condition relation: " + relation);
+        }
+        predicates.emplace_back(conditions[i]);
+    }
+    return predicates;
+}
+
+template <typename T>
+bool Predicate::holds(const T& lhs, const T& rhs) const {
+    switch (op) {
+        case Op::Equal: return lhs == rhs;
+        case Op::NotEqual: return lhs != rhs;
+        case Op::Less: return lhs < rhs;
+        case Op::Greater: return lhs > rhs;
+        case Op::LessEqual: return lhs <= rhs;
+        case Op::GreaterEqual: return lhs >= rhs;
+        case Op::Like:
+        case Op::In:
+        case Op::Between:
+            break; // Not comparisons; see matches
+    }
+    return false;
+}
+
+bool Predicate::inList(std::string_view value) const {
+    double parsed;
+    if (!inValues->numbers.empty() && ValueParser::parseDouble(value, parsed)) {
+        return inValues->numbers.count(parsed) > 0;
+    }
+    // A number cannot equal a string of the list, so lists of strings skip parsing
+    return !inValues->strings.empty() && inValues->strings.count(value) > 0;
+}
+
+bool Predicate::inRange(std::string_view value) const {
+    double parsed;
+    if (numeric && ValueParser::parseDouble(value, parsed)) {
+        return parsed >= number && parsed <= upperNumber;
+    }
+    return value >= std::string_view(operand) && value <= std::string_view(upperOperand);
+}
+
+bool Predicate::matches(std::string_view value) const {
+    if (op == Op::Like) {
+        return pattern->matches(value);
+    }
+    if (op == Op::In) {
+        return inList(value);
+    }
+    if (op == Op::Between) {
+        return inRange(value);
+    }
+    double lhs;
+    if (numeric && ValueParser::parseDouble(value, lhs)) {
+        return holds(lhs, number);
+    }
+    return holds(value, std::string_view(operand));
+}
+
+template <typename Compare>
+bool Predicate::matchRowsWith(Compare compare, const std::string_view* values, const uint32_t* rows, size_t count,
+                              uint8_t* matches) const {
+    std::string_view text(operand);
+    for (size_t i = 0; i < count; ++i) {
+        std::string_view value = values[rows[i]];
+        if (value.data() == nullptr) {
+            return false;
+        }
+        double lhs;
+        matches[rows[i]] = numeric && ValueParser::parseDouble(value, lhs) ? compare(lhs, number) : compare(value, text);
+    }
+    return true;
+}
+
+bool Predicate::matchRows(const std::string_view* values, const uint32_t* rows, size_t count, uint8_t* matches) const {
+    switch (op) {
+        case Op::Equal: return matchRowsWith(std::equal_to<>(), values, rows, count, matches);
+        case Op::NotEqual: return matchRowsWith(std::not_equal_to<>(), values, rows, count, matches);
+        case Op::Less: return matchRowsWith(std::less<>(), values, rows, count, matches);
+        case Op::Greater: return matchRowsWith(std::greater<>(), values, rows, count, matches);
+        case Op::LessEqual: return matchRowsWith(std::less_equal<>(), values, rows, count, matches);
+        case Op::GreaterEqual: return matchRowsWith(std::greater_equal<>(), values, rows, count, matches);
+        case Op::Like:
+        case Op::In:
+        case Op::Between:
+            break;
+    }
+
+    // LIKE, IN and BETWEEN test each value as a whole
+    for (size_t i = 0; i < count; ++i) {
+        std::string_view value = values[rows[i]];
+        if (value.data() == nullptr) {
+            return false;
+        }
+        matches[rows[i]] = op == Op::Like ? pattern->matches(value) : op == Op::In ? inList(value) : inRange(value);
+    }
+    return true;
+}
+
+int Predicate::compareValues(std::string_view lhs, std::string_view rhs) {
+    double left, right;
+    if (ValueParser::parseDouble(lhs, left) && ValueParser::parseDouble(rhs, right)) {
+        return left < right ? -1 : right < left ? 1 : 0;
+    }
+    return lhs.compare(rhs) < 0 ? -1 : lhs.compare(rhs) > 0 ? 1 : 0;
+}
+
+Predicate::Op Predicate::swapOperands(Op op) {
+    switch (op) {
+        case Op::Less: return Op::Greater;
+        case Op::Greater: return Op::Less;
+        case Op::LessEqual: return Op::GreaterEqual;
+        case Op::GreaterEqual: return Op::LessEqual;
+        default: return op;
+    }
+}
+
+std::string Predicate::equalityKey(std::string_view value) {
+    // Tagged so that a string never collides with a number's key
+    double number;
+    if (!ValueParser::parseDouble(value, number)) {
+        return "s" + std::string(value);
+    }
+    if (number == 0.0) {
+        number = 0.0; // -0 equals 0
+    }
+    char buffer[32];
+    auto [end, ec] = std::to_chars(buffer, buffer + sizeof(buffer), number);
+    return "n" + std::string(buffer, end);
+}
+
+bool Predicate::hasEqualityKey() const {
+    return (op == Op::Equal && !(numeric && std::isnan(number))) || op == Op::In;
+}
+
+// Could some x with min <= x <= max satisfy "x op bound"?
+template <typename T>
+static bool rangeMayMatch(Predicate::Op op, const T& min, const T& max, const T& bound) {
+    switch (op) {
+        case Predicate::Op::Equal: return !(bound < min) && !(max < bound);
+        case Predicate::Op::NotEqual: return !(min == bound && max == bound);
+        case Predicate::Op::Less: return min < bound;
+        case Predicate::Op::Greater: return bound < max;
+        case Predicate::Op::LessEqual: return !(bound < min);
+        case Predicate::Op::GreaterEqual: return !(max < bound);
+        case Predicate::Op::Like:
+        case Predicate::Op::In:
+        case Predicate::Op::Between:
+            break; // Handled by the callers
+    }
+    return true;
+}
+
+bool Predicate::mayMatchNumbers(double min, double max) const {
+    if (op == Op::In) {
+        for (double value : inValues->numbers) {
+            if (!(value < min) && !(max < value)) {
+                return true;
+            }
+        }
+        return false;
+    }
+    if (op == Op::Between) {
+        return !(max < number) && !(upperNumber < min);
+    }
+    return rangeMayMatch(op, min, max, number);
+}
+
+bool Predicate::mayMatchStrings(std::string_view min, std::string_view max) const {
+    if (op == Op::In) {
+        for (std::string_view value : inValues->strings) {
+            if (!(value < min) && !(max < value)) {
+                return true;
+            }
+        }
+        return false;
+    }
+    if (op == Op::Like) {
+        // Every match lies in [prefix, the prefix's successor)
+        const std::string& prefix = pattern->getPrefix();
+        if (max.compare(0, prefix.size(), prefix) < 0) {
+            return false;
+        }
+        return min.compare(0, prefix.size(), prefix) <= 0;
+    }
+    if (op == Op::Between) {
+        return !(max < std::string_view(operand)) && !(std::string_view(upperOperand) < min);
+    }
+    return rangeMayMatch(op, min, max, std::string_view(operand));
+}
@@ -0,0 +1,34 @@
+#include "../../include/database/QueryArena.h"
+#include <cstring>
+
+QueryArena::QueryArena(MemoryTracker* tracker)
+    : upstream(tracker), buffer(initialBuffer, sizeof(initialBuffer), &upstream) {}
+
+void* QueryArena::do_allocate(size_t bytes, size_t alignment) {
+    allocated += bytes;
+    return buffer.allocate(bytes, alignment);
+}
+
+void QueryArena::do_deallocate(void* p, size_t bytes, size_t alignment) {
+    // Monotonic: memory is only reclaimed when the arena is destroyed
+    buffer.deallocate(p, bytes, alignment);
+}
+
+bool QueryArena::do_is_equal(const std::pmr::memory_resource& other) const noexcept {
+    return this == &other;
+}
+
+std::string_view QueryArena::intern(std::string_view value) {
+    char* data = static_cast<char*>(allocate(value.size(), 1));
+    std::memcpy(data, value.data(), value.size());
+    return std::string_view(data, value.size());
+}
+
+std::string_view QueryArena::qualify(std::string_view table, std::string_view column) {
+    size_t length = table.size() + 1 + column.size();
+    char* data = static_cast<char*>(allocate(length, 1));
+    std::memcpy(data, table.data(), table.size());
+    data[table.size()] = '.';
+    std::memcpy(data + table.size() + 1, column.data(), column.size());
+    return std::string_view(data, length);
+}
@@ -0,0 +1,254 @@
+#include "../../include/database/QueryLog.h"
+#include "../../include/database/JsonLine.h"
+#include "../../include/database/Metrics.h"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <iomanip>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+QueryLogWriter::QueryLogWriter(const std::string& path) : file(path, std::ios::app) {
+    if (!file) {
+        throw std::runtime_error("Unable to open query log: " + path);
+    }
+}
+
+void QueryLogWriter::append(const QueryLogEntry& entry) {
+    std::string line = QueryLog::toJson(entry);
+    std::lock_guard<std::mutex> lock(mutex);
+    file << line << '\n';
+    file.flush();
+}
+
+std::string QueryLog::toJson(const QueryLogEntry& entry) {
+    std::ostringstream out;
+    out << "{\"ts\":" << entry.timestampMicros
+        << ",\"type\":";
+    writeJsonString(out, entry.type);
+    out << ",\"duration_ns\":" << entry.durationNanos
+        << ",\"rows\":" << entry.rowsAffected
+        << ",\"sql\":";
+    writeJsonString(out, entry.statement);
+    if (!entry.error.empty()) {
+        out << ",\"error\":";
+        writeJsonString(out, entry.error);
+    }
+    out << "}";
+    return out.str();
+}
+
+QueryLogEntry QueryLog::fromJson(const std::string& line) {
+    QueryLogEntry entry;
+    JsonLineReader reader(line);
+    reader.expect('{');
+    if (reader.consume('}')) {
+        return entry;
+    }
+    do {
+        std::string key = reader.readString();
+        reader.expect(':');
+        if (reader.peekString()) {
+            std::string value = reader.readString();
+            if (key == "type") {
+                entry.type = value;
+            } else if (key == "sql") {
+                entry.statement = value;
+            } else if (key == "error") {
+                entry.error = value;
+            }
+        } else {
+            int64_t value = reader.readInteger();
+            if (key == "ts") {
+                entry.timestampMicros = value;
+            } else if (key == "duration_ns") {
+                entry.durationNanos = static_cast<uint64_t>(value);
+            } else if (key == "rows") {
+                entry.rowsAffected = static_cast<size_t>(value);
+            }
+        }
+    } while (reader.consume(','));
+    reader.expect('}');
+    return entry;
+}
+
+std::vector<QueryLogEntry> QueryLog::read(const std::string& path) {
+    std::ifstream file(path);
+    if (!file) {
+        throw std::runtime_error("Unable to open query log: " + path);
+    }
+
+    std::vector<QueryLogEntry> entries;
+    std::string line;
+    size_t lineNumber = 0;
+    while (std::getline(file, line)) {
+        ++lineNumber;
+        if (line.find_first_not_of(" \t\r") == std::string::npos) {
+            continue;
+        }
+        try {
+            entries.push_back(fromJson(line));
+        } catch (const std::exception& e) {
+            throw std::runtime_error(path + ":" + std::to_string(lineNumber) + ": " + e.what());
+        }
+    }
+    return entries;
+}
+
+std::string QueryLog::normalize(const std::string& statement) {
+    std::string shape;
+    for (size_t i = 0; i < statement.size();) {
+        char c = statement[i];
+        char previous = shape.empty() ? ' ' : shape.back();
+        if (c == '\'' || c == '"') {
+            // Quoted literal
+            size_t end = statement.find(c, i + 1);
+            i = end == std::string::npos ? statement.size() : end + 1;
+            shape += '?';
+        } else if (std::isdigit(static_cast<unsigned char>(c)) &&
+                   !(std::isalnum(static_cast<unsigned char>(previous)) || previous == '_' || previous == '.')) {
+            // Numeric literal (digits inside identifiers such as T1.COL2 are kept)
+            while (i < statement.size() && (std::isdigit(static_cast<unsigned char>(statement[i])) || statement[i] == '.')) {
+                ++i;
+            }
+            shape += '?';
+        } else if (std::isspace(static_cast<unsigned char>(c))) {
+            if (previous != ' ') {
+                shape += ' ';
+            }
+            ++i;
+        } else {
+            shape += c;
+            ++i;
+        }
+    }
+
+    // Trailing whitespace and semicolon are not part of the shape
+    while (!shape.empty() && (shape.back() == ' ' || shape.back() == ';')) {
+        shape.pop_back();
+    }
+    shape.erase(0, shape.find_first_not_of(' '));
+    return shape;
+}
+
+void QueryLog::replay(const std::function<size_t(const std::string&)>& execute, const std::vector<QueryLogEntry>& entries,
+                      bool preservePacing, std::ostream& report) {
+    std::map<std::string, std::unique_ptr<LatencyHistogram>> replayed;
+    std::map<std::string, std::unique_ptr<LatencyHistogram>> original;
+    size_t errors = 0;
+    size_t originalErrors = 0;
+    size_t outcomeMismatches = 0;
+
+    auto replayStart = std::chrono::steady_clock::now();
+    for (const QueryLogEntry& entry : entries) {
+        if (preservePacing) {
+            std::chrono::microseconds offset(entry.timestampMicros - entries.front().timestampMicros);
+            std::this_thread::sleep_until(replayStart + offset);
+        }
+
+        std::string error;
+        size_t rowsAffected = 0;
+        auto start = std::chrono::steady_clock::now();
+        try {
+            rowsAffected = execute(entry.statement);
+        } catch (const std::exception& e) {
+            error = e.what();
+        }
+        auto elapsed = std::chrono::steady_clock::now() - start;
+
+        auto& replayedHistogram = replayed[entry.type];
+        auto& originalHistogram = original[entry.type];
+        if (!replayedHistogram) {
+            replayedHistogram = std::make_unique<LatencyHistogram>();
+            originalHistogram = std::make_unique<LatencyHistogram>();
+        }
+        replayedHistogram->record(elapsed);
+        originalHistogram->record(entry.durationNanos);
+
+        errors += !error.empty();
+        originalErrors += !entry.error.empty();
+        // A replay against a faithful snapshot fails and succeeds where the original did, touching as many rows
+        if (error.empty() != entry.error.empty() || (error.empty() && rowsAffected != entry.rowsAffected)) {
+            ++outcomeMismatches;
+        }
+    }
+    std::chrono::duration<double, std::milli> total = std::chrono::steady_clock::now() - replayStart;
+
+    auto millis = [](uint64_t nanos) { return nanos / 1e6; };
+    report << std::fixed << std::setprecision(3);
+    report << "Replayed " << entries.size() << " statements in " << total.count() << " ms"
+           << (preservePacing ? " (original pacing)" : " (as fast as possible)") << "\n";
+    report << "Errors: " << errors << " (original " << originalErrors << "), outcome mismatches: "
+           << outcomeMismatches << "\n\n";
+    report << std::left << std::setw(10) << "STATEMENT" << std::right
+           << std::setw(10) << "COUNT" << std::setw(12) << "P50 MS" << std::setw(12) << "P95 MS"
+           << std::setw(12) << "P99 MS" << std::setw(14) << "ORIG P50 MS" << std::setw(14) << "ORIG P99 MS" << "\n";
+    for (const auto& [type, histogram] : replayed) {
+        const LatencyHistogram& before = *original.at(type);
+        report << std::left << std::setw(10) << type << std::right
+               << std::setw(10) << histogram->count()
+               << std::setw(12) << millis(histogram->quantile(0.5))
+               << std::setw(12) << millis(histogram->quantile(0.95))
+               << std::setw(12) << millis(histogram->quantile(0.99))
+               << std::setw(14) << millis(before.quantile(0.5))
+               << std::setw(14) << millis(before.quantile(0.99)) << "\n";
+    }
+    report.unsetf(std::ios_base::floatfield);
+}
+
+// Statement on a single line, for reports
+static std::string oneLine(std::string statement) {
+    std::replace(statement.begin(), statement.end(), '\n', ' ');
+    statement.erase(statement.find_last_not_of(" \t\r") + 1);
+    return statement;
+}
+
+void QueryLog::writeSlowQueryReport(const std::vector<QueryLogEntry>& entries, double thresholdMs, std::ostream& report) {
+    struct Shape {
+        size_t count = 0;
+        uint64_t totalNanos = 0;
+        uint64_t maxNanos = 0;
+        size_t errors = 0;
+        std::string slowest;  // the statement behind maxNanos, verbatim
+    };
+
+    uint64_t thresholdNanos = static_cast<uint64_t>(thresholdMs * 1e6);
+    std::map<std::string, Shape> shapes;
+    size_t slowCount = 0;
+    for (const QueryLogEntry& entry : entries) {
+        if (entry.durationNanos < thresholdNanos) {
+            continue;
+        }
+        ++slowCount;
+        Shape& shape = shapes[normalize(entry.statement)];
+        ++shape.count;
+        shape.totalNanos += entry.durationNanos;
+        shape.errors += !entry.error.empty();
+        if (entry.durationNanos >= shape.maxNanos) {
+            shape.maxNanos = entry.durationNanos;
+            shape.slowest = entry.statement;
+        }
+    }
+
+    std::vector<std::pair<std::string, Shape>> ordered(shapes.begin(), shapes.end());
+    std::sort(ordered.begin(), ordered.end(), [](const auto& a, const auto& b) {
+        return a.second.totalNanos > b.second.totalNanos;
+    });
+
+    report << std::fixed << std::setprecision(3);
+    report << slowCount << " of " << entries.size() << " statements took " << thresholdMs << " ms or more, "
+           << ordered.size() << " distinct shapes\n";
+    for (const auto& [text, shape] : ordered) {
+        report << "\n" << text << "\n"
+               << "    count=" << shape.count
+               << " total=" << shape.totalNanos / 1e6 << " ms"
+               << " mean=" << shape.totalNanos / 1e6 / shape.count << " ms"
+               << " max=" << shape.maxNanos / 1e6 << " ms"
+               << " errors=" << shape.errors << "\n"
+               << "    slowest: " << oneLine(shape.slowest) << "\n";
+    }
+    report.unsetf(std::ios_base::floatfield);
+}
@@ -0,0 +1,115 @@
+#include "../../include/database/QueryPlan.h"
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+
+size_t QueryPlan::addNode(const std::string& op, const std::string& detail, const std::vector<size_t>& children) {
+    nodes.push_back({op, detail, children, OperatorStats()});
+    return nodes.size() - 1;
+}
+
+std::string formatBytes(size_t bytes) {
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(1);
+    if (bytes >= 1024 * 1024) {
+        out << bytes / (1024.0 * 1024.0) << " MB";
+    } else {
+        out << bytes / 1024.0 << " KB";
+    }
+    return out.str();
+}
+
+void QueryPlan::printNode(std::ostream& out, size_t id, size_t depth, bool analyze) const {
+    const Node& node = nodes[id];
+    out << std::string(depth * 4, ' ') << (depth > 0 ? "-> " : "") << node.op;
+    if (!node.detail.empty()) {
+        out << " " << node.detail;
+    }
+    if (node.estimatedRows >= 0.0) {
+        out << "  (rows=" << std::llround(node.estimatedRows) << ")";
+    }
+    if (analyze) {
+        const OperatorStats& stats = node.stats;
+        out << "  (actual rows in=" << stats.rowsIn << " out=" << stats.rowsOut
+            << " loops=" << stats.loops
+            << " time=" << std::fixed << std::setprecision(3) << stats.elapsedMs << " ms"
+            << " mem=" << formatBytes(stats.bytesAllocated);
+        if (stats.bytesSpilled > 0) {
+            out << " spilled=" << formatBytes(stats.bytesSpilled);
+        }
+        if (stats.partitions > 1) {
+            out << " partitions=" << stats.partitions;
+        }
+        if (stats.workers > 1) {
+            out << " workers=" << stats.workers;
+        }
+        out << ")";
+        out.unsetf(std::ios_base::floatfield);
+    }
+    out << std::endl;
+
+    for (size_t child : node.children) {
+        printNode(out, child, depth + 1, analyze);
+    }
+}
+
+void QueryPlan::print(std::ostream& out, bool analyze) const {
+    if (nodes.empty()) {
+        return;
+    }
+    out << "QUERY PLAN" << std::endl;
+    printNode(out, nodes.size() - 1, 0, analyze);
+    if (analyze) {
+        out << "Execution time: " << std::fixed << std::setprecision(3) << executionMs << " ms" << std::endl;
+        out.unsetf(std::ios_base::floatfield);
+        out << "Peak memory: " << formatBytes(peakBytes) << std::endl;
+    }
+}
+
+OperatorTimer::OperatorTimer(OperatorStats& stats)
+    : stats(stats), start(std::chrono::steady_clock::now()) {}
+
+OperatorTimer::~OperatorTimer() {
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    stats.elapsedMs += elapsed.count();
+    ++stats.loops;
+}
+
+bool parseAggregate(const std::string& field, AggregateSpec& spec) {
+    size_t open = field.find('(');
+    if (open == std::string::npos || field.back() != ')' || open + 2 > field.size() - 1) {
+        return false;
+    }
+    std::string function = field.substr(0, open);
+    if (function == "COUNT") {
+        spec.function = AggregateSpec::Function::Count;
+    } else if (function == "SUM") {
+        spec.function = AggregateSpec::Function::Sum;
+    } else if (function == "MIN") {
+        spec.function = AggregateSpec::Function::Min;
+    } else if (function == "MAX") {
+        spec.function = AggregateSpec::Function::Max;
+    } else if (function == "AVG") {
+        spec.function = AggregateSpec::Function::Avg;
+    } else {
+        return false;
+    }
+    spec.argument = field.substr(open + 1, field.size() - open - 2);
+    spec.name = field;
+    if (spec.argument == "*" && spec.function != AggregateSpec::Function::Count) {
+        throw std::runtime_error("Only COUNT accepts '*': " + field);
+    }
+    return true;
+}
+
+std::string describeConditions(const std::vector<SQLParser::Condition>& conditions) {
+    std::string description;
+    for (const auto& condition : conditions) {
+        if (!condition.relation.empty()) {
+            description += " " + condition.relation + " ";
+        }
+        description += condition.field + " " + condition.op + " " + condition.value;
+    }
+    return description;
+}
@@ -0,0 +1,76 @@
+#include "../../include/database/ResultCache.h"
+#include "../../include/database/MemoryTracker.h"
+#include "../../include/database/Metrics.h"
+#include <iterator>
+
+void ResultCache::setLimit(size_t bytes) {
+    limit = bytes;
+    evictTo(limit);
+}
+
+const ResultCache::Rows* ResultCache::find(const std::string& key,
+                                           const std::function<uint64_t(const std::string&)>& currentVersion) {
+    auto it = index.find(key);
+    if (it == index.end()) {
+        EngineMetrics::get().resultCacheMisses.add();
+        return nullptr;
+    }
+    for (const auto& [table, version] : it->second->tables) {
+        if (currentVersion(table) != version) {
+            erase(it->second);
+            EngineMetrics::get().resultCacheMisses.add();
+            return nullptr;
+        }
+    }
+    entries.splice(entries.begin(), entries, it->second);
+    EngineMetrics::get().resultCacheHits.add();
+    return &entries.front().rows;
+}
+
+void ResultCache::insert(const std::string& key, TableVersions tables, const Rows& rows) {
+    // List and hash nodes, the key twice, the table versions and the rows
+    size_t size = sizeof(Entry) + 4 * sizeof(void*) + 2 * key.capacity() + rows.capacity() * sizeof(rows[0]);
+    for (const auto& [table, version] : tables) {
+        size += sizeof(std::pair<std::string, uint64_t>) + (table.size() > 15 ? table.capacity() : 0);
+    }
+    for (const auto& row : rows) {
+        size += estimateRecordBytes(row) - sizeof(row);
+    }
+    auto existing = index.find(key);
+    if (existing != index.end()) {
+        erase(existing->second);
+    }
+    if (size > limit) {
+        return;
+    }
+
+    evictTo(limit - size);
+    entries.push_front({key, std::move(tables), rows, size});
+    index[key] = entries.begin();
+    bytes += size;
+}
+
+void ResultCache::eraseTable(const std::string& tableName) {
+    for (auto entry = entries.begin(); entry != entries.end();) {
+        auto next = std::next(entry);
+        for (const auto& [table, version] : entry->tables) {
+            if (table == tableName) {
+                erase(entry);
+                break;
+            }
+        }
+        entry = next;
+    }
+}
+
+void ResultCache::erase(std::list<Entry>::iterator entry) {
+    bytes -= entry->bytes;
+    index.erase(entry->key);
+    entries.erase(entry);
+}
+
+void ResultCache::evictTo(size_t target) {
+    while (bytes > target && !entries.empty()) {
+        erase(std::prev(entries.end()));
+    }
+}
@@ -0,0 +1,72 @@
+#include "../../include/database/SortedKeys.h"
+#include "../../include/database/ValueParser.h"
+#include <algorithm>
+#include <cmath>
+
+void SortedKeys::add(std::string_view key, size_t row) {
+    if (key.empty()) {
+        return;
+    }
+    double number = 0.0;
+    if (ValueParser::parseDouble(key, number)) {
+        ++numbers;
+        unordered = unordered || std::isnan(number);
+    }
+    entries.push_back({key, number, row});
+}
+
+void SortedKeys::sort(bool presorted) {
+    if (presorted || unordered || (numbers > 0 && !numeric())) {
+        return;
+    }
+    // Stable, so equal keys keep the order their rows were added in
+    if (numeric()) {
+        std::stable_sort(entries.begin(), entries.end(),
+                         [](const Entry& lhs, const Entry& rhs) { return lhs.number < rhs.number; });
+    } else {
+        std::stable_sort(entries.begin(), entries.end(),
+                         [](const Entry& lhs, const Entry& rhs) { return lhs.key < rhs.key; });
+    }
+}
+
+bool SortedKeys::searchable(std::string_view bound) const {
+    if (unordered || (numbers > 0 && !numeric())) {
+        return false;
+    }
+    // Against numbers a bound compares by value only if it is a number too;
+    // against strings any bound compares as a string
+    double number;
+    return numbers == 0 || (ValueParser::parseDouble(bound, number) && !std::isnan(number));
+}
+
+template <typename Before>
+size_t SortedKeys::search(size_t from, Before before) const {
+    // Double the step until it passes the answer, then bisect the last step
+    size_t low = from;
+    size_t step = 1;
+    while (low + step < entries.size() && before(entries[low + step - 1])) {
+        low += step;
+        step *= 2;
+    }
+    auto first = entries.begin() + low;
+    auto last = entries.begin() + std::min(entries.size(), low + step);
+    return std::partition_point(first, last, before) - entries.begin();
+}
+
+size_t SortedKeys::lowerBound(std::string_view bound, size_t from) const {
+    if (numbers > 0) {
+        double number = 0.0;
+        ValueParser::parseDouble(bound, number);
+        return search(from, [number](const Entry& entry) { return entry.number < number; });
+    }
+    return search(from, [bound](const Entry& entry) { return entry.key < bound; });
+}
+
+size_t SortedKeys::upperBound(std::string_view bound, size_t from) const {
+    if (numbers > 0) {
+        double number = 0.0;
+        ValueParser::parseDouble(bound, number);
+        return search(from, [number](const Entry& entry) { return !(number < entry.number); });
+    }
+    return search(from, [bound](const Entry& entry) { return !(bound < entry.key); });
+}
@@ -0,0 +1,51 @@
+#include "../../include/database/SpillFile.h"
+#include "../../include/database/Metrics.h"
+#include <stdexcept>
+#include <utility>
+
+SpillFile::SpillFile() : file(std::tmpfile()) {
+    if (!file) {
+        throw std::runtime_error("Cannot create spill file");
+    }
+}
+
+SpillFile::~SpillFile() {
+    if (file) {
+        std::fclose(file);
+    }
+}
+
+SpillFile::SpillFile(SpillFile&& other) noexcept
+    : file(std::exchange(other.file, nullptr)), written(std::exchange(other.written, 0)) {}
+
+SpillFile& SpillFile::operator=(SpillFile&& other) noexcept {
+    if (this != &other) {
+        if (file) {
+            std::fclose(file);
+        }
+        file = std::exchange(other.file, nullptr);
+        written = std::exchange(other.written, 0);
+    }
+    return *this;
+}
+
+void SpillFile::write(const void* data, size_t bytes) {
+    if (bytes == 0) {
+        return;
+    }
+    if (std::fseek(file, 0, SEEK_END) != 0 || std::fwrite(data, 1, bytes, file) != bytes) {
+        throw std::runtime_error("Cannot write spill file");
+    }
+    written += bytes;
+    EngineMetrics::get().bytesSpilled.add(bytes);
+}
+
+void SpillFile::read(size_t offset, void* data, size_t bytes) const {
+    if (bytes == 0) {
+        return;
+    }
+    if (offset + bytes > written || std::fseek(file, static_cast<long>(offset), SEEK_SET) != 0 ||
+        std::fread(data, 1, bytes, file) != bytes) {
+        throw std::runtime_error("Cannot read spill file");
+    }
+}
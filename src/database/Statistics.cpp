@@ -0,0 +1,248 @@
+#include "../../include/database/Statistics.h"
+#include "../../include/database/ValueParser.h"
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <random>
+#include <unordered_map>
+
+HyperLogLog::HyperLogLog(int precision)
+    : precision(precision), registers(size_t(1) << precision, 0) {}
+
+void HyperLogLog::add(std::string_view value) {
+    // Finalize the library hash so the high bits are usable as an index
+    uint64_t hash = std::hash<std::string_view>()(value);
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ULL;
+    hash ^= hash >> 33;
+
+    size_t index = hash >> (64 - precision);
+    uint64_t rest = hash << precision;
+    uint8_t rank = 1;
+    while (rank <= 64 - precision && (rest & (uint64_t(1) << 63)) == 0) {
+        ++rank;
+        rest <<= 1;
+    }
+    registers[index] = std::max(registers[index], rank);
+}
+
+double HyperLogLog::estimate() const {
+    double m = static_cast<double>(registers.size());
+    double sum = 0.0;
+    size_t zeros = 0;
+    for (uint8_t rank : registers) {
+        sum += std::ldexp(1.0, -rank);
+        zeros += rank == 0;
+    }
+    double estimate = 0.7213 / (1.0 + 1.079 / m) * m * m / sum;
+
+    // Small cardinalities: linear counting over the empty registers is more accurate
+    if (estimate <= 2.5 * m && zeros > 0) {
+        estimate = m * std::log(m / zeros);
+    }
+    return estimate;
+}
+
+double ColumnStatistics::selectivity(const Predicate& predicate) const {
+    double fraction = predicate.matches("") ? nullFraction : 0.0;
+
+    // Most common values are checked one by one. An '=' matching, or a '!='
+    // rejecting, one of them means the operand is that value.
+    double commonFraction = 0.0;
+    bool operandIsCommon = false;
+    size_t commonMatches = 0;
+    for (const auto& common : mostCommon) {
+        commonFraction += common.frequency;
+        bool matches = predicate.matches(common.value);
+        if (matches) {
+            fraction += common.frequency;
+            ++commonMatches;
+        }
+        if ((predicate.getOp() == Predicate::Op::Equal && matches) ||
+            (predicate.getOp() == Predicate::Op::NotEqual && !matches)) {
+            operandIsCommon = true;
+        }
+    }
+
+    // The other values share the rest evenly, or by histogram for ranges
+    double rest = std::max(0.0, 1.0 - nullFraction - commonFraction);
+    double otherDistinct = std::max(1.0, distinct - static_cast<double>(mostCommon.size()));
+    switch (predicate.getOp()) {
+        case Predicate::Op::Equal:
+            fraction += operandIsCommon ? 0.0 : rest / otherDistinct;
+            break;
+        case Predicate::Op::NotEqual:
+            fraction += operandIsCommon ? rest : rest * (1.0 - 1.0 / otherDistinct);
+            break;
+        case Predicate::Op::In:
+            // Each IN value that is not a common one takes an even share
+            fraction += rest * std::min(1.0, (predicate.getListSize() - std::min(commonMatches, predicate.getListSize())) /
+                                                 otherDistinct);
+            break;
+        case Predicate::Op::Like:
+            fraction += rest * likeFraction;
+            break;
+        default:
+            fraction += rest * histogramFraction(predicate);
+            break;
+    }
+    return std::clamp(fraction, 0.0, 1.0);
+}
+
+double ColumnStatistics::histogramFraction(const Predicate& predicate) const {
+    if (histogram.size() < 2) {
+        return 1.0 / 3.0;
+    }
+
+    // Each bucket holds the same share of the values: count it in full when
+    // both bounds match, not at all when neither does, and in part otherwise
+    bool interpolate = numericHistogram && predicate.isNumeric();
+    double matched = 0.0;
+    for (size_t bucket = 0; bucket + 1 < histogram.size(); ++bucket) {
+        const std::string& low = histogram[bucket];
+        const std::string& high = histogram[bucket + 1];
+        bool lowMatches = predicate.matches(low);
+        bool highMatches = predicate.matches(high);
+        double lowNumber, highNumber;
+        bool numbers = interpolate && ValueParser::parseDouble(low, lowNumber) &&
+                       ValueParser::parseDouble(high, highNumber) && highNumber > lowNumber;
+        auto position = [&](double bound) { return std::clamp((bound - lowNumber) / (highNumber - lowNumber), 0.0, 1.0); };
+        bool between = predicate.getOp() == Predicate::Op::Between;
+        if (lowMatches && highMatches) {
+            matched += 1.0;
+        } else if (lowMatches != highMatches) {
+            // A BETWEEN is cut by its upper bound when the bucket starts inside it
+            double bound = between && lowMatches ? predicate.getUpperNumber() : predicate.getNumber();
+            if (numbers) {
+                matched += lowMatches ? position(bound) : 1.0 - position(bound);
+            } else {
+                matched += 0.5;
+            }
+        } else if (between && numbers) {
+            // Both bounds may fall inside the bucket
+            matched += std::max(0.0, position(predicate.getUpperNumber()) - position(predicate.getNumber()));
+        }
+    }
+    return matched / static_cast<double>(histogram.size() - 1);
+}
+
+TableStatistics Statistics::analyze(const std::vector<std::map<std::string, std::string>>& records,
+                                    const std::vector<std::string>& columns) {
+    TableStatistics statistics;
+    statistics.rowCount = records.size();
+
+    // One pass: sketch every value, and keep a uniform sample of the rows
+    // (reservoir sampling, seeded so that plans are reproducible)
+    std::vector<HyperLogLog> sketches(columns.size());
+    std::vector<size_t> sample;
+    std::mt19937_64 random(42);
+    for (size_t row = 0; row < records.size(); ++row) {
+        // Both the record and the column list are sorted by name: walk them together
+        auto it = records[row].begin();
+        for (size_t column = 0; column < columns.size(); ++column) {
+            while (it != records[row].end() && it->first < columns[column]) {
+                ++it;
+            }
+            if (it != records[row].end() && it->first == columns[column] && !it->second.empty()) {
+                sketches[column].add(it->second);
+            }
+        }
+
+        if (sample.size() < sampleSize) {
+            sample.push_back(row);
+        } else {
+            size_t slot = random() % (row + 1);
+            if (slot < sampleSize) {
+                sample[slot] = row;
+            }
+        }
+    }
+    statistics.sampledRows = sample.size();
+    if (sample.empty()) {
+        for (const auto& column : columns) {
+            statistics.columns[column];
+        }
+        return statistics;
+    }
+
+    for (size_t column = 0; column < columns.size(); ++column) {
+        ColumnStatistics& stats = statistics.columns[columns[column]];
+
+        // Values of the sampled rows
+        std::vector<std::string_view> values;
+        size_t empty = 0;
+        double width = 0.0;
+        for (size_t row : sample) {
+            auto it = records[row].find(columns[column]);
+            if (it == records[row].end() || it->second.empty()) {
+                ++empty;
+                continue;
+            }
+            values.push_back(it->second);
+            width += it->second.size();
+        }
+        double sampled = static_cast<double>(sample.size());
+        stats.nullFraction = empty / sampled;
+        stats.averageWidth = values.empty() ? 0.0 : width / values.size();
+
+        std::unordered_map<std::string_view, size_t> counts;
+        for (std::string_view value : values) {
+            ++counts[value];
+        }
+        double nonEmptyRows = records.size() * (1.0 - stats.nullFraction);
+        stats.distinct = std::min(std::max(sketches[column].estimate(), static_cast<double>(counts.size())), nonEmptyRows);
+
+        // Most common values: those clearly above the average frequency, or
+        // every value when the whole table was read and they all fit
+        std::vector<std::pair<std::string_view, size_t>> candidates(counts.begin(), counts.end());
+        std::sort(candidates.begin(), candidates.end(), [](const auto& a, const auto& b) {
+            return a.second != b.second ? a.second > b.second : a.first < b.first;
+        });
+        bool keepAll = sample.size() == records.size() && candidates.size() <= mostCommonLimit;
+        double average = values.empty() ? 0.0 : static_cast<double>(values.size()) / counts.size();
+        for (const auto& [value, count] : candidates) {
+            if (stats.mostCommon.size() == mostCommonLimit || (!keepAll && (count < 2 || count <= 1.25 * average))) {
+                break;
+            }
+            stats.mostCommon.push_back({std::string(value), count / sampled});
+        }
+
+        // Equi-depth histogram over the values that are not most common
+        std::vector<std::string_view> rest;
+        for (std::string_view value : values) {
+            bool common = std::any_of(stats.mostCommon.begin(), stats.mostCommon.end(),
+                                      [&](const ColumnStatistics::CommonValue& c) { return c.value == value; });
+            if (!common) {
+                rest.push_back(value);
+            }
+        }
+        std::vector<double> numbers(rest.size());
+        stats.numericHistogram = !rest.empty();
+        for (size_t i = 0; i < rest.size() && stats.numericHistogram; ++i) {
+            stats.numericHistogram = ValueParser::parseDouble(rest[i], numbers[i]) && !std::isnan(numbers[i]);
+        }
+        if (stats.numericHistogram) {
+            std::vector<size_t> order(rest.size());
+            for (size_t i = 0; i < order.size(); ++i) {
+                order[i] = i;
+            }
+            std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return numbers[a] < numbers[b]; });
+            std::vector<std::string_view> sorted;
+            for (size_t i : order) {
+                sorted.push_back(rest[i]);
+            }
+            rest.swap(sorted);
+        } else {
+            std::sort(rest.begin(), rest.end());
+        }
+        if (rest.size() >= 2) {
+            size_t buckets = std::min(histogramBuckets, rest.size() - 1);
+            for (size_t bound = 0; bound <= buckets; ++bound) {
+                stats.histogram.emplace_back(rest[bound * (rest.size() - 1) / buckets]);
+            }
+        }
+    }
+    return statistics;
+}
@@ -1,11 +1,22 @@
 #include "../../include/database/Table.h"
+#include "../../include/database/Metrics.h"
+#include "../../include/database/Operator.h"
+#include "../../include/database/ValueParser.h"
 #include <stdexcept>
 #include <iostream>
 #include <algorithm>
+#include <cmath>
+#include <atomic>
+#include <cstdint>
 
 // Constructor
 Table::Table(const std::string& name) : name(name) {}
 
+uint64_t Table::nextVersion() {
+    static std::atomic<uint64_t> last{0};
+    return ++last;
+}
+
 // Destructor
 Table::~Table() {
     clearFields();
@@ -25,15 +36,36 @@ bool Table::checkForeignKeyConstraint(const std::string& referencedTableName,
         throw std::runtime_error("Referenced table not found: " + referencedTableName);
     }
 
-    // Check if the value exists in the referenced table's column
-    for (const auto& record : referencedTable->records) {
-        auto it = record.find(referencedColumnName);
+    // Probe the referenced table's primary key index
+    return referencedTable->containsKey(referencedColumnName, value);
+}
+
+bool Table::containsKey(const std::string& fieldName, const std::string& value) const {
+    auto indexIt = uniqueFields.find(fieldName);
+    if (indexIt != uniqueFields.end()) {
+        EngineMetrics::get().indexLookups.add();
+        return indexIt->second.count(value) > 0;
+    }
+
+    // Not an indexed column: fall back to scanning the records
+    EngineMetrics::get().fullScans.add();
+    EngineMetrics::get().rowsScanned.add(records.size());
+    for (const auto& record : records) {
+        auto it = record.find(fieldName);
         if (it != record.end() && it->second == value) {
-            return true; // Value exists in the referenced table
+            return true;
         }
     }
+    return false;
+}
 
-    return false; // Value not found, constraint violated
+size_t Table::countReferences(const std::string& fieldName, const std::string& value) const {
+    auto fieldIt = referenceRows.find(fieldName);
+    if (fieldIt == referenceRows.end()) {
+        return 0;
+    }
+    auto it = fieldIt->second.find(value);
+    return it != fieldIt->second.end() ? it->second.size() : 0;
 }
 
 
@@ -54,404 +86,984 @@ const std::map<std::string, Field*>& Table::getFields() const {
     return fields;
 }
     
+// Get the precompiled validation rules of the table
+const ValidationPlan& Table::getValidationPlan() const {
+    return validationPlan;
+}
+
 // Add a field to the table
 void Table::addField(Field* field) {
     if (fields.find(field->getName()) != fields.end()) {
         throw std::invalid_argument("Field already exists: " + field->getName());
     }
+
+    // Flatten the field's type and constraints into the table's validation plan
+    validationPlan.addField(*field);
     fields[field->getName()] = field;
+    const ValidationPlan::ColumnRule& rule = *validationPlan.findColumn(field->getName());
 
     // If the field has a UNIQUE or PRIMARY_KEY constraint, initialize its unique value set
-    for (const auto& constraint : field->getConstraints()) {
-        std::string constraintName = constraint->getName();
-        if (constraintName == "PRIMARY_KEY") {
-            uniqueFields[field->getName()] = std::set<std::string>();
-            break; // PRIMARY_KEY implies uniqueness, so we can stop checking
-        }else if (constraintName == "FOREIGN_KEY_REFERENCES"){
-
-            std::string referencedTable = dynamic_cast<ForeignKeyConstraint*>(constraint)->getReferencedTable();
-            std::string referencedColumn = dynamic_cast<ForeignKeyConstraint*>(constraint)->getReferencedColumn();
-
-            if (!database->getTable(referencedTable)) {
-                throw std::invalid_argument("Referenced table not found: " + referencedTable);
-            }
+    if (rule.primaryKey) {
+        uniqueFields[field->getName()] = std::set<std::string>();
+        rowIndex[field->getName()];
+        rebuildRowIndex();
+    }
 
-            if (referencedColumn != field->getName()) {
-                throw std::invalid_argument("Referenced column does not match field name: " + referencedColumn);
-            }
+    if (rule.foreignKey) {
+        const std::string& referencedTable = rule.foreignKey->getReferencedTable();
+        const std::string& referencedColumn = rule.foreignKey->getReferencedColumn();
 
-            // Check if the referenced column is a primary key of the other table
-            bool isPrimaryKey = false;
-            for (const auto& constraint : database->getTable(referencedTable)->fields.at(referencedColumn)->getConstraints()) {
-                if (constraint->getName() == "PRIMARY_KEY") {
-                    isPrimaryKey = true;
-                    break;
-                }
-            }
-            
-            if (!isPrimaryKey) {
-                throw std::invalid_argument("Referenced column is not a primary key: " + referencedColumn);
-            }
-        
+        if (!database->getTable(referencedTable)) {
+            throw std::invalid_argument("Referenced table not found: " + referencedTable);
         }
-        // Add handling for UNIQUE constraint if implemented
+
+        if (referencedColumn != field->getName()) {
+            throw std::invalid_argument("Referenced column does not match field name: " + referencedColumn);
+        }
+
+        // Check if the referenced column is a primary key of the other table
+        const ValidationPlan::ColumnRule* referencedRule =
+            database->getTable(referencedTable)->getValidationPlan().findColumn(referencedColumn);
+        if (!referencedRule || !referencedRule->primaryKey) {
+            throw std::invalid_argument("Referenced column is not a primary key: " + referencedColumn);
+        }
+
+        // Start the reverse-reference index used by the referenced table
+        referenceRows[field->getName()];
+        rebuildRowIndex();
+    }
+    // Add handling for UNIQUE constraint if implemented
+
+    std::vector<std::string> columnNames;
+    for (const auto& [fieldName, tableField] : fields) {
+        columnNames.push_back(fieldName);
     }
+    zoneMap.setColumns(columnNames);
+    zoneMap.rebuild(records);
+    version = nextVersion();
 }
 
 // Insert a record into the table
 void Table::insertRecord(const std::map<std::string, std::string>& record) {
-    // Validate fields and enforce constraints
-    enforceConstraintsOnInsert(record);
+    insertRecords({record});
+}
 
-    // Insert the record
-    records.push_back(record);
+// Make room for 'extra' more rows. Capacity at least doubles, so a run of
+// single-row INSERTs moves the existing rows only O(log n) times.
+static void reserveRows(std::vector<std::map<std::string, std::string>>& records, size_t extra) {
+    size_t needed = records.size() + extra;
+    if (needed > records.capacity()) {
+        records.reserve(std::max(needed, 2 * records.capacity()));
+    }
+}
 
-    // Update unique fields
-    for (const auto& [fieldName, field] : fields) {
-        auto it = uniqueFields.find(fieldName);
-        if (it != uniqueFields.end()) {
-            const std::string& value = record.at(fieldName);
-            it->second.insert(value);
+// Insert a batch of records into the table
+void Table::insertRecords(const std::vector<std::map<std::string, std::string>>& newRecords) {
+    auto checkStart = std::chrono::steady_clock::now();
+
+    // Validate fields and enforce constraints on every record before touching the table
+    std::map<std::string, std::set<std::string>> batchKeys;
+    for (const auto& record : newRecords) {
+        enforceConstraintsOnInsert(record);
+
+        // Primary keys must also be unique within the batch itself
+        for (const auto& [fieldName, values] : uniqueFields) {
+            if (!batchKeys[fieldName].insert(record.at(fieldName)).second) {
+                throw std::invalid_argument("Primary key constraint violated for field: " + fieldName);
+            }
         }
     }
+    enforceForeignKeys(newRecords);
+    EngineMetrics::get().constraintCheck.record(std::chrono::steady_clock::now() - checkStart);
+
+    // Insert the records
+    modifiedRows += newRecords.size();
+    version = nextVersion();
+    reserveRows(records, newRecords.size());
+    for (const auto& record : newRecords) {
+        records.push_back(record);
+        indexRecord(records.back(), records.size() - 1);
+        zoneMap.append(records.back(), records.size() - 1);
+    }
+    if (!observers.empty()) {
+        notify({TableChange::Kind::Insert, {}, newRecords});
+    }
 }
 
-// Enforce constraints during insertion
-void Table::enforceConstraintsOnInsert(const std::map<std::string, std::string>& record) {
-    // Validate and enforce constraints
-    for (const auto& [fieldName, field] : fields) {
+// Add a record's values to the unique, row and reverse-reference indexes
+void Table::indexRecord(const std::map<std::string, std::string>& record, size_t rowId) {
+    for (auto& [fieldName, values] : uniqueFields) {
+        values.insert(record.at(fieldName));
+    }
+    for (auto& [fieldName, rows] : rowIndex) {
+        rows.emplace(Predicate::equalityKey(record.at(fieldName)), rowId);
+    }
+    for (auto& [fieldName, rows] : referenceRows) {
+        rows[record.at(fieldName)].push_back(rowId);
+    }
+    for (auto& [fieldName, index] : trigramIndexes) {
         auto it = record.find(fieldName);
         if (it != record.end()) {
-            const std::string& value = it->second;
-            // Field-level validation
-            field->validate(value);
-        } else {
-            // Handle missing field (e.g., default values or error)
-            throw std::invalid_argument("Missing value for field: " + fieldName);
+            index->insert(rowId, it->second);
         }
     }
+}
 
-    // Enforce table-level constraints
-    for (const auto& [fieldName, field] : fields) {
-        auto it = record.find(fieldName);
-        const std::string& value = it->second;
+// Re-key the row and reverse-reference indexes after rows have moved
+void Table::rebuildRowIndex() {
+    for (auto& [fieldName, rows] : rowIndex) {
+        rows.clear();
+        rows.reserve(records.size());
+        for (size_t rowId = 0; rowId < records.size(); ++rowId) {
+            auto it = records[rowId].find(fieldName);
+            rows.emplace(Predicate::equalityKey(it != records[rowId].end() ? it->second : ""), rowId);
+        }
+    }
+    for (auto& [fieldName, rows] : referenceRows) {
+        rows.clear();
+        for (size_t rowId = 0; rowId < records.size(); ++rowId) {
+            auto it = records[rowId].find(fieldName);
+            rows[it != records[rowId].end() ? it->second : ""].push_back(rowId);
+        }
+    }
+}
 
-        for (const auto& constraint : field->getConstraints()) {
-            std::string constraintName = constraint->getName();
-            if (constraintName == "PRIMARY_KEY") {
-                // Enforce uniqueness
-                if (uniqueFields[fieldName].find(value) != uniqueFields[fieldName].end()) {
-                    throw std::invalid_argument("Primary key constraint violated for field: " + fieldName);
-                }
-            }
+// Index every row again, after the rows were replaced wholesale
+void Table::rebuildIndexes() {
+    for (auto& [fieldName, values] : uniqueFields) {
+        values.clear();
+    }
+    for (auto& [fieldName, rows] : rowIndex) {
+        rows.clear();
+    }
+    for (size_t rowId = 0; rowId < records.size(); ++rowId) {
+        for (auto& [fieldName, values] : uniqueFields) {
+            values.insert(records[rowId].at(fieldName));
         }
     }
+    rebuildRowIndex();
+    for (auto& [fieldName, index] : trigramIndexes) {
+        index->build(records);
+    }
+    zoneMap.rebuild(records);
+}
 
-      // Enforce foreign key constraints
-    for (const auto& [fieldName, field] : fields) {
-        auto it = record.find(fieldName);
-        if (it != record.end()) {
-            const std::string& value = it->second;
-
-            for (const auto& constraint : field->getConstraints()) {
-                if (constraint->getName() == "FOREIGN_KEY") {
-                    ForeignKeyConstraint* fkConstraint = dynamic_cast<ForeignKeyConstraint*>(constraint);
-                    if (fkConstraint) {
-                        if (!checkForeignKeyConstraint(fkConstraint->getReferencedTable(),
-                                                       fkConstraint->getReferencedColumn(), value)) {
-                            throw std::invalid_argument("Foreign key constraint violated for field: " + fieldName);
-                        }
-                    }
-                }
+// Check foreign keys for a batch: each distinct value is probed once
+void Table::enforceForeignKeys(const std::vector<std::map<std::string, std::string>>& newRecords) const {
+    const auto& columns = validationPlan.getColumns();
+    for (size_t column : validationPlan.getForeignKeyColumns()) {
+        const std::string& fieldName = columns[column].name;
+        const ForeignKeyConstraint* fkConstraint = columns[column].foreignKey;
+
+        std::set<std::string> distinctValues;
+        for (const auto& record : newRecords) {
+            distinctValues.insert(record.at(fieldName));
+        }
+
+        for (const auto& value : distinctValues) {
+            if (!checkForeignKeyConstraint(fkConstraint->getReferencedTable(),
+                                           fkConstraint->getReferencedColumn(), value)) {
+                throw std::invalid_argument("Foreign key constraint violated for field: " + fieldName);
             }
         }
     }
 }
 
-// Select records based on conditions
-std::vector<std::map<std::string, std::string>> Table::selectRecords(const std::vector<std::string>& fieldsToSelect,const std::vector<SQLParser::Condition>& conditions) const {
+// Enforce constraints during insertion
+void Table::enforceConstraintsOnInsert(const std::map<std::string, std::string>& record) {
+    // Validate types and value-level constraints through the precompiled plan
+    validationPlan.validateRecord(record);
+
+    // Enforce table-level constraints
+    const auto& columns = validationPlan.getColumns();
+    for (size_t column : validationPlan.getPrimaryKeyColumns()) {
+        const std::string& fieldName = columns[column].name;
+        // Enforce uniqueness
+        if (uniqueFields[fieldName].count(record.find(fieldName)->second) > 0) {
+            throw std::invalid_argument("Primary key constraint violated for field: " + fieldName);
+        }
+    }
 
-    std::vector<std::map<std::string, std::string>> result;
+    // Foreign keys are enforced per batch in enforceForeignKeys
+}
 
+Table::MemoryUsage Table::memoryUsage() const {
+    MemoryUsage usage;
+    usage.rows = records.capacity() * sizeof(std::map<std::string, std::string>);
     for (const auto& record : records) {
-        if (evaluateConditions(record, conditions)) {
-            // Create a new record with only the selected fields
-            std::map<std::string, std::string> selectedRecord;
-            if (fieldsToSelect.size() == 1 && fieldsToSelect[0] == "*") {
-                selectedRecord = record; // Select all fields
-            } else {
-                for (const auto& fieldName : fieldsToSelect) {
-                    auto it = record.find(fieldName);
-                    if (it != record.end()) {
-                        selectedRecord[fieldName] = it->second;
-                    } else {
-                        throw std::invalid_argument("Field not found: " + fieldName);
-                    }
-                }
+        usage.rows += estimateRecordBytes(record) - sizeof(record);
+    }
+
+    // Tree and hash nodes: links, the key string, the mapped value
+    for (const auto& [fieldName, values] : uniqueFields) {
+        for (const auto& value : values) {
+            usage.indexes += 4 * sizeof(void*) + sizeof(std::string) + (value.size() > 15 ? value.capacity() : 0);
+        }
+    }
+    for (const auto& [fieldName, rows] : rowIndex) {
+        usage.indexes += rows.bucket_count() * sizeof(void*);
+        for (const auto& [key, rowId] : rows) {
+            usage.indexes += 2 * sizeof(void*) + sizeof(std::string) + sizeof(size_t) + (key.size() > 15 ? key.capacity() : 0);
+        }
+    }
+    for (const auto& [fieldName, references] : referenceRows) {
+        usage.indexes += references.bucket_count() * sizeof(void*);
+        for (const auto& [value, rowIds] : references) {
+            usage.indexes += 2 * sizeof(void*) + sizeof(std::string) + sizeof(rowIds) +
+                             rowIds.capacity() * sizeof(size_t) + (value.size() > 15 ? value.capacity() : 0);
+        }
+    }
+    for (const auto& [fieldName, index] : trigramIndexes) {
+        usage.indexes += index->memoryUsage();
+    }
+
+    usage.summaries = zoneMap.memoryUsage();
+    if (statistics) {
+        for (const auto& [column, stats] : statistics->columns) {
+            usage.summaries += sizeof(stats);
+            for (const auto& common : stats.mostCommon) {
+                usage.summaries += sizeof(common) + common.value.capacity();
             }
-            result.push_back(selectedRecord);
-        }
-    }
-
-    return result;
-}
-
-void Table::enforceConstraintsOnUpdate(const std::map<std::string, std::string>& originalRecord,
-                                       const std::map<std::string, std::string>& updatedRecord) {
-    // Iterate over the fields to be updated
-    for (const auto& [fieldName, newValue] : updatedRecord) {
-        // Get the original value
-        auto itOriginal = originalRecord.find(fieldName);
-        const std::string& originalValue = itOriginal != originalRecord.end() ? itOriginal->second : "";
-
-        // Validate the new value
-        auto fieldIt = fields.find(fieldName);
-        if (fieldIt != fields.end()) {
-            Field* field = fieldIt->second;
-            field->validate(newValue);
-
-            // Enforce constraints if the value has changed
-            if (newValue != originalValue) {
-                for (const auto& constraint : field->getConstraints()) {
-                    std::string constraintName = constraint->getName();
-
-                    if (constraintName == "PRIMARY_KEY") {
-                        // Check uniqueness only if primary key is being modified
-                        if (uniqueFields[fieldName].find(newValue) != uniqueFields[fieldName].end()) {
-                            throw std::invalid_argument("Primary key constraint violated for field: " + fieldName);
-                        }
-                    } else if (constraintName == "FOREIGN_KEY") {
-                        // Enforce foreign key constraint
-                        ForeignKeyConstraint* fkConstraint = dynamic_cast<ForeignKeyConstraint*>(constraint);
-                        if (fkConstraint) {
-                            if (!checkForeignKeyConstraint(fkConstraint->getReferencedTable(),
-                                                           fkConstraint->getReferencedColumn(), newValue)) {
-                                throw std::invalid_argument("Foreign key constraint violated for field: " + fieldName);
-                            }
-                        }
-                    }
-                    // Add checks for other constraints as needed
-                }
+            for (const auto& bound : stats.histogram) {
+                usage.summaries += sizeof(bound) + bound.capacity();
             }
+        }
+    }
+    return usage;
+}
+
+void Table::analyze() {
+    std::vector<std::string> columnNames;
+    for (const auto& [fieldName, field] : fields) {
+        columnNames.push_back(fieldName);
+    }
+    statistics = std::make_unique<TableStatistics>(Statistics::analyze(records, columnNames));
+    modifiedRows = 0;
+}
+
+const TableStatistics* Table::getStatistics() const {
+    return statistics.get();
+}
+
+bool Table::statisticsStale(double fraction) const {
+    // The minimum keeps small tables from being re-analyzed on every change
+    size_t analyzedRows = statistics ? statistics->rowCount : 0;
+    return modifiedRows > 50 + fraction * analyzedRows;
+}
+
+// Statistics of a column, if the table has been analyzed since it was added
+static const ColumnStatistics* findColumnStatistics(const TableStatistics* statistics, const std::string& fieldName) {
+    if (!statistics) {
+        return nullptr;
+    }
+    auto it = statistics->columns.find(fieldName);
+    return it != statistics->columns.end() ? &it->second : nullptr;
+}
+
+bool Table::isSortedOn(const std::string& fieldName) const {
+    auto cached = sortedColumns.find(fieldName);
+    if (cached != sortedColumns.end() && cached->second.first == version) {
+        return cached->second.second;
+    }
+
+    // Numbers and strings do not share one order, so a column mixing them is never sorted
+    bool sorted = true;
+    bool numbers = false;
+    std::string_view previous;
+    double previousNumber = 0.0;
+    for (size_t row = 0; row < records.size() && sorted; ++row) {
+        auto it = records[row].find(fieldName);
+        if (it == records[row].end() || it->second.empty()) {
+            sorted = false;
+            break;
+        }
+        double number;
+        bool numeric = ValueParser::parseDouble(it->second, number);
+        if (numeric && std::isnan(number)) {
+            sorted = false;
+        } else if (row == 0) {
+            numbers = numeric;
+        } else if (numeric != numbers) {
+            sorted = false;
         } else {
-            throw std::invalid_argument("Field not found: " + fieldName);
+            sorted = numeric ? !(number < previousNumber) : previous <= it->second;
         }
+        previous = it->second;
+        previousNumber = number;
     }
+    sortedColumns[fieldName] = {version, sorted};
+    return sorted;
 }
 
-// Update records based on conditions
-void Table::updateRecords(const std::map<std::string, std::string>& newValues, const std::vector<SQLParser::Condition>& conditions) {
-    bool updated = false;  
-    for (auto& record : records) {
-        if (evaluateConditions(record, conditions)) {
-            updated = true;
-            // Make copies of the original and updated records
-            auto originalRecord = record;
-            auto updatedRecord = record;
-
-            // Apply the updates to the updatedRecord
-            for (const auto& [fieldName, newValue] : newValues) {
-                // Validate the new value
-                auto fieldIt = fields.find(fieldName);
-                if (fieldIt != fields.end()) {
-                    Field* field = fieldIt->second;
-                    field->validate(newValue);
-                    updatedRecord[fieldName] = newValue;
-                } else {
-                    throw std::invalid_argument("Field not found: " + fieldName);
-                }
+double Table::estimateDistinct(const std::string& fieldName) const {
+    // Keys are distinct by definition and foreign keys are counted per value
+    if (rowIndex.count(fieldName) > 0) {
+        return static_cast<double>(records.size());
+    }
+    auto references = referenceRows.find(fieldName);
+    if (references != referenceRows.end()) {
+        return static_cast<double>(references->second.size());
+    }
+    // Otherwise the sketch from ANALYZE, scaled to the table's current size;
+    // without one the column is assumed distinct, like the key columns joins use
+    if (const ColumnStatistics* column = findColumnStatistics(statistics.get(), fieldName)) {
+        double growth = statistics->rowCount > 0 ? static_cast<double>(records.size()) / statistics->rowCount : 1.0;
+        return std::min(column->distinct * std::max(growth, 1.0), static_cast<double>(records.size()));
+    }
+    return static_cast<double>(records.size());
+}
+
+double Table::estimateRows(const std::vector<Predicate>& predicates) const {
+    double rows = static_cast<double>(records.size());
+    if (predicates.empty() || records.empty()) {
+        return rows;
+    }
+
+    // Fold the selectivities the way the predicates combine, treating them as independent
+    auto estimate = [&](const Predicate& predicate) {
+        // Key lookups are exact
+        auto index = rowIndex.find(predicate.getField());
+        if (index != rowIndex.end() && predicate.hasEqualityKey()) {
+            size_t matching = 0;
+            for (const auto& key : predicate.getEqualityKeys()) {
+                matching += index->second.count(key);
             }
+            return matching / rows;
+        }
+        if (const ColumnStatistics* column = findColumnStatistics(statistics.get(), predicate.getField())) {
+            return column->selectivity(predicate);
+        }
+        double distinct = std::max(estimateDistinct(predicate.getField()), 1.0);
+        switch (predicate.getOp()) {
+            case Predicate::Op::Equal:
+                return 1.0 / distinct;
+            case Predicate::Op::NotEqual:
+                return 1.0 - 1.0 / distinct;
+            case Predicate::Op::In:
+                return std::min(1.0, predicate.getListSize() / distinct);
+            case Predicate::Op::Like:
+                return ColumnStatistics::likeFraction;
+            case Predicate::Op::Between:
+                return 1.0 / 9.0; // Two ranges
+            default:
+                return 1.0 / 3.0; // Ranges: no histogram to go by
+        }
+    };
+    // A trigram index bounds a LIKE by its shortest posting list
+    auto selectivity = [&](const Predicate& predicate) {
+        double fraction = estimate(predicate);
+        auto trigrams = trigramIndexes.find(predicate.getField());
+        if (trigrams != trigramIndexes.end() && predicate.getOp() == Predicate::Op::Like &&
+            TrigramIndex::canFilter(*predicate.getPattern())) {
+            fraction = std::min(fraction, trigrams->second->estimateCandidates(*predicate.getPattern()) / rows);
+        }
+        return fraction;
+    };
+    double fraction = selectivity(predicates[0]);
+    for (size_t i = 1; i < predicates.size(); ++i) {
+        double next = selectivity(predicates[i]);
+        fraction = predicates[i].isOr() ? fraction + next - fraction * next : fraction * next;
+    }
+    return rows * fraction;
+}
+
+// With an OR anywhere, no single predicate has to hold for every match
+static bool isConjunction(const std::vector<Predicate>& predicates) {
+    for (size_t i = 1; i < predicates.size(); ++i) {
+        if (predicates[i].isOr()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+const Predicate* Table::findIndexPredicate(const std::vector<Predicate>& predicates) const {
+    if (!isConjunction(predicates)) {
+        return nullptr;
+    }
+    for (const auto& predicate : predicates) {
+        if (predicate.hasEqualityKey() && rowIndex.count(predicate.getField()) > 0) {
+            return &predicate;
+        }
+    }
+    return nullptr;
+}
+
+std::vector<size_t> Table::lookupRows(const Predicate& predicate) const {
+    std::vector<size_t> rowIds;
+    const auto& index = rowIndex.at(predicate.getField());
+    for (const auto& key : predicate.getEqualityKeys()) {
+        auto [begin, end] = index.equal_range(key);
+        for (auto it = begin; it != end; ++it) {
+            rowIds.push_back(it->second);
+        }
+    }
+    std::sort(rowIds.begin(), rowIds.end());
+    return rowIds;
+}
+
+void Table::createTrigramIndex(const std::string& indexName, const std::string& fieldName) {
+    if (fields.count(fieldName) == 0) {
+        throw std::invalid_argument("Field not found: " + fieldName);
+    }
+    if (trigramIndexes.count(fieldName) > 0) {
+        throw std::invalid_argument("Column " + fieldName + " already has a trigram index: " +
+                                    trigramIndexes.at(fieldName)->getName());
+    }
+    auto index = std::make_unique<TrigramIndex>(indexName, fieldName);
+    index->build(records);
+    trigramIndexes[fieldName] = std::move(index);
+}
+
+bool Table::dropIndex(const std::string& indexName) {
+    for (auto it = trigramIndexes.begin(); it != trigramIndexes.end(); ++it) {
+        if (it->second->getName() == indexName) {
+            trigramIndexes.erase(it);
+            return true;
+        }
+    }
+    return false;
+}
 
-            // Enforce constraints on the updated record
-            enforceConstraintsOnUpdate(originalRecord, updatedRecord);
-
-            // Update unique fields (if necessary)
-            for (const auto& [fieldName, newValue] : newValues) {
-                if (uniqueFields.find(fieldName) != uniqueFields.end()) {
-                    // Check if the value has actually changed
-                    const std::string& originalValue = originalRecord[fieldName];
-                    if (newValue != originalValue) {
-                        // Update uniqueFields map
-                        uniqueFields[fieldName].erase(originalValue); // Remove old value
-                        uniqueFields[fieldName].insert(newValue);     // Insert new value
-                    }
+bool Table::hasIndex(const std::string& indexName) const {
+    for (const auto& [fieldName, index] : trigramIndexes) {
+        if (index->getName() == indexName) {
+            return true;
+        }
+    }
+    return false;
+}
+
+const Predicate* Table::findTrigramPredicate(const std::vector<Predicate>& predicates) const {
+    if (trigramIndexes.empty() || !isConjunction(predicates)) {
+        return nullptr;
+    }
+    for (const auto& predicate : predicates) {
+        if (predicate.getOp() == Predicate::Op::Like && trigramIndexes.count(predicate.getField()) > 0 &&
+            TrigramIndex::canFilter(*predicate.getPattern())) {
+            return &predicate;
+        }
+    }
+    return nullptr;
+}
+
+std::vector<size_t> Table::trigramCandidates(const Predicate& predicate) const {
+    return trigramIndexes.at(predicate.getField())->candidates(*predicate.getPattern());
+}
+
+// Validate an update of the given rows as a set: each new value once, each
+// foreign key once, and primary keys against the table with the rows' own
+// keys released first (so keys may move between rows of the batch). Returns
+// the old -> new values of every primary key that changes.
+std::map<std::string, std::map<std::string, std::string>> Table::enforceConstraintsOnUpdate(
+    const std::vector<size_t>& rowIds, const std::map<std::string, std::string>& newValues) const {
+    std::map<std::string, std::map<std::string, std::string>> keyChanges;
+    for (const auto& [fieldName, newValue] : newValues) {
+        const ValidationPlan::ColumnRule* rule = validationPlan.findColumn(fieldName);
+        if (!rule) {
+            throw std::invalid_argument("Field not found: " + fieldName);
+        }
+        ValidationPlan::validateValue(*rule, newValue);
+
+        // Constraints only apply when some row's value actually changes
+        bool changes = std::any_of(rowIds.begin(), rowIds.end(), [&](size_t rowId) {
+            auto it = records[rowId].find(fieldName);
+            return it == records[rowId].end() || it->second != newValue;
+        });
+        if (!changes) {
+            continue;
+        }
+
+        if (rule->primaryKey) {
+            std::set<std::string> released;
+            for (size_t rowId : rowIds) {
+                auto it = records[rowId].find(fieldName);
+                released.insert(it != records[rowId].end() ? it->second : "");
+            }
+            std::set<std::string> claimed;
+            const std::set<std::string>& existing = uniqueFields.at(fieldName);
+            for (size_t rowId : rowIds) {
+                if (!claimed.insert(newValue).second || (existing.count(newValue) > 0 && released.count(newValue) == 0)) {
+                    throw std::invalid_argument("Primary key constraint violated for field: " + fieldName);
+                }
+                auto it = records[rowId].find(fieldName);
+                const std::string& oldValue = it != records[rowId].end() ? it->second : "";
+                if (oldValue != newValue) {
+                    keyChanges[fieldName][oldValue] = newValue;
                 }
             }
-
-            // Apply the updates
-            record = updatedRecord;
+        }
+        if (rule->foreignKey) {
+            if (!checkForeignKeyConstraint(rule->foreignKey->getReferencedTable(),
+                                           rule->foreignKey->getReferencedColumn(), newValue)) {
+                throw std::invalid_argument("Foreign key constraint violated for field: " + fieldName);
+            }
         }
     }
+    return keyChanges;
+}
 
-    if (!updated) {
+// Update records based on conditions. Every row is checked before any is
+// changed, so a failing update leaves this table and those referencing it as
+// they were.
+size_t Table::updateRecords(const std::map<std::string, std::string>& newValues, const std::vector<SQLParser::Condition>& conditions) {
+    std::vector<size_t> rowIds = scanRowIds(Predicate::compile(conditions), {});
+    if (rowIds.empty()) {
         throw std::invalid_argument("No records matched the update conditions.");
     }
-}
 
+    // Phase one: validate the batch, including rows of other tables referencing a changed key
+    auto checkStart = std::chrono::steady_clock::now();
+    auto keyChanges = enforceConstraintsOnUpdate(rowIds, newValues);
+    EngineMetrics::get().constraintCheck.record(std::chrono::steady_clock::now() - checkStart);
+    enforceReferencesOnUpdate(keyChanges);
 
-// Delete records based on conditions
-void Table::deleteRecords(const std::vector<SQLParser::Condition>& conditions) {
-    auto it = records.begin();
-    bool deleted = false;  
+    // Observers get the old values of the rows that change
+    TableChange change{TableChange::Kind::Update, {}, {}};
+    if (!observers.empty()) {
+        for (size_t rowId : rowIds) {
+            change.before.push_back(records[rowId]);
+        }
+    }
 
-    while (it != records.end()) {
-        if (evaluateConditions(*it, conditions)) {
-            deleted = true;
-            // Update unique fields (if necessary)
-            for (const auto& [fieldName, field] : fields) {
-                auto uniqueIt = uniqueFields.find(fieldName);
-                if (uniqueIt != uniqueFields.end()) {
-                    uniqueIt->second.erase((*it)[fieldName]); // Remove value from unique set
+    // Phase two: apply the values and maintain the indexes in one pass. Unique
+    // keys are all released before any is claimed.
+    for (const auto& [fieldName, changes] : keyChanges) {
+        for (const auto& [oldValue, newValue] : changes) {
+            uniqueFields[fieldName].erase(oldValue);
+        }
+    }
+    size_t changedBlock = SIZE_MAX;
+    for (size_t rowId : rowIds) {
+        auto& record = records[rowId];
+        bool changed = false;
+        for (const auto& [fieldName, newValue] : newValues) {
+            std::string& value = record[fieldName];
+            if (value != newValue) {
+                reindexValue(fieldName, value, newValue, rowId);
+                value = newValue;
+                changed = true;
+            }
+        }
+        // Tighten the summaries of the blocks that changed; row ids ascend
+        if (changed && rowId / ZoneMap::blockSize != changedBlock) {
+            if (changedBlock != SIZE_MAX) {
+                zoneMap.rebuildBlock(records, changedBlock);
+            }
+            changedBlock = rowId / ZoneMap::blockSize;
+        }
+    }
+    if (changedBlock != SIZE_MAX) {
+        zoneMap.rebuildBlock(records, changedBlock);
+    }
+    for (const auto& [fieldName, changes] : keyChanges) {
+        for (const auto& [oldValue, newValue] : changes) {
+            uniqueFields[fieldName].insert(newValue);
+        }
+    }
+
+    modifiedRows += rowIds.size();
+    version = nextVersion();
+
+    if (!observers.empty()) {
+        size_t changed = 0;
+        for (size_t i = 0; i < rowIds.size(); ++i) {
+            if (records[rowIds[i]] != change.before[i]) {
+                if (changed != i) {
+                    change.before[changed] = std::move(change.before[i]);
                 }
+                ++changed;
+                change.after.push_back(records[rowIds[i]]);
+            }
+        }
+        change.before.resize(changed);
+        if (changed > 0) {
+            notify(change);
+        }
+    }
+    return rowIds.size();
+}
+
+// Move one row's value in the row and reverse-reference indexes
+void Table::reindexValue(const std::string& fieldName, const std::string& oldValue, const std::string& newValue, size_t rowId) {
+    auto index = rowIndex.find(fieldName);
+    if (index != rowIndex.end()) {
+        auto [begin, end] = index->second.equal_range(Predicate::equalityKey(oldValue));
+        for (auto it = begin; it != end; ++it) {
+            if (it->second == rowId) {
+                index->second.erase(it);
+                break;
             }
-            // Erase the record
-            it = records.erase(it);
-        } else {
-            ++it;
         }
+        index->second.emplace(Predicate::equalityKey(newValue), rowId);
     }
+    auto references = referenceRows.find(fieldName);
+    if (references != referenceRows.end()) {
+        auto it = references->second.find(oldValue);
+        if (it != references->second.end()) {
+            auto& rowIds = it->second;
+            rowIds.erase(std::find(rowIds.begin(), rowIds.end(), rowId));
+            if (rowIds.empty()) {
+                references->second.erase(it);
+            }
+        }
+        references->second[newValue].push_back(rowId);
+    }
+    auto trigrams = trigramIndexes.find(fieldName);
+    if (trigrams != trigramIndexes.end()) {
+        trigrams->second->update(rowId, oldValue, newValue);
+    }
+}
 
-    if (!deleted) {
+
+// Delete records based on conditions. Restricting references are checked
+// through every cascade before any row is removed.
+size_t Table::deleteRecords(const std::vector<SQLParser::Condition>& conditions) {
+    std::vector<size_t> rowIds = scanRowIds(Predicate::compile(conditions), {});
+
+    if (rowIds.empty()) {
         throw std::invalid_argument("No records matched the delete conditions.");
     }
+
+    checkReferencesOnDelete(rowIds);
+    deleteRows(rowIds);
+    return rowIds.size();
 }
 
-// Evaluate conditions for a record
-bool Table::evaluateConditions(const std::map<std::string, std::string>& record, const std::vector<SQLParser::Condition>& conditions) const {
-    if (conditions.empty()) {
-        return true; // No conditions, select all
+void Table::deleteRows(const std::vector<size_t>& rowIds) {
+    // Referencing rows in other tables go first
+    cascadeDeletes(rowIds);
+
+    // Update unique fields; the row and reverse-reference indexes are rebuilt below
+    for (size_t rowId : rowIds) {
+        const auto& record = records[rowId];
+        for (auto& [fieldName, values] : uniqueFields) {
+            values.erase(record.at(fieldName));
+        }
     }
+    modifiedRows += rowIds.size();
+    version = nextVersion();
 
-    bool result = evaluateCondition(record, conditions[0]);
-    for (size_t i = 1; i < conditions.size(); ++i) {
-        const auto& condition = conditions[i];
-        if (condition.relation == "AND") {
-            result = result && evaluateCondition(record, condition);
-        } else if (condition.relation == "OR") {
-            result = result || evaluateCondition(record, condition);
-        } else {
-            // Should not reach here
-            throw std::runtime_error("Unknown condition relation: " + condition.relation);
+    // Erase the records, compacting the survivors in one pass; observers get the erased ones
+    TableChange change{TableChange::Kind::Delete, {}, {}};
+    size_t next = 0;
+    size_t write = 0;
+    for (size_t read = 0; read < records.size(); ++read) {
+        if (next < rowIds.size() && rowIds[next] == read) {
+            if (!observers.empty()) {
+                change.before.push_back(std::move(records[read]));
+            }
+            ++next;
+            continue;
         }
+        if (write != read) {
+            records[write] = std::move(records[read]);
+        }
+        ++write;
     }
+    records.resize(write);
 
-    return result;
+    // Rows from the first deleted one onwards have moved
+    rebuildRowIndex();
+    for (auto& [fieldName, index] : trigramIndexes) {
+        index->removeRows(rowIds);
+    }
+    zoneMap.rebuildFrom(records, rowIds.front());
+
+    if (!observers.empty()) {
+        notify(change);
+    }
 }
 
-// Evaluate a single condition for a record
-bool Table::evaluateCondition(const std::map<std::string, std::string>& record, const SQLParser::Condition& condition) const {
-    auto it = record.find(condition.field);
-    if (it == record.end()) {
-        throw std::invalid_argument("Field not found in condition: " + condition.field);
+// The keys of the given rows that rows of 'reference' still point at
+std::set<std::string> Table::referencedKeys(const Database::ForeignKeyReference& reference,
+                                            const std::vector<size_t>& rowIds) const {
+    const std::string& keyField = reference.constraint->getReferencedColumn();
+    std::set<std::string> keys;
+    for (size_t rowId : rowIds) {
+        const std::string& key = records[rowId].at(keyField);
+        if (reference.table->countReferences(reference.fieldName, key) > 0) {
+            keys.insert(key);
+        }
     }
-    const std::string& value = it->second;
-    const std::string& condValue = condition.value;
+    return keys;
+}
 
-    if (condition.op == "=" || condition.op == "==") {
-        try{
-            bool check_truth = std::stod(value) == std::stod(condValue);
-            return check_truth;
-        }catch(std::invalid_argument& e){
-            return value == condValue;
+// Reject the deletion of rows whose keys are referenced without ON_DELETE_CASCADE,
+// following cascades down to the tables they would delete from
+void Table::checkReferencesOnDelete(const std::vector<size_t>& rowIds) const {
+    for (const auto& reference : database->getReferencingFields(name)) {
+        std::set<std::string> keys = referencedKeys(reference, rowIds);
+        if (keys.empty()) {
+            continue;
         }
-        // Should not reach here
-        std::cout << "Should not reach here" << std::endl;
-        return 0;
-    }else if (condition.op == "!=" || condition.op == "<>") {
-        try{
-            bool check_truth = std::stod(value) != std::stod(condValue);
-            return check_truth;
-        }catch(std::invalid_argument& e){
-            return value != condValue;
-        }
-        std::cout << "Should not reach here" << std::endl;
-        // Should not reach here
-        return 0;
-    } else if (condition.op == "<") {
-        bool check_truth = std::stod(value) < std::stod(condValue);   
-        return check_truth;
-    } else if (condition.op == ">") {
-        bool check_truth = std::stod(value) > std::stod(condValue);   
-        return check_truth;
-    } else if (condition.op == "<=") {
-        bool check_truth = std::stod(value) <= std::stod(condValue);   
-        return check_truth;
-    } else if (condition.op == ">=") {
-        bool check_truth = std::stod(value) >= std::stod(condValue);   
-        return check_truth;
-    } else {
-        throw std::runtime_error("Unsupported operator in condition: " + condition.op);
+        if (!reference.constraint->cascadesOnDelete()) {
+            throw std::invalid_argument("Foreign key constraint violated: " + name + "." +
+                                        reference.constraint->getReferencedColumn() + " is referenced by " +
+                                        reference.table->getName() + "." + reference.fieldName);
+        }
+        reference.table->checkReferencesOnDelete(reference.table->findReferencingRows(reference.fieldName, keys));
     }
 }
 
-// Get the name of the table
-std::string Table::getName() const {
-    return name;
+// ON_DELETE_CASCADE: remove the rows of other tables referencing the given rows
+void Table::cascadeDeletes(const std::vector<size_t>& rowIds) {
+    for (const auto& reference : database->getReferencingFields(name)) {
+        std::set<std::string> keys = referencedKeys(reference, rowIds);
+        if (!keys.empty()) {
+            std::vector<size_t> referencing = reference.table->findReferencingRows(reference.fieldName, keys);
+            reference.table->deleteRows(referencing);
+        }
+    }
 }
 
-// Get all records
-const std::vector<std::map<std::string, std::string>>& Table::getRecords() const {
-    return records;
+// Reject changed keys that are still referenced without ON_UPDATE_CASCADE;
+// once every reference allows the change, move the referencing rows along
+void Table::enforceReferencesOnUpdate(const std::map<std::string, std::map<std::string, std::string>>& keyChanges) {
+    if (keyChanges.empty()) {
+        return;
+    }
+    checkReferencesOnUpdate(keyChanges);
+    cascadeUpdates(keyChanges);
 }
 
-bool evaluateJoinCondition(
-    const std::map<std::string, std::string>& leftRecord,
-    const std::map<std::string, std::string>& rightRecord,
-    const SQLParser::Condition& condition) {
+// Follow the changed keys through every ON_UPDATE_CASCADE, down to the tables
+// whose own keys a cascade would move, before any row changes
+void Table::checkReferencesOnUpdate(const std::map<std::string, std::map<std::string, std::string>>& keyChanges) const {
+    for (const auto& reference : database->getReferencingFields(name)) {
+        auto changes = keyChanges.find(reference.constraint->getReferencedColumn());
+        if (changes == keyChanges.end()) {
+            continue;
+        }
+        bool referenced = std::any_of(changes->second.begin(), changes->second.end(), [&](const auto& change) {
+            return reference.table->countReferences(reference.fieldName, change.first) > 0;
+        });
+        if (!referenced) {
+            continue;
+        }
+        if (!reference.constraint->cascadesOnUpdate()) {
+            throw std::invalid_argument("Foreign key constraint violated: " + name + "." + changes->first +
+                                        " is referenced by " + reference.table->getName() + "." + reference.fieldName);
+        }
+        auto cascaded = reference.table->referencedKeyChanges(reference.fieldName, changes->second);
+        if (!cascaded.empty()) {
+            reference.table->checkReferencesOnUpdate(cascaded);
+        }
+    }
+}
 
-    auto getValue = [&](const std::map<std::string, std::string>& record, const std::string& fieldName) -> std::string {
-        size_t dotPos = fieldName.find('.');
-        std::string key = (dotPos != std::string::npos) ? fieldName.substr(dotPos + 1) : fieldName;
-        auto it = record.find(key);
-        if (it != record.end()) {
-            return it->second;
+// ON_UPDATE_CASCADE: move the rows of other tables referencing a changed key
+void Table::cascadeUpdates(const std::map<std::string, std::map<std::string, std::string>>& keyChanges) {
+    for (const auto& reference : database->getReferencingFields(name)) {
+        auto changes = keyChanges.find(reference.constraint->getReferencedColumn());
+        if (changes != keyChanges.end() && reference.constraint->cascadesOnUpdate()) {
+            reference.table->updateReferencing(reference.fieldName, changes->second);
         }
-        return ""; // Return empty string if not found
-    };
+    }
+}
 
-    std::string leftValue = getValue(leftRecord, condition.field);
-    std::string rightValue = getValue(rightRecord, condition.value); // Assuming 'value' holds the right field
+// Positions of the rows whose value of the field is one of the given values, ascending
+std::vector<size_t> Table::findReferencingRows(const std::string& fieldName, const std::set<std::string>& values) const {
+    const auto& references = referenceRows.at(fieldName);
+    std::vector<size_t> rowIds;
+    for (const auto& value : values) {
+        EngineMetrics::get().indexLookups.add();
+        auto it = references.find(value);
+        if (it != references.end()) {
+            rowIds.insert(rowIds.end(), it->second.begin(), it->second.end());
+        }
+    }
+    std::sort(rowIds.begin(), rowIds.end());
+    return rowIds;
+}
 
-    // Evaluate the condition
-    if (condition.op == "=") {
-        return leftValue == rightValue;
-    } else {
-        // Handle other operators if necessary
-        throw std::runtime_error("Unsupported operator in join condition: " + condition.op);
+// The primary keys of this table that a cascaded update of a key column
+// moves: the changes whose old key some row holds
+std::map<std::string, std::map<std::string, std::string>> Table::referencedKeyChanges(
+    const std::string& fieldName, const std::map<std::string, std::string>& changes) const {
+    std::map<std::string, std::map<std::string, std::string>> keyChanges;
+    if (uniqueFields.count(fieldName) == 0) {
+        return keyChanges;
+    }
+    for (const auto& [oldValue, newValue] : changes) {
+        if (countReferences(fieldName, oldValue) > 0) {
+            keyChanges[fieldName][oldValue] = newValue;
+        }
     }
+    return keyChanges;
 }
 
+// ON_UPDATE_CASCADE: move every row referencing an old key to its new one,
+// after the tables referencing the keys this moves in turn
+void Table::updateReferencing(const std::string& fieldName, const std::map<std::string, std::string>& changes) {
+    cascadeUpdates(referencedKeyChanges(fieldName, changes));
 
-std::vector<std::map<std::string, std::string>> Table::performInnerJoin(
-    const std::vector<std::map<std::string, std::string>>& leftRecords,
-    const std::vector<std::map<std::string, std::string>>& rightRecords,
-    const SQLParser::Condition& joinCondition,
-    const std::string& rightTableName,
-    const std::string& leftTableName) {
+    std::vector<size_t> rowIds;
+    for (const auto& [oldValue, newValue] : changes) {
+        EngineMetrics::get().indexLookups.add();
+        auto it = referenceRows.at(fieldName).find(oldValue);
+        if (it != referenceRows.at(fieldName).end()) {
+            rowIds.insert(rowIds.end(), it->second.begin(), it->second.end());
+        }
+    }
+    if (rowIds.empty()) {
+        return;
+    }
+    std::sort(rowIds.begin(), rowIds.end());
 
-    std::vector<std::map<std::string, std::string>> result;
+    auto unique = uniqueFields.find(fieldName);
+    std::vector<std::string> claimed;
+    std::set<size_t> changedBlocks;
+    TableChange rowChanges{TableChange::Kind::Update, {}, {}};
+    for (size_t rowId : rowIds) {
+        auto it = records[rowId].find(fieldName);
+        const std::string& newValue = changes.at(it->second);
+        if (unique != uniqueFields.end()) {
+            unique->second.erase(it->second);
+            claimed.push_back(newValue);
+        }
+        if (!observers.empty()) {
+            rowChanges.before.push_back(records[rowId]);
+        }
+        reindexValue(fieldName, it->second, newValue, rowId);
+        it->second = newValue;
+        if (!observers.empty()) {
+            rowChanges.after.push_back(records[rowId]);
+        }
+        ++modifiedRows;
+        changedBlocks.insert(rowId / ZoneMap::blockSize);
+    }
+    if (unique != uniqueFields.end()) {
+        unique->second.insert(claimed.begin(), claimed.end());
+    }
+    version = nextVersion();
+    for (size_t block : changedBlocks) {
+        zoneMap.rebuildBlock(records, block);
+    }
+    if (!rowChanges.before.empty()) {
+        notify(rowChanges);
+    }
+}
 
-    for (const auto& leftRecord : leftRecords) {
-        for (const auto& rightRecord : rightRecords) {
-            if (evaluateJoinCondition(leftRecord, rightRecord, joinCondition)) {
-                // Copy the leftRecord as is
-                std::map<std::string, std::string> combinedRecord;
-                
-                // Prefix right table fields
-                for (const auto& [key, value] : leftRecord) {
-                    combinedRecord[leftTableName + "." + key] = value;
-                }
+// Get the name of the table
+std::string Table::getName() const {
+    return name;
+}
 
-                // Prefix right table fields
-                for (const auto& [key, value] : rightRecord) {
-                    combinedRecord[rightTableName + "." + key] = value;
-                }
+void Table::addObserver(TableObserver* observer) {
+    observers.push_back(observer);
+}
+
+void Table::removeObserver(TableObserver* observer) {
+    observers.erase(std::remove(observers.begin(), observers.end(), observer), observers.end());
+}
+
+void Table::notify(const TableChange& change) {
+    // An observer may remove itself while being told
+    std::vector<TableObserver*> current = observers;
+    for (TableObserver* observer : current) {
+        observer->tableChanged(*this, change);
+    }
+}
+
+void Table::replaceRows(std::vector<std::map<std::string, std::string>> rows) {
+    TableChange removed{TableChange::Kind::Delete, {}, {}};
+    if (!observers.empty()) {
+        removed.before = std::move(records);
+    }
+    records = std::move(rows);
+    modifiedRows += removed.before.size() + records.size();
+    version = nextVersion();
+    rebuildIndexes();
+
+    if (!observers.empty()) {
+        if (!removed.before.empty()) {
+            notify(removed);
+        }
+        if (!records.empty()) {
+            notify({TableChange::Kind::Insert, {}, records});
+        }
+    }
+}
+
+void Table::appendRows(const std::vector<std::map<std::string, std::string>>& rows) {
+    if (rows.empty()) {
+        return;
+    }
+    reserveRows(records, rows.size());
+    for (const auto& record : rows) {
+        records.push_back(record);
+        indexRecord(records.back(), records.size() - 1);
+        zoneMap.append(records.back(), records.size() - 1);
+    }
+    modifiedRows += rows.size();
+    version = nextVersion();
+    if (!observers.empty()) {
+        notify({TableChange::Kind::Insert, {}, rows});
+    }
+}
 
-                result.push_back(combinedRecord);
+void Table::removeRows(const std::vector<size_t>& rowIds) {
+    if (!rowIds.empty()) {
+        deleteRows(rowIds);
+    }
+}
+
+void Table::setRows(const std::vector<std::pair<size_t, std::map<std::string, std::string>>>& rows) {
+    if (rows.empty()) {
+        return;
+    }
+    TableChange change{TableChange::Kind::Update, {}, {}};
+    size_t changedBlock = SIZE_MAX;
+    for (const auto& [rowId, values] : rows) {
+        auto& record = records[rowId];
+        if (!observers.empty()) {
+            change.before.push_back(record);
+        }
+        for (const auto& [fieldName, newValue] : values) {
+            std::string& value = record[fieldName];
+            if (value != newValue) {
+                reindexValue(fieldName, value, newValue, rowId);
+                value = newValue;
             }
         }
+        // Each block's summary is rebuilt once, after its last row changed
+        if (rowId / ZoneMap::blockSize != changedBlock) {
+            if (changedBlock != SIZE_MAX) {
+                zoneMap.rebuildBlock(records, changedBlock);
+            }
+            changedBlock = rowId / ZoneMap::blockSize;
+        }
+        if (!observers.empty()) {
+            change.after.push_back(record);
+        }
+    }
+    zoneMap.rebuildBlock(records, changedBlock);
+    modifiedRows += rows.size();
+    version = nextVersion();
+    if (!observers.empty()) {
+        notify(change);
     }
+}
 
-    return result;
+// Get all records
+const std::vector<std::map<std::string, std::string>>& Table::getRecords() const {
+    return records;
 }
 
+std::vector<size_t> Table::scanRowIds(const std::vector<Predicate>& predicates, const std::vector<JoinKeyFilter>& filters,
+                                      OperatorStats* scanStats) const {
+    static const std::vector<PipelineColumn> noColumns;
+    ScanOperator scan(*this, 0, predicates, filters, noColumns, 1);
+    ColumnBatch batch;
+    std::vector<size_t> rowIds;
+    while (scan.next(batch)) {
+        for (uint32_t row : batch.selection) {
+            rowIds.push_back(batch.rowIds[0][row]);
+        }
+    }
+    if (scanStats) {
+        scanStats->rowsIn += scan.getRowsRead();
+    }
+    return rowIds;
+}
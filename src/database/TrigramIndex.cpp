@@ -0,0 +1,180 @@
+#include "../../include/database/TrigramIndex.h"
+#include <algorithm>
+#include <iterator>
+
+TrigramIndex::TrigramIndex(const std::string& name, const std::string& column)
+    : name(name), column(column) {}
+
+std::vector<uint32_t> TrigramIndex::trigramsOf(std::string_view value) {
+    std::vector<uint32_t> trigrams;
+    for (size_t i = 0; i + 3 <= value.size(); ++i) {
+        trigrams.push_back(static_cast<uint32_t>(static_cast<unsigned char>(value[i])) << 16 |
+                           static_cast<uint32_t>(static_cast<unsigned char>(value[i + 1])) << 8 |
+                           static_cast<unsigned char>(value[i + 2]));
+    }
+    std::sort(trigrams.begin(), trigrams.end());
+    trigrams.erase(std::unique(trigrams.begin(), trigrams.end()), trigrams.end());
+    return trigrams;
+}
+
+std::vector<uint32_t> TrigramIndex::trigramsOf(const LikePattern& pattern) {
+    std::vector<uint32_t> trigrams;
+    for (std::string_view literal : pattern.getLiterals()) {
+        std::vector<uint32_t> more = trigramsOf(literal);
+        trigrams.insert(trigrams.end(), more.begin(), more.end());
+    }
+    std::sort(trigrams.begin(), trigrams.end());
+    trigrams.erase(std::unique(trigrams.begin(), trigrams.end()), trigrams.end());
+    return trigrams;
+}
+
+void TrigramIndex::build(const std::vector<std::map<std::string, std::string>>& records) {
+    postings.clear();
+    for (size_t rowId = 0; rowId < records.size(); ++rowId) {
+        auto it = records[rowId].find(column);
+        if (it != records[rowId].end()) {
+            insert(rowId, it->second);
+        }
+    }
+}
+
+void TrigramIndex::insert(size_t rowId, std::string_view value) {
+    uint32_t row = static_cast<uint32_t>(rowId);
+    for (uint32_t trigram : trigramsOf(value)) {
+        std::vector<uint32_t>& rows = postings[trigram];
+        // Appended rows come last, so the list usually just grows
+        if (rows.empty() || rows.back() < row) {
+            rows.push_back(row);
+        } else {
+            auto at = std::lower_bound(rows.begin(), rows.end(), row);
+            if (at == rows.end() || *at != row) {
+                rows.insert(at, row);
+            }
+        }
+    }
+}
+
+void TrigramIndex::update(size_t rowId, std::string_view oldValue, std::string_view newValue) {
+    uint32_t row = static_cast<uint32_t>(rowId);
+    std::vector<uint32_t> before = trigramsOf(oldValue);
+    std::vector<uint32_t> after = trigramsOf(newValue);
+
+    // Trigrams both values hold keep the row
+    std::vector<uint32_t> removed;
+    std::set_difference(before.begin(), before.end(), after.begin(), after.end(), std::back_inserter(removed));
+    for (uint32_t trigram : removed) {
+        auto list = postings.find(trigram);
+        if (list == postings.end()) {
+            continue;
+        }
+        std::vector<uint32_t>& rows = list->second;
+        auto at = std::lower_bound(rows.begin(), rows.end(), row);
+        if (at != rows.end() && *at == row) {
+            rows.erase(at);
+        }
+        if (rows.empty()) {
+            postings.erase(list);
+        }
+    }
+
+    std::vector<uint32_t> added;
+    std::set_difference(after.begin(), after.end(), before.begin(), before.end(), std::back_inserter(added));
+    for (uint32_t trigram : added) {
+        std::vector<uint32_t>& rows = postings[trigram];
+        auto at = std::lower_bound(rows.begin(), rows.end(), row);
+        if (at == rows.end() || *at != row) {
+            rows.insert(at, row);
+        }
+    }
+}
+
+void TrigramIndex::removeRows(const std::vector<size_t>& rowIds) {
+    if (rowIds.empty()) {
+        return;
+    }
+    for (auto list = postings.begin(); list != postings.end();) {
+        std::vector<uint32_t>& rows = list->second;
+
+        // Rows before the first deleted one stay where they are
+        size_t write = std::lower_bound(rows.begin(), rows.end(), rowIds.front()) - rows.begin();
+        auto deleted = rowIds.begin();
+        for (size_t read = write; read < rows.size(); ++read) {
+            deleted = std::lower_bound(deleted, rowIds.end(), rows[read]);
+            if (deleted != rowIds.end() && *deleted == rows[read]) {
+                continue;
+            }
+            // Shift down by the number of deleted rows before this one
+            rows[write++] = rows[read] - static_cast<uint32_t>(deleted - rowIds.begin());
+        }
+        rows.resize(write);
+
+        if (rows.empty()) {
+            list = postings.erase(list);
+        } else {
+            ++list;
+        }
+    }
+}
+
+bool TrigramIndex::canFilter(const LikePattern& pattern) {
+    for (std::string_view literal : pattern.getLiterals()) {
+        if (literal.size() >= 3) {
+            return true;
+        }
+    }
+    return false;
+}
+
+std::vector<size_t> TrigramIndex::candidates(const LikePattern& pattern) const {
+    // A trigram no row holds rules out every row
+    std::vector<const std::vector<uint32_t>*> lists;
+    for (uint32_t trigram : trigramsOf(pattern)) {
+        auto list = postings.find(trigram);
+        if (list == postings.end()) {
+            return {};
+        }
+        lists.push_back(&list->second);
+    }
+    if (lists.empty()) {
+        return {};
+    }
+
+    // Intersect starting from the shortest list; each survivor is searched
+    // for in the next list from where the previous one was found
+    std::sort(lists.begin(), lists.end(), [](const auto* a, const auto* b) { return a->size() < b->size(); });
+    std::vector<size_t> rowIds(lists[0]->begin(), lists[0]->end());
+    for (size_t i = 1; i < lists.size() && !rowIds.empty(); ++i) {
+        const std::vector<uint32_t>& rows = *lists[i];
+        auto from = rows.begin();
+        size_t kept = 0;
+        for (size_t rowId : rowIds) {
+            from = std::lower_bound(from, rows.end(), static_cast<uint32_t>(rowId));
+            if (from == rows.end()) {
+                break;
+            }
+            if (*from == rowId) {
+                rowIds[kept++] = rowId;
+            }
+        }
+        rowIds.resize(kept);
+    }
+    return rowIds;
+}
+
+size_t TrigramIndex::estimateCandidates(const LikePattern& pattern) const {
+    size_t shortest = SIZE_MAX;
+    for (uint32_t trigram : trigramsOf(pattern)) {
+        auto list = postings.find(trigram);
+        shortest = std::min(shortest, list != postings.end() ? list->second.size() : 0);
+    }
+    return shortest;
+}
+
+size_t TrigramIndex::memoryUsage() const {
+    // Hash nodes: link, cached hash, the trigram and the list header, plus the list itself
+    size_t bytes = postings.bucket_count() * sizeof(void*);
+    for (const auto& [trigram, rows] : postings) {
+        bytes += 2 * sizeof(void*) + sizeof(uint32_t) + sizeof(rows) + rows.capacity() * sizeof(uint32_t);
+    }
+    return bytes;
+}
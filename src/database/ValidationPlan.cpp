@@ -0,0 +1,115 @@
+#include "../../include/database/ValidationPlan.h"
+#include "../../include/database/ValueParser.h"
+#include <algorithm>
+#include <stdexcept>
+
+// Add a column's rules to the plan
+void ValidationPlan::addField(const Field& field) {
+    ColumnRule rule{field.getName(), field.getDataType()->getKind(), 0, false, false, nullptr};
+
+    if (rule.kind == DataKind::Varchar) {
+        rule.maxLength = static_cast<const VarcharType*>(field.getDataType())->getMaxLength();
+    }
+
+    for (const auto& constraint : field.getConstraints()) {
+        switch (constraint->getKind()) {
+            case ConstraintKind::NotEmpty:
+                rule.notEmpty = true;
+                break;
+            case ConstraintKind::PrimaryKey:
+                rule.primaryKey = true;
+                break;
+            case ConstraintKind::ForeignKey:
+                rule.foreignKey = static_cast<const ForeignKeyConstraint*>(constraint);
+                break;
+        }
+    }
+
+    // Keep the rules sorted by name, like the table's field map
+    auto position = std::lower_bound(columns.begin(), columns.end(), rule.name,
+                                     [](const ColumnRule& column, const std::string& name) { return column.name < name; });
+    columns.insert(position, std::move(rule));
+    rebuildColumnLists();
+}
+
+void ValidationPlan::rebuildColumnLists() {
+    primaryKeyColumns.clear();
+    foreignKeyColumns.clear();
+    for (size_t i = 0; i < columns.size(); ++i) {
+        if (columns[i].primaryKey) {
+            primaryKeyColumns.push_back(i);
+        }
+        if (columns[i].foreignKey) {
+            foreignKeyColumns.push_back(i);
+        }
+    }
+}
+
+const ValidationPlan::ColumnRule* ValidationPlan::findColumn(const std::string& name) const {
+    auto position = std::lower_bound(columns.begin(), columns.end(), name,
+                                     [](const ColumnRule& column, const std::string& name) { return column.name < name; });
+    if (position == columns.end() || position->name != name) {
+        return nullptr;
+    }
+    return &*position;
+}
+
+const char* ValidationPlan::check(const ColumnRule& rule, std::string_view value) {
+    switch (rule.kind) {
+        case DataKind::Varchar:
+            if (value.size() > rule.maxLength) {
+                return "Value exceeds maximum length for Varchar";
+            }
+            break;
+        case DataKind::Int: {
+            int32_t parsed;
+            if (!ValueParser::parseInt(value, parsed)) {
+                return "Invalid value for Int";
+            }
+            break;
+        }
+        case DataKind::LongInt: {
+            int64_t parsed;
+            if (!ValueParser::parseLongInt(value, parsed)) {
+                return "Invalid value for LongInt";
+            }
+            break;
+        }
+        case DataKind::Double: {
+            double parsed;
+            if (!ValueParser::parseDouble(value, parsed)) {
+                return "Invalid value for Double";
+            }
+            break;
+        }
+        case DataKind::DateTime:
+            if (!ValueParser::parseDateTime(value)) {
+                return "Invalid value for DateTime";
+            }
+            break;
+    }
+
+    if (rule.notEmpty && value.empty()) {
+        return "Value cannot be empty.";
+    }
+
+    // Primary and foreign keys are enforced at the table level
+    return nullptr;
+}
+
+void ValidationPlan::validateValue(const ColumnRule& rule, std::string_view value) {
+    if (const char* error = check(rule, value)) {
+        throw std::invalid_argument(error);
+    }
+}
+
+void ValidationPlan::validateRecord(const std::map<std::string, std::string>& record) const {
+    for (const auto& rule : columns) {
+        auto it = record.find(rule.name);
+        if (it == record.end()) {
+            // Handle missing field (e.g., default values or error)
+            throw std::invalid_argument("Missing value for field: " + rule.name);
+        }
+        validateValue(rule, it->second);
+    }
+}
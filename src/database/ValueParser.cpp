@@ -0,0 +1,83 @@
+#include "../../include/database/ValueParser.h"
+#include <cctype>
+#include <charconv>
+
+// Drop an explicit '+' sign, which std::from_chars does not accept
+static std::string_view stripPlus(std::string_view text) {
+    if (text.size() > 1 && text[0] == '+' && text[1] != '-' && text[1] != '+') {
+        return text.substr(1);
+    }
+    return text;
+}
+
+// Parse the whole of 'text' as a number of type T
+template <typename T>
+static bool parseWhole(std::string_view text, T& out) {
+    text = stripPlus(text);
+    const char* end = text.data() + text.size();
+    auto [ptr, ec] = std::from_chars(text.data(), end, out);
+    return ec == std::errc() && ptr == end && !text.empty();
+}
+
+bool ValueParser::parseInt(std::string_view text, int32_t& out) {
+    return parseWhole(text, out);
+}
+
+bool ValueParser::parseLongInt(std::string_view text, int64_t& out) {
+    return parseWhole(text, out);
+}
+
+bool ValueParser::parseDouble(std::string_view text, double& out) {
+    return parseWhole(text, out);
+}
+
+// Read exactly 'width' digits starting at 'pos'
+static bool readDigits(std::string_view text, size_t pos, size_t width, int& out) {
+    out = 0;
+    for (size_t i = pos; i < pos + width; ++i) {
+        if (text[i] < '0' || text[i] > '9') {
+            return false;
+        }
+        out = out * 10 + (text[i] - '0');
+    }
+    return true;
+}
+
+bool ValueParser::parseDateTime(std::string_view text) {
+    // YYYY-MM-DD HH:MM:SS
+    if (text.size() != 19 || text[4] != '-' || text[7] != '-' || text[10] != ' ' ||
+        text[13] != ':' || text[16] != ':') {
+        return false;
+    }
+
+    int year, month, day, hour, minute, second;
+    if (!readDigits(text, 0, 4, year) || !readDigits(text, 5, 2, month) || !readDigits(text, 8, 2, day) ||
+        !readDigits(text, 11, 2, hour) || !readDigits(text, 14, 2, minute) || !readDigits(text, 17, 2, second)) {
+        return false;
+    }
+
+    static const int daysInMonth[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    if (month < 1 || month > 12) {
+        return false;
+    }
+    bool leapYear = (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+    int monthLength = daysInMonth[month - 1] + (month == 2 && leapYear ? 1 : 0);
+
+    return day >= 1 && day <= monthLength && hour <= 23 && minute <= 59 && second <= 59;
+}
+
+bool ValueParser::parseLeadingDouble(std::string_view text, double& out) {
+    size_t pos = 0;
+    while (pos < text.size() && std::isspace(static_cast<unsigned char>(text[pos]))) {
+        ++pos;
+    }
+    text = stripPlus(text.substr(pos));
+    auto [ptr, ec] = std::from_chars(text.data(), text.data() + text.size(), out);
+    return ec == std::errc();
+}
+
+std::string ValueParser::formatDouble(double value) {
+    char buffer[64];
+    auto [end, ec] = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    return std::string(buffer, end);
+}
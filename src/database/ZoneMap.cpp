@@ -0,0 +1,140 @@
+#include "../../include/database/ZoneMap.h"
+#include "../../include/database/ValueParser.h"
+#include <algorithm>
+#include <cmath>
+
+void ZoneMap::ColumnSummary::add(const std::string& value) {
+    if (value.empty()) {
+        ++emptyCount;
+        return;
+    }
+
+    if (valueCount == 0) {
+        minString = maxString = value;
+    } else if (value < minString) {
+        minString = value;
+    } else if (maxString < value) {
+        maxString = value;
+    }
+    ++valueCount;
+
+    double number;
+    if (!ValueParser::parseDouble(value, number)) {
+        return;
+    }
+    if (std::isnan(number)) {
+        hasNaN = true;
+        return;
+    }
+    if (numberCount == 0) {
+        minNumber = maxNumber = number;
+    } else {
+        minNumber = std::min(minNumber, number);
+        maxNumber = std::max(maxNumber, number);
+    }
+    ++numberCount;
+}
+
+bool ZoneMap::ColumnSummary::mayMatch(const Predicate& predicate) const {
+    if (hasNaN) {
+        return true;
+    }
+    // Empty values compare as strings
+    if (emptyCount > 0 && predicate.matches("")) {
+        return true;
+    }
+    if (valueCount == 0) {
+        return false;
+    }
+    if (!predicate.isNumeric()) {
+        return predicate.mayMatchStrings(minString, maxString);
+    }
+    // A numeric operand compares numerically with numbers and as a string with
+    // everything else; the string range also covers the numbers, so it is
+    // only consulted when the block holds some non-numeric value
+    if (numberCount > 0 && predicate.mayMatchNumbers(minNumber, maxNumber)) {
+        return true;
+    }
+    return numberCount < valueCount && predicate.mayMatchStrings(minString, maxString);
+}
+
+void ZoneMap::setColumns(const std::vector<std::string>& columnNames) {
+    columns = columnNames;
+    blocks.clear();
+}
+
+int ZoneMap::columnIndex(const std::string& name) const {
+    auto it = std::lower_bound(columns.begin(), columns.end(), name);
+    return it != columns.end() && *it == name ? static_cast<int>(it - columns.begin()) : -1;
+}
+
+void ZoneMap::addRow(std::vector<ColumnSummary>& block, const std::map<std::string, std::string>& record) const {
+    // Both the record and the column list are sorted by name: walk them together
+    auto it = record.begin();
+    for (size_t column = 0; column < columns.size(); ++column) {
+        while (it != record.end() && it->first < columns[column]) {
+            ++it;
+        }
+        if (it != record.end() && it->first == columns[column]) {
+            block[column].add(it->second);
+        } else {
+            block[column].add("");
+        }
+    }
+}
+
+size_t ZoneMap::memoryUsage() const {
+    size_t bytes = 0;
+    for (const auto& block : blocks) {
+        bytes += sizeof(block) + block.capacity() * sizeof(ColumnSummary);
+        for (const auto& summary : block) {
+            bytes += summary.minString.size() > 15 ? summary.minString.capacity() : 0;
+            bytes += summary.maxString.size() > 15 ? summary.maxString.capacity() : 0;
+        }
+    }
+    return bytes;
+}
+
+void ZoneMap::rebuild(const std::vector<std::map<std::string, std::string>>& records) {
+    blocks.clear();
+    rebuildFrom(records, 0);
+}
+
+void ZoneMap::rebuildFrom(const std::vector<std::map<std::string, std::string>>& records, size_t firstRow) {
+    size_t firstBlock = firstRow / blockSize;
+    size_t blockCount = (records.size() + blockSize - 1) / blockSize;
+    blocks.resize(std::min(blocks.size(), firstBlock));
+    for (size_t block = blocks.size(); block < blockCount; ++block) {
+        blocks.emplace_back();
+        rebuildBlock(records, block);
+    }
+}
+
+void ZoneMap::rebuildBlock(const std::vector<std::map<std::string, std::string>>& records, size_t block) {
+    std::vector<ColumnSummary>& summary = blocks.at(block);
+    summary.assign(columns.size(), ColumnSummary());
+    size_t end = std::min(records.size(), (block + 1) * blockSize);
+    for (size_t row = block * blockSize; row < end; ++row) {
+        addRow(summary, records[row]);
+    }
+}
+
+void ZoneMap::append(const std::map<std::string, std::string>& record, size_t rowId) {
+    if (rowId / blockSize >= blocks.size()) {
+        blocks.emplace_back(columns.size());
+    }
+    addRow(blocks.back(), record);
+}
+
+void ZoneMap::widen(const std::map<std::string, std::string>& record, size_t rowId) {
+    addRow(blocks.at(rowId / blockSize), record);
+}
+
+bool ZoneMap::mayMatch(size_t block, const std::vector<Predicate>& predicates) const {
+    const std::vector<ColumnSummary>& summary = blocks[block];
+    return Predicate::combine(predicates, [&](const Predicate& predicate) {
+        int column = columnIndex(predicate.getField());
+        // Unknown columns are left to row evaluation, which reports them
+        return column < 0 || summary[column].mayMatch(predicate);
+    });
+}
@@ -1,114 +1,242 @@
-#include "../include/database/Table.h"
-#include "../include/database/Field.h"
-#include "../include/database/Constraint.h"
-#include "../include/sql/SQLParser.h"
-#include "../include/database/Datatype.h"
-#include "database/Database.h"
-
-#include <iostream>
-#include <fstream>
-#include <string>
-
-void read_from_file(const std::string& filename, Database& db) {
-    std::ifstream inputFile(filename);
-
-    if (!inputFile) {
-        std::cerr << "Unable to open file: " << filename << std::endl;
-        return;
-    }
-
-    std::string line;
-    std::string sql;
-    SQLParser parser;
-
-    // Read the file line by line
-    while (std::getline(inputFile, line)) {
-        // Append the line to the current SQL command
-        sql += line + "\n";
-
-        // Check if the line ends with a semicolon
-        if (!line.empty() && line.back() == ';') {
-            try {
-                SQLParser::Query query = parser.parse(sql);
-                db.executeQuery(query);
-            } catch (const std::exception& e) {
-                std::cerr << e.what() << std::endl;
-            }
-            sql.clear(); // Reset for the next command
-        }
-    }
-
-    // Handle any remaining SQL command without a trailing semicolon
-    if (!sql.empty()) {
-        try {
-            SQLParser::Query query = parser.parse(sql);
-            db.executeQuery(query);
-        } catch (const std::exception& e) {
-            std::cerr << e.what() << std::endl;
-        }
-    }
-
-    inputFile.close();
-}
-
-int main() {
-    Database db;
-
-    while (true) {
-        std::cout << "Enter the SQL command or CLI command: ";
-        std::string input;
-        std::getline(std::cin, input);
-
-        // Trim leading and trailing whitespace
-        input.erase(0, input.find_first_not_of(" \t\n\r"));
-        input.erase(input.find_last_not_of(" \t\n\r") + 1);
-
-        // Check for 'exit' command
-        if (input == "exit") {
-            break;
-        }
-
-        try {
-            // Check if the command is 'i "filename"' or 'i filename'
-            if (input.length() > 2 && input[0] == 'i' && (input[1] == ' ' || input[1] == '\t')) {
-                std::string filename = input.substr(2);
-                // Trim leading whitespace
-                filename.erase(0, filename.find_first_not_of(" \t\n\r"));
-
-                // Remove surrounding quotes if present
-                if (!filename.empty() && ((filename.front() == '"' && filename.back() == '"') ||
-                                          (filename.front() == '\'' && filename.back() == '\''))) {
-                    filename = filename.substr(1, filename.size() - 2);
-                }
-
-                read_from_file(filename, db);
-            } else {
-                // Process SQL command
-                SQLParser parser;
-                std::string sql = input;
-
-                // Continue reading lines if the command is incomplete (no semicolon at the end)
-                while (!sql.empty() && sql.back() != ';') {
-                    std::cout << "-> ";
-                    std::string nextLine;
-                    std::getline(std::cin, nextLine);
-                    sql += "\n" + nextLine;
-                }
-
-                // Remove the trailing semicolon
-                if (!sql.empty() && sql.back() == ';') {
-                    sql.pop_back();
-                }
-
-                SQLParser::Query query = parser.parse(sql);
-                db.executeQuery(query);
-            }
-        } catch (const std::exception& e) {
-            std::cerr << "Error: " << e.what() << std::endl;
-        }
-    }
-
-    return 0;
-}
-
-
+#include "reldb/Connection.h"
+#include "database/Metrics.h"
+#include "database/ChangeStream.h"
+#include "database/QueryLog.h"
+
+#include <iostream>
+#include <fstream>
+#include <memory>
+#include <string>
+
+void read_from_file(const std::string& filename, Connection& connection) {
+    std::ifstream inputFile(filename);
+
+    if (!inputFile) {
+        std::cerr << "Unable to open file: " << filename << std::endl;
+        return;
+    }
+
+    std::string line;
+    std::string sql;
+
+    // Read the file line by line
+    while (std::getline(inputFile, line)) {
+        // Append the line to the current SQL command
+        sql += line + "\n";
+
+        // Check if the line ends with a semicolon
+        if (!line.empty() && line.back() == ';') {
+            try {
+                connection.execute(sql);
+            } catch (const std::exception& e) {
+                std::cerr << e.what() << std::endl;
+            }
+            sql.clear(); // Reset for the next command
+        }
+    }
+
+    // Handle any remaining SQL command without a trailing semicolon
+    if (!sql.empty()) {
+        try {
+            connection.execute(sql);
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << std::endl;
+        }
+    }
+
+    inputFile.close();
+}
+
+// Handle backslash commands; returns false if the input is not one
+bool run_cli_command(const std::string& input, const Connection& connection) {
+    if (input == "\\stats") {
+        MetricsRegistry::instance().writeSummary(std::cout);
+    } else if (input == "\\stats prometheus") {
+        MetricsRegistry::instance().writePrometheus(std::cout);
+    } else if (input == "\\memory") {
+        connection.writeMemoryReport(std::cout);
+    } else {
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    Connection connection;
+    connection.setOutput(&std::cout);
+
+    // --metrics-file PATH [--metrics-interval SECONDS]: keep a Prometheus text file up to date
+    // --query-log PATH: append every statement to a JSONL query log
+    // --replay LOG [--snapshot FILE] [--fast]: re-run a captured log and report latencies
+    // --slow-queries LOG [--threshold-ms MS]: report the slow statements of a captured log
+    // --analyze-fraction F: re-analyze a table once this fraction of its rows has changed
+    // --query-memory MB: memory budget of each query (0: unlimited)
+    // --join-threads N: threads a join's hash table is built on (default 0: one per core)
+    // --result-cache MB: keep this much of repeated SELECTs' results (default 0: off)
+    // --cdc-file PATH: append every row change to a JSONL change stream
+    // --cdc-socket PATH: serve the change stream on a Unix socket
+    std::string metricsFile;
+    long metricsInterval = 15;
+    std::string queryLogFile;
+    std::string replayLog;
+    std::string snapshotFile;
+    bool replayFast = false;
+    std::string slowQueryLog;
+    std::string changeFile;
+    std::string changeSocket;
+    double slowThresholdMs = 100.0;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--metrics-file" && i + 1 < argc) {
+            metricsFile = argv[++i];
+        } else if (arg == "--metrics-interval" && i + 1 < argc) {
+            metricsInterval = std::stol(argv[++i]);
+        } else if (arg == "--query-log" && i + 1 < argc) {
+            queryLogFile = argv[++i];
+        } else if (arg == "--replay" && i + 1 < argc) {
+            replayLog = argv[++i];
+        } else if (arg == "--snapshot" && i + 1 < argc) {
+            snapshotFile = argv[++i];
+        } else if (arg == "--fast") {
+            replayFast = true;
+        } else if (arg == "--slow-queries" && i + 1 < argc) {
+            slowQueryLog = argv[++i];
+        } else if (arg == "--threshold-ms" && i + 1 < argc) {
+            slowThresholdMs = std::stod(argv[++i]);
+        } else if (arg == "--query-memory" && i + 1 < argc) {
+            connection.setQueryMemoryLimit(static_cast<size_t>(std::stod(argv[++i]) * 1024 * 1024));
+        } else if (arg == "--join-threads" && i + 1 < argc) {
+            connection.setJoinThreads(static_cast<size_t>(std::stoul(argv[++i])));
+        } else if (arg == "--result-cache" && i + 1 < argc) {
+            connection.setResultCacheLimit(static_cast<size_t>(std::stod(argv[++i]) * 1024 * 1024));
+        } else if (arg == "--cdc-file" && i + 1 < argc) {
+            changeFile = argv[++i];
+        } else if (arg == "--cdc-socket" && i + 1 < argc) {
+            changeSocket = argv[++i];
+        } else if (arg == "--analyze-fraction" && i + 1 < argc) {
+            try {
+                connection.setAnalyzeFraction(std::stod(argv[++i]));
+            } catch (const std::exception& e) {
+                std::cerr << "Error: " << e.what() << std::endl;
+                return 1;
+            }
+        } else {
+            std::cerr << "Unknown argument: " << arg << std::endl;
+            return 1;
+        }
+    }
+
+    try {
+        if (!slowQueryLog.empty()) {
+            QueryLog::writeSlowQueryReport(QueryLog::read(slowQueryLog), slowThresholdMs, std::cout);
+            return 0;
+        }
+        if (!replayLog.empty()) {
+            std::vector<QueryLogEntry> entries = QueryLog::read(replayLog);
+            // Neither the snapshot's output nor query results are part of the report
+            connection.setOutput(nullptr);
+            if (!snapshotFile.empty()) {
+                read_from_file(snapshotFile, connection);
+            }
+            QueryLog::replay([&](const std::string& sql) { return connection.execute(sql).getRowsAffected(); },
+                             entries, !replayFast, std::cout);
+            return 0;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    std::unique_ptr<QueryLogWriter> queryLog;
+    if (!queryLogFile.empty()) {
+        try {
+            queryLog = std::make_unique<QueryLogWriter>(queryLogFile);
+        } catch (const std::exception& e) {
+            std::cerr << "Error: " << e.what() << std::endl;
+            return 1;
+        }
+        connection.setQueryLog(queryLog.get());
+    }
+
+    std::unique_ptr<ChangeStream> changeStream;
+    if (!changeFile.empty() || !changeSocket.empty()) {
+        try {
+            changeStream = std::make_unique<ChangeStream>();
+            if (!changeFile.empty()) {
+                changeStream->openFile(changeFile);
+            }
+            if (!changeSocket.empty()) {
+                changeStream->listen(changeSocket);
+            }
+        } catch (const std::exception& e) {
+            std::cerr << "Error: " << e.what() << std::endl;
+            return 1;
+        }
+        connection.setChangeStream(changeStream.get());
+    }
+
+    std::unique_ptr<MetricsExporter> metricsExporter;
+    if (!metricsFile.empty()) {
+        metricsExporter = std::make_unique<MetricsExporter>(metricsFile, std::chrono::seconds(metricsInterval));
+    }
+
+    while (true) {
+        std::cout << "Enter the SQL command or CLI command: ";
+        std::string input;
+        std::getline(std::cin, input);
+
+        // Trim leading and trailing whitespace
+        input.erase(0, input.find_first_not_of(" \t\n\r"));
+        input.erase(input.find_last_not_of(" \t\n\r") + 1);
+
+        // Check for 'exit' command
+        if (input == "exit") {
+            break;
+        }
+
+        try {
+            if (run_cli_command(input, connection)) {
+                continue;
+            }
+
+            // Check if the command is 'i "filename"' or 'i filename'
+            if (input.length() > 2 && input[0] == 'i' && (input[1] == ' ' || input[1] == '\t')) {
+                std::string filename = input.substr(2);
+                // Trim leading whitespace
+                filename.erase(0, filename.find_first_not_of(" \t\n\r"));
+
+                // Remove surrounding quotes if present
+                if (!filename.empty() && ((filename.front() == '"' && filename.back() == '"') ||
+                                          (filename.front() == '\'' && filename.back() == '\''))) {
+                    filename = filename.substr(1, filename.size() - 2);
+                }
+
+                read_from_file(filename, connection);
+            } else {
+                // Process SQL command
+                std::string sql = input;
+
+                // Continue reading lines if the command is incomplete (no semicolon at the end)
+                while (!sql.empty() && sql.back() != ';') {
+                    std::cout << "-> ";
+                    std::string nextLine;
+                    std::getline(std::cin, nextLine);
+                    sql += "\n" + nextLine;
+                }
+
+                // Remove the trailing semicolon
+                if (!sql.empty() && sql.back() == ';') {
+                    sql.pop_back();
+                }
+
+                connection.execute(sql);
+            }
+        } catch (const std::exception& e) {
+            std::cerr << "Error: " << e.what() << std::endl;
+        }
+    }
+
+    return 0;
+}
+
+
@@ -0,0 +1,53 @@
+#include "../../include/reldb/Connection.h"
+#include "../../include/database/Database.h"
+#include <utility>
+
+Connection::Connection() : database(std::make_unique<Database>()) {
+    database->setOutput(nullptr);
+}
+
+Connection::~Connection() = default;
+Connection::Connection(Connection&&) noexcept = default;
+Connection& Connection::operator=(Connection&&) noexcept = default;
+
+ResultSet Connection::execute(const std::string& sql) {
+    QueryResult result;
+    database->executeStatement(sql, &result);
+    return ResultSet(std::move(result));
+}
+
+Statement Connection::prepare(const std::string& sql) {
+    return Statement(*database, sql);
+}
+
+void Connection::setOutput(std::ostream* out) {
+    database->setOutput(out);
+}
+
+void Connection::setQueryLog(QueryLogWriter* log) {
+    database->setQueryLog(log);
+}
+
+void Connection::setAnalyzeFraction(double fraction) {
+    database->setAnalyzeFraction(fraction);
+}
+
+void Connection::setQueryMemoryLimit(size_t bytes) {
+    database->setQueryMemoryLimit(bytes);
+}
+
+void Connection::setJoinThreads(size_t threads) {
+    database->setJoinThreads(threads);
+}
+
+void Connection::setResultCacheLimit(size_t bytes) {
+    database->setResultCacheLimit(bytes);
+}
+
+void Connection::setChangeStream(ChangeStream* stream) {
+    database->setChangeStream(stream);
+}
+
+void Connection::writeMemoryReport(std::ostream& out) const {
+    database->writeMemoryReport(out);
+}
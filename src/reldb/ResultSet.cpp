@@ -0,0 +1,64 @@
+#include "../../include/reldb/ResultSet.h"
+#include "../../include/database/Database.h"
+#include "../../include/database/ValueParser.h"
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+int64_t ResultBatch::getInt(size_t column, size_t row) const {
+    int64_t value;
+    if (!ValueParser::parseLongInt(getText(column, row), value)) {
+        throw std::runtime_error("Value of column '" + getColumn(column).name + "' is not an integer");
+    }
+    return value;
+}
+
+double ResultBatch::getDouble(size_t column, size_t row) const {
+    double value;
+    if (!ValueParser::parseDouble(getText(column, row), value)) {
+        throw std::runtime_error("Value of column '" + getColumn(column).name + "' is not a number");
+    }
+    return value;
+}
+
+ResultSet::ResultSet(QueryResult&& result)
+    : columns(std::move(result.columns)), rows(result.rows.size()), rowsAffected(result.rowsAffected) {
+    // Each row's map is ordered by name, so it is walked once alongside the
+    // columns in name order
+    std::vector<size_t> byName(columns.size());
+    std::iota(byName.begin(), byName.end(), 0);
+    std::stable_sort(byName.begin(), byName.end(),
+                     [this](size_t a, size_t b) { return columns[a].name < columns[b].name; });
+
+    values.resize(columns.size());
+    for (auto& column : values) {
+        column.reserve(rows);
+    }
+    for (auto& row : result.rows) {
+        auto it = row.begin();
+        for (size_t i = 0; i < byName.size(); ++i) {
+            size_t column = byName[i];
+            const std::string& name = columns[column].name;
+            if (i > 0 && columns[byName[i - 1]].name == name) {
+                values[column].push_back(values[byName[i - 1]].back()); // The same column selected twice
+                continue;
+            }
+            while (it != row.end() && it->first < name) {
+                ++it;
+            }
+            values[column].push_back(it != row.end() && it->first == name ? std::move(it->second) : std::string());
+        }
+    }
+}
+
+bool ResultSet::nextBatch(ResultBatch& batch, size_t batchSize) {
+    size_t end = std::min(rows, position + std::max<size_t>(batchSize, 1));
+    batch.columns = &columns;
+    batch.values = &values;
+    batch.first = position;
+    batch.rows = end - position;
+    position = end;
+    return batch.rows > 0;
+}
@@ -0,0 +1,20 @@
+#include "../../include/reldb/Statement.h"
+#include "../../include/database/Database.h"
+#include <utility>
+
+struct Statement::Parsed {
+    SQLParser::Query query;
+};
+
+Statement::Statement(Database& database, std::string sql)
+    : database(&database), sql(std::move(sql)), parsed(std::make_unique<Parsed>(Parsed{SQLParser::parse(this->sql)})) {}
+
+Statement::~Statement() = default;
+Statement::Statement(Statement&&) noexcept = default;
+Statement& Statement::operator=(Statement&&) noexcept = default;
+
+ResultSet Statement::execute() {
+    QueryResult result;
+    database->executePrepared(sql, parsed->query, &result);
+    return ResultSet(std::move(result));
+}
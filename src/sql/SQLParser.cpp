@@ -43,6 +43,31 @@ std::string to_upper(const std::string& str) {
     return result;
 }
 
+// Uppercase everything but quoted literals, which keep their case
+static std::string to_upper_unquoted(const std::string& str) {
+    std::string result = str;
+    char quote = 0;
+    for (char& c : result) {
+        if (quote) {
+            quote = c == quote ? 0 : quote;
+        } else if (c == '\'' || c == '"') {
+            quote = c;
+        } else {
+            c = static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+        }
+    }
+    return result;
+}
+
+// Trim a clause and drop the statement terminator ending it, if any
+static std::string strip_terminator(const std::string& clause) {
+    std::string result = SQLParser::trim(clause);
+    while (!result.empty() && result.back() == ';') {
+        result = SQLParser::trim(result.substr(0, result.size() - 1));
+    }
+    return result;
+}
+
 // Helper function to join strings with a delimiter
 std::string join(const std::vector<std::string>& tokens, const std::string& delimiter) {
     std::ostringstream result;
@@ -61,12 +86,98 @@ std::vector<std::string> acceptableConstraints = {
     "FOREIGN_KEY_REFERENCES",
 };
 
+// Values of an IN list: "( 1 , 'a, b' )" holds 1 and "a, b"
+static std::vector<std::string> parse_value_list(const std::string& list) {
+    if (list.size() < 2 || list.front() != '(' || list.back() != ')') {
+        throw std::runtime_error("Expected a parenthesized list after IN: " + list);
+    }
+    std::vector<std::string> values;
+    std::string current;
+    char quote = 0;
+    for (size_t i = 1; i + 1 < list.size(); ++i) {
+        char c = list[i];
+        if (quote) {
+            quote = c == quote ? 0 : quote;
+        } else if (c == '\'' || c == '"') {
+            quote = c;
+        } else if (c == ',') {
+            values.push_back(remove_quotes(SQLParser::trim(current)));
+            current.clear();
+            continue;
+        }
+        current += c;
+    }
+    if (!SQLParser::trim(current).empty() || !values.empty()) {
+        values.push_back(remove_quotes(SQLParser::trim(current)));
+    }
+    return values;
+}
+
+// Replace each parenthesized SELECT of a WHERE clause by "@SUBQUERYn",
+// where n is its position in 'subqueries': the SELECT as written and parsed
+static std::string extract_subqueries(const std::string& clause,
+                                      std::vector<std::pair<std::string, std::shared_ptr<SQLParser::Query>>>& subqueries) {
+    std::string result;
+    char quote = 0;
+    for (size_t i = 0; i < clause.size(); ++i) {
+        char c = clause[i];
+        if (quote) {
+            quote = c == quote ? 0 : quote;
+        } else if (c == '\'' || c == '"') {
+            quote = c;
+        } else if (c == '(') {
+            size_t start = clause.find_first_not_of(" \t\r\n", i + 1);
+            bool select = start != std::string::npos && to_upper(clause.substr(start, 6)) == "SELECT" &&
+                          (start + 6 == clause.size() || !std::isalnum(static_cast<unsigned char>(clause[start + 6])));
+            if (select) {
+                // The matching parenthesis, outside quotes
+                size_t depth = 1;
+                size_t end = i + 1;
+                char innerQuote = 0;
+                for (; end < clause.size() && depth > 0; ++end) {
+                    char d = clause[end];
+                    if (innerQuote) {
+                        innerQuote = d == innerQuote ? 0 : innerQuote;
+                    } else if (d == '\'' || d == '"') {
+                        innerQuote = d;
+                    } else if (d == '(' || d == ')') {
+                        depth += d == '(' ? 1 : -1;
+                    }
+                }
+                if (depth > 0) {
+                    throw std::runtime_error("Missing ')' after subquery: " + clause.substr(i));
+                }
+                std::string text = SQLParser::trim(clause.substr(i + 1, end - i - 2));
+                auto parsed = std::make_shared<SQLParser::Query>(SQLParser::parse(text));
+                if (parsed->operation != "SELECT" || parsed->explain) {
+                    throw std::runtime_error("A subquery must be a SELECT: " + text);
+                }
+                result += " @SUBQUERY" + std::to_string(subqueries.size()) + " ";
+                subqueries.emplace_back(text, parsed);
+                i = end - 1;
+                continue;
+            }
+        }
+        result += c;
+    }
+    return result;
+}
+
 void SQLParser::parse_conditions(const std::string& condition_str, std::vector<SQLParser::Condition>& conditions) {
     // Regex to match conditions and logical operators in sequence
-    std::regex tokenRegex(R"(([\w.]+\s*(?:[<>!=]+|\bLIKE\b|\bIN\b)\s*(?:'[^']*'|"[^"]*"|\S+)|\bAND\b|\bOR\b))", std::regex_constants::icase);
+    // An IN list is one value: everything up to the closing parenthesis.
+    // Both patterns are compiled once, as the planner parses every ON clause
+    static const std::regex tokenRegex(R"((\bNOT\s+EXISTS\s+@SUBQUERY\d+|\bEXISTS\s+@SUBQUERY\d+|[\w.]+\s+NOT\s+IN\s+@SUBQUERY\d+|[\w.]+\s+BETWEEN\s+(?:'[^']*'|"[^"]*"|\S+)\s+AND\s+(?:'[^']*'|"[^"]*"|\S+)|[\w.]+\s*(?:[<>!=]+|\bLIKE\b|\bIN\b)\s*(?:\((?:'[^']*'|"[^"]*"|[^)'"])*\)|'[^']*'|"[^"]*"|\S+)|\bAND\b|\bOR\b))", std::regex_constants::icase);
+
+    // The statement terminator is not part of the last value ("price <= 500;")
+    std::string clause = strip_terminator(condition_str);
+
+    // Each subquery is parsed on its own and stands in the clause as one word
+    std::vector<std::pair<std::string, std::shared_ptr<Query>>> subqueries;
+    clause = extract_subqueries(clause, subqueries);
 
     std::vector<std::string> tokens;
-    auto tokens_begin = std::sregex_iterator(condition_str.begin(), condition_str.end(), tokenRegex);
+    auto tokens_begin = std::sregex_iterator(clause.begin(), clause.end(), tokenRegex);
     auto tokens_end = std::sregex_iterator();
 
     // Collect tokens in order
@@ -84,18 +195,65 @@ void SQLParser::parse_conditions(const std::string& condition_str, std::vector<S
             // Update currentRelation for the next condition
             currentRelation = token_upper;
         } else {
+            // [NOT] EXISTS and NOT IN with a subquery
+            static const std::regex subqueryRegex(R"((NOT\s+EXISTS|EXISTS|([\w.]+)\s+NOT\s+IN)\s+@SUBQUERY(\d+))", std::regex_constants::icase);
+            std::smatch subquery;
+            if (std::regex_match(token, subquery, subqueryRegex)) {
+                std::string op = subquery[2].matched                      ? "NOT IN"
+                                 : to_upper(subquery.str(1)) == "EXISTS" ? "EXISTS"
+                                                                         : "NOT EXISTS";
+                const auto& [text, parsed] = subqueries.at(std::stoul(subquery.str(3)));
+                SQLParser::Condition cond;
+                cond.field = to_upper(subquery.str(2));
+                cond.op = op;
+                cond.value = text;
+                cond.relation = currentRelation;
+                cond.subquery = parsed;
+                conditions.push_back(cond);
+                currentRelation = "";
+                continue;
+            }
+
+            // X BETWEEN low AND high stays one condition, so that an OR
+            // before it applies to both bounds
+            static const std::regex betweenRegex(R"(([\w.]+)\s+BETWEEN\s+('[^']*'|"[^"]*"|\S+)\s+AND\s+('[^']*'|"[^"]*"|\S+))", std::regex_constants::icase);
+            std::smatch between;
+            if (std::regex_match(token, between, betweenRegex)) {
+                SQLParser::Condition cond;
+                cond.field = to_upper(between.str(1));
+                cond.op = "BETWEEN";
+                cond.value = between.str(2) + " AND " + between.str(3);
+                cond.relation = currentRelation;
+                cond.values = {remove_quotes(between.str(2)), remove_quotes(between.str(3))};
+                conditions.push_back(cond);
+                currentRelation = "";
+                continue;
+            }
+
             // It's a condition
             // Parse the condition using the conditionRegex
-            std::regex conditionRegex(R"(([\w.]+)\s*([<>!=]+|\bLIKE\b|\bIN\b)\s*(('[^']*'|"[^"]*"|\S+)))", std::regex_constants::icase);
+            static const std::regex conditionRegex(R"(([\w.]+)\s*([<>!=]+|\bLIKE\b|\bIN\b)\s*((\((?:'[^']*'|"[^"]*"|[^)'"])*\)|'[^']*'|"[^"]*"|\S+)))", std::regex_constants::icase);
             std::smatch match;
             if (std::regex_match(token, match, conditionRegex)) {
                 SQLParser::Condition cond;
                 cond.field = to_upper(SQLParser::trim(match.str(1)));
-                cond.op = SQLParser::trim(match.str(2));
+                cond.op = to_upper(SQLParser::trim(match.str(2)));
                 cond.value = SQLParser::trim(match.str(3));
 
-                // Remove surrounding quotes from the value if present
-                cond.value = remove_quotes(cond.value);
+                if (cond.value.rfind("@SUBQUERY", 0) == 0) {
+                    const auto& [text, parsed] = subqueries.at(std::stoul(cond.value.substr(9)));
+                    if (cond.op != "IN") {
+                        throw std::runtime_error("A subquery can only follow EXISTS or IN: " + cond.field + " " + cond.op +
+                                                 " ( " + text + " )");
+                    }
+                    cond.value = text;
+                    cond.subquery = parsed;
+                } else if (cond.op == "IN") {
+                    cond.values = parse_value_list(cond.value);
+                } else {
+                    // Remove surrounding quotes from the value if present
+                    cond.value = remove_quotes(cond.value);
+                }
 
                 // Assign the logical operator (relation) to the current condition
                 cond.relation = currentRelation;
@@ -133,20 +291,157 @@ std::map<std::string, std::string> parse_field_value_pairs(const std::string& cl
     return values;
 }
 
+// Position where the GROUP BY, ORDER BY or LIMIT clauses start in the text
+// after WHERE (outside quoted values), or npos if there are none
+static size_t find_select_tail(const std::string& clause) {
+    std::string upper = to_upper(clause);
+    char quote = 0;
+    size_t depth = 0; // Inside parentheses, such as a subquery's own tail
+    for (size_t i = 0; i < upper.size(); ++i) {
+        char c = upper[i];
+        if (quote) {
+            quote = c == quote ? 0 : quote;
+            continue;
+        }
+        if (c == '\'' || c == '"') {
+            quote = c;
+            continue;
+        }
+        if (c == '(' || c == ')') {
+            depth = c == '(' ? depth + 1 : depth - (depth > 0);
+            continue;
+        }
+        if (depth > 0 || (i > 0 && !std::isspace(static_cast<unsigned char>(upper[i - 1])))) {
+            continue;
+        }
+        std::istringstream words(upper.substr(i));
+        std::string first, second;
+        words >> first >> second;
+        if (((first == "GROUP" || first == "ORDER") && second == "BY") || first == "LIMIT") {
+            return i;
+        }
+    }
+    return std::string::npos;
+}
+
+// Parse "[GROUP BY c, ...] [ORDER BY c [ASC|DESC], ...] [LIMIT n]"
+static void parse_select_tail(const std::string& tail, SQLParser::Query& query) {
+    std::string spaced;
+    for (char c : tail) {
+        spaced += c == ',' ? std::string(" , ") : std::string(1, c);
+    }
+    std::vector<std::string> tokens;
+    std::istringstream stream(spaced);
+    std::string token;
+    while (stream >> token) {
+        token = to_upper(token);
+        if (token.size() > 1 && token.back() == ';') {
+            token.pop_back();
+        }
+        if (token != ";") {
+            tokens.push_back(token);
+        }
+    }
+
+    // A column is every token up to a comma or keyword, so "COUNT ( * )" reads as COUNT(*)
+    auto isKeyword = [](const std::string& word) {
+        return word == "GROUP" || word == "ORDER" || word == "LIMIT" || word == "ASC" || word == "DESC" || word == ",";
+    };
+    size_t i = 0;
+    auto readColumn = [&](const std::string& clause) {
+        std::string column;
+        while (i < tokens.size() && !isKeyword(tokens[i])) {
+            column += tokens[i++];
+        }
+        if (column.empty()) {
+            throw std::runtime_error("Expected a column in " + clause + ".");
+        }
+        return column;
+    };
+    auto expectBy = [&](const std::string& clause) {
+        if (++i >= tokens.size() || tokens[i++] != "BY") {
+            throw std::runtime_error("Expected 'BY' after '" + clause + "' in SELECT statement.");
+        }
+    };
+
+    int stage = 0; // Clauses must come in order: GROUP BY, ORDER BY, LIMIT
+    while (i < tokens.size()) {
+        if (tokens[i] == "GROUP" && stage < 1) {
+            expectBy("GROUP");
+            query.groupBy.push_back(readColumn("GROUP BY"));
+            while (i < tokens.size() && tokens[i] == ",") {
+                ++i;
+                query.groupBy.push_back(readColumn("GROUP BY"));
+            }
+            stage = 1;
+        } else if (tokens[i] == "ORDER" && stage < 2) {
+            expectBy("ORDER");
+            do {
+                if (!query.orderBy.empty()) {
+                    ++i;
+                }
+                SQLParser::OrderKey key;
+                key.field = readColumn("ORDER BY");
+                if (i < tokens.size() && (tokens[i] == "ASC" || tokens[i] == "DESC")) {
+                    key.descending = tokens[i++] == "DESC";
+                }
+                query.orderBy.push_back(key);
+            } while (i < tokens.size() && tokens[i] == ",");
+            stage = 2;
+        } else if (tokens[i] == "LIMIT" && stage < 3) {
+            if (++i >= tokens.size() || tokens[i].empty() ||
+                !std::all_of(tokens[i].begin(), tokens[i].end(), [](unsigned char c) { return std::isdigit(c); })) {
+                throw std::runtime_error("Expected a row count after 'LIMIT' in SELECT statement.");
+            }
+            query.limit = std::stoll(tokens[i++]);
+            stage = 3;
+        } else {
+            throw std::runtime_error("Unexpected '" + tokens[i] + "' in SELECT statement.");
+        }
+    }
+}
+
 SQLParser::Query SQLParser::parse(const std::string& sql) {
     SQLParser::Query query;
     std::istringstream stream(sql);
     std::string token;
 
-    // Get the operation (SELECT, INSERT, UPDATE, DELETE, CREATE, DROP)
+    // Get the operation (SELECT, INSERT, UPDATE, DELETE, CREATE, DROP, ANALYZE)
     stream >> token;
     token = to_upper(token);
+    if (token.size() > 1 && token.back() == ';') {
+        token.pop_back();
+    }
     query.operation = token;
 
     if (query.operation.empty()) {
         throw std::runtime_error("No operation specified in the SQL query.");
     }
 
+    if (query.operation == "EXPLAIN") {
+        // EXPLAIN [ANALYZE] <select>: parse the wrapped statement and flag it
+        std::string rest;
+        std::getline(stream, rest, '\0');
+        rest = trim(rest);
+
+        bool analyze = false;
+        std::istringstream restStream(rest);
+        std::string firstWord;
+        restStream >> firstWord;
+        if (to_upper(firstWord) == "ANALYZE") {
+            analyze = true;
+            rest = trim(rest.substr(firstWord.size()));
+        }
+
+        Query explained = parse(rest);
+        if (explained.operation != "SELECT") {
+            throw std::runtime_error("EXPLAIN supports only SELECT statements.");
+        }
+        explained.explain = true;
+        explained.explainAnalyze = analyze;
+        return explained;
+    }
+
     if (query.operation == "SELECT") {
         // Read tokens until "FROM"
         std::vector<std::string> fieldTokens;
@@ -166,7 +461,10 @@ SQLParser::Query SQLParser::parse(const std::string& sql) {
         std::string fields = join(fieldTokens, " ");
         std::istringstream fieldsStream(fields);
         while (std::getline(fieldsStream, token, ',')) {
-            query.fields.push_back(trim(token));
+            // Spaces carry no meaning inside a field: "COUNT ( * )" is COUNT(*)
+            token.erase(std::remove_if(token.begin(), token.end(), [](unsigned char c) { return std::isspace(c); }),
+                        token.end());
+            query.fields.push_back(token);
         }
 
         // Now read the table name
@@ -179,53 +477,70 @@ SQLParser::Query SQLParser::parse(const std::string& sql) {
         std::string nextToken;
         while (stream >> nextToken) {
             nextToken = to_upper(nextToken);
-            if (nextToken == "INNER") {
-                // Parse INNER JOIN
-                while (nextToken == "INNER") {
-                    Join join;
-                    stream >> nextToken;  // Should be JOIN
+            // [INNER] JOIN, or LEFT, RIGHT or FULL [OUTER] JOIN
+            auto startsJoin = [](const std::string& word) {
+                return word == "INNER" || word == "LEFT" || word == "RIGHT" || word == "FULL" || word == "JOIN";
+            };
+            while (startsJoin(nextToken)) {
+                Join join;
+                if (nextToken != "JOIN") {
+                    join.type = nextToken;
+                    stream >> nextToken;
                     nextToken = to_upper(nextToken);
-                    if (nextToken == "JOIN") {
-                        stream >> join.table;
-                        join.table = to_upper(join.table);
-
-                        stream >> nextToken;  // Should be ON
+                    if (nextToken == "OUTER" && join.type != "INNER") {
+                        stream >> nextToken;
                         nextToken = to_upper(nextToken);
-                        if (nextToken == "ON") {
-                            // Read until the next keyword (WHERE or INNER)
-                            std::string joinCondition;
-                            std::string word;
-                            while (stream >> word) {
-                                std::string upperWord = to_upper(word);
-                                if (upperWord == "WHERE" || upperWord == "INNER") {
-                                    nextToken = upperWord;
-                                    break;
-                                }
-                                joinCondition += word + " ";
-                            }
-                            join.onCondition = trim(joinCondition);
-                            join.onCondition = to_upper(join.onCondition);
-                            query.joins.push_back(join);
-                            if (nextToken != "INNER") {
-                                break;
-                            }
-                        } else {
-                            throw std::runtime_error("Expected 'ON' after 'INNER JOIN' in SELECT statement.");
-                        }
-                    } else {
-                        throw std::runtime_error("Expected 'JOIN' after 'INNER' in SELECT statement.");
                     }
                 }
+                if (nextToken != "JOIN") {
+                    throw std::runtime_error("Expected 'JOIN' after '" + join.type + "' in SELECT statement.");
+                }
+                stream >> join.table;
+                join.table = to_upper(join.table);
+
+                stream >> nextToken;  // Should be ON
+                nextToken = to_upper(nextToken);
+                if (nextToken != "ON") {
+                    throw std::runtime_error("Expected 'ON' after '" + join.type + " JOIN' in SELECT statement.");
+                }
+                // Read until the next keyword (WHERE, another join or the tail)
+                std::string joinCondition;
+                std::string word;
+                nextToken.clear();
+                while (stream >> word) {
+                    std::string upperWord = to_upper(word);
+                    if (upperWord == "WHERE" || startsJoin(upperWord) || upperWord == "GROUP" ||
+                        upperWord == "ORDER" || upperWord == "LIMIT") {
+                        nextToken = upperWord;
+                        break;
+                    }
+                    joinCondition += word + " ";
+                }
+                // An ON clause ending the statement does not keep its ';'
+                join.onCondition = to_upper_unquoted(strip_terminator(joinCondition));
+                query.joins.push_back(join);
             }
 
             if (nextToken == "WHERE") {
                 std::string condition;
-                std::getline(stream, condition);  // get the rest of the line as condition
+                std::getline(stream, condition, '\0');  // the rest of the statement
+                size_t tailPos = find_select_tail(condition);
+                if (tailPos != std::string::npos) {
+                    parse_select_tail(condition.substr(tailPos), query);
+                    condition = condition.substr(0, tailPos);
+                }
                 parse_conditions(condition, query.conditions);
                 for(Condition &c : query.conditions){
                     c.field = to_upper(c.field);
                 }
-                break; // Assuming WHERE is the last clause
+                break;
+            }
+
+            if (nextToken == "GROUP" || nextToken == "ORDER" || nextToken == "LIMIT") {
+                std::string rest;
+                std::getline(stream, rest, '\0');
+                parse_select_tail(nextToken + " " + rest, query);
+                break;
             }
         }
     }
@@ -395,6 +710,15 @@ SQLParser::Query SQLParser::parse(const std::string& sql) {
                         colDef.referencedTable = to_upper(referenceStr.substr(0, dotPos));
                         colDef.referencedColumn = to_upper(referenceStr.substr(dotPos + 1));
                         colDef.constraints.push_back("FOREIGN_KEY_REFERENCES");
+                    } else if (constraintToken == "ON_DELETE_CASCADE" || constraintToken == "ON_UPDATE_CASCADE") {
+                        if (colDef.referencedTable.empty()) {
+                            throw std::runtime_error(constraintToken + " must follow FOREIGN_KEY_REFERENCES.");
+                        }
+                        if (constraintToken == "ON_DELETE_CASCADE") {
+                            colDef.onDeleteCascade = true;
+                        } else {
+                            colDef.onUpdateCascade = true;
+                        }
                     } else {
                         throw std::runtime_error("Invalid constraint: " + constraintToken);
                     }
@@ -402,19 +726,102 @@ SQLParser::Query SQLParser::parse(const std::string& sql) {
 
                 query.columns.push_back(colDef);
             }
+        } else if (token == "INDEX") {
+            // CREATE INDEX name ON table ( column ) USING method
+            std::string definition;
+            std::getline(stream, definition, ';');
+            static const std::regex indexRegex(R"(^\s*(\w+)\s+ON\s+(\w+)\s*\(\s*(\w+)\s*\)\s*USING\s+(\w+)\s*$)",
+                                               std::regex::icase);
+            std::smatch match;
+            if (!std::regex_match(definition, match, indexRegex)) {
+                throw std::runtime_error("Invalid CREATE INDEX statement. Expected CREATE INDEX name ON table (column) USING TRIGRAM.");
+            }
+            query.indexName = to_upper(match[1]);
+            query.table = to_upper(match[2]);
+            query.fields.push_back(to_upper(match[3]));
+            query.indexMethod = to_upper(match[4]);
+            if (query.indexMethod != "TRIGRAM") {
+                throw std::runtime_error("Unsupported index method: " + query.indexMethod);
+            }
+        } else if (token == "MATERIALIZED") {
+            // CREATE MATERIALIZED VIEW name AS SELECT ...
+            std::string keyword;
+            stream >> keyword;
+            if (to_upper(keyword) != "VIEW") {
+                throw std::runtime_error("Expected 'VIEW' keyword after 'MATERIALIZED'.");
+            }
+            if (!(stream >> query.table)) {
+                throw std::runtime_error("No view specified in CREATE MATERIALIZED VIEW statement.");
+            }
+            query.table = to_upper(query.table);
+            stream >> keyword;
+            if (to_upper(keyword) != "AS") {
+                throw std::runtime_error("Expected 'AS' after the view name.");
+            }
+            std::getline(stream, query.viewQuery, '\0');
+            query.viewQuery = trim(query.viewQuery);
+            if (parse(query.viewQuery).operation != "SELECT") {
+                throw std::runtime_error("A materialized view must be defined by a SELECT statement.");
+            }
+            query.materializedView = true;
         } else {
-            throw std::runtime_error("Expected 'TABLE' keyword after 'CREATE'.");
+            throw std::runtime_error("Expected 'TABLE', 'INDEX' or 'MATERIALIZED' keyword after 'CREATE'.");
+        }
+    }else if (query.operation == "ANALYZE") {
+        // ANALYZE [table]: without a table every table is analyzed
+        if (stream >> query.table) {
+            if (query.table.back() == ';') {
+                query.table.pop_back();
+            }
+            query.table = to_upper(query.table);
+        }
+    }else if (query.operation == "REFRESH") {
+        // REFRESH MATERIALIZED VIEW name
+        std::string keyword;
+        stream >> token >> keyword;
+        if (to_upper(token) != "MATERIALIZED" || to_upper(keyword) != "VIEW") {
+            throw std::runtime_error("Expected 'MATERIALIZED VIEW' after 'REFRESH'.");
+        }
+        if (!(stream >> query.table)) {
+            throw std::runtime_error("No view specified in REFRESH MATERIALIZED VIEW statement.");
+        }
+        if (query.table.back() == ';') {
+            query.table.pop_back();
         }
+        query.table = to_upper(query.table);
+        query.materializedView = true;
     }else if (query.operation == "DROP") {
         stream >> token; // Should be TABLE
         token = to_upper(token);
-        if (token == "TABLE") {
+        if (token == "MATERIALIZED") {
+            // DROP MATERIALIZED VIEW name
+            stream >> token;
+            if (to_upper(token) != "VIEW") {
+                throw std::runtime_error("Expected 'VIEW' keyword after 'MATERIALIZED'.");
+            }
+            if (!(stream >> query.table)) {
+                throw std::runtime_error("No view specified in DROP MATERIALIZED VIEW statement.");
+            }
+            if (query.table.back() == ';') {
+                query.table.pop_back();
+            }
+            query.table = to_upper(query.table);
+            query.materializedView = true;
+        } else if (token == "TABLE") {
             if (!(stream >> query.table)) {
                 throw std::runtime_error("No table specified in DROP TABLE statement.");
             }
             query.table = to_upper(query.table);
+        } else if (token == "INDEX") {
+            if (!(stream >> query.indexName)) {
+                throw std::runtime_error("No index specified in DROP INDEX statement.");
+            }
+            if (query.indexName.back() == ';') {
+                query.indexName.pop_back();
+            }
+            query.indexName = to_upper(query.indexName);
         } else {
-            throw std::runtime_error("Expected 'TABLE' keyword in DROP statement.");
+            throw std::runtime_error("Expected 'TABLE', 'INDEX' or 'MATERIALIZED VIEW' in DROP statement.");
         }
     }
     else {